@@ -63,6 +63,12 @@ private:
 public:
     void init(int32_t num_threshold_, double hash_table_alpha);
     void destroy();
+    /**
+     * @brief Replace the content by that of `other`, initialized with the
+     * same threshold and load factor
+     *
+     */
+    void copyFrom(const StreamSummary &other);
     void emplace(FlowKey<key_len> key, T val);
     void insert(FlowKey<key_len> key, T val);
     void erase(hash_table_elem<key_len, T, hash_t>* h);
@@ -129,6 +135,38 @@ void StreamSummary<key_len, T, hash_t>::destroy(){
   delete bucket_list_tail;
 }
 
+template <int32_t key_len, typename T, typename hash_t>
+void StreamSummary<key_len, T, hash_t>::copyFrom(const StreamSummary &other){
+  for(int i = 0; i < hash_table_length; i++)
+  {
+    hash_table_elem<key_len, T, hash_t>* ptr = hash_table[i];
+    while(ptr != NULL)
+    {
+      hash_table_elem<key_len, T, hash_t>* tmp = ptr;
+      ptr = ptr->next_hash_elem;
+      delete tmp;
+    }
+    hash_table[i] = NULL;
+  }
+  while(bucket_list_head->next != bucket_list_tail)
+  {
+    delete_bucket(bucket_list_head->next);
+  }
+  size_ = 0;
+  hash_func = other.hash_func;
+  // from the largest value down, so that each flow lands in the first bucket
+  for(bucket_list_elem<key_len, T, hash_t>* b = other.bucket_list_tail->prev;
+      b != other.bucket_list_head; b = b->prev)
+  {
+    hash_table_elem<key_len, T, hash_t>* h = b->child;
+    do
+    {
+      emplace(h->first, h->second);
+      h = h->next;
+    } while(h != b->child);
+  }
+}
+
 template <int32_t key_len, typename T, typename hash_t>
 void StreamSummary<key_len, T, hash_t>::insert(FlowKey<key_len> key, T val){
   hash_table_elem<key_len, T, hash_t>* h = find(key);
@@ -0,0 +1,134 @@
+/**
+ * @file arena.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief An arena of power-of-2 sized slabs
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace OmniSketch::Util {
+
+/**
+ * @brief An arena of power-of-2 sized slabs
+ *
+ * @details Slabs of `2^bits` objects are carved out of large chunks, and a
+ * released slab is kept on a free list of its size to serve the next request
+ * of the same size. Containers that grow by doubling (e.g., small hash
+ * tables) thus stop allocating once they have warmed up, and the memory held
+ * is known at any time.
+ *
+ * @tparam T  type of the object, default-constructible and copy-assignable
+ */
+template <typename T> class SlabArena {
+private:
+  static constexpr int32_t chunk_bits = 16;
+  static constexpr int32_t max_bits = 48;
+
+  std::vector<T *> chunks;
+  std::vector<T *> pool[max_bits];
+  T *cur;
+  size_t left;
+  size_t reserved; // objects in chunks
+  size_t used;     // objects in live slabs
+
+  SlabArena(const SlabArena &) = delete;
+  SlabArena(SlabArena &&) = delete;
+
+public:
+  SlabArena() : cur(nullptr), left(0), reserved(0), used(0) {}
+  /**
+   * @brief Release all chunks
+   *
+   */
+  ~SlabArena() { reset(); }
+  /**
+   * @brief Get a slab of `2^bits` objects, all reset to `T()`
+   *
+   */
+  T *allocate(int32_t bits);
+  /**
+   * @brief Return a slab obtained by `allocate(bits)`
+   *
+   */
+  void release(T *slab, int32_t bits) {
+    pool[bits].push_back(slab);
+    used -= size_t(1) << bits;
+  }
+  /**
+   * @brief Release all chunks, invalidating every slab
+   *
+   */
+  void reset();
+  /**
+   * @brief Bytes of the slabs in use
+   *
+   */
+  size_t bytesUsed() const { return used * sizeof(T); }
+  /**
+   * @brief Bytes held from the system
+   *
+   */
+  size_t bytesReserved() const { return reserved * sizeof(T); }
+};
+
+} // namespace OmniSketch::Util
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Util {
+
+template <typename T> T *SlabArena<T>::allocate(int32_t bits) {
+  const size_t n = size_t(1) << bits;
+  T *slab;
+  if (!pool[bits].empty()) {
+    slab = pool[bits].back();
+    pool[bits].pop_back();
+  } else if (bits >= chunk_bits) { // a chunk of its own
+    slab = new T[n];
+    chunks.push_back(slab);
+    reserved += n;
+  } else {
+    if (left < n) {
+      // the tail of the chunk is a sum of powers of 2, so nothing is wasted
+      for (int32_t b = 0; left; ++b) {
+        if (left & (size_t(1) << b)) {
+          pool[b].push_back(cur);
+          cur += size_t(1) << b;
+          left ^= size_t(1) << b;
+        }
+      }
+      cur = new T[size_t(1) << chunk_bits];
+      chunks.push_back(cur);
+      left = size_t(1) << chunk_bits;
+      reserved += left;
+    }
+    slab = cur;
+    cur += n;
+    left -= n;
+  }
+  std::fill(slab, slab + n, T());
+  used += n;
+  return slab;
+}
+
+template <typename T> void SlabArena<T>::reset() {
+  for (T *chunk : chunks)
+    delete[] chunk;
+  chunks.clear();
+  for (auto &slabs : pool)
+    slabs.clear();
+  cur = nullptr;
+  left = reserved = used = 0;
+}
+
+} // namespace OmniSketch::Util
@@ -0,0 +1,218 @@
+/**
+ * @file blocked.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Cache-line-blocked narrow counters
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "utils.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+namespace OmniSketch::Sketch {
+
+/**
+ * @brief Counters of a `depth`-row sketch packed into 64-byte blocks
+ *
+ * @details A hash value selects one block, and the counter of each row is a
+ * narrow sub-counter inside that block, so that an update or a query touches
+ * a single cache line. The block is split evenly into `depth` rows, and the
+ * offset within each row (and an optional sign, as in Count Sketch) is drawn
+ * from other bits of the same hash value.
+ *
+ * A sub-counter that leaves the range of `narrow_t` escalates: it sticks to
+ * the boundary value and the excess is kept in a sparse table of `T`, which
+ * is only visited for these saturated counters.
+ *
+ * @tparam T        type of the counter
+ * @tparam narrow_t type of the sub-counter in a block (signed integral)
+ */
+template <typename T, typename narrow_t> class BlockedCounter {
+  static_assert(std::is_integral_v<narrow_t> && std::is_signed_v<narrow_t>,
+                "Sub-counter must be signed integral");
+
+public:
+  /**
+   * @brief Bytes per block
+   *
+   */
+  static constexpr int32_t block_size = 64;
+  /**
+   * @brief Sub-counters per block
+   *
+   */
+  static constexpr int32_t slots = block_size / sizeof(narrow_t);
+
+private:
+  static constexpr narrow_t lo = std::numeric_limits<narrow_t>::min();
+  static constexpr narrow_t hi = std::numeric_limits<narrow_t>::max();
+
+  int32_t depth;
+  int32_t num_blocks;
+  int32_t per_row;  // sub-counters of a row in a block
+  int32_t row_bits; // hash bits spent on locating a row in a block
+  bool with_sign;
+  narrow_t *blocks;
+  std::unordered_map<size_t, T> overflow;
+
+  BlockedCounter(const BlockedCounter &) = delete;
+  BlockedCounter(BlockedCounter &&) = delete;
+
+public:
+  /**
+   * @brief Construct by specifying the number of rows and blocks
+   *
+   * @param depth       number of rows, at most `slots`
+   * @param num_blocks  number of 64-byte blocks
+   * @param with_sign   whether a random sign is drawn for each row
+   *
+   * @warning An exception is thrown if 32 bits of the hash value are not enough
+   * to locate `depth` rows.
+   */
+  BlockedCounter(int32_t depth, int32_t num_blocks, bool with_sign);
+  /**
+   * @brief Release the blocks
+   *
+   */
+  ~BlockedCounter() { std::free(blocks); }
+  /**
+   * @brief Locate the sub-counter of each row
+   *
+   * @param hash    hash value of the flowkey
+   * @param index   `depth` indices of sub-counters, one per row
+   * @param sign    `depth` signs in {-1, +1}, only filled if constructed with
+   * signs
+   */
+  void locate(uint64_t hash, size_t *index, int32_t *sign = nullptr) const;
+  /**
+   * @brief Value of a sub-counter
+   *
+   */
+  T get(size_t index) const {
+    const narrow_t val = blocks[index];
+    if (val != lo && val != hi)
+      return val;
+    auto it = overflow.find(index);
+    return it == overflow.end() ? val : val + it->second;
+  }
+  /**
+   * @brief Set a sub-counter, escalating it if necessary
+   *
+   */
+  void set(size_t index, T val) {
+    if (val > lo && val < hi) {
+      if (blocks[index] == lo || blocks[index] == hi)
+        overflow.erase(index);
+      blocks[index] = static_cast<narrow_t>(val);
+    } else {
+      const narrow_t bound = val > 0 ? hi : lo;
+      blocks[index] = bound;
+      overflow[index] = val - bound;
+    }
+  }
+  /**
+   * @brief Add to a sub-counter
+   *
+   */
+  void add(size_t index, T val) { set(index, get(index) + val); }
+  /**
+   * @brief Number of rows
+   *
+   */
+  int32_t getDepth() const { return depth; }
+  /**
+   * @brief Number of escalated sub-counters
+   *
+   */
+  size_t getOverflowNum() const { return overflow.size(); }
+  /**
+   * @brief Size of blocks and escalated counters
+   *
+   */
+  size_t size() const {
+    return static_cast<size_t>(block_size) * num_blocks +
+           (sizeof(size_t) + sizeof(T)) * overflow.size();
+  }
+  /**
+   * @brief Reset all sub-counters
+   *
+   */
+  void clear() {
+    std::memset(blocks, 0, static_cast<size_t>(block_size) * num_blocks);
+    overflow.clear();
+  }
+};
+
+} // namespace OmniSketch::Sketch
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Sketch {
+
+template <typename T, typename narrow_t>
+BlockedCounter<T, narrow_t>::BlockedCounter(int32_t depth, int32_t num_blocks,
+                                            bool with_sign)
+    : depth(depth), num_blocks(num_blocks), with_sign(with_sign) {
+  if (depth <= 0 || depth > slots) {
+    throw std::invalid_argument(
+        "Invalid Argument: A block holds at most " + std::to_string(slots) +
+        " rows, but got depth = " + std::to_string(depth) + " instead.");
+  }
+  if (num_blocks <= 0) {
+    throw std::invalid_argument(
+        "Invalid Argument: #blocks should be positive, but got " +
+        std::to_string(num_blocks) + " instead.");
+  }
+  per_row = slots / depth;
+  // 32 bits are split evenly among rows
+  row_bits = 32 / depth - with_sign;
+  if (row_bits < 0 || (1LL << row_bits) < per_row) {
+    throw std::invalid_argument(
+        "Invalid Argument: Not enough hash bits to locate " +
+        std::to_string(depth) + " rows in a block, use a wider sub-counter.");
+  }
+  blocks = static_cast<narrow_t *>(
+      std::aligned_alloc(block_size, static_cast<size_t>(block_size) * num_blocks));
+  if (!blocks)
+    throw std::bad_alloc();
+  clear();
+}
+
+template <typename T, typename narrow_t>
+void BlockedCounter<T, narrow_t>::locate(uint64_t hash, size_t *index,
+                                         int32_t *sign) const {
+  const uint64_t h = Util::Mix64(hash);
+  const size_t base =
+      static_cast<size_t>(((h >> 32) * static_cast<uint64_t>(num_blocks)) >>
+                          32) *
+      slots;
+  uint64_t bits = static_cast<uint32_t>(h);
+  const uint64_t mask = (1ULL << row_bits) - 1;
+  for (int32_t i = 0; i < depth; ++i) {
+    // map row_bits bits to [0, per_row) by multiply-shift
+    const uint64_t offset = ((bits & mask) * per_row) >> row_bits;
+    index[i] = base + i * per_row + offset;
+    bits >>= row_bits;
+    if (with_sign) {
+      if (sign)
+        sign[i] = static_cast<int32_t>(bits & 1) * 2 - 1;
+      bits >>= 1;
+    }
+  }
+}
+
+} // namespace OmniSketch::Sketch
@@ -0,0 +1,134 @@
+/**
+ * @file bucket.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Cache-line-packed buckets with fingerprints
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/simd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace OmniSketch::Util {
+
+/**
+ * @brief 8-bit fingerprint of a hash value
+ * @details Taken from the top byte, so that it is independent of the bucket
+ * index drawn from the low bits. `0` is reserved for empty entries.
+ *
+ */
+inline uint8_t Fingerprint(uint64_t hash) {
+  const uint8_t fp = static_cast<uint8_t>(hash >> 56);
+  return fp ? fp : 1;
+}
+
+/**
+ * @brief Buckets each holding fingerprints and values in one block
+ *
+ * @details Every bucket is a block of `num_fps` fingerprints followed by
+ * `num_vals` values of type `T`. Blocks are sized to a power of two no
+ * smaller than 16 bytes (or a multiple of 64 bytes if larger than a cache
+ * line) and the whole array is 64-byte aligned, so a bucket of up to 64 bytes
+ * never straddles cache lines. Flowkeys are kept elsewhere by the sketch and
+ * only read on a fingerprint hit.
+ *
+ * Fingerprints are zero-initialized, i.e., all entries are empty.
+ *
+ * @tparam T  type of the value
+ */
+template <typename T> class PackedBuckets {
+private:
+  int32_t num_buckets;
+  int32_t num_fps;
+  int32_t num_vals;
+  size_t fp_bytes;
+  size_t stride;
+  uint8_t *data;
+
+  PackedBuckets(const PackedBuckets &) = delete;
+  PackedBuckets(PackedBuckets &&) = delete;
+
+public:
+  /**
+   * @brief Construct by specifying the number of buckets and their contents
+   *
+   */
+  PackedBuckets(int32_t num_buckets, int32_t num_fps, int32_t num_vals);
+  /**
+   * @brief Release the block
+   *
+   */
+  ~PackedBuckets() { std::free(data); }
+  /**
+   * @brief Fingerprints of the `i`-th bucket
+   * @details Readable up to `FingerprintStride(num_fps)` bytes, as is required
+   * by FindFingerprint().
+   *
+   */
+  uint8_t *fp(int32_t i) const { return data + i * stride; }
+  /**
+   * @brief Values of the `i`-th bucket
+   *
+   */
+  T *val(int32_t i) const {
+    return reinterpret_cast<T *>(data + i * stride + fp_bytes);
+  }
+  /**
+   * @brief Empty all buckets and zero all values
+   *
+   */
+  void clear() { std::memset(data, 0, stride * num_buckets); }
+  /**
+   * @brief Copy all buckets of `other`, which is of the same shape
+   *
+   */
+  void copyFrom(const PackedBuckets &other) {
+    std::memcpy(data, other.data, stride * num_buckets);
+  }
+  /**
+   * @brief Bytes allocated, including paddings
+   *
+   */
+  size_t size() const { return stride * num_buckets; }
+};
+
+} // namespace OmniSketch::Util
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Util {
+
+template <typename T>
+PackedBuckets<T>::PackedBuckets(int32_t num_buckets, int32_t num_fps,
+                                int32_t num_vals)
+    : num_buckets(num_buckets), num_fps(num_fps), num_vals(num_vals) {
+  constexpr size_t align = alignof(T) > 8 ? alignof(T) : 8;
+  fp_bytes = (num_fps + align - 1) / align * align;
+  size_t need = fp_bytes + sizeof(T) * num_vals;
+  // fingerprints are loaded 16 bytes at a time
+  need = std::max(need, static_cast<size_t>(FingerprintStride(num_fps)));
+  if (need > 64) {
+    stride = (need + 63) & ~static_cast<size_t>(63);
+  } else {
+    stride = 16;
+    while (stride < need)
+      stride <<= 1;
+  }
+  const size_t bytes = (size() + 63) & ~static_cast<size_t>(63);
+  data = static_cast<uint8_t *>(std::aligned_alloc(64, bytes));
+  if (!data)
+    throw std::bad_alloc();
+  clear();
+}
+
+} // namespace OmniSketch::Util
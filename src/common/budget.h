@@ -0,0 +1,107 @@
+/**
+ * @file budget.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Sizing sketches by a memory budget
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Sizing sketches by a memory budget
+ *
+ * @details Instead of a width, the `.para` node of a test may give a budget,
+ * e.g., `memory = "1.5MB"`. A sketch that supports it provides a static
+ * solver, typically `solveWidth()`, which returns the largest width whose
+ * sketch has a size() within the budget. The solvers compute the size from
+ * the parameters alone, since building a sketch to measure it would not only
+ * be slow but also consume hash seeds.
+ *
+ */
+namespace OmniSketch::Util {
+
+/**
+ * @brief Parse a memory size such as `"1.5MB"`, `"512kB"` or `"65536"`
+ * @details Units are `B`, `kB`, `MB` and `GB` in powers of 1024, as shown by
+ * TestBase::show(), and are case-insensitive. A number without a unit is in
+ * bytes. The result is rounded down to a whole byte.
+ *
+ * @warning An exception is thrown on a malformed or non-positive size.
+ */
+inline size_t ParseMemory(const std::string_view str) {
+  const std::string text(str);
+  const char *begin = text.c_str();
+  char *end = nullptr;
+  const double num = std::strtod(begin, &end);
+
+  std::string unit;
+  for (const char *ptr = end; *ptr; ++ptr) {
+    if (!std::isspace(static_cast<unsigned char>(*ptr)))
+      unit += std::toupper(static_cast<unsigned char>(*ptr));
+  }
+  double scale = 0.0;
+  if (unit.empty() || unit == "B")
+    scale = 1.0;
+  else if (unit == "KB")
+    scale = 1024.0;
+  else if (unit == "MB")
+    scale = 1024.0 * 1024.0;
+  else if (unit == "GB")
+    scale = 1024.0 * 1024.0 * 1024.0;
+
+  const double bytes = std::floor(num * scale);
+  if (end == begin || scale == 0.0 || !std::isfinite(bytes) || bytes < 1.0) {
+    throw std::invalid_argument("Invalid Argument: Memory should be a positive "
+                                "size like \"1.5MB\", but got \"" +
+                                text + "\".");
+  }
+  return static_cast<size_t>(bytes);
+}
+
+/**
+ * @brief Size of a sketch that cannot be built, e.g., whose counters would
+ * overflow their indices, so that it fits no budget
+ *
+ */
+constexpr size_t kNoFit = std::numeric_limits<size_t>::max();
+
+/**
+ * @brief Largest `x` in `[1, hi]` such that `size_of(x) <= budget`
+ * @details `size_of` should be non-decreasing, which holds for a size
+ * against a width, even if the width is rounded (e.g., to a prime) first.
+ * It may return #kNoFit for widths too large to be built. It is evaluated
+ * `O(log hi)` times.
+ *
+ * @warning An exception is thrown if the budget is below `size_of(1)`.
+ */
+template <typename F>
+int32_t SolveBudget(const size_t budget, F &&size_of,
+                    const int32_t hi = 1 << 30) {
+  if (size_of(1) > budget) {
+    throw std::invalid_argument(
+        "Invalid Argument: Memory of " + std::to_string(budget) +
+        " bytes is too small, since the smallest sketch takes " +
+        std::to_string(size_of(1)) + " bytes.");
+  }
+  int32_t lo = 1, up = hi;
+  while (lo < up) {
+    const int32_t mid = lo + (up - lo + 1) / 2;
+    if (size_of(mid) <= budget)
+      lo = mid;
+    else
+      up = mid - 1;
+  }
+  return lo;
+}
+
+} // namespace OmniSketch::Util
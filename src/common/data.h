@@ -16,6 +16,10 @@
 #include <boost/bimap/vector_of.hpp>
 #include <filesystem>
 #include <fmt/core.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
 
 /**
  * @brief Miscellaneous tools for processing data.
@@ -38,6 +42,20 @@ enum HXMethod {
   TopK /** Top K flow(s) */,
   Percentile /** Flows that exceed a certain fraction of all counters */
 };
+/**
+ * @brief Whether tests in the same process share data
+ *
+ * @details Off by default. Once turned on, StreamData reads a file in a given
+ * format only once and keeps the records for the rest of the process, and
+ * GndTruth::getGroundTruth() computes the flow summary of such records only
+ * once per range and counting method. Meant for drivers that run many tests in
+ * a row, e.g., `omnisketch`.
+ *
+ */
+inline bool &ShareData() {
+  static bool share = false;
+  return share;
+}
 
 /**
  * @brief Struct of a single record (i.e., a packet in a segment of streaming
@@ -106,6 +124,15 @@ public:
    *
    */
   [[nodiscard]] int32_t getKeyLength() const { return length[KEYLEN]; }
+  /**
+   * @brief Whether two formats read a record the same way
+   *
+   */
+  bool operator==(const DataFormat &other) const {
+    return std::equal(offset, offset + ENDALL, other.offset) &&
+           std::equal(length, length + ENDALL, other.length) &&
+           total == other.total;
+  }
   /**
    * @brief Construct by specifications in config file
    *
@@ -157,14 +184,32 @@ template <int32_t key_len> class StreamData {
   using Stream = std::vector<Record<key_len>>;
   /**
    * @brief Store a row of records in order
+   * @details Possibly shared with other instances, see ShareData().
    *
    */
-  Stream records;
+  std::shared_ptr<const Stream> records;
   /**
    * @brief Whether the data is parsed successfully
    *
    */
   bool is_parsed;
+  /**
+   * @brief Records kept for the rest of the process, along with file names and
+   * formats
+   *
+   */
+  static std::vector<
+      std::tuple<std::string, DataFormat, std::shared_ptr<const Stream>>> &
+  loaded() {
+    static std::vector<
+        std::tuple<std::string, DataFormat, std::shared_ptr<const Stream>>>
+        streams;
+    return streams;
+  }
+  static std::mutex &loadedMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
 
 public:
   /**
@@ -188,18 +233,25 @@ public:
    *
    * @return `true` if not empty. `false` otherwise.
    */
-  [[nodiscard]] bool empty() const { return records.empty(); }
+  [[nodiscard]] bool empty() const { return records->empty(); }
   /**
    * @brief Return the number of records in StreamData
    */
-  [[nodiscard]] size_t size() const { return records.size(); }
+  [[nodiscard]] size_t size() const { return records->size(); }
+  /**
+   * @brief Whether a record belongs to records kept for the rest of the
+   * process
+   * @details Such records never move, so their addresses identify them.
+   *
+   */
+  static bool isKept(const Record<key_len> *record);
   /**
    * @brief Return an iterator pointed to the very first record
    *
    * @return A random access iterator
    */
   [[nodiscard]] typename Stream::const_iterator begin() const {
-    return records.cbegin();
+    return records->cbegin();
   }
   /**
    * @brief Return an iterator pointed to the one after the very last record (in
@@ -208,7 +260,7 @@ public:
    * @return A random access iterator
    */
   [[nodiscard]] typename Stream::const_iterator end() const {
-    return records.cend();
+    return records->cend();
   }
   /**
    * @brief Return an iterator pointed to the record at given offset
@@ -219,12 +271,12 @@ public:
    * @note If the index is out of range, an exception would be thrown.
    */
   [[nodiscard]] typename Stream::const_iterator diff(size_t offset) const {
-    if (offset > records.size()) {
+    if (offset > records->size()) {
       throw std::out_of_range("Index Out Of Range: Expected to be in [0, " +
-                              std::to_string(records.size()) + "], but got " +
+                              std::to_string(records->size()) + "], but got " +
                               std::to_string(offset) + " instead.");
     }
-    return records.cbegin() + offset;
+    return records->cbegin() + offset;
   }
 };
 
@@ -339,6 +391,22 @@ protected:
   int64_t called = 0;
 
 private:
+  /**
+   * @brief Flow summaries of records kept by StreamData, indexed by the first
+   * record, the number of records and the counting method
+   * @see ShareData()
+   *
+   */
+  using SummaryKey = std::tuple<const Record<key_len> *, size_t, int32_t>;
+  static std::map<SummaryKey, std::shared_ptr<const GndTruth>> &summaries() {
+    static std::map<SummaryKey, std::shared_ptr<const GndTruth>> cache;
+    return cache;
+  }
+  static std::mutex &summariesMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
   /**
    * @brief Absolute difference between two flow summaries
    * @details Order of the right view is kept in descending order. Besides,
@@ -758,9 +826,25 @@ const int8_t *DataFormat::writeAsFormat(const Record<key_len> &record,
 
 template <int32_t key_len>
 StreamData<key_len>::StreamData(const std::string_view file_name,
-                                const DataFormat &format) {
+                                const DataFormat &format)
+    : records(std::make_shared<const Stream>()) {
   // records are always empty
 
+  // concurrent tests wait for the one loading the same file
+  const bool share = ShareData();
+  std::unique_lock<std::mutex> lock(loadedMutex(), std::defer_lock);
+  if (share) {
+    lock.lock();
+    for (const auto &[name, kept_format, stream] : loaded()) {
+      if (name == file_name && kept_format == format) {
+        LOG(VERBOSE, fmt::format("Reusing records from {}.", file_name));
+        records = stream;
+        is_parsed = true;
+        return;
+      }
+    }
+  }
+
   LOG(VERBOSE, "Preparing test data...");
   // open files
   LOG(INFO, fmt::format("Loading records from {}...", file_name));
@@ -785,15 +869,33 @@ StreamData<key_len>::StreamData(const std::string_view file_name,
   // read records in turn
   int8_t buf[size];
   Record<key_len> record;
+  Stream stream;
+  stream.reserve(file_size / size);
   while (fin.read((char *)&buf, size)) {
     format.readAsFormat(record, buf);
-    records.emplace_back(std::move(record));
+    stream.emplace_back(std::move(record));
   }
+  records = std::make_shared<const Stream>(std::move(stream));
   LOG(VERBOSE, "Records Loaded.");
   is_parsed = true;
+
+  if (share)
+    loaded().emplace_back(std::string(file_name), format, records);
   return; // fin automatically closed
 }
 
+template <int32_t key_len>
+bool StreamData<key_len>::isKept(const Record<key_len> *record) {
+  std::lock_guard<std::mutex> lock(loadedMutex());
+  for (const auto &kept : loaded()) {
+    const Stream &stream = *std::get<2>(kept);
+    if (!stream.empty() && record >= stream.data() &&
+        record < stream.data() + stream.size())
+      return true;
+  }
+  return false;
+}
+
 #define CHECK_CALLED_ONCE                                                      \
   called++;                                                                    \
   if (called > 1) {                                                            \
@@ -900,6 +1002,20 @@ void GndTruth<key_len, T>::getGroundTruth(
     CntMethod cnt_method) {
   CHECK_CALLED_ONCE;
 
+  // records kept by StreamData are summarized once
+  const bool memoize =
+      ShareData() && begin != end && StreamData<key_len>::isKept(&*begin);
+  const SummaryKey key(memoize ? &*begin : nullptr, end - begin, cnt_method);
+  if (memoize) {
+    std::lock_guard<std::mutex> lock(summariesMutex());
+    auto iter = summaries().find(key);
+    if (iter != summaries().end()) {
+      my_map = iter->second->my_map;
+      tot_value = iter->second->tot_value;
+      return;
+    }
+  }
+
   bool spurious_len = false, overflow = false;
 
   for (auto ptr = begin; ptr != end; ptr++) {
@@ -939,6 +1055,14 @@ void GndTruth<key_len, T>::getGroundTruth(
 
   // sort the vector in descending order
   my_map.right.sort(std::greater<T>());
+
+  if (memoize) {
+    auto summary = std::make_shared<GndTruth>();
+    summary->my_map = my_map;
+    summary->tot_value = tot_value;
+    std::lock_guard<std::mutex> lock(summariesMutex());
+    summaries().emplace(key, std::move(summary));
+  }
 }
 
 template <int32_t key_len, typename T>
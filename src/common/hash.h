@@ -176,10 +176,20 @@ public:
    * @brief Construct an AwareHash instance
    *
    * @details Seeds are internally mangled and hashed so that fewer
-   * hash collisions are expected.
+   * hash collisions are expected. They are drawn from a generator local to
+   * the calling thread, so a thread constructs the same sequence of hashing
+   * classes whatever other threads do. `AwareHash(1)` constructs nothing
+   * usable but restarts that sequence at a fixed point.
    *
    */
   AwareHash(int32_t reset = 0);
+  /**
+   * @brief Restart the seeds of the calling thread as in a fresh process
+   * @details Called before each run of a sweep, so that a run gets the
+   * hashing classes it would get alone, on whichever thread it lands.
+   *
+   */
+  static void reseed();
 };
 
 } // namespace OmniSketch::Hash
\ No newline at end of file
@@ -9,6 +9,7 @@
 #pragma once
 
 #include "hash.h"
+#include "stats.h"
 #include "utils.h"
 
 #include <coin/OsiClpSolverInterface.hpp>
@@ -18,12 +19,14 @@
 #include <Eigen/IterativeLinearSolvers>
 #include <Eigen/SparseCore>
 #include <boost/dynamic_bitset.hpp>
+#include <cmath>
 #include <map>
 
 #define RECORD_ACCESS_TIME
 #define TEST_DECODE_TIME
 #define SKIP_HASH
 // #define USE_CLP
+// #define ENABLE_ORACLE
 
 namespace OmniSketch::Sketch {
 /**
@@ -92,17 +95,31 @@ private:
    *
    */
   boost::dynamic_bitset<uint8_t> *status_bits;
+#ifdef ENABLE_ORACLE
   /**
-   * @brief Original counters
+   * @brief Original counters, i.e., the counters without CH
+   * @details Only kept with `ENABLE_ORACLE`, for they take more memory than CH
+   * saves.
    *
    */
   std::vector<T> original_cnt;
+#endif
   /**
    * @brief get decoded counter
    * @details `double` will round to `T` after decoding each layer. The reason
    * why `double` here is to facilitate NZE decoding.
    */
   std::vector<double> decoded_cnt;
+  /**
+   * @brief Number of overflows (carries) of each layer
+   *
+   */
+  std::vector<int64_t> carries;
+  /**
+   * @brief Number of decodings and the time they take in microseconds
+   *
+   */
+  int64_t decodes, decode_us;
 #ifndef RECORD_ACCESS_TIME
   /**
    * @brief For lazy update policy
@@ -237,15 +254,18 @@ public:
    * index serialized in advance.
    */
   T getCnt(size_t index);
+#ifdef ENABLE_ORACLE
   /**
    * @brief Get the original value of counters.
    *
-   * @details I.e., the value of the counter without CH.
+   * @details I.e., the value of the counter without CH. Only available with
+   * `ENABLE_ORACLE`.
    *
    * @param index Serialized index of a counter. It is the user's job to get
    * the index serialized in advance.
    */
   T getOriginalCnt(size_t index) const;
+#endif
   /**
    * @brief Size of CH.
    *
@@ -256,6 +276,23 @@ public:
    *
    */
   size_t originalSize() const;
+  /**
+   * @brief Number of counters on each layer, given that of the lowest one
+   *
+   * @details Every layer has `ratio` times as many counters as the one below,
+   * rounded up to a prime, which is how CH-optimized sketches lay out CH.
+   */
+  static std::vector<size_t> layerCnt(size_t no_cnt_0, double ratio);
+  /**
+   * @brief Size of a CH with these parameters, without building it
+   *
+   * @details Same as size(). A `cm_row` of 0 means that the CM sketch is not
+   * used, and `cm_width` is its width after rounding up to a prime.
+   */
+  static size_t sizeOf(const std::vector<size_t> &no_cnt,
+                       const std::vector<size_t> &width_cnt,
+                       const std::vector<size_t> &no_hash, size_t cm_row = 0,
+                       size_t cm_width = 0);
   /**
    * @brief Reset CH.
    *
@@ -267,10 +304,15 @@ public:
    */
   uint8_t getStatus(int32_t idx) const;
   /**
-   * @brief Output Overflow rates and correct rates
+   * @brief Record statistics of CH in Util::Stats under scope `name`
+   * @details Gauges `update_rate` (accesses per update) and `overflow_rate`
+   * of layer-0 counters, counters `decodes` and `decode_us` and histogram
+   * `carries` by layer. With `ENABLE_ORACLE`, also gauge `correct_rate` of
+   * layer-0 counters and histogram `cnt_bits` of the bit lengths of the
+   * original counters, plus `est_error_rate` and `est_are` with the CM sketch.
    *
    */
-  void print_rate(const char* name);
+  void reportStats(const char* name);
   void highest_bit_add(int32_t val);
   /**
    * @brief return -1 if we think counter[layer][idx] < 0, return 1
@@ -316,6 +358,7 @@ void CounterHierarchy<no_layer, T, hash_t>::updateSegment(const int32_t layer,
   T overflow = cnt_array[layer][index] + val;
   if (overflow) {
     need_to_decode = true;
+    carries[layer]++;
     // mark status bits
     status_bits[layer][index] = true;
     if (use_cm_sketch && layer == 0){
@@ -366,6 +409,7 @@ CounterHierarchy<no_layer, T, hash_t>::updateLayer(const int32_t layer,
   for (const auto &kv : updates) {
     T overflow = cnt_array[layer][kv.first] + kv.second;
     if (overflow) {
+      carries[layer]++;
       // mark status bits
       status_bits[layer][kv.first] = true;
       if (layer == no_layer - 1) { // last layer
@@ -480,7 +524,6 @@ std::vector<double> CounterHierarchy<no_layer, T, hash_t>::decodeLayer(
   delete[] my_start;
   delete[] my_index;
   delete[] values;
-  printf("REACH HERE12!\n");
 
   return ret;
   
@@ -546,7 +589,8 @@ CounterHierarchy<no_layer, T, hash_t>::CounterHierarchy(
       use_negative_counters(use_negative_counters), 
       need_to_decode(false), have_decoded(false), use_cm_sketch(use_cm_sketch_),
       cm_row(cm_row_), cm_width(use_cm_sketch_? Util::NextPrime(cm_width_) : -1),
-      cm_sketch(NULL), est_TIMES(0), est_ARE(0), est_ERROR_TIME(0) {
+      cm_sketch(NULL), est_TIMES(0), est_ARE(0), est_ERROR_TIME(0),
+      carries(no_layer, 0), decodes(0), decode_us(0) {
   // validity check
   if (use_cm_sketch_){
     if(cm_row_ <= 0){
@@ -626,12 +670,10 @@ CounterHierarchy<no_layer, T, hash_t>::CounterHierarchy(
   for (int32_t i = 0; i < no_layer; ++i) {
     status_bits[i].resize(no_cnt[i], false);
   }
+#ifdef ENABLE_ORACLE
   // original counters, value initialized
   original_cnt.resize(no_cnt[0]);
-  for(int i = 0; i < no_cnt[0]; i++)
-  {
-    original_cnt[i] = 0;
-  }
+#endif
   // decoded counters, value initialized
   decoded_cnt.resize(no_cnt[0]);
   // set counters to make them record negtive values
@@ -697,8 +739,10 @@ void CounterHierarchy<no_layer, T, hash_t>::updateCnt(size_t index, T val) {
   updateSegment(0, index, val);
   total_update_time++;
 #endif
+#ifdef ENABLE_ORACLE
   // original counters
   original_cnt[index] += val;
+#endif
 }
 
 template <int32_t no_layer, typename T, typename hash_t>
@@ -726,11 +770,8 @@ T CounterHierarchy<no_layer, T, hash_t>::getCnt(size_t index) {
     else
       return static_cast<T>(decoded_cnt[index]);
   } else { // decode
-    printf("\nDECODER CALLED!\n");
     #ifdef TEST_DECODE_TIME
-      auto MY_TIMER = std::chrono::microseconds::zero();                              \
-      auto MY_TICK = std::chrono::steady_clock::now();                                \
-      auto MY_TOCK = std::chrono::steady_clock::now();
+      auto MY_TICK = std::chrono::steady_clock::now();
     #endif
     decoded_cnt = std::vector<double>(no_cnt.back());
     for (size_t i = 0; i < no_cnt.back(); ++i) {
@@ -756,11 +797,11 @@ T CounterHierarchy<no_layer, T, hash_t>::getCnt(size_t index) {
       }
     }
     #ifdef TEST_DECODE_TIME
-      MY_TOCK = std::chrono::steady_clock::now();
-      MY_TIMER = std::chrono::duration_cast<std::chrono::microseconds>(MY_TOCK - MY_TICK);
-      printf("\nDECODE COST %ldms\n", static_cast<int64_t>(MY_TIMER.count()));
+      decode_us += std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - MY_TICK)
+                       .count();
     #endif
-    printf("\nDECODER END!\n");
+    decodes++;
     have_decoded = true;
     return static_cast<T>(decoded_cnt[index]);
   }
@@ -821,9 +862,12 @@ void CounterHierarchy<no_layer, T, hash_t>::resetCnt(size_t index, T val) {
   // sketch.erase(index);
   status_bits[0][index] = false;
   updateSegment(0, index, val);
+#ifdef ENABLE_ORACLE
   original_cnt[index] = val;
+#endif
 }
 
+#ifdef ENABLE_ORACLE
 template <int32_t no_layer, typename T, typename hash_t>
 T CounterHierarchy<no_layer, T, hash_t>::getOriginalCnt(size_t index) const {
   if (index >= no_cnt[0]) {
@@ -833,9 +877,31 @@ T CounterHierarchy<no_layer, T, hash_t>::getOriginalCnt(size_t index) const {
   }
   return original_cnt[index];
 }
+#endif
 
 template <int32_t no_layer, typename T, typename hash_t>
-size_t CounterHierarchy<no_layer, T, hash_t>::size() const {
+std::vector<size_t>
+CounterHierarchy<no_layer, T, hash_t>::layerCnt(size_t no_cnt_0,
+                                                double ratio) {
+  std::vector<size_t> no_cnt = {no_cnt_0};
+  for (int32_t i = 1; i < no_layer; ++i) {
+    size_t last_layer = no_cnt.back();
+    no_cnt.push_back(Util::NextPrime(std::ceil(last_layer * ratio)));
+  }
+  return no_cnt;
+}
+
+template <int32_t no_layer, typename T, typename hash_t>
+size_t CounterHierarchy<no_layer, T, hash_t>::sizeOf(
+    const std::vector<size_t> &no_cnt, const std::vector<size_t> &width_cnt,
+    const std::vector<size_t> &no_hash, size_t cm_row, size_t cm_width) {
+  if (no_cnt.size() != no_layer || width_cnt.size() != no_layer ||
+      no_hash.size() != no_layer - 1) {
+    throw std::invalid_argument(
+        "Invalid Argument: `no_cnt`, `width_cnt` and `no_hash` should be of "
+        "size " + std::to_string(no_layer) + ", " + std::to_string(no_layer) +
+        " and " + std::to_string(no_layer - 1) + " respectively.");
+  }
   // counters + status bits
   size_t tot = 0; // first in bits
   for (int32_t i = 0; i < no_layer; ++i) {
@@ -849,7 +915,7 @@ size_t CounterHierarchy<no_layer, T, hash_t>::size() const {
     tot += sizeof(hash_t) * no_hash[i];
   }
 #endif
-  if(use_cm_sketch){
+  if(cm_row > 0){
     int32_t length = 0;
     for(int i = 1; i < no_layer; i++){
       length += width_cnt[i];
@@ -860,6 +926,12 @@ size_t CounterHierarchy<no_layer, T, hash_t>::size() const {
   return tot;
 }
 
+template <int32_t no_layer, typename T, typename hash_t>
+size_t CounterHierarchy<no_layer, T, hash_t>::size() const {
+  return sizeOf(no_cnt, width_cnt, no_hash, use_cm_sketch ? cm_row : 0,
+                cm_width);
+}
+
 template <int32_t no_layer, typename T, typename hash_t>
 size_t CounterHierarchy<no_layer, T, hash_t>::originalSize() const {
   return sizeof(T) * no_cnt[0];
@@ -875,8 +947,10 @@ void CounterHierarchy<no_layer, T, hash_t>::clear() {
   for (int32_t i = 0; i < no_layer; ++i) {
     status_bits[i].reset();
   }
+#ifdef ENABLE_ORACLE
   // reset original counters
   original_cnt = std::vector<T>(no_cnt[0]);
+#endif
   // // reset decoded counters
   // decoded_cnt = std::vector<double>(no_cnt[0]);
   // reset lazy_update
@@ -886,6 +960,9 @@ void CounterHierarchy<no_layer, T, hash_t>::clear() {
   // reset tag
   need_to_decode = false;
   have_decoded = false;
+  // reset statistics
+  carries.assign(no_layer, 0);
+  decodes = decode_us = 0;
 
   if(use_cm_sketch){
     if(!use_negative_counters){
@@ -907,30 +984,50 @@ void CounterHierarchy<no_layer, T, hash_t>::clear() {
 }
 
 template <int32_t no_layer, typename T, typename hash_t>
-void CounterHierarchy<no_layer, T, hash_t>::print_rate(const char* name){
+void CounterHierarchy<no_layer, T, hash_t>::reportStats(const char* name){
+  const char *scope = (name && *name) ? name : "CH";
   size_t length = no_cnt[0];
   int32_t overflow_num = 0;
-  int32_t correct_num = 0;
   for(int32_t i = 0; i < length; i++)
   {
     if(getStatus(i) == true)
     {
       overflow_num++;
     }
+  }
+#ifdef ENABLE_ORACLE
+  int32_t correct_num = 0;
+  std::vector<int64_t> cnt_bits;
+  for(int32_t i = 0; i < length; i++)
+  {
     if(getCnt(i) == getOriginalCnt(i))
     {
       correct_num++;
     }
+    // bit length of the original counter
+    uint64_t val = static_cast<uint64_t>(std::abs(getOriginalCnt(i)));
+    size_t bits = 0;
+    for (; val; val >>= 1)
+      bits++;
+    if (cnt_bits.size() <= bits)
+      cnt_bits.resize(bits + 1);
+    cnt_bits[bits]++;
   }
   if(use_cm_sketch){
-    printf("\n %s EST ERROR %d / %d = %lf TIMES! ARE: %lf\n", 
-          name, est_ERROR_TIME, est_TIMES, (double)est_ERROR_TIME / est_TIMES, est_ARE / est_TIMES);
+    STATS_SET(scope, "est_error_rate", (double)est_ERROR_TIME / est_TIMES);
+    STATS_SET(scope, "est_are", est_ARE / est_TIMES);
   }
+  STATS_SET(scope, "correct_rate", (double)correct_num / length);
+  STATS_SET_HIST(scope, "cnt_bits", std::move(cnt_bits));
+#endif
 #ifdef RECORD_ACCESS_TIME
-  printf("\n%s AVERAGE UPDATE RATE: %lf\n", name, (double)access_time / total_update_time);
+  STATS_SET(scope, "update_rate", (double)access_time / total_update_time);
 #endif
-  printf("\n%s OVERFLOW RATE: %lf\n\n", name, (double)overflow_num / length);
-  printf("\n%s CORRECT NUM: %lf\n\n", name, (double)correct_num / length);
+  STATS_SET(scope, "overflow_rate", (double)overflow_num / length);
+  STATS_ADD(scope, "decodes", decodes);
+  STATS_ADD(scope, "decode_us", decode_us);
+  STATS_SET_HIST(scope, "carries", carries);
+  decodes = decode_us = 0;
 }
 
 template <int32_t no_layer, typename T, typename hash_t>
@@ -1065,12 +1162,14 @@ T CounterHierarchy<no_layer, T, hash_t>::getEstCnt(int32_t idx, int32_t layer){
     else{
       val = std::min(val, getTotalCnt(idx));
     }
+#ifdef ENABLE_ORACLE
     est_TIMES++;
     T ori = getOriginalCnt(idx);
     if(val != ori){
       est_ERROR_TIME++;
       est_ARE += (ori == 0)? 0 : std::abs((ori - val) / ori);
     }
+#endif
     return val;
   }
 }
@@ -9,6 +9,7 @@
 #pragma once
 
 #include "hash.h"
+#include "stats.h"
 #include "utils.h"
 
 #include <Eigen/Dense>
@@ -108,6 +109,11 @@ private:
    * why `double` here is to facilitate NZE decoding.
    */
   std::vector<double> decoded_cnt;
+  /**
+   * @brief Number of decodings and the time they take in microseconds
+   *
+   */
+  int64_t decodes, decode_us;
 #ifndef NO_LAZILY_UPDATING
   /**
    * @brief For lazy update policy
@@ -271,10 +277,13 @@ public:
    */
   uint8_t getStatus(int32_t idx) const;
   /**
-   * @brief Output Overflow rates and correct rates
+   * @brief Record statistics of CH in Util::Stats under scope `name`
+   * @details Gauges `overflow_rate` and `correct_rate` of layer-0 counters
+   * and counters `decodes` and `decode_us`, plus `est_error_rate` and
+   * `est_are` with the CM sketch.
    *
    */
-  void print_rate(const char *name);
+  void reportStats(const char *name);
   void highest_bit_add(int32_t val);
   /**
    * @brief return -1 if we think counter[layer][idx] < 0, return 1
@@ -581,7 +590,6 @@ std::vector<double> CounterHierarchy<no_layer, T, hash_t>::decodeLayer(
   delete[] my_start;
   delete[] my_index;
   delete[] values;
-  printf("REACH HERE12!\n");
 
   return ret;
   
@@ -647,8 +655,8 @@ CounterHierarchy<no_layer, T, hash_t>::CounterHierarchy(
       use_negative_counters(use_negative_counters), need_to_decode(false),
       have_decoded(false), use_cm_sketch(use_cm_sketch_), cm_row(cm_row_),
       cm_width(use_cm_sketch_ ? Util::NextPrime(cm_width_) : -1),
-      cm_sketch(NULL), est_TIMES(0), est_ARE(0), est_ERROR_TIME(0), 
-      first_time(true), need_to_join(true) {
+      cm_sketch(NULL), decodes(0), decode_us(0), est_TIMES(0), est_ARE(0),
+      est_ERROR_TIME(0), first_time(true), need_to_join(true) {
   // validity check
   if (use_cm_sketch_) {
     if (cm_row_ <= 0) {
@@ -827,11 +835,8 @@ T CounterHierarchy<no_layer, T, hash_t>::getCnt(size_t index, bool used_for_test
     else
       return static_cast<T>(decoded_cnt[index]);
   } else { // decode
-    printf("\nDECODER CALLED!\n");
 #ifdef TEST_DECODE_TIME
-    auto MY_TIMER = std::chrono::microseconds::zero();
     auto MY_TICK = std::chrono::steady_clock::now();
-    auto MY_TOCK = std::chrono::steady_clock::now();
 #endif
     decoded_cnt = std::vector<double>(no_cnt.back());
     for (size_t i = 0; i < no_cnt.back(); ++i) {
@@ -853,12 +858,11 @@ T CounterHierarchy<no_layer, T, hash_t>::getCnt(size_t index, bool used_for_test
       }
     }
 #ifdef TEST_DECODE_TIME
-    MY_TOCK = std::chrono::steady_clock::now();
-    MY_TIMER = std::chrono::duration_cast<std::chrono::microseconds>(MY_TOCK -
-                                                                     MY_TICK);
-    printf("\nDECODE COST %ldms\n", static_cast<int64_t>(MY_TIMER.count()));
+    decode_us += std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - MY_TICK)
+                     .count();
 #endif
-    printf("\nDECODER END!\n");
+    decodes++;
     have_decoded = true;
     return static_cast<T>(decoded_cnt[index]);
   }
@@ -984,6 +988,7 @@ void CounterHierarchy<no_layer, T, hash_t>::clear() {
   // reset tag
   need_to_decode = false;
   have_decoded = false;
+  decodes = decode_us = 0;
 
   if (use_cm_sketch) {
     if (!use_negative_counters) {
@@ -1004,7 +1009,8 @@ void CounterHierarchy<no_layer, T, hash_t>::clear() {
 }
 
 template <int32_t no_layer, typename T, typename hash_t>
-void CounterHierarchy<no_layer, T, hash_t>::print_rate(const char *name) {
+void CounterHierarchy<no_layer, T, hash_t>::reportStats(const char *name) {
+  const char *scope = (name && *name) ? name : "CH";
   size_t length = no_cnt[0];
   int32_t overflow_num = 0;
   int32_t correct_num = 0;
@@ -1017,12 +1023,14 @@ void CounterHierarchy<no_layer, T, hash_t>::print_rate(const char *name) {
     }
   }
   if (use_cm_sketch) {
-    printf("\n %s EST ERROR %d / %d = %lf TIMES! ARE: %lf\n", name,
-           est_ERROR_TIME, est_TIMES, (double)est_ERROR_TIME / est_TIMES,
-           est_ARE / est_TIMES);
+    STATS_SET(scope, "est_error_rate", (double)est_ERROR_TIME / est_TIMES);
+    STATS_SET(scope, "est_are", est_ARE / est_TIMES);
   }
-  printf("\n%s OVERFLOW RATE: %lf\n\n", name, (double)overflow_num / length);
-  printf("\n%s CORRECT NUM: %lf\n\n", name, (double)correct_num / length);
+  STATS_SET(scope, "overflow_rate", (double)overflow_num / length);
+  STATS_SET(scope, "correct_rate", (double)correct_num / length);
+  STATS_ADD(scope, "decodes", decodes);
+  STATS_ADD(scope, "decode_us", decode_us);
+  decodes = decode_us = 0;
 }
 
 template <int32_t no_layer, typename T, typename hash_t>
@@ -0,0 +1,174 @@
+/**
+ * @file index.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Warehouse of indexing policies
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "utils.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Warehouse of indexing policies
+ *
+ * @details An indexing policy reduces a 64-bit hash value to an index in
+ * `[0, width)`, which is what sketches do on every row for every packet.
+ * Besides the plain modulo, which costs a hardware division, the policies
+ * here trade exactness or the choice of width for a few multiplications.
+ *
+ * Every policy provides
+ * - `static int32_t roundWidth(int32_t width)`, turning the configured width
+ *   into the one actually used (e.g., a prime for Mod);
+ * - a constructor taking that rounded width;
+ * - `int32_t operator()(uint64_t hash) const`, the reduction itself.
+ *
+ * A sketch takes the policy as a template parameter `index_t` (by default
+ * Mod, i.e., the classic behavior), and its testing class picks one by the
+ * `index` key in `.para`, cf. Dispatch().
+ *
+ */
+namespace OmniSketch::Index {
+
+/**
+ * @brief Spread every bit of a hash over the top bits
+ *
+ * @details The xorshift-multiply finalizer of MurmurHash3. Policies taking
+ * the top bits need it: Hash::AwareHash adds the last key byte after its
+ * final multiply, so that byte reaches the top bits only through a carry.
+ *
+ */
+inline uint64_t Mix(uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+/**
+ * @brief `hash % width` with a prime width
+ *
+ */
+class Mod {
+  uint64_t n;
+
+public:
+  static int32_t roundWidth(int32_t width) { return Util::NextPrime(width); }
+  explicit Mod(int32_t width = 1) : n(width) {}
+  int32_t operator()(uint64_t hash) const {
+    return static_cast<int32_t>(hash % n);
+  }
+};
+
+/**
+ * @brief `hash % width` with a prime width, by a precomputed reciprocal
+ *
+ * @details Same indices as Mod. The remainder is computed from the 128-bit
+ * reciprocal `M = ceil(2^128 / width)` as the high bits of `(M * hash mod
+ * 2^128) * width`, see Lemire et al., "Faster Remainder by Direct
+ * Computation", 2019.
+ *
+ */
+class Reciprocal {
+  uint64_t n;
+  __uint128_t m;
+
+public:
+  static int32_t roundWidth(int32_t width) { return Util::NextPrime(width); }
+  explicit Reciprocal(int32_t width = 1)
+      : n(width), m(~static_cast<__uint128_t>(0) / n + 1) {}
+  int32_t operator()(uint64_t hash) const {
+    const __uint128_t low = m * hash;
+    const __uint128_t mid =
+        static_cast<__uint128_t>(static_cast<uint64_t>(low)) * n;
+    const __uint128_t high =
+        static_cast<__uint128_t>(static_cast<uint64_t>(low >> 64)) * n +
+        (mid >> 64);
+    return static_cast<int32_t>(high >> 64);
+  }
+};
+
+/**
+ * @brief Lemire's fast range `(hash * width) >> 64`, any width
+ *
+ * @details Only the high bits of the hash matter, so the hash goes through
+ * Mix() first. The width is kept as configured.
+ *
+ */
+class FastRange {
+  uint64_t n;
+
+public:
+  static int32_t roundWidth(int32_t width) { return std::max(width, 1); }
+  explicit FastRange(int32_t width = 1) : n(width) {}
+  int32_t operator()(uint64_t hash) const {
+    return static_cast<int32_t>((static_cast<__uint128_t>(Mix(hash)) * n) >>
+                                64);
+  }
+};
+
+/**
+ * @brief Top bits of the hash, with the width rounded down to a power of 2
+ *
+ * @details The top bits of the hash are taken after Mix(), since those of
+ * Hash::AwareHash barely depend on the last key byte. Rounding down keeps the
+ * sketch within the configured memory.
+ *
+ */
+class Pow2 {
+  int32_t bits;
+
+public:
+  static int32_t roundWidth(int32_t width) {
+    int32_t n = 1;
+    while (n <= width / 2)
+      n <<= 1;
+    return n;
+  }
+  explicit Pow2(int32_t width = 1) : bits(0) {
+    while ((1 << bits) < width)
+      ++bits;
+  }
+  int32_t operator()(uint64_t hash) const {
+    return bits ? static_cast<int32_t>(Mix(hash) >> (64 - bits)) : 0;
+  }
+};
+
+/**
+ * @brief Call `f` with an instance of the policy named `name`
+ *
+ * @details Names are `"mod"`, `"reciprocal"`, `"fastrange"` and `"pow2"`. The
+ * instance is only meant for deducing the type, e.g.,
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.cpp
+ * Index::Dispatch(index, [&](auto policy) {
+ *   using index_t = decltype(policy);
+ *   return new Sketch::CMSketch<key_len, T, hash_t, index_t>(depth, width);
+ * });
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * so `f` has to return the same type for every policy.
+ *
+ * @warning An exception is thrown on an unknown name.
+ */
+template <typename F> auto Dispatch(const std::string_view name, F &&f) {
+  if (name == "mod")
+    return f(Mod());
+  if (name == "reciprocal")
+    return f(Reciprocal());
+  if (name == "fastrange")
+    return f(FastRange());
+  if (name == "pow2")
+    return f(Pow2());
+  throw std::invalid_argument(
+      "Invalid Argument: Unknown indexing policy \"" + std::string(name) +
+      "\", should be one of mod, reciprocal, fastrange and pow2.");
+}
+
+} // namespace OmniSketch::Index
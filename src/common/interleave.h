@@ -0,0 +1,74 @@
+/**
+ * @file interleave.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Interleaved execution of memory-bound jobs
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace OmniSketch::Util {
+
+/**
+ * @brief Prefetch every cache line of `[addr, addr + len)` for writing
+ *
+ */
+inline void Prefetch(const void *addr, size_t len = 1) {
+  const uintptr_t first = reinterpret_cast<uintptr_t>(addr) & ~uintptr_t(63);
+  const uintptr_t last =
+      (reinterpret_cast<uintptr_t>(addr) + len - 1) & ~uintptr_t(63);
+  for (uintptr_t line = first; line <= last; line += 64)
+    __builtin_prefetch(reinterpret_cast<const void *>(line), 1);
+}
+
+/**
+ * @brief Run `n` jobs with up to `width` of them in flight
+ *
+ * @details A job is a hand-written state machine that issues a prefetch at the
+ * end of every step instead of waiting for the load, in the spirit of
+ * asynchronous memory access chaining (AMAC). While one job waits for its
+ * cache line, the others make progress. The machine provides
+ * - `void start(int32_t slot, int32_t job)`, the first step of a job, e.g.,
+ *   hashing and prefetching;
+ * - `bool resume(int32_t slot)`, the next step, returning whether there are
+ *   more steps to go.
+ *
+ * Here `slot` in `[0, width)` tells where the state of the job is kept.
+ *
+ * Slots are visited round robin, and a slot is refilled with the next job as
+ * soon as it becomes free. Hence the `s`-th steps of all jobs take place in
+ * job order, and a structure that jobs only touch at a fixed step sees the
+ * very same operations in the very same order as in a serial run. With
+ * `width = 1` the jobs simply run one after another.
+ *
+ */
+template <typename Machine>
+void Interleave(Machine &machine, int32_t n, int32_t width) {
+  if (n <= 0)
+    return;
+  width = std::max(1, std::min(width, n));
+  std::vector<bool> busy(width, false);
+  int32_t next = 0, active = 0;
+  for (; next < width; ++next, ++active) {
+    machine.start(next, next);
+    busy[next] = true;
+  }
+  for (int32_t slot = 0; active; slot = (slot + 1 == width) ? 0 : slot + 1) {
+    if (!busy[slot] || machine.resume(slot))
+      continue;
+    if (next < n) {
+      machine.start(slot, next++);
+    } else {
+      busy[slot] = false;
+      --active;
+    }
+  }
+}
+
+} // namespace OmniSketch::Util
@@ -0,0 +1,126 @@
+/**
+ * @file levels.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Level sampling with shared row hashing
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "flowkey.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace OmniSketch::Sketch {
+
+/**
+ * @brief Sample flowkeys into levels and hash them for every level at once
+ *
+ * @details UnivMon keeps a flowkey in level `i` with probability `2^-i`, and
+ * every level is a Count Sketch of `depth` rows with its own hash functions.
+ * Done naively, a packet costs one hash per level to sample and `depth` more
+ * per level to update.
+ *
+ * Here the number of levels a flowkey falls into is one plus the number of
+ * trailing zeros of a single (mixed) hash value, capped at `logn`, which has the same
+ * distribution. The flowkey is then hashed once per row, and the hash value of
+ * row `r` at level `i` is derived as `Util::Mix64(row[r] ^ seed_i)`. A packet
+ * thus costs `depth + 1` hashes, no matter how many levels it reaches.
+ *
+ * @tparam key_len  length of flowkey
+ * @tparam hash_t   hashing class
+ */
+template <int32_t key_len, typename hash_t> class LevelSampler {
+private:
+  int32_t depth;
+  int32_t logn;
+  hash_t level_fn;
+  hash_t *row_fns;
+
+  LevelSampler(const LevelSampler &) = delete;
+  LevelSampler(LevelSampler &&) = delete;
+
+  /**
+   * @brief Seed of a level
+   *
+   */
+  static uint64_t seed(int32_t level) {
+    return 0x9e3779b97f4a7c15ULL * static_cast<uint64_t>(level + 1);
+  }
+
+public:
+  /**
+   * @brief Construct by specifying the number of rows and levels
+   *
+   * @warning An exception is thrown if either is not positive.
+   */
+  LevelSampler(int32_t depth, int32_t logn);
+  /**
+   * @brief Release the pointer
+   *
+   */
+  ~LevelSampler() { delete[] row_fns; }
+  /**
+   * @brief Number of levels the flowkey falls into, in `[1, logn]`
+   * @details The flowkey belongs to levels `0, 1, ..., numLevels() - 1`.
+   *
+   */
+  int32_t numLevels(const FlowKey<key_len> &flowkey) const {
+    // low bits of multiplicative hashes are weak, so mix them first
+    const uint64_t h = Util::Mix64(level_fn(flowkey));
+    return h ? std::min(logn, 1 + __builtin_ctzll(h)) : logn;
+  }
+  /**
+   * @brief Hash the flowkey once per row
+   *
+   * @param rows  `depth` hash values, to be passed to atLevel()
+   */
+  void hashRows(const FlowKey<key_len> &flowkey, uint64_t *rows) const {
+    for (int32_t r = 0; r < depth; ++r)
+      rows[r] = row_fns[r](flowkey);
+  }
+  /**
+   * @brief Hash values of all rows at a level
+   *
+   * @param rows    output of hashRows()
+   * @param level   the level, in `[0, logn)`
+   * @param hashes  `depth` hash values, one per row
+   */
+  void atLevel(const uint64_t *rows, int32_t level, uint64_t *hashes) const {
+    const uint64_t s = seed(level);
+    for (int32_t r = 0; r < depth; ++r)
+      hashes[r] = Util::Mix64(rows[r] ^ s);
+  }
+  /**
+   * @brief Size of the hashing classes
+   *
+   */
+  size_t size() const { return sizeof(*this) + sizeof(hash_t) * depth; }
+};
+
+} // namespace OmniSketch::Sketch
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Sketch {
+
+template <int32_t key_len, typename hash_t>
+LevelSampler<key_len, hash_t>::LevelSampler(int32_t depth, int32_t logn)
+    : depth(depth), logn(logn) {
+  if (depth <= 0 || logn <= 0) {
+    throw std::invalid_argument(
+        "Invalid Argument: Depth and #levels should be positive, but got " +
+        std::to_string(depth) + " and " + std::to_string(logn) + " instead.");
+  }
+  row_fns = new hash_t[depth];
+}
+
+} // namespace OmniSketch::Sketch
@@ -0,0 +1,122 @@
+/**
+ * @file perf.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Hardware performance counters
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace OmniSketch::Util {
+
+/**
+ * @brief Hardware performance counters of the calling thread
+ *
+ * @details Counts cycles, instructions, LLC misses, branch misses and dTLB
+ * misses in user space between start() and stop(), through Linux
+ * `perf_event_open(2)`. Each event is opened on its own, so that an event the
+ * PMU lacks (as is common in VMs) does not take the others down with it.
+ * Counts are scaled by the time an event was actually scheduled on the PMU,
+ * in case the kernel has to multiplex them.
+ *
+ * If no event can be opened, say on another OS, in a container without
+ * `CAP_PERFMON` or with `kernel.perf_event_paranoid` above 2, a warning is
+ * logged once and the counters are simply unavailable: start() and stop() do
+ * nothing and sample() is empty. Tests never fail for the lack of counters.
+ *
+ * ### Example
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~cpp
+ * Util::PerfCounters perf;
+ * perf.start();
+ * for (const auto &record : records)
+ *   sketch.update(record.flowkey, 1);
+ * perf.stop();
+ * for (const auto &[event, value] : perf.sample(records.size()))
+ *   fmt::print("{} per packet: {:g}\n", event, value);
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ */
+class PerfCounters {
+public:
+  /**
+   * @brief Events counted
+   *
+   */
+  enum Event {
+    CYCLES,
+    INSTRUCTIONS,
+    LLC_MISSES,
+    BRANCH_MISSES,
+    DTLB_MISSES,
+    NUM_EVENTS
+  };
+  /**
+   * @brief Names of the events, e.g., `cycles` and `llc_misses`
+   *
+   */
+  static const char *const names[NUM_EVENTS];
+  /**
+   * @brief (event, value) pairs of the available events
+   *
+   */
+  using Sample = std::vector<std::pair<std::string, double>>;
+
+private:
+  int fds[NUM_EVENTS];
+  uint64_t counts[NUM_EVENTS];
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+public:
+  /**
+   * @brief Open the counters for the calling thread, disabled
+   *
+   */
+  PerfCounters();
+  /**
+   * @brief Close the counters
+   *
+   */
+  ~PerfCounters();
+  /**
+   * @brief Whether an event is counted
+   *
+   */
+  bool available(Event event) const { return fds[event] >= 0; }
+  /**
+   * @brief Whether any event is counted
+   *
+   */
+  bool available() const;
+  /**
+   * @brief Reset and enable the counters
+   *
+   */
+  void start();
+  /**
+   * @brief Disable the counters and read them
+   *
+   */
+  void stop();
+  /**
+   * @brief Count of an event read by the last stop()
+   *
+   */
+  uint64_t count(Event event) const { return counts[event]; }
+  /**
+   * @brief Counts of the available events divided by `ops`, e.g., the
+   * number of packets
+   *
+   */
+  Sample sample(size_t ops = 1) const;
+};
+
+} // namespace OmniSketch::Util
@@ -0,0 +1,116 @@
+/**
+ * @file registry.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Runtime registry of sketch tests
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Tests that can be picked by name at runtime
+ *
+ * @details Every `add_user_sketch(YYY XXX)` in CMakeLists.txt generates, next
+ * to the driver of `YYY`, an entry that registers `XXXTest` under the name
+ * `YYY` before `main()` is entered. The `omnisketch` executable links all the
+ * entries, so a single binary runs any test, or a bunch of them in a row.
+ *
+ */
+class Registry {
+public:
+  /**
+   * @brief A registered test
+   *
+   */
+  struct Entry {
+    /**
+     * @brief Name of the standalone driver, e.g., `CM`
+     *
+     */
+    std::string name;
+    /**
+     * @brief Name of the test, e.g., `CMSketch`
+     *
+     */
+    std::string test;
+    /**
+     * @brief Config file used when none is given
+     *
+     */
+    std::string config;
+    /**
+     * @brief Construct the test with a config file and run it
+     *
+     */
+    std::function<void(const std::string &)> run;
+  };
+
+private:
+  static std::vector<Entry> &entries() {
+    static std::vector<Entry> all;
+    return all;
+  }
+
+public:
+  /**
+   * @brief Register a test
+   *
+   * @warning An exception is thrown if the name is taken.
+   */
+  static void add(Entry entry) {
+    if (find(entry.name)) {
+      throw std::invalid_argument("Invalid Argument: Test " + entry.name +
+                                  " is registered twice.");
+    }
+    entries().push_back(std::move(entry));
+  }
+  /**
+   * @brief Look up a test by name
+   *
+   * @return pointer to the entry, or `nullptr` if there is none
+   */
+  static const Entry *find(std::string_view name) {
+    for (const Entry &entry : entries()) {
+      if (entry.name == name)
+        return &entry;
+    }
+    return nullptr;
+  }
+  /**
+   * @brief All registered tests, sorted by name
+   *
+   */
+  static std::vector<const Entry *> list() {
+    std::vector<const Entry *> ans;
+    for (const Entry &entry : entries())
+      ans.push_back(&entry);
+    std::sort(ans.begin(), ans.end(), [](const Entry *a, const Entry *b) {
+      return a->name < b->name;
+    });
+    return ans;
+  }
+};
+
+/**
+ * @brief Register a test as a side effect of static initialization
+ *
+ */
+struct Registrar {
+  Registrar(std::string name, std::string test, std::string config,
+            std::function<void(const std::string &)> run) {
+    Registry::add({std::move(name), std::move(test), std::move(config),
+                   std::move(run)});
+  }
+};
+
+} // namespace OmniSketch::Test
@@ -0,0 +1,168 @@
+/**
+ * @file report.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Machine-readable reports of tests
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Reports of tests as JSON lines or CSV, for tracking results
+ *
+ * @details Every call to TestBase::show() appends a record to the report
+ * file, if any. The file is given by `-r` of the drivers, or else by the key
+ * `report` of the test node, e.g.,
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.toml
+ * [CM.test]
+ * report = "bench.jsonl"
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * A file ending with `.csv` gets CSV, and any other gets JSON lines. Records
+ * are appended, so that a file collects the runs of many releases:
+ * - A JSON line is an object of the fields of Record, with `params` and
+ *   `metrics` as nested objects.
+ * - CSV is in a long format, one line per metric, which keeps the columns
+ *   fixed however the metrics vary. The header is written to an empty file.
+ *
+ * Appending is serialized, so concurrent runs (cf. Test::Sweep) may share a
+ * file.
+ *
+ */
+class Report {
+public:
+  /**
+   * @brief A (column, value) pair, as in Test::Row
+   *
+   */
+  using Field = std::pair<std::string, std::string>;
+  /**
+   * @brief A record of a test
+   *
+   */
+  struct Record {
+    /**
+     * @brief Identifier of the process, shared by all its records
+     *
+     */
+    std::string run_id;
+    /**
+     * @brief UTC time of the record in ISO 8601
+     *
+     */
+    std::string time;
+    /**
+     * @brief Host, OS, architecture, CPU model and number of CPUs
+     *
+     */
+    std::vector<Field> host;
+    /**
+     * @brief Commit that was built, as `git describe --always --dirty`
+     *
+     */
+    std::string git;
+    /**
+     * @brief Show name of the test, e.g., `Count Min`
+     *
+     */
+    std::string sketch;
+    /**
+     * @brief Path to the test node, e.g., `CM.test`
+     *
+     */
+    std::string test;
+    /**
+     * @brief Parameters, e.g., `para.depth`, in the nodes next to the test
+     * node except `data`
+     *
+     */
+    std::vector<Field> params;
+    /**
+     * @brief File of the records
+     *
+     */
+    std::string dataset;
+    /**
+     * @brief Memory footprint in bytes, 0 if not measured
+     *
+     */
+    size_t memory = 0;
+    /**
+     * @brief All metrics, see Test::Row
+     *
+     */
+    std::vector<Field> metrics;
+  };
+
+  /**
+   * @brief Report file given on the command line, which takes precedence
+   * over the config
+   *
+   */
+  static std::string &path();
+  /**
+   * @brief Identifier of this process, e.g., `20221018T071500Z-12345`
+   *
+   */
+  static const std::string &runId();
+  /**
+   * @brief Commit that was built, or `unknown`
+   *
+   */
+  static const std::string &gitHash();
+  /**
+   * @brief Host, OS, architecture, CPU model and number of CPUs
+   *
+   */
+  static const std::vector<Field> &hostInfo();
+  /**
+   * @brief Make a record of the test, reading the parameters and dataset
+   * from the config
+   *
+   * @param sketch      Show name of the test
+   * @param config_file Path to the config file
+   * @param test_path   Path to the test node
+   * @param metrics     Metrics of the test
+   */
+  static Record make(const std::string_view sketch,
+                     const std::string_view config_file,
+                     const std::string_view test_path,
+                     std::vector<Field> metrics);
+  /**
+   * @brief Append a record of the test to the report file, if any
+   * @details The arguments are those of make().
+   *
+   */
+  static void write(const std::string_view sketch,
+                    const std::string_view config_file,
+                    const std::string_view test_path,
+                    const std::vector<Field> &metrics);
+  /**
+   * @brief Write a record as a JSON line
+   * @details Values that are numbers are written as numbers.
+   *
+   */
+  static void writeJson(std::ostream &out, const Record &record);
+  /**
+   * @brief Header of CSV
+   *
+   */
+  static void writeCsvHeader(std::ostream &out);
+  /**
+   * @brief Write a record as CSV, one line per metric
+   * @details Parameters are joined as `key=value;...` in a single column.
+   *
+   */
+  static void writeCsv(std::ostream &out, const Record &record);
+};
+
+} // namespace OmniSketch::Test
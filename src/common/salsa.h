@@ -0,0 +1,196 @@
+/**
+ * @file salsa.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Word-parallel primitives of SALSA
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+namespace OmniSketch::Util {
+
+/**
+ * @brief A row of SALSA counters: bytes that merge with their neighbors
+ *
+ * @details A row is `width` byte-sized counters plus a bitmap of `width`
+ * flags, where flag `i` (bit `i % 8` of byte `i / 8`) tells that bytes `i` and
+ * `i + 1` belong to the same counter. A merged counter keeps its most
+ * significant byte on the left, so its value reads the same whichever byte of
+ * it a flowkey is hashed to.
+ *
+ * A merged counter spans at most 8 bytes, so both its boundaries lie within a
+ * 64-bit window of the bitmap and its value within a 64-bit word of the
+ * bytes. The boundaries are thus found by a bit scan of runs of set flags
+ * instead of testing flags one by one, and a value is loaded or stored by a
+ * single 64-bit access. Merged counters need not be aligned, since SALSACM
+ * merges a counter with whatever its neighbor is at the moment, so the
+ * accesses are unaligned ones, which cost no more on x86 unless they cross a
+ * cache line.
+ *
+ * Both the bytes and the bitmap of the whole sketch must be followed by
+ * #kPadding bytes, as the 64-bit accesses may run past the end of the last
+ * row. Bytes and flags past a row are never modified.
+ *
+ */
+class SalsaRow {
+public:
+  /**
+   * @brief Bytes to allocate past the counters and past the bitmap
+   *
+   */
+  static constexpr int32_t kPadding = 8;
+  /**
+   * @brief Bytes of the bitmap of a row of `width` counters
+   *
+   */
+  static constexpr int32_t bitmapBytes(int32_t width) {
+    return (width + 7) / 8;
+  }
+  /**
+   * @brief Find the counter the `idx`-th byte belongs to
+   *
+   * @param bitmap  flags of the row
+   * @param width   number of bytes in the row
+   * @param idx     index of the byte
+   * @param left    index of its most significant byte
+   * @param right   index of its least significant byte
+   */
+  static void boundary(const uint8_t *bitmap, int32_t width, int32_t idx,
+                       int32_t &left, int32_t &right) {
+    // a window of 64 flags, with those of 8 bytes on either side of idx
+    const int32_t base = idx >= 32 ? (idx - 32) & ~7 : 0;
+    const int32_t pos = idx - base;
+    const uint64_t window = load(bitmap + base / 8);
+    // the run of set flags just below idx
+    left = pos ? idx - __builtin_clzll(~(window << (64 - pos))) : idx;
+    // the run of set flags from idx on
+    right = idx + __builtin_ctzll(~(window >> pos));
+    if (right > width - 1)
+      right = width - 1;
+  }
+  /**
+   * @brief Value of the counter of bytes `[left, right]`
+   *
+   */
+  static uint64_t get(const uint8_t *bytes, int32_t left, int32_t right) {
+    const int32_t shift = (8 - (right - left + 1)) * 8;
+    return bigEndian(load(bytes + left)) >> shift;
+  }
+  /**
+   * @brief Set the counter of bytes `[left, right]`, leaving other bytes
+   * intact
+   *
+   */
+  static void set(uint8_t *bytes, int32_t left, int32_t right,
+                  uint64_t val) {
+    const int32_t len = right - left + 1;
+    assert(len == 8 || (val >> (len * 8)) == 0);
+    const int32_t shift = (8 - len) * 8;
+    const uint64_t mask = ~0ULL >> (64 - len * 8) << shift;
+    const uint64_t word = bigEndian(load(bytes + left));
+    store(bytes + left, bigEndian((word & ~mask) | (val << shift)));
+  }
+  /**
+   * @brief Whether a value fits in a counter of `len` bytes
+   *
+   */
+  static bool fits(uint64_t val, int32_t len) {
+    return len >= 8 || (val >> (len * 8)) == 0;
+  }
+
+private:
+  static uint64_t load(const uint8_t *ptr) {
+    uint64_t word;
+    std::memcpy(&word, ptr, sizeof(word));
+    return word;
+  }
+  static void store(uint8_t *ptr, uint64_t word) {
+    std::memcpy(ptr, &word, sizeof(word));
+  }
+  /**
+   * @brief Swap a word read from memory so that its first byte is the most
+   * significant, or back
+   *
+   */
+  static uint64_t bigEndian(uint64_t word) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return __builtin_bswap64(word);
+#else
+    return word;
+#endif
+  }
+};
+
+/**
+ * @brief A row of SALSA counters, accessed flag by flag and byte by byte
+ *
+ * @details The same layout and interface as SalsaRow, with the loops SALSACM
+ * and SALSACU had before SalsaRow. It is kept as a reference, which the
+ * SALSA comparison (`SSC`) and the tests check SalsaRow against.
+ *
+ */
+class SalsaBytes {
+public:
+  /**
+   * @brief Nothing is read past a row, yet the padding is kept the same
+   *
+   */
+  static constexpr int32_t kPadding = SalsaRow::kPadding;
+  /**
+   * @brief Bytes of the bitmap of a row of `width` counters
+   *
+   */
+  static constexpr int32_t bitmapBytes(int32_t width) {
+    return SalsaRow::bitmapBytes(width);
+  }
+  /**
+   * @brief Find the counter the `idx`-th byte belongs to
+   *
+   */
+  static void boundary(const uint8_t *bitmap, int32_t width, int32_t idx,
+                       int32_t &left, int32_t &right) {
+    auto flag = [bitmap](int32_t i) { return (bitmap[i / 8] >> (i % 8)) & 1; };
+    left = idx;
+    right = idx;
+    while (left >= 1 && flag(left - 1))
+      left--;
+    while (right < width - 1 && flag(right))
+      right++;
+  }
+  /**
+   * @brief Value of the counter of bytes `[left, right]`
+   *
+   */
+  static uint64_t get(const uint8_t *bytes, int32_t left, int32_t right) {
+    uint64_t ret = bytes[left];
+    for (int32_t i = left + 1; i <= right; ++i)
+      ret = (ret << 8) + bytes[i];
+    return ret;
+  }
+  /**
+   * @brief Set the counter of bytes `[left, right]`
+   *
+   */
+  static void set(uint8_t *bytes, int32_t left, int32_t right,
+                  uint64_t val) {
+    for (int32_t i = right; i >= left; --i) {
+      bytes[i] = val & 0xff;
+      val >>= 8;
+    }
+    assert(val == 0);
+  }
+  /**
+   * @brief Whether a value fits in a counter of `len` bytes
+   *
+   */
+  static bool fits(uint64_t val, int32_t len) {
+    return SalsaRow::fits(val, len);
+  }
+};
+
+} // namespace OmniSketch::Util
@@ -0,0 +1,100 @@
+/**
+ * @file sampling.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Geometric skipping for packet sampling
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+
+namespace OmniSketch::Util {
+
+/**
+ * @brief Number of trials to skip before the next success, for trials that
+ * succeed with probability `p`
+ *
+ * @details Instead of tossing a coin per packet, a sampler draws how many
+ * packets to skip, which follows a geometric distribution on `{0, 1, ...}`
+ * with mean `(1 - p) / p`. A skip is drawn by inversion, i.e.,
+ * `floor(log(u) / log(1 - p))` for `u` uniform in `(0, 1]`, and skips are
+ * drawn #kBatch at a time into a buffer, so that the per-packet cost is a
+ * decrement and, once in a while, a tight loop of logarithms.
+ *
+ * With `p = 1` every skip is 0 and no random number is drawn.
+ *
+ */
+class GeometricSkip {
+public:
+  /**
+   * @brief Skips drawn at a time
+   *
+   */
+  static constexpr int32_t kBatch = 64;
+
+private:
+  double p;
+  double inv_log; // 1 / log(1 - p)
+  std::mt19937_64 rng;
+  int32_t skips[kBatch];
+  int32_t pos;
+
+  void refill() {
+    if (p >= 1.0) {
+      std::fill(skips, skips + kBatch, 0);
+    } else {
+      for (int32_t i = 0; i < kBatch; ++i) {
+        // 53 random bits, uniform in (0, 1]
+        const double u = ((rng() >> 11) + 1) * 0x1p-53;
+        const double skip = std::floor(std::log(u) * inv_log);
+        skips[i] = skip < 1e9 ? static_cast<int32_t>(skip) : 1000000000;
+      }
+    }
+    pos = 0;
+  }
+
+public:
+  /**
+   * @brief Construct by specifying the probability and the seed
+   *
+   * @warning An exception is thrown unless `0 < prob <= 1`.
+   */
+  explicit GeometricSkip(double prob = 1.0, uint64_t seed = 5489)
+      : rng(seed) {
+    setProb(prob);
+  }
+  /**
+   * @brief Change the probability, discarding skips drawn so far
+   *
+   */
+  void setProb(double prob) {
+    if (!(prob > 0.0 && prob <= 1.0))
+      throw std::invalid_argument(
+          "Invalid Argument: Sampling probability should be in (0, 1]");
+    p = prob;
+    inv_log = p < 1.0 ? 1.0 / std::log1p(-p) : 0.0;
+    refill();
+  }
+  /**
+   * @brief The probability
+   *
+   */
+  double prob() const { return p; }
+  /**
+   * @brief Draw the next skip
+   *
+   */
+  int32_t next() {
+    if (pos == kBatch)
+      refill();
+    return skips[pos++];
+  }
+};
+
+} // namespace OmniSketch::Util
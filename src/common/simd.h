@@ -0,0 +1,453 @@
+/**
+ * @file simd.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief SIMD kernels shared by sketches
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Vectorized kernels on the per-packet path
+ *
+ * @details Every kernel comes with a portable scalar version. The AVX2 version
+ * is picked by overload resolution whenever the translation unit is compiled
+ * for an AVX2-capable target (cf. `USE_NATIVE_ARCH` in CMakeLists.txt), so
+ * callers never have to test for the ISA themselves.
+ *
+ */
+namespace OmniSketch::Util {
+
+/**
+ * @brief Add a value to every counter whose bit is on in a bit mask
+ *
+ * @details For each `k` in `[0, 8 * len)`, `dst[k] += val` if and only if the
+ * `k`-th bit of `bits` is on, where bits are numbered the same way as in
+ * FlowKey::getBit(), i.e., LSB of `bits[0]` first. The update is branch-free.
+ *
+ * @tparam T    type of the counter (integral)
+ * @param dst   `8 * len` contiguous counters
+ * @param bits  the bit mask, e.g., `flowkey.cKey()`
+ * @param len   length of the bit mask in bytes
+ * @param val   the value to add (may be negative)
+ */
+template <typename T>
+inline void MaskedAddBits(T *dst, const int8_t *bits, int32_t len, T val) {
+  static_assert(std::is_integral_v<T>, "Counter must be integral");
+  for (int32_t i = 0; i < len; ++i) {
+    const uint8_t byte = static_cast<uint8_t>(bits[i]);
+    for (int32_t b = 0; b < 8; ++b) {
+      dst[8 * i + b] += val & (T)(-static_cast<T>((byte >> b) & 1));
+    }
+  }
+}
+
+/**
+ * @brief Add a value to one of two counters per bit, as told by a bit mask
+ *
+ * @details For each `k` in `[0, 8 * len)`, `on[k] += val` if the `k`-th bit
+ * of `bits` is on and `off[k] += val` otherwise, with bits numbered as in
+ * MaskedAddBits(). The update is branch-free.
+ *
+ * @tparam T    type of the counter (integral)
+ * @param off   `8 * len` contiguous counters for bits that are off
+ * @param on    `8 * len` contiguous counters for bits that are on
+ * @param bits  the bit mask, e.g., `flowkey.cKey()`
+ * @param len   length of the bit mask in bytes
+ * @param val   the value to add (may be negative)
+ */
+template <typename T>
+inline void SplitAddBits(T *off, T *on, const int8_t *bits, int32_t len,
+                         T val) {
+  static_assert(std::is_integral_v<T>, "Counter must be integral");
+  for (int32_t i = 0; i < len; ++i) {
+    const uint8_t byte = static_cast<uint8_t>(bits[i]);
+    for (int32_t b = 0; b < 8; ++b) {
+      const T mask = (T)(-static_cast<T>((byte >> b) & 1));
+      on[8 * i + b] += val & mask;
+      off[8 * i + b] += val & ~mask;
+    }
+  }
+}
+
+#if defined(__AVX2__)
+/**
+ * @brief AVX2 kernel of MaskedAddBits() for 32-bit counters
+ * @details One key byte expands to exactly one 8-lane mask.
+ *
+ */
+inline void MaskedAddBits(int32_t *dst, const int8_t *bits, int32_t len,
+                          int32_t val) {
+  const __m256i sel = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+  const __m256i add = _mm256_set1_epi32(val);
+  for (int32_t i = 0; i < len; ++i) {
+    const __m256i byte = _mm256_set1_epi32(static_cast<uint8_t>(bits[i]));
+    const __m256i mask =
+        _mm256_cmpeq_epi32(_mm256_and_si256(byte, sel), sel);
+    __m256i *ptr = reinterpret_cast<__m256i *>(dst + 8 * i);
+    _mm256_storeu_si256(ptr, _mm256_add_epi32(_mm256_loadu_si256(ptr),
+                                              _mm256_and_si256(mask, add)));
+  }
+}
+
+/**
+ * @brief AVX2 kernel of MaskedAddBits() for 64-bit counters
+ * @details One key byte expands to two 4-lane masks.
+ *
+ */
+inline void MaskedAddBits(int64_t *dst, const int8_t *bits, int32_t len,
+                          int64_t val) {
+  const __m256i sel_lo = _mm256_setr_epi64x(1, 2, 4, 8);
+  const __m256i sel_hi = _mm256_setr_epi64x(16, 32, 64, 128);
+  const __m256i add = _mm256_set1_epi64x(val);
+  for (int32_t i = 0; i < len; ++i) {
+    const __m256i byte = _mm256_set1_epi64x(static_cast<uint8_t>(bits[i]));
+    const __m256i mask_lo =
+        _mm256_cmpeq_epi64(_mm256_and_si256(byte, sel_lo), sel_lo);
+    const __m256i mask_hi =
+        _mm256_cmpeq_epi64(_mm256_and_si256(byte, sel_hi), sel_hi);
+    __m256i *lo = reinterpret_cast<__m256i *>(dst + 8 * i);
+    __m256i *hi = reinterpret_cast<__m256i *>(dst + 8 * i + 4);
+    _mm256_storeu_si256(lo, _mm256_add_epi64(_mm256_loadu_si256(lo),
+                                             _mm256_and_si256(mask_lo, add)));
+    _mm256_storeu_si256(hi, _mm256_add_epi64(_mm256_loadu_si256(hi),
+                                             _mm256_and_si256(mask_hi, add)));
+  }
+}
+
+/**
+ * @brief AVX2 kernel of SplitAddBits() for 32-bit counters
+ * @details One key byte expands to one 8-lane mask, used as is for `on` and
+ * negated for `off`.
+ *
+ */
+inline void SplitAddBits(int32_t *off, int32_t *on, const int8_t *bits,
+                         int32_t len, int32_t val) {
+  const __m256i sel = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+  const __m256i add = _mm256_set1_epi32(val);
+  for (int32_t i = 0; i < len; ++i) {
+    const __m256i byte = _mm256_set1_epi32(static_cast<uint8_t>(bits[i]));
+    const __m256i mask =
+        _mm256_cmpeq_epi32(_mm256_and_si256(byte, sel), sel);
+    __m256i *p1 = reinterpret_cast<__m256i *>(on + 8 * i);
+    __m256i *p0 = reinterpret_cast<__m256i *>(off + 8 * i);
+    _mm256_storeu_si256(p1, _mm256_add_epi32(_mm256_loadu_si256(p1),
+                                             _mm256_and_si256(mask, add)));
+    _mm256_storeu_si256(p0, _mm256_add_epi32(_mm256_loadu_si256(p0),
+                                             _mm256_andnot_si256(mask, add)));
+  }
+}
+
+/**
+ * @brief AVX2 kernel of SplitAddBits() for 64-bit counters
+ * @details One key byte expands to two 4-lane masks.
+ *
+ */
+inline void SplitAddBits(int64_t *off, int64_t *on, const int8_t *bits,
+                         int32_t len, int64_t val) {
+  const __m256i sel[2] = {_mm256_setr_epi64x(1, 2, 4, 8),
+                          _mm256_setr_epi64x(16, 32, 64, 128)};
+  const __m256i add = _mm256_set1_epi64x(val);
+  for (int32_t i = 0; i < len; ++i) {
+    const __m256i byte = _mm256_set1_epi64x(static_cast<uint8_t>(bits[i]));
+    for (int32_t h = 0; h < 2; ++h) {
+      const __m256i mask =
+          _mm256_cmpeq_epi64(_mm256_and_si256(byte, sel[h]), sel[h]);
+      __m256i *p1 = reinterpret_cast<__m256i *>(on + 8 * i + 4 * h);
+      __m256i *p0 = reinterpret_cast<__m256i *>(off + 8 * i + 4 * h);
+      _mm256_storeu_si256(p1, _mm256_add_epi64(_mm256_loadu_si256(p1),
+                                               _mm256_and_si256(mask, add)));
+      _mm256_storeu_si256(
+          p0, _mm256_add_epi64(_mm256_loadu_si256(p0),
+                               _mm256_andnot_si256(mask, add)));
+    }
+  }
+}
+#endif
+
+/**
+ * @brief Number of bytes a fingerprint array of `n` entries must span
+ * @details FindFingerprint() reads fingerprints 16 at a time, so the array
+ * (or the memory right after it) must be readable up to this length.
+ *
+ */
+constexpr int32_t FingerprintStride(int32_t n) { return (n + 15) & ~15; }
+
+/**
+ * @brief Find the first entry whose fingerprint is `fp` and that passes `pred`
+ *
+ * @details Fingerprints are compared 16 at a time, and `pred` (typically a
+ * full key comparison) is only evaluated on a fingerprint hit, in increasing
+ * order of the index.
+ *
+ * @param fps   fingerprints, readable up to `FingerprintStride(n)` bytes
+ * @param n     number of entries
+ * @param fp    the fingerprint to look for
+ * @param pred  callable of signature `bool(int32_t index)`
+ * @return the index found, or `-1` if there is none
+ */
+template <typename Pred>
+inline int32_t FindFingerprint(const uint8_t *fps, int32_t n, uint8_t fp,
+                               Pred &&pred) {
+#if defined(__SSE2__)
+  const __m128i needle = _mm_set1_epi8(static_cast<char>(fp));
+  for (int32_t base = 0; base < n; base += 16) {
+    uint32_t hits = _mm_movemask_epi8(_mm_cmpeq_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(fps + base)),
+        needle));
+    if (n - base < 16)
+      hits &= (1u << (n - base)) - 1;
+    while (hits) {
+      const int32_t i = base + __builtin_ctz(hits);
+      if (pred(i))
+        return i;
+      hits &= hits - 1;
+    }
+  }
+#else
+  for (int32_t i = 0; i < n; ++i) {
+    if (fps[i] == fp && pred(i))
+      return i;
+  }
+#endif
+  return -1;
+}
+
+/**
+ * @brief Index of the first minimum of `n > 0` values
+ *
+ */
+template <typename T> inline int32_t MinIndex(const T *vals, int32_t n) {
+  int32_t ans = 0;
+  for (int32_t i = 1; i < n; ++i) {
+    if (vals[i] < vals[ans])
+      ans = i;
+  }
+  return ans;
+}
+
+#if defined(__AVX2__)
+/**
+ * @brief AVX2 kernel of MinIndex() for 32-bit values
+ * @details Reduce the minimum 8 lanes at a time, then locate its first
+ * occurrence by comparison.
+ *
+ */
+inline int32_t MinIndex(const int32_t *vals, int32_t n) {
+  if (n < 8)
+    return MinIndex<int32_t>(vals, n);
+  const int32_t tail = n & ~7;
+  __m256i vmin = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(vals));
+  for (int32_t i = 8; i < tail; i += 8) {
+    vmin = _mm256_min_epi32(
+        vmin, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(vals + i)));
+  }
+  __m128i m = _mm_min_epi32(_mm256_castsi256_si128(vmin),
+                            _mm256_extracti128_si256(vmin, 1));
+  m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+  m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+  int32_t minn = _mm_cvtsi128_si32(m);
+  for (int32_t i = tail; i < n; ++i)
+    minn = std::min(minn, vals[i]);
+
+  const __m256i target = _mm256_set1_epi32(minn);
+  for (int32_t i = 0; i < tail; i += 8) {
+    const uint32_t hits = _mm256_movemask_ps(_mm256_castsi256_ps(
+        _mm256_cmpeq_epi32(target, _mm256_loadu_si256(
+                                       reinterpret_cast<const __m256i *>(vals + i)))));
+    if (hits)
+      return i + __builtin_ctz(hits);
+  }
+  for (int32_t i = tail; i < n; ++i) {
+    if (vals[i] == minn)
+      return i;
+  }
+  return -1; // unreachable
+}
+#endif
+
+/**
+ * @brief Minimum of `n > 0` counters scattered around `base`
+ * @details That is, the minimum of `base[offsets[i]]` for `i` in `[0, n)`,
+ * e.g., of the counters a flowkey is hashed to, one per row.
+ *
+ * Unlike other kernels, the AVX2 version (`vpgatherdd`) is only picked with
+ * `USE_AVX2_GATHER` defined, since gathers decode into many micro-ops on AMD
+ * Zen and lose to scalar loads there at any depth. They may pay off on Intel
+ * cores for deep sketches.
+ *
+ */
+template <typename T>
+inline T GatherMin(const T *base, const int32_t *offsets, int32_t n) {
+  T ans = base[offsets[0]];
+  for (int32_t i = 1; i < n; ++i)
+    ans = std::min(ans, base[offsets[i]]);
+  return ans;
+}
+
+#if defined(__AVX2__) && defined(USE_AVX2_GATHER)
+/**
+ * @brief AVX2 kernel of GatherMin() for 32-bit counters
+ * @details Gather 8 counters at a time, with a masked gather for the tail so
+ * that neither `offsets` nor `base` is read out of bounds.
+ *
+ */
+inline int32_t GatherMin(const int32_t *base, const int32_t *offsets,
+                         int32_t n) {
+  const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  __m256i vmin = _mm256_set1_epi32(std::numeric_limits<int32_t>::max());
+  int32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256i idx =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(offsets + i));
+    vmin = _mm256_min_epi32(vmin, _mm256_i32gather_epi32(base, idx, 4));
+  }
+  if (i < n) {
+    const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(n - i), lane);
+    const __m256i idx = _mm256_maskload_epi32(offsets + i, mask);
+    vmin = _mm256_min_epi32(
+        vmin, _mm256_mask_i32gather_epi32(vmin, base, idx, mask, 4));
+  }
+  __m128i m = _mm_min_epi32(_mm256_castsi256_si128(vmin),
+                            _mm256_extracti128_si256(vmin, 1));
+  m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+  m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(m);
+}
+
+/**
+ * @brief AVX2 kernel of GatherMin() for 64-bit counters
+ * @details Gather 4 counters at a time. AVX2 has no 64-bit minimum, so lanes
+ * are blended by comparison.
+ *
+ */
+inline int64_t GatherMin(const int64_t *base, const int32_t *offsets,
+                         int32_t n) {
+  const long long *ptr = reinterpret_cast<const long long *>(base);
+  const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+  __m256i vmin = _mm256_set1_epi64x(std::numeric_limits<int64_t>::max());
+  int32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m128i idx =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(offsets + i));
+    const __m256i val = _mm256_i32gather_epi64(ptr, idx, 8);
+    vmin = _mm256_blendv_epi8(vmin, val, _mm256_cmpgt_epi64(vmin, val));
+  }
+  if (i < n) {
+    const __m128i mask = _mm_cmpgt_epi32(_mm_set1_epi32(n - i), lane);
+    const __m128i idx = _mm_maskload_epi32(offsets + i, mask);
+    const __m256i val = _mm256_mask_i32gather_epi64(
+        vmin, ptr, idx, _mm256_cvtepi32_epi64(mask), 8);
+    vmin = _mm256_blendv_epi8(vmin, val, _mm256_cmpgt_epi64(vmin, val));
+  }
+  alignas(32) int64_t lanes[4];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), vmin);
+  return std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+}
+#endif
+
+/**
+ * @brief Batcher's odd-even merge sort of `P` inputs, `P` a power of 2
+ * @details The `k`-th comparator orders inputs `lo[k]` and `hi[k]`. There are
+ * 1, 5, 19 and 63 of them for `P` = 2, 4, 8 and 16.
+ *
+ */
+template <int32_t P> struct SortingNetwork {
+  int32_t size = 0;
+  int8_t lo[P * P / 2] = {};
+  int8_t hi[P * P / 2] = {};
+
+  constexpr SortingNetwork() {
+    for (int32_t p = 1; p < P; p <<= 1)
+      for (int32_t k = p; k >= 1; k >>= 1)
+        for (int32_t j = k % p; j + k < P; j += 2 * k)
+          for (int32_t i = 0; i < k && i + j + k < P; ++i)
+            if ((i + j) / (2 * p) == (i + j + k) / (2 * p)) {
+              lo[size] = static_cast<int8_t>(i + j);
+              hi[size] = static_cast<int8_t>(i + j + k);
+              ++size;
+            }
+  }
+};
+
+/**
+ * @brief The network itself, built at compile time
+ *
+ */
+template <int32_t P> inline constexpr SortingNetwork<P> kSortingNetwork{};
+
+/**
+ * @brief Sort `P` values in place with branch-free comparators
+ * @details Every comparator is unrolled with constant indices, so the values
+ * stay in registers and a comparator is a min and a max (conditional moves)
+ * rather than a mispredicted branch.
+ *
+ */
+template <int32_t P, typename T, size_t... K>
+inline void SortByNetwork(T *vals, std::index_sequence<K...>) {
+  auto compare = [vals](int32_t lo, int32_t hi) {
+    // not std::min() and std::max(), which GCC turns into branches
+    const T a = vals[lo], b = vals[hi];
+    const bool swap = b < a;
+    vals[lo] = swap ? b : a;
+    vals[hi] = swap ? a : b;
+  };
+  (compare(kSortingNetwork<P>.lo[K], kSortingNetwork<P>.hi[K]), ...);
+}
+
+template <int32_t P, typename T> inline void SortByNetwork(T *vals) {
+  SortByNetwork<P>(vals, std::make_index_sequence<kSortingNetwork<P>.size>{});
+}
+
+/**
+ * @brief Median of `n > 0` values
+ *
+ * @details The middle value if `n` is odd, or else the mean of the two middle
+ * values computed in `T`, i.e., rounded towards zero if `T` is integral. Up
+ * to 16 values are sorted by a sorting network after padding them to a power
+ * of 2 with the largest value of `T`, which does not move the middle. More
+ * values fall back to `std::nth_element()`.
+ *
+ * @param vals  the values, which may be reordered
+ * @param n     number of values
+ */
+template <typename T> inline T Median(T *vals, int32_t n) {
+  const auto middle = [n](const T *sorted) -> T {
+    return (n & 1) ? sorted[n / 2]
+                   : static_cast<T>((sorted[n / 2 - 1] + sorted[n / 2]) / 2);
+  };
+  const auto sort = [&](auto network) -> T {
+    constexpr int32_t P = decltype(network)::value;
+    T buf[P];
+    for (int32_t i = 0; i < P; ++i)
+      buf[i] = i < n ? vals[i] : std::numeric_limits<T>::max();
+    SortByNetwork<P>(buf);
+    return middle(buf);
+  };
+  if (n <= 2)
+    return n == 1 ? vals[0] : static_cast<T>((vals[0] + vals[1]) / 2);
+  if (n <= 4)
+    return sort(std::integral_constant<int32_t, 4>{});
+  if (n <= 8)
+    return sort(std::integral_constant<int32_t, 8>{});
+  if (n <= 16)
+    return sort(std::integral_constant<int32_t, 16>{});
+  std::nth_element(vals, vals + n / 2, vals + n);
+  if (n & 1)
+    return vals[n / 2];
+  return static_cast<T>(
+      (*std::max_element(vals, vals + n / 2) + vals[n / 2]) / 2);
+}
+
+} // namespace OmniSketch::Util
@@ -49,6 +49,20 @@ namespace OmniSketch::Sketch {
  *        <td>update(const FlowKey<key_len> &, T)</td>
  *   </tr>
  *   <tr>
+ *        <td>insert a batch of flowkeys with values</td>
+ *        <td>updateBatch(const FlowKey<key_len> *, const T *, int32_t,
+ * int32_t)</td>
+ *   </tr>
+ *   <tr>
+ *        <td>query a flowkey</td>
+ *        <td>query(const FlowKey<key_len> &) const</td>
+ *   </tr>
+ *   <tr>
+ *        <td>query a batch of flowkeys</td>
+ *        <td>queryBatch(const FlowKey<key_len> *, T *, int32_t, int32_t)
+ * const</td>
+ *   </tr>
+ *   <tr>
  *        <td>look up a flowkey (*if exists*)</td>
  *        <td>lookup(const FlowKey<key_len> &) const</td>
  *   </tr>
@@ -107,6 +121,19 @@ public:
     }
     return;
   }
+  /**
+   * @brief Update a batch of flowkeys with their values
+   * @details Same as calling update() on each of them in order, which is what
+   * is done by default. A sketch whose update is a chain of dependent cache
+   * misses may override it to keep `width` flowkeys in flight at a time, cf.
+   * Util::Interleave().
+   *
+   */
+  virtual void updateBatch(const FlowKey<key_len> *flowkeys, const T *vals,
+                           int32_t n, int32_t width) {
+    for (int32_t i = 0; i < n; ++i)
+      update(flowkeys[i], vals[i]);
+  }
   /**
    * @brief Query the sketch for the estimated size of a flowkey
    *
@@ -119,6 +146,19 @@ public:
     }
     return 0;
   }
+  /**
+   * @brief Query a batch of flowkeys
+   * @details Same as calling query() on each of them, storing the estimates
+   * in `out`, which is what is done by default. A sketch may override it to
+   * hash and prefetch `width` flowkeys ahead of the ones being reduced, cf.
+   * Util::Interleave().
+   *
+   */
+  virtual void queryBatch(const FlowKey<key_len> *flowkeys, T *out, int32_t n,
+                          int32_t width) const {
+    for (int32_t i = 0; i < n; ++i)
+      out[i] = query(flowkeys[i]);
+  }
   /**
    * @brief Look up a flowkey in the sketch
    * @return `true` means there exists; `false` otherwise.
@@ -0,0 +1,295 @@
+/**
+ * @file source.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Records read as they come, from a pipe, the standard input or a file
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "data.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace OmniSketch::Data {
+/**
+ * @brief Records of an unbounded stream, read in chunks as they come
+ *
+ * @details StreamData needs a regular file and keeps all its records in
+ * memory. A RecordSource instead reads a file descriptor, e.g., a FIFO fed by
+ * the pcap parser or the standard input, and hands out its records one chunk
+ * at a time, so a trace of any length runs in constant memory.
+ *
+ * A reader thread reads and decodes records into a bounded queue of `depth`
+ * chunks, while the consumer works on the chunk it got last; with the default
+ * depth of 2, reading and consuming are double-buffered. Once the queue is
+ * full, the reader waits for the consumer to give a chunk back, which it does
+ * by asking for the next one.
+ *
+ * A chunk holds the records of a single read, at most `chunk` of them, so
+ * records are handed out as soon as they arrive on a pipe. Bytes of a record
+ * split across reads are kept for the next one, and those of an incomplete
+ * record at the end of the stream are dropped.
+ *
+ * @tparam key_len length of flowkey
+ */
+template <int32_t key_len> class RecordSource {
+public:
+  /**
+   * @brief A chunk of records, in the order of the stream
+   *
+   */
+  using Chunk = std::vector<Record<key_len>>;
+
+private:
+  const DataFormat format;
+  const int32_t chunk_len;
+  int fd;
+  bool own_fd;
+  bool is_opened;
+
+  std::vector<Chunk> chunks;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<Chunk *> free_chunks; // for the reader to fill
+  std::deque<Chunk *> full_chunks; // for the consumer, in order
+  Chunk *held;                     // by the consumer
+  bool eof;
+  std::atomic<bool> stopped;
+  int64_t num_records;
+  int64_t num_waits;
+  std::thread reader;
+
+  RecordSource(const RecordSource &) = delete;
+  RecordSource(RecordSource &&) = delete;
+
+  /**
+   * @brief Main loop of the reader
+   *
+   */
+  void read();
+
+public:
+  /**
+   * @brief Construct by specifying the file descriptor to read, which is left
+   * open, the data format, the largest chunk and the chunks in the queue
+   *
+   * @warning An exception is thrown unless `chunk >= 1` and `depth >= 1`.
+   */
+  RecordSource(int fd, const DataFormat &format, int32_t chunk = 4096,
+               int32_t depth = 2);
+  /**
+   * @brief Construct by specifying the file to read, `-` for the standard
+   * input, and the rest as above
+   * @details Fails if the file cannot be opened, see succeed().
+   *
+   */
+  RecordSource(const std::string_view file_name, const DataFormat &format,
+               int32_t chunk = 4096, int32_t depth = 2);
+  /**
+   * @brief Stop the reader and close the file if it is opened here
+   *
+   */
+  ~RecordSource();
+  /**
+   * @brief Whether the file is opened
+   *
+   */
+  [[nodiscard]] bool succeed() const { return is_opened; }
+  /**
+   * @brief Wait for the next chunk of records
+   * @details The chunk got last is given back to the reader, so it is no
+   * longer to be used.
+   *
+   * @return the chunk, which is never empty, or `nullptr` once the stream is
+   * over or stop() is called
+   */
+  const Chunk *next();
+  /**
+   * @brief Make the reader stop within a tenth of a second, e.g., to stop
+   * waiting on a quiet pipe
+   * @details Async-signal-safe. Chunks already read are still handed out.
+   *
+   */
+  void stop() { stopped.store(true, std::memory_order_relaxed); }
+  /**
+   * @brief Records handed out so far
+   *
+   */
+  [[nodiscard]] int64_t size() const { return num_records; }
+  /**
+   * @brief Times next() waited for the reader, i.e., the consumer was faster
+   *
+   */
+  [[nodiscard]] int64_t waits() const { return num_waits; }
+};
+
+/**
+ * @brief Whether a file is to be read as it comes rather than as a whole,
+ * i.e., it is `-` for the standard input or a FIFO
+ *
+ */
+inline bool IsStream(const std::string_view file_name) {
+  std::error_code err;
+  return file_name == "-" ||
+         std::filesystem::is_fifo(std::filesystem::path(file_name), err);
+}
+
+} // namespace OmniSketch::Data
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Data {
+
+template <int32_t key_len>
+RecordSource<key_len>::RecordSource(int fd, const DataFormat &format,
+                                    int32_t chunk, int32_t depth)
+    : format(format), chunk_len(chunk), fd(fd), own_fd(false),
+      is_opened(fd >= 0), held(nullptr), eof(!is_opened), stopped(false),
+      num_records(0), num_waits(0) {
+  if (chunk < 1 || depth < 1)
+    throw std::invalid_argument(
+        "Invalid Argument: Chunk and depth should be positive, but got " +
+        std::to_string(chunk) + " and " + std::to_string(depth) +
+        " instead.");
+  if (key_len != format.getKeyLength()) {
+    throw std::runtime_error("Runtime Error: Keylen of Record(" +
+                             std::to_string(key_len) + ") and of DataFormat(" +
+                             std::to_string(format.getKeyLength()) +
+                             ") mismatch.");
+  }
+  chunks.resize(depth);
+  for (auto &buf : chunks) {
+    buf.reserve(chunk);
+    free_chunks.push_back(&buf);
+  }
+  if (is_opened)
+    reader = std::thread(&RecordSource::read, this);
+}
+
+template <int32_t key_len>
+RecordSource<key_len>::RecordSource(const std::string_view file_name,
+                                    const DataFormat &format, int32_t chunk,
+                                    int32_t depth)
+    : RecordSource(-1, format, chunk, depth) {
+  if (file_name == "-") {
+    fd = STDIN_FILENO;
+  } else {
+    fd = ::open(std::string(file_name).c_str(), O_RDONLY);
+    if (fd < 0) {
+      LOG(FATAL, fmt::format("Failed to open record file {}.", file_name));
+      return;
+    }
+    own_fd = true;
+  }
+  LOG(INFO, fmt::format("Streaming records from {}...", file_name));
+  is_opened = true;
+  eof = false;
+  reader = std::thread(&RecordSource::read, this);
+}
+
+template <int32_t key_len> RecordSource<key_len>::~RecordSource() {
+  stop();
+  {
+    // the reader may be waiting for a chunk back
+    std::lock_guard<std::mutex> lock(mutex);
+    cv.notify_all();
+  }
+  if (reader.joinable())
+    reader.join();
+  if (own_fd)
+    ::close(fd);
+}
+
+template <int32_t key_len> void RecordSource<key_len>::read() {
+  const size_t size = format.getRecordLength();
+  std::vector<int8_t> buf(size * chunk_len);
+  size_t filled = 0; // bytes of a record split across reads
+  pollfd pfd{fd, POLLIN, 0};
+  for (;;) {
+    Chunk *chunk;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [this] { return !free_chunks.empty() || stopped; });
+      if (stopped)
+        break;
+      chunk = free_chunks.front();
+      free_chunks.pop_front();
+    }
+    // wake up now and then to see whether it is stopped, and go on reading
+    // as long as not even a record is complete
+    while (!stopped) {
+      const int ready = ::poll(&pfd, 1, 100);
+      if (ready < 0 && errno != EINTR)
+        break;
+      if (ready <= 0)
+        continue;
+      const ssize_t got = ::read(fd, buf.data() + filled, buf.size() - filled);
+      if (got < 0 && errno == EINTR)
+        continue;
+      if (got <= 0)
+        break;
+      filled += got;
+      if (filled >= size)
+        break;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopped || filled < size) {
+      free_chunks.push_front(chunk);
+      break;
+    }
+    chunk->resize(filled / size);
+    const int8_t *ptr = buf.data();
+    for (auto &record : *chunk)
+      ptr = format.readAsFormat(record, ptr);
+    filled -= ptr - buf.data();
+    std::memmove(buf.data(), ptr, filled);
+    full_chunks.push_back(chunk);
+    cv.notify_all();
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  if (filled && !stopped)
+    LOG(WARNING, fmt::format("{} bytes of an incomplete record are dropped.",
+                             filled));
+  eof = true;
+  cv.notify_all();
+}
+
+template <int32_t key_len>
+const typename RecordSource<key_len>::Chunk *RecordSource<key_len>::next() {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (held) {
+    free_chunks.push_back(held);
+    held = nullptr;
+    cv.notify_all();
+  }
+  if (full_chunks.empty() && !eof)
+    num_waits++;
+  cv.wait(lock, [this] { return !full_chunks.empty() || eof; });
+  if (full_chunks.empty())
+    return nullptr;
+  held = full_chunks.front();
+  full_chunks.pop_front();
+  num_records += held->size();
+  return held;
+}
+
+} // namespace OmniSketch::Data
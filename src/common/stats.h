@@ -0,0 +1,159 @@
+/**
+ * @file stats.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Named statistics of sketches
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace OmniSketch::Util {
+
+/**
+ * @brief Named statistics of sketches, e.g., carries in CH or evictions
+ *
+ * @details Sketches record their diagnostics here instead of printing them.
+ * A statistic is named by a scope, usually the sketch or the component (e.g.,
+ * `"CH"`), and a name within the scope. There are three kinds:
+ * - counters, accumulated by add();
+ * - gauges, holding the last value set by set();
+ * - histograms of integer bins, accumulated by hist() or replaced as a whole
+ *   by setHist().
+ *
+ * Statistics are kept per thread, like Test::RowSink(), so that concurrent
+ * tests (cf. Test::Sweep) never mix and recording needs no synchronization.
+ * TestBase clears them when a test is constructed, and shows or exports them
+ * along with the metrics.
+ *
+ * Sketches record through the `STATS_*` macros below, which compile to
+ * nothing if `DISABLE_STATS` is defined. A record costs a lookup by name, so
+ * a hot path should rather count in a plain member and set the total when
+ * reporting, as CounterHierarchy::reportStats() does.
+ *
+ */
+class Stats {
+public:
+  /**
+   * @brief Kinds of statistics
+   *
+   */
+  enum Kind { COUNTER, GAUGE, HISTOGRAM };
+  /**
+   * @brief A statistic
+   *
+   */
+  struct Entry {
+    Kind kind;
+    int64_t count = 0;          // counter
+    double value = 0.0;         // gauge
+    std::vector<int64_t> bins;  // histogram
+  };
+  /**
+   * @brief Statistics by scope and then by name, both in lexical order
+   *
+   */
+  using Table =
+      std::map<std::string, std::map<std::string, Entry, std::less<>>,
+               std::less<>>;
+
+private:
+  static Table &table() {
+    thread_local Table tbl;
+    return tbl;
+  }
+  /**
+   * @brief Find or create a statistic
+   *
+   * @warning An exception is thrown if it exists with another kind.
+   */
+  static Entry &entry(std::string_view scope, std::string_view name,
+                      Kind kind);
+
+public:
+  /**
+   * @brief Add to a counter
+   *
+   */
+  static void add(std::string_view scope, std::string_view name,
+                  int64_t delta = 1) {
+    entry(scope, name, COUNTER).count += delta;
+  }
+  /**
+   * @brief Set a gauge
+   *
+   */
+  static void set(std::string_view scope, std::string_view name,
+                  double value) {
+    entry(scope, name, GAUGE).value = value;
+  }
+  /**
+   * @brief Add to a bin of a histogram
+   *
+   */
+  static void hist(std::string_view scope, std::string_view name, size_t bin,
+                   int64_t delta = 1) {
+    auto &bins = entry(scope, name, HISTOGRAM).bins;
+    if (bins.size() <= bin)
+      bins.resize(bin + 1);
+    bins[bin] += delta;
+  }
+  /**
+   * @brief Replace all the bins of a histogram
+   *
+   */
+  static void setHist(std::string_view scope, std::string_view name,
+                      std::vector<int64_t> bins) {
+    entry(scope, name, HISTOGRAM).bins = std::move(bins);
+  }
+  /**
+   * @brief All statistics of the calling thread
+   *
+   */
+  static const Table &all() { return table(); }
+  /**
+   * @brief Drop all statistics of the calling thread
+   *
+   */
+  static void clear() { table().clear(); }
+  /**
+   * @brief Write all statistics as a JSON object
+   * @details E.g., `{"CH": {"carries": [1024, 3], "overflow_rate": 0.01}}`.
+   * Histograms are arrays of bins, and gauges that are not finite are `null`.
+   *
+   */
+  static void writeJson(std::ostream &out);
+  /**
+   * @brief Write all statistics as CSV
+   * @details One line per counter or gauge, and one per bin of a histogram,
+   * under the header `Scope,Name,Bin,Value`. `Bin` is empty except for bins.
+   *
+   */
+  static void writeCsv(std::ostream &out);
+};
+
+} // namespace OmniSketch::Util
+
+#ifndef DISABLE_STATS
+#define STATS_ADD(scope, name, delta)                                          \
+  OmniSketch::Util::Stats::add((scope), (name), (delta))
+#define STATS_SET(scope, name, value)                                          \
+  OmniSketch::Util::Stats::set((scope), (name), (value))
+#define STATS_HIST(scope, name, bin, delta)                                    \
+  OmniSketch::Util::Stats::hist((scope), (name), (bin), (delta))
+#define STATS_SET_HIST(scope, name, bins)                                      \
+  OmniSketch::Util::Stats::setHist((scope), (name), (bins))
+#else
+#define STATS_ADD(scope, name, delta) ((void)0)
+#define STATS_SET(scope, name, value) ((void)0)
+#define STATS_HIST(scope, name, bin, delta) ((void)0)
+#define STATS_SET_HIST(scope, name, bins) ((void)0)
+#endif
@@ -0,0 +1,98 @@
+/**
+ * @file sweep.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Parameter sweeps over registered tests
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "registry.h"
+#include "test.h"
+#include "utils.h"
+
+#include <ostream>
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Run registered tests over a grid of parameters, concurrently
+ *
+ * @details The grid of a test is given by the table `sweep.NAME` of its config
+ * file, where `NAME` is the name in Registry. Keys are paths into the rest of
+ * the file, and every value is a list of candidates:
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.toml
+ * [sweep.CM]
+ * CM.para.depth = [2, 3, 4]
+ * CM.para.width = [8192, 16384, 31497]
+ *
+ * [sweep.CHCM] # reads CM.para as well
+ * CM.para.width = [8192, 16384, 31497]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * Each of the 9 combinations of CM overrides `CM.para.depth` and
+ * `CM.para.width` for one run of the test, cf.
+ * Util::ConfigParser::overrides(). Runs are put on a thread pool and share
+ * the records and ground truth, cf. Data::ShareData(). Every call to
+ * TestBase::show() yields a row, and rows are written as CSV in the order of
+ * runs, with one column per parameter and one per metric (cf. Test::Row).
+ * Every run starts from the same seeds of hashing classes, cf.
+ * Hash::AwareHash::reseed(), so accuracy does not depend on the number of
+ * threads or their scheduling.
+ *
+ * @note Concurrent runs compete for cores, caches and memory bandwidth, so
+ * rates are lower than those of a run on an idle machine. Sweep with a single
+ * thread when rates matter.
+ *
+ */
+class Sweep {
+private:
+  struct Run {
+    const Registry::Entry *entry;
+    std::string config_file;
+    toml::table patch;
+    std::vector<std::pair<std::string, std::string>> params;
+    std::vector<std::pair<std::string, Row>> rows;
+    bool failed = false;
+  };
+  std::vector<Run> runs;
+  /**
+   * @brief A parameter and its candidates
+   *
+   */
+  struct Dimension {
+    std::vector<std::string> path;
+    const toml::array *candidates;
+  };
+  /**
+   * @brief Collect the lists of candidates in a table, depth first
+   *
+   */
+  static bool collect(const toml::table &table, std::vector<std::string> &path,
+                      std::vector<Dimension> &dims);
+
+public:
+  /**
+   * @brief Add one run of a test per combination in the config file
+   * @details A config file without a `sweep.NAME` table adds a single run.
+   *
+   * @return `false` if the config file or its `sweep.NAME` table is malformed
+   */
+  bool add(const Registry::Entry &entry, const std::string &config_file);
+  /**
+   * @brief Number of runs added
+   *
+   */
+  size_t size() const { return runs.size(); }
+  /**
+   * @brief Carry out all the runs and write the rows as CSV
+   *
+   * @param num_threads number of threads, `0` for the number of hardware
+   * threads
+   * @param out         where CSV goes
+   * @return whether all runs succeeded
+   */
+  bool run(int32_t num_threads, std::ostream &out);
+};
+
+} // namespace OmniSketch::Test
@@ -9,12 +9,21 @@
 #pragma once
 
 // A bunch of files to include!
+#include "perf.h"
+#include "report.h"
 #include "sketch.h"
+#include "source.h"
+#include "stats.h"
+#include <atomic>
 #include <boost/any.hpp>
 #include <ctime>
+#include <functional>
 #include <map>
 #include <memory>
+#include <optional>
 #include <set>
+#include <thread>
+#include <vector>
 
 /**
  * @brief Testing classes and metrics
@@ -47,6 +56,7 @@ enum Metric {
   RATIO /** decoded ratio (in percentile), i.e., the ratio of #(decoded flows)
            in ground truth to #flows */
   ,
+  PERF /** hardware counters per operation (see Util::PerfCounters) */,
 };
 
 /**
@@ -72,6 +82,12 @@ public:
    *
    */
   std::vector<double> quantiles;
+  /**
+   * @brief Number of operations in flight if run as one batch, or 0 if run
+   * one by one
+   *
+   */
+  int32_t batch = 0;
 
   /**
    * @brief Read and parse the metric vector
@@ -94,7 +110,12 @@ public:
    * ```
    * XXX_dist = [a vector of double]
    * ```
-   * to specify the ticks.
+   * to specify the ticks. An optional line
+   * ```
+   * XXX_batch = [number of operations in flight]
+   * ```
+   * runs the routine as one batch, if it has a batched counterpart, e.g.,
+   * Sketch::SketchBase::queryBatch() for `query`.
    *
    * ### Example
    * Suppose we have the following toml file:
@@ -115,6 +136,40 @@ public:
   bool in(const Metric metric) const { return metric_set.count(metric); }
 };
 
+/**
+ * @brief Metrics of a test as (column, value) pairs
+ * @details Columns are named `Routine.METRIC` after the testing routine and
+ * the metric, e.g., `Update.RATE` or `HH.F1`. Values are in the units of
+ * Test::Metric. `PODF` comes with its threshold as `Routine.PODF.threshold`,
+ * `DIST` is a column per quantile, e.g., `Query.DIST<=0.1`, and `PERF` a
+ * column per hardware event, e.g., `Update.PERF.cycles`. Counters and gauges
+ * of Util::Stats follow as `Stats.scope.name`.
+ *
+ */
+using Row = std::vector<std::pair<std::string, std::string>>;
+/**
+ * @brief Receiver of the metrics shown in the calling thread
+ * @details Empty by default. Once set, TestBase::show() hands the metrics over
+ * to it as a Row, along with the show name, instead of printing them. Meant
+ * for drivers that collect results of many tests, e.g., sweeps.
+ *
+ */
+inline std::function<void(std::string_view, const Row &)> &RowSink() {
+  thread_local std::function<void(std::string_view, const Row &)> sink;
+  return sink;
+}
+/**
+ * @brief Export Util::Stats of the calling thread as the test node asks
+ * @details If the test node has a key `stats`, e.g., `stats = "cm.json"`, the
+ * statistics are written to that file, as JSON if it ends with `.json` and as
+ * CSV otherwise. Nothing is done without the key.
+ *
+ * @param config_file Path to the config file
+ * @param test_path   Path to the test node
+ */
+void ExportStats(const std::string_view config_file,
+                 const std::string_view test_path);
+
 /**
  * @brief Collection of metrics
  *
@@ -147,13 +202,26 @@ public:
  *   <tr>
  *        <td>testUpdate()</td>
  *        <td>[update()](@ref Sketch::SketchBase::update())</td>
+ *        <td>RATE, PERF</td>
+ *        <td>`update`</td>
+ *   </tr>
+ *   <tr>
+ *        <td>testUpdateBatch()</td>
+ *        <td>[updateBatch()](@ref Sketch::SketchBase::updateBatch())</td>
+ *        <td>RATE, PERF</td>
+ *        <td>`update`</td>
+ *   </tr>
+ *   <tr>
+ *        <td>testUpdateStream()</td>
+ *        <td>[updateBatch()](@ref Sketch::SketchBase::updateBatch())</td>
  *        <td>RATE</td>
  *        <td>`update`</td>
  *   </tr>
  *   <tr>
  *        <td>testQuery()</td>
- *        <td>[query()](@ref Sketch::SketchBase::query())</td>
- *        <td>RATE, ARE, AAE, ACC, PODF, DIST</td>
+ *        <td>[query()](@ref Sketch::SketchBase::query()) or
+ * [queryBatch()](@ref Sketch::SketchBase::queryBatch())</td>
+ *        <td>RATE, ARE, AAE, ACC, PODF, DIST, PERF</td>
  *        <td>`query`</td>
  *   </tr>
  *   <tr>
@@ -179,7 +247,7 @@ public:
  *   <tr>
  *        <td>testDecode()</td>
  *        <td>[decode()](@ref Sketch::SketchBase::decode())</td>
- *        <td>TIME, RATIO, ARE, AAE, ACC, PODF, DIST</td>
+ *        <td>TIME, RATIO, ARE, AAE, ACC, PODF, DIST, PERF</td>
  *        <td>`decode`</td>
  *   </tr>
  * </table>
@@ -198,6 +266,22 @@ private:
   Vec heavy_changer;
   Vec decode;
 
+  /**
+   * @brief Split records among `num_threads` threads, by flowkey or into
+   * contiguous chunks, keeping their order within each thread
+   *
+   */
+  static std::vector<std::vector<const Data::Record<key_len> *>>
+  partition(typename std::vector<Data::Record<key_len>>::const_iterator begin,
+            typename std::vector<Data::Record<key_len>>::const_iterator end,
+            int32_t num_threads, bool by_flow);
+  /**
+   * @brief Run `f(t)` on threads `t = 0, ..., num_threads - 1` at once
+   * @return microseconds from the moment all threads are ready to the moment
+   * the last one is done
+   */
+  template <typename F> static int64_t runParallel(int32_t num_threads, F &&f);
+
 protected:
   const std::string_view show_name;
   const std::string_view config_file;
@@ -242,9 +326,15 @@ public:
    */
   TestBase(const std::string_view show_name, const std::string_view config_file,
            const std::string_view test_path)
-      : show_name(show_name), config_file(config_file), test_path(test_path) {}
+      : show_name(show_name), config_file(config_file), test_path(test_path) {
+    Util::Stats::clear();
+  }
   /**
    * @brief Display metrics in a human-readable manner
+   * @details Statistics recorded by the sketch in Util::Stats since the test
+   * was constructed are shown as well, and exported if the config asks (see
+   * Test::ExportStats()). The metrics are also appended to the report, if
+   * any, see Test::Report.
    * @todo DIST
    */
   virtual void show() const final;
@@ -287,9 +377,60 @@ public:
              typename std::vector<Data::Record<key_len>>::const_iterator begin,
              typename std::vector<Data::Record<key_len>>::const_iterator end,
              Data::CntMethod cnt_method) final;
+  /**
+   * @brief Update a row of records as one batch
+   * @details Records in [begin, end) are handed over to
+   * Sketch::SketchBase::updateBatch() at once, with `width` of them in flight.
+   * Unlike testUpdate(), the whole batch is timed rather than each record.
+   *
+   */
+  virtual void testUpdateBatch(
+      std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr_sketch,
+      typename std::vector<Data::Record<key_len>>::const_iterator begin,
+      typename std::vector<Data::Record<key_len>>::const_iterator end,
+      Data::CntMethod cnt_method, int32_t width) final;
+  /**
+   * @brief Update the records of a stream as they come
+   * @details Each chunk of the source is handed over to
+   * Sketch::SketchBase::updateBatch(), with `width` of them in flight, until
+   * the stream is over. Only the updates are timed, not waiting for records,
+   * so `RATE` is that of the sketch whether reading keeps up or not.
+   *
+   * @return number of records updated
+   */
+  virtual int64_t
+  testUpdateStream(std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr_sketch,
+                   Data::RecordSource<key_len> &source,
+                   Data::CntMethod cnt_method, int32_t width) final;
+  /**
+   * @brief Update a row of records from `num_threads` threads at once
+   * @details The sketch should be safe to update concurrently, e.g.,
+   * Sketch::ConcurrentCMSketch. Records are split among the threads before
+   * the test, either by flowkey (`by_flow`), as receive-side scaling of a NIC
+   * does, or into contiguous chunks. The whole run is timed, so `RATE` is the
+   * aggregate rate of all threads.
+   *
+   */
+  virtual void testUpdateParallel(
+      std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr_sketch,
+      typename std::vector<Data::Record<key_len>>::const_iterator begin,
+      typename std::vector<Data::Record<key_len>>::const_iterator end,
+      Data::CntMethod cnt_method, int32_t num_threads, bool by_flow) final;
+  /**
+   * @brief Insert a row of records from `num_threads` threads at once
+   * @see testUpdateParallel()
+   *
+   */
+  virtual void testInsertParallel(
+      std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr_sketch,
+      typename std::vector<Data::Record<key_len>>::const_iterator begin,
+      typename std::vector<Data::Record<key_len>>::const_iterator end,
+      int32_t num_threads, bool by_flow) final;
   /**
    * @brief Query for each flow in ground truth
-   * @details You should override the Sketch::SketchBase::query() method.
+   * @details You should override the Sketch::SketchBase::query() method. With
+   * `query_batch` in the config, all flows are handed over to
+   * Sketch::SketchBase::queryBatch() at once instead and timed as a whole.
    *
    * @param ptr_sketch  pointer to the sketch
    * @param gnd_truth   ground truth
@@ -376,6 +517,69 @@ template <int32_t key_len, typename T> void TestBase<key_len, T>::runTest() {
 }
 
 template <int32_t key_len, typename T> void TestBase<key_len, T>::show() const {
+  static const char *names[] = {"SIZE", "TIME", "RATE", "ARE",  "AAE",  "ACC",
+                                "TP",   "FP",   "TN",   "FN",   "PRC",  "RCL",
+                                "F1",   "DIST", "PODF", "RATIO", "PERF"};
+  using Dist = std::pair<std::vector<double>, std::vector<double>>;
+  Row row;
+  auto flatten = [&row](const Vec &vec, const std::string_view prefix) {
+    for (const auto &[metric, any] : vec) {
+      std::string value;
+      if (any.type() == typeid(size_t)) {
+        value = std::to_string(boost::any_cast<size_t>(any));
+      } else if (any.type() == typeid(int64_t)) {
+        value = std::to_string(boost::any_cast<int64_t>(any));
+      } else if (any.type() == typeid(double)) {
+        value = fmt::format("{:g}", boost::any_cast<double>(any));
+      } else if (any.type() == typeid(std::pair<double, double>)) {
+        const auto podf = boost::any_cast<std::pair<double, double>>(any);
+        row.emplace_back(fmt::format("{}.PODF.threshold", prefix),
+                         fmt::format("{:g}", podf.first));
+        value = fmt::format("{:g}", podf.second);
+      } else if (any.type() == typeid(Dist)) {
+        const auto &[quantiles, dist] = *boost::any_cast<Dist>(&any);
+        for (size_t i = 0; i < quantiles.size() && i < dist.size(); ++i) {
+          row.emplace_back(fmt::format("{}.DIST<={:g}", prefix, quantiles[i]),
+                           fmt::format("{:g}", dist[i]));
+        }
+        continue;
+      } else if (any.type() == typeid(Util::PerfCounters::Sample)) {
+        for (const auto &[event, val] :
+             *boost::any_cast<Util::PerfCounters::Sample>(&any)) {
+          row.emplace_back(fmt::format("{}.PERF.{}", prefix, event),
+                           fmt::format("{:g}", val));
+        }
+        continue;
+      } else {
+        continue;
+      }
+      row.emplace_back(fmt::format("{}.{}", prefix, names[metric]), value);
+    }
+  };
+  flatten(size, "Size");
+  flatten(insert, "Insert");
+  flatten(lookup, "Lookup");
+  flatten(update, "Update");
+  flatten(query, "Query");
+  flatten(heavy_hitter, "HH");
+  flatten(heavy_changer, "HC");
+  flatten(decode, "Decode");
+  for (const auto &[scope, entries] : Util::Stats::all()) {
+    for (const auto &[name, stat] : entries) {
+      if (stat.kind == Util::Stats::COUNTER)
+        row.emplace_back(fmt::format("Stats.{}.{}", scope, name),
+                         std::to_string(stat.count));
+      else if (stat.kind == Util::Stats::GAUGE)
+        row.emplace_back(fmt::format("Stats.{}.{}", scope, name),
+                         fmt::format("{:g}", stat.value));
+    }
+  }
+  Report::write(show_name, config_file, test_path, row);
+  if (RowSink()) {
+    RowSink()(show_name, row);
+    return;
+  }
+
   auto foo = [](const Vec &vec, const std::string_view prefix) {
     if (vec.count(SIZE)) {
       assert(vec.at(SIZE).type() == typeid(size_t));
@@ -482,6 +686,14 @@ template <int32_t key_len, typename T> void TestBase<key_len, T>::show() const {
       fmt::print("{:>15}: {:g}%\n", fmt::format("{} Ratio", prefix),
                  boost::any_cast<double>(vec.at(RATIO)) * 1e2);
     }
+    if (vec.count(PERF)) {
+      assert(vec.at(PERF).type() == typeid(Util::PerfCounters::Sample));
+      for (const auto &[event, val] :
+           *boost::any_cast<Util::PerfCounters::Sample>(&vec.at(PERF))) {
+        fmt::print("{:>15}: {:g}/op\n", fmt::format("{} {}", prefix, event),
+                   val);
+      }
+    }
   };
   // prologue
   fmt::print("============ {:^18} ============\n", show_name);
@@ -502,8 +714,28 @@ template <int32_t key_len, typename T> void TestBase<key_len, T>::show() const {
   foo(heavy_changer, "HC");
   // decode
   foo(decode, "Decode");
+  // statistics
+  if (!Util::Stats::all().empty()) {
+    fmt::print("------------       Stats        ------------\n");
+    for (const auto &[scope, entries] : Util::Stats::all()) {
+      for (const auto &[name, stat] : entries) {
+        std::string value;
+        if (stat.kind == Util::Stats::COUNTER) {
+          value = std::to_string(stat.count);
+        } else if (stat.kind == Util::Stats::GAUGE) {
+          value = fmt::format("{:g}", stat.value);
+        } else {
+          for (size_t i = 0; i < stat.bins.size(); ++i)
+            value += (i ? " " : "") + std::to_string(stat.bins[i]);
+          value = "[" + value + "]";
+        }
+        fmt::print("{:>15}: {}\n", fmt::format("{}.{}", scope, name), value);
+      }
+    }
+  }
   // epilogue
   fmt::print("============================================\n");
+  ExportStats(config_file, test_path);
 }
 
 template <int32_t key_len, typename T>
@@ -541,16 +773,180 @@ void TestBase<key_len, T>::testUpdate(
   MetricVec metric_vec(config_file, test_path, "update");
 
   DEFINE_TIMERS;
-  for (auto ptr = begin; ptr != end; ptr++) {
+  if (metric_vec.in(Metric::PERF)) {
+    // timed as a whole, so that the counters see nothing but the sketch
+    Util::PerfCounters perf;
+    perf.start();
     START_TIMER;
-    ptr_sketch->update(ptr->flowkey,
-                       cnt_method == Data::InLength ? ptr->length : 1);
+    for (auto ptr = begin; ptr != end; ptr++)
+      ptr_sketch->update(ptr->flowkey,
+                         cnt_method == Data::InLength ? ptr->length : 1);
     STOP_TIMER;
+    perf.stop();
+    if (perf.available())
+      update[Metric::PERF] = perf.sample(end - begin);
+  } else {
+    for (auto ptr = begin; ptr != end; ptr++) {
+      START_TIMER;
+      ptr_sketch->update(ptr->flowkey,
+                         cnt_method == Data::InLength ? ptr->length : 1);
+      STOP_TIMER;
+    }
+  }
+  if (metric_vec.in(Metric::RATE))
+    update[Metric::RATE] = 1.0 * (end - begin) / TIMER_RESULT * 1e6;
+}
+
+template <int32_t key_len, typename T>
+void TestBase<key_len, T>::testUpdateBatch(
+    std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr_sketch,
+    typename std::vector<Data::Record<key_len>>::const_iterator begin,
+    typename std::vector<Data::Record<key_len>>::const_iterator end,
+    Data::CntMethod cnt_method, int32_t width) {
+  // config
+  MetricVec metric_vec(config_file, test_path, "update");
+
+  std::vector<FlowKey<key_len>> flowkeys;
+  std::vector<T> vals;
+  flowkeys.reserve(end - begin);
+  vals.reserve(end - begin);
+  for (auto ptr = begin; ptr != end; ptr++) {
+    flowkeys.push_back(ptr->flowkey);
+    vals.push_back(cnt_method == Data::InLength ? ptr->length : 1);
+  }
+
+  DEFINE_TIMERS;
+  std::optional<Util::PerfCounters> perf;
+  if (metric_vec.in(Metric::PERF))
+    perf.emplace();
+  if (perf)
+    perf->start();
+  START_TIMER;
+  ptr_sketch->updateBatch(flowkeys.data(), vals.data(),
+                          static_cast<int32_t>(flowkeys.size()), width);
+  STOP_TIMER;
+  if (perf) {
+    perf->stop();
+    if (perf->available())
+      update[Metric::PERF] = perf->sample(end - begin);
   }
   if (metric_vec.in(Metric::RATE))
     update[Metric::RATE] = 1.0 * (end - begin) / TIMER_RESULT * 1e6;
 }
 
+template <int32_t key_len, typename T>
+int64_t TestBase<key_len, T>::testUpdateStream(
+    std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr_sketch,
+    Data::RecordSource<key_len> &source, Data::CntMethod cnt_method,
+    int32_t width) {
+  // config
+  MetricVec metric_vec(config_file, test_path, "update");
+
+  std::vector<FlowKey<key_len>> flowkeys;
+  std::vector<T> vals;
+  int64_t count = 0;
+
+  DEFINE_TIMERS;
+  while (const auto *chunk = source.next()) {
+    flowkeys.clear();
+    vals.clear();
+    for (const auto &record : *chunk) {
+      flowkeys.push_back(record.flowkey);
+      vals.push_back(cnt_method == Data::InLength ? record.length : 1);
+    }
+    START_TIMER;
+    ptr_sketch->updateBatch(flowkeys.data(), vals.data(),
+                            static_cast<int32_t>(flowkeys.size()), width);
+    STOP_TIMER;
+    count += chunk->size();
+  }
+  STATS_SET("Source", "records", count);
+  STATS_SET("Source", "waits", source.waits());
+  if (metric_vec.in(Metric::RATE))
+    update[Metric::RATE] = 1.0 * count / TIMER_RESULT * 1e6;
+  return count;
+}
+
+template <int32_t key_len, typename T>
+std::vector<std::vector<const Data::Record<key_len> *>>
+TestBase<key_len, T>::partition(
+    typename std::vector<Data::Record<key_len>>::const_iterator begin,
+    typename std::vector<Data::Record<key_len>>::const_iterator end,
+    int32_t num_threads, bool by_flow) {
+  std::vector<std::vector<const Data::Record<key_len> *>> parts(num_threads);
+  const int64_t n = end - begin;
+  int64_t i = 0;
+  for (auto ptr = begin; ptr != end; ptr++, i++) {
+    const int32_t t =
+        by_flow ? std::hash<FlowKey<key_len>>()(ptr->flowkey) % num_threads
+                : i * num_threads / n;
+    parts[t].push_back(&*ptr);
+  }
+  return parts;
+}
+
+template <int32_t key_len, typename T>
+template <typename F>
+int64_t TestBase<key_len, T>::runParallel(int32_t num_threads, F &&f) {
+  std::atomic<int32_t> ready(0);
+  std::atomic<bool> go(false);
+  std::vector<std::thread> threads;
+  for (int32_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      ready++;
+      while (!go.load(std::memory_order_acquire))
+        std::this_thread::yield();
+      f(t);
+    });
+  }
+  while (ready.load() < num_threads)
+    std::this_thread::yield();
+  DEFINE_TIMERS;
+  START_TIMER;
+  go.store(true, std::memory_order_release);
+  for (auto &thread : threads)
+    thread.join();
+  STOP_TIMER;
+  return TIMER_RESULT;
+}
+
+template <int32_t key_len, typename T>
+void TestBase<key_len, T>::testUpdateParallel(
+    std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr_sketch,
+    typename std::vector<Data::Record<key_len>>::const_iterator begin,
+    typename std::vector<Data::Record<key_len>>::const_iterator end,
+    Data::CntMethod cnt_method, int32_t num_threads, bool by_flow) {
+  // config
+  MetricVec metric_vec(config_file, test_path, "update");
+
+  const auto parts = partition(begin, end, num_threads, by_flow);
+  const int64_t elapsed = runParallel(num_threads, [&](int32_t t) {
+    for (const Data::Record<key_len> *ptr : parts[t])
+      ptr_sketch->update(ptr->flowkey,
+                         cnt_method == Data::InLength ? ptr->length : 1);
+  });
+  if (metric_vec.in(Metric::RATE))
+    update[Metric::RATE] = 1.0 * (end - begin) / elapsed * 1e6;
+}
+
+template <int32_t key_len, typename T>
+void TestBase<key_len, T>::testInsertParallel(
+    std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr_sketch,
+    typename std::vector<Data::Record<key_len>>::const_iterator begin,
+    typename std::vector<Data::Record<key_len>>::const_iterator end,
+    int32_t num_threads, bool by_flow) {
+  // config
+  MetricVec metric_vec(config_file, test_path, "insert");
+
+  const auto parts = partition(begin, end, num_threads, by_flow);
+  const int64_t elapsed = runParallel(num_threads, [&](int32_t t) {
+    for (const Data::Record<key_len> *ptr : parts[t])
+      ptr_sketch->insert(ptr->flowkey);
+  });
+  if (metric_vec.in(Metric::RATE))
+    insert[Metric::RATE] = 1.0 * (end - begin) / elapsed * 1e6;
+}
+
 template <int32_t key_len, typename T>
 double TestBase<key_len, T>::testQuery(
     std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr_sketch,
@@ -566,6 +962,44 @@ double TestBase<key_len, T>::testQuery(
   int32_t needed_turns = gnd_truth.size() * 1;
   int32_t finished_turns = 0;
 
+  // with PERF or in a batch, query all flows beforehand as a whole, so that
+  // the counters see nothing but the sketch
+  std::vector<T> estimated;
+  if (metric_vec.batch > 0) {
+    std::vector<FlowKey<key_len>> flowkeys;
+    flowkeys.reserve(gnd_truth.size());
+    for (const auto &kv : gnd_truth)
+      flowkeys.push_back(kv.get_left());
+    estimated.resize(flowkeys.size());
+
+    std::optional<Util::PerfCounters> perf;
+    if (metric_vec.in(Metric::PERF))
+      perf.emplace();
+    if (perf)
+      perf->start();
+    START_TIMER;
+    ptr_sketch->queryBatch(flowkeys.data(), estimated.data(),
+                           static_cast<int32_t>(flowkeys.size()),
+                           metric_vec.batch);
+    STOP_TIMER;
+    if (perf) {
+      perf->stop();
+      if (perf->available())
+        query[Metric::PERF] = perf->sample(needed_turns);
+    }
+  } else if (metric_vec.in(Metric::PERF)) {
+    estimated.reserve(gnd_truth.size());
+    Util::PerfCounters perf;
+    perf.start();
+    START_TIMER;
+    for (const auto &kv : gnd_truth)
+      estimated.push_back(ptr_sketch->query(kv.get_left()));
+    STOP_TIMER;
+    perf.stop();
+    if (perf.available())
+      query[Metric::PERF] = perf.sample(needed_turns);
+  }
+
   for (const auto &kv : gnd_truth) {
     /*
     if(kv.get_right() < 1000)
@@ -573,9 +1007,14 @@ double TestBase<key_len, T>::testQuery(
       break;
     }
     */
-    START_TIMER;
-    T estimated_size = ptr_sketch->query(kv.get_left());
-    STOP_TIMER;
+    T estimated_size;
+    if (estimated.empty()) {
+      START_TIMER;
+      estimated_size = ptr_sketch->query(kv.get_left());
+      STOP_TIMER;
+    } else {
+      estimated_size = estimated[finished_turns];
+    }
     // update RE, AE, Correct Rate, PODF
     double RE = static_cast<double>(std::abs(kv.get_right() - estimated_size)) /
                 kv.get_right();
@@ -618,7 +1057,7 @@ double TestBase<key_len, T>::testQuery(
     query[Metric::PODF] =
         // std::make_pair(metric_vec.podf, podf_cnt / gnd_truth.size());
         std::make_pair(metric_vec.podf, podf_cnt / needed_turns);
-        printf("PODF::TOTAL %d FLOWS\n", needed_turns);
+    STATS_SET("Query", "podf_flows", needed_turns);
   }
   if (measure_dist) {
     for (auto &v : dist)
@@ -778,9 +1217,20 @@ double TestBase<key_len, T>::testDecode(
   const bool measure_dist = metric_vec.in(Metric::DIST);
   std::vector<double> dist(metric_vec.quantiles.size()); // zero initialized
 
+  std::optional<Util::PerfCounters> perf;
+  if (metric_vec.in(Metric::PERF))
+    perf.emplace();
+  if (perf)
+    perf->start();
   START_TIMER;
   Data::Estimation<key_len, T> decoded = ptr_sketch->decode();
   STOP_TIMER;
+  if (perf) {
+    perf->stop();
+    // per flow in the ground truth
+    if (perf->available())
+      decode[Metric::PERF] = perf->sample(gnd_truth.size());
+  }
 
   for (const auto &kv : decoded) {
     if (gnd_truth.count(kv.get_left())) {
@@ -808,7 +1258,7 @@ double TestBase<key_len, T>::testDecode(
   if (metric_vec.in(Metric::RATIO)) {
     decode[Metric::RATIO] = decoded_flows / gnd_truth.size();
   }
-  printf("DECODE GND TRUTH SIZE: %ld\n", gnd_truth.size());
+  STATS_SET("Decode", "truth_flows", gnd_truth.size());
 
   double ans = 1;
   if((int32_t)decoded_flows == gnd_truth.size())
@@ -0,0 +1,173 @@
+/**
+ * @file thread_pool.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief A fixed-size thread pool
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace OmniSketch::Util {
+
+/**
+ * @brief A fixed-size thread pool
+ *
+ * @details Tasks are run in FIFO order by a fixed number of workers. Besides
+ * plain task submission, parallelFor() splits an index range into contiguous
+ * chunks, so a caller that writes per-chunk results and concatenates them in
+ * chunk order gets exactly the same output as a serial loop.
+ *
+ * A parallelFor() issued from inside a worker runs serially on that worker,
+ * so nested parallelism (e.g., a sketch learning in parallel while being
+ * itself tested on the pool) never deadlocks.
+ *
+ */
+class ThreadPool {
+private:
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> tasks;
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool stop;
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool(ThreadPool &&) = delete;
+  /**
+   * @brief Main loop of a worker
+   *
+   */
+  void work();
+  /**
+   * @brief Whether the calling thread is a worker of any pool
+   *
+   */
+  static bool &inWorker();
+
+public:
+  /**
+   * @brief Construct by specifying the number of workers
+   *
+   * @param num_threads number of workers, `0` for the number of hardware
+   * threads
+   */
+  explicit ThreadPool(int32_t num_threads = 0);
+  /**
+   * @brief Finish the queued tasks and join the workers
+   *
+   */
+  ~ThreadPool();
+  /**
+   * @brief Number of workers
+   *
+   */
+  int32_t numThreads() const {
+    return static_cast<int32_t>(workers.size());
+  }
+  /**
+   * @brief The process-wide pool shared by all sketches
+   * @details Created on first use with one worker per hardware thread.
+   *
+   */
+  static ThreadPool &global();
+  /**
+   * @brief Submit a task
+   *
+   * @return a future holding the result of the task
+   */
+  template <typename F>
+  std::future<std::invoke_result_t<std::decay_t<F>>> submit(F &&f);
+  /**
+   * @brief Run `f(lo, hi)` over contiguous chunks of `[begin, end)`
+   * @details Blocks until all chunks are done. The calling thread runs the
+   * first chunk itself.
+   *
+   * @param begin   first index
+   * @param end     one past the last index
+   * @param f       callable of signature `void(int64_t lo, int64_t hi)`
+   * @param max_chunks  upper bound of the number of chunks, `0` for one chunk
+   * per worker
+   */
+  template <typename F>
+  void parallelFor(int64_t begin, int64_t end, F &&f, int32_t max_chunks = 0);
+};
+
+} // namespace OmniSketch::Util
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Util {
+
+template <typename F>
+std::future<std::invoke_result_t<std::decay_t<F>>> ThreadPool::submit(F &&f) {
+  using R = std::invoke_result_t<std::decay_t<F>>;
+  auto task =
+      std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+  std::future<R> ret = task->get_future();
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    tasks.emplace([task]() { (*task)(); });
+  }
+  cv.notify_one();
+  return ret;
+}
+
+template <typename F>
+void ThreadPool::parallelFor(int64_t begin, int64_t end, F &&f,
+                             int32_t max_chunks) {
+  if (begin >= end)
+    return;
+  int64_t chunks = numThreads() + 1; // workers plus the caller
+  if (max_chunks > 0 && max_chunks < chunks)
+    chunks = max_chunks;
+  if (chunks > end - begin)
+    chunks = end - begin;
+  if (chunks <= 1 || inWorker()) {
+    f(begin, end);
+    return;
+  }
+  const int64_t step = (end - begin) / chunks, rem = (end - begin) % chunks;
+  auto lower = [&](int64_t c) { return begin + c * step + std::min(c, rem); };
+
+  std::vector<std::future<void>> pending;
+  pending.reserve(chunks - 1);
+  for (int64_t c = 1; c < chunks; ++c) {
+    pending.push_back(
+        submit([&f, lo = lower(c), hi = lower(c + 1)]() { f(lo, hi); }));
+  }
+  // chunks in flight refer to `f`, so wait for all of them before rethrowing
+  std::exception_ptr err;
+  try {
+    f(lower(0), lower(1));
+  } catch (...) {
+    err = std::current_exception();
+  }
+  for (auto &fut : pending) {
+    try {
+      fut.get();
+    } catch (...) {
+      if (!err)
+        err = std::current_exception();
+    }
+  }
+  if (err)
+    std::rethrow_exception(err);
+}
+
+} // namespace OmniSketch::Util
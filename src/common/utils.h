@@ -38,6 +38,22 @@ template <typename T> T Mangle(T key) {
 }
 #undef MANGLE_MAGIC
 
+/**
+ * @brief Scramble a 64-bit integer so that every output bit depends on every
+ * input bit
+ * @details The finalizer of MurmurHash3. It is a bijection, cheap enough to
+ * derive several independent-looking values from one hash value.
+ *
+ */
+inline uint64_t Mix64(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
 /**
  * @brief Compute primality of a 32-bit number
  *
@@ -176,8 +192,19 @@ public:
    * @brief Open the config file
    *
    * @param config_file path to the config file
+   *
+   * @note overrides() of the calling thread are merged into the file.
    */
   ConfigParser(const std::string_view config_file);
+  /**
+   * @brief Values that take precedence over config files, per thread
+   * @details A table laid out in the same way as config files. Every parser
+   * constructed in the calling thread merges it into the file it opens, so
+   * that, e.g., `CM.para.width` set here is what a test reads whatever the
+   * file says. Empty by default.
+   *
+   */
+  static toml::table &overrides();
   /**
    * @brief Return whether the parsing succeeds
    *
@@ -228,6 +255,12 @@ public:
    *
    */
   void setWorkingNode(const std::string_view path = "");
+  /**
+   * @brief The working node as a table, e.g., to walk through all its keys
+   *
+   * @return `nullptr` if the working node is not a table.
+   */
+  const toml::table *workingTable() const { return node.as_table(); }
   /**
    * @brief Get the configuration and store it directly into the object.
    *
@@ -2,11 +2,13 @@ import sys, os, re
 
 def help(name: str):
   print("usage:")
-  print(f"  {name} [input_file]\n")
+  print(f"  {name} [input_file] [short_name]\n")
   print(f"explanation:")
   print(f"  The input file should be XXXTest.h. "
         f"The last three lines of the file should contain the author's name, "
-        f"default config file, and template header for the driver.")
+        f"default config file, and template header for the driver. "
+        f"If a short name is given, an entry registering the test under "
+        f"that name is generated as well, to be linked into omnisketch.")
   sys.exit(-1)
 
 def extract(line: str, argv):
@@ -27,7 +29,7 @@ def main(argv):
   file, author, config, template = "", "", "", ""
   has_template = False
 
-  if len(argv) != 2:
+  if len(argv) not in (2, 3):
     help(argv[0])
   if not argv[1].endswith("Test.h"):
     print(f"({argv[0]}) File name must end with Test.h, got {argv[1]}.")
@@ -64,6 +66,7 @@ def main(argv):
  */
 
 #include <sketch_test/{file}Test.h>
+#include <common/report.h>
 #include <getopt.h>
 #include <iostream>
 
@@ -78,13 +81,17 @@ int main(int argc, char *argv[]) {{
   // parse command line arguments
   int opt;
   option options[] = {{{{"config", required_argument, nullptr, 'c'}},
+                      {{"report", required_argument, nullptr, 'r'}},
                       {{"help", no_argument, nullptr, 'h'}},
                       {{"verbose", no_argument, nullptr, 'v'}}}};
-  while ((opt = getopt_long(argc, argv, "c:hv", options, nullptr)) != -1) {{
+  while ((opt = getopt_long(argc, argv, "c:r:hv", options, nullptr)) != -1) {{
     switch (opt) {{
     case 'c':
       config_file = optarg;
       break;
+    case 'r':
+      Test::Report::path() = optarg;
+      break;
     case 'h':
       Help(argv[0]); // never return
       break;
@@ -102,11 +109,37 @@ int main(int argc, char *argv[]) {{
 }}
 
 static void Help(const char *ptr) {{
-  fmt::print("Usage: {{}} [-c config]\\n", ptr);
+  fmt::print("Usage: {{}} [-c config] [-r report.jsonl|report.csv]\\n", ptr);
   exit(0);
 }}"""
     with open(f"driver/{driver_name}", "w") as fp:
       fp.write(driver)
 
+    if len(argv) == 3:
+      entry_name = file + "Entry.cpp"
+      entry = f"""/**
+ * @file {entry_name}
+ * @author {author}
+ * @brief Registry entry of {sketch_name}
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <common/registry.h>
+#include <sketch_test/{file}Test.h>
+
+using namespace OmniSketch;
+
+static Test::Registrar registrar(
+    "{argv[2]}", "{file}", "{config}", [](const std::string &config_file) {{
+      auto ptr =
+          std::make_unique<Test::{file}Test{template}>(config_file);
+      ptr->runTest();
+    }});
+"""
+      with open(f"driver/{entry_name}", "w") as fp:
+        fp.write(entry)
+
 if __name__ == "__main__":
   main(sys.argv)
\ No newline at end of file
@@ -8,6 +8,7 @@
  */
 #include <common/hash.h>
 #include <common/utils.h>
+#include <random>
 
 //-----------------------------------------------------------------------------
 //
@@ -17,32 +18,47 @@
 
 namespace OmniSketch::Hash {
 
+namespace {
+/**
+ * @brief State behind the seeds of AwareHash, one per thread so that tests
+ * run concurrently draw the same seeds as they would alone
+ *
+ */
+struct SeedState {
+  int32_t index = 0;
+  std::minstd_rand rng;
+};
+thread_local SeedState seed_state;
+} // namespace
+
 AwareHash::AwareHash(int32_t reset) {
   static const int32_t GEN_INIT_MAGIC = 388650253;
   static const int32_t GEN_SCALE_MAGIC = 388650319;
   static const int32_t GEN_HARDENER_MAGIC = 1176845762;
-  static int32_t index = 0;
-  static uint64_t seed = 0;
-  static AwareHash gen_hash(GEN_INIT_MAGIC, GEN_SCALE_MAGIC,
-                            GEN_HARDENER_MAGIC);
+  static const AwareHash gen_hash(GEN_INIT_MAGIC, GEN_SCALE_MAGIC,
+                                  GEN_HARDENER_MAGIC);
+  SeedState &state = seed_state;
   if(!reset){                         
-    seed = rand();
+    uint64_t seed = state.rng();
 
     uint64_t mangled;
-    mangled = Util::Mangle(seed + (index++));
+    mangled = Util::Mangle(seed + (state.index++));
     init = gen_hash((const uint8_t *)&mangled, sizeof(uint64_t));
-    mangled = Util::Mangle(seed + (index++));
+    mangled = Util::Mangle(seed + (state.index++));
     scale = gen_hash((const uint8_t *)&mangled, sizeof(uint64_t));
-    mangled = Util::Mangle(seed + (index++));
+    mangled = Util::Mangle(seed + (state.index++));
     hardener = gen_hash((const uint8_t *)&mangled, sizeof(uint64_t));
   }
   else{
-    index = 20;
-    seed = 0;
-    srand(1);
+    state.index = 20;
+    state.rng.seed(1);
   }
 }
 
+void AwareHash::reseed() {
+  seed_state = SeedState();
+}
+
 uint64_t AwareHash::hash(const uint8_t *data, const int32_t n) const {
   int32_t len = n;
   uint64_t result = init;
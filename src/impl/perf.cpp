@@ -0,0 +1,152 @@
+/**
+ * @file perf.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Implementation of hardware performance counters
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <common/logger.h>
+#include <common/perf.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fmt/core.h>
+#include <mutex>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace OmniSketch::Util {
+
+const char *const PerfCounters::names[PerfCounters::NUM_EVENTS] = {
+    "cycles", "instructions", "llc_misses", "branch_misses", "dtlb_misses"};
+
+#ifdef __linux__
+/**
+ * @brief Open an event of the calling thread in user space, disabled
+ *
+ * @return the file descriptor, or -1 with `errno` set
+ */
+static int Open(uint32_t type, uint64_t config) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+/**
+ * @brief Config of a read miss of a hardware cache
+ *
+ */
+static constexpr uint64_t CacheMiss(uint64_t cache) {
+  return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+#endif
+
+PerfCounters::PerfCounters() {
+  for (int i = 0; i < NUM_EVENTS; ++i) {
+    fds[i] = -1;
+    counts[i] = 0;
+  }
+#ifdef __linux__
+  const std::pair<uint32_t, uint64_t> events[NUM_EVENTS] = {
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {PERF_TYPE_HW_CACHE, CacheMiss(PERF_COUNT_HW_CACHE_LL)},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+      {PERF_TYPE_HW_CACHE, CacheMiss(PERF_COUNT_HW_CACHE_DTLB)}};
+  int error = 0;
+  for (int i = 0; i < NUM_EVENTS; ++i) {
+    fds[i] = Open(events[i].first, events[i].second);
+    if (fds[i] < 0)
+      error = errno;
+  }
+  if (available())
+    return;
+  static std::once_flag warned;
+  std::call_once(warned, [error]() {
+    LOG(WARNING,
+        fmt::format("Hardware counters unavailable: perf_event_open: {}. "
+                    "Check kernel.perf_event_paranoid.",
+                    std::strerror(error)));
+  });
+#else
+  static std::once_flag warned;
+  std::call_once(warned, []() {
+    LOG(WARNING, "Hardware counters are only supported on Linux.");
+  });
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (int fd : fds) {
+    if (fd >= 0)
+      close(fd);
+  }
+#endif
+}
+
+bool PerfCounters::available() const {
+  for (int fd : fds) {
+    if (fd >= 0)
+      return true;
+  }
+  return false;
+}
+
+void PerfCounters::start() {
+#ifdef __linux__
+  for (int fd : fds) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#endif
+}
+
+void PerfCounters::stop() {
+#ifdef __linux__
+  for (int fd : fds) {
+    if (fd >= 0)
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+  for (int i = 0; i < NUM_EVENTS; ++i) {
+    counts[i] = 0;
+    // value, time enabled, time running
+    uint64_t buf[3];
+    if (fds[i] < 0 || read(fds[i], buf, sizeof(buf)) != sizeof(buf))
+      continue;
+    if (buf[2] == 0)
+      continue;
+    counts[i] = buf[2] < buf[1]
+                    ? static_cast<uint64_t>(1.0 * buf[0] * buf[1] / buf[2])
+                    : buf[0];
+  }
+#endif
+}
+
+PerfCounters::Sample PerfCounters::sample(size_t ops) const {
+  Sample ans;
+  for (int i = 0; i < NUM_EVENTS; ++i) {
+    if (fds[i] >= 0)
+      ans.emplace_back(names[i], ops ? 1.0 * counts[i] / ops : 0.0);
+  }
+  return ans;
+}
+
+} // namespace OmniSketch::Util
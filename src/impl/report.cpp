@@ -0,0 +1,338 @@
+/**
+ * @file report.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Implementation of reports of tests
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <common/logger.h>
+#include <common/report.h>
+#include <common/utils.h>
+
+#include <cctype>
+#include <ctime>
+#include <fmt/core.h>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <sys/utsname.h>
+#include <thread>
+#include <unistd.h>
+
+#ifndef OMNISKETCH_GIT_HASH
+#define OMNISKETCH_GIT_HASH "unknown"
+#endif
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Escape a string for JSON
+ *
+ */
+static std::string Escape(std::string_view str) {
+  std::string ans = "\"";
+  for (char c : str) {
+    switch (c) {
+    case '"':
+      ans += "\\\"";
+      break;
+    case '\\':
+      ans += "\\\\";
+      break;
+    case '\b':
+      ans += "\\b";
+      break;
+    case '\f':
+      ans += "\\f";
+      break;
+    case '\n':
+      ans += "\\n";
+      break;
+    case '\r':
+      ans += "\\r";
+      break;
+    case '\t':
+      ans += "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20)
+        ans += fmt::format("\\u{:04x}", static_cast<unsigned char>(c));
+      else
+        ans += c;
+    }
+  }
+  return ans + "\"";
+}
+
+/**
+ * @brief Whether a string is a number in JSON, i.e., matches
+ * `-?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?`
+ *
+ */
+static bool IsNumber(std::string_view str) {
+  size_t i = 0;
+  auto digits = [&]() {
+    const size_t begin = i;
+    while (i < str.size() && std::isdigit(static_cast<unsigned char>(str[i])))
+      i++;
+    return i - begin;
+  };
+  if (i < str.size() && str[i] == '-')
+    i++;
+  if (i < str.size() && str[i] == '0')
+    i++;
+  else if (!digits())
+    return false;
+  if (i < str.size() && str[i] == '.') {
+    i++;
+    if (!digits())
+      return false;
+  }
+  if (i < str.size() && (str[i] == 'e' || str[i] == 'E')) {
+    i++;
+    if (i < str.size() && (str[i] == '+' || str[i] == '-'))
+      i++;
+    if (!digits())
+      return false;
+  }
+  return i == str.size();
+}
+
+/**
+ * @brief A JSON value: a number as is, a non-finite one (as formatted, e.g.,
+ * `nan` or `-inf`) as null, and anything else as a string
+ *
+ */
+static std::string Value(const std::string &str) {
+  if (IsNumber(str))
+    return str;
+  if (str == "nan" || str == "-nan" || str == "inf" || str == "-inf")
+    return "null";
+  return Escape(str);
+}
+
+/**
+ * @brief Quote a CSV field if needed
+ *
+ */
+static std::string Quote(std::string_view field) {
+  if (field.find_first_of(",\"\n") == std::string::npos)
+    return std::string(field);
+  std::string ans = "\"";
+  for (char c : field) {
+    if (c == '"')
+      ans += '"';
+    ans += c;
+  }
+  return ans + "\"";
+}
+
+/**
+ * @brief Join fields as `key=value;...`
+ *
+ */
+static std::string Join(const std::vector<Report::Field> &fields) {
+  std::string ans;
+  for (const auto &[key, value] : fields)
+    ans += (ans.empty() ? "" : ";") + key + "=" + value;
+  return ans;
+}
+
+/**
+ * @brief Format the current UTC time
+ *
+ */
+static std::string Now(const char *format) {
+  const std::time_t now = std::time(nullptr);
+  std::tm tm;
+  gmtime_r(&now, &tm);
+  char buf[64];
+  std::strftime(buf, sizeof(buf), format, &tm);
+  return buf;
+}
+
+/**
+ * @brief Collect the leaves of a table as `prefix.key`
+ *
+ */
+static void Flatten(const toml::table &table, const std::string &prefix,
+                    std::vector<Report::Field> &fields) {
+  for (auto &&[key, value] : table) {
+    const std::string name = prefix + std::string(std::string_view(key));
+    if (value.is_table()) {
+      Flatten(*value.as_table(), name + ".", fields);
+      continue;
+    }
+    std::ostringstream str;
+    value.visit([&str](const auto &val) {
+      if constexpr (toml::is_string<decltype(val)>)
+        str << val.get();
+      else
+        str << val;
+    });
+    fields.emplace_back(name, str.str());
+  }
+}
+
+std::string &Report::path() {
+  static std::string file;
+  return file;
+}
+
+const std::string &Report::runId() {
+  static const std::string id =
+      Now("%Y%m%dT%H%M%SZ") + "-" + std::to_string(getpid());
+  return id;
+}
+
+const std::string &Report::gitHash() {
+  static const std::string hash = OMNISKETCH_GIT_HASH;
+  return hash;
+}
+
+const std::vector<Report::Field> &Report::hostInfo() {
+  static const std::vector<Field> info = []() {
+    std::vector<Field> ans;
+    char name[256] = {};
+    gethostname(name, sizeof(name) - 1);
+    ans.emplace_back("hostname", name);
+    utsname uts;
+    if (uname(&uts) == 0) {
+      ans.emplace_back("os", std::string(uts.sysname) + " " + uts.release);
+      ans.emplace_back("arch", uts.machine);
+    }
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    for (std::string line; std::getline(cpuinfo, line);) {
+      if (line.rfind("model name", 0) == 0 &&
+          line.find(':') != std::string::npos) {
+        ans.emplace_back("cpu", line.substr(line.find(':') + 2));
+        break;
+      }
+    }
+    ans.emplace_back("cpus",
+                     std::to_string(std::thread::hardware_concurrency()));
+    return ans;
+  }();
+  return info;
+}
+
+Report::Record Report::make(const std::string_view sketch,
+                            const std::string_view config_file,
+                            const std::string_view test_path,
+                            std::vector<Field> metrics) {
+  Record record;
+  record.run_id = runId();
+  record.time = Now("%Y-%m-%dT%H:%M:%SZ");
+  record.host = hostInfo();
+  record.git = gitHash();
+  record.sketch = sketch;
+  record.test = test_path;
+  record.metrics = std::move(metrics);
+  for (const auto &[key, value] : record.metrics) {
+    if (key == "Size.SIZE")
+      record.memory = std::stoull(value);
+  }
+
+  // the nodes next to the test node, e.g., CM.para next to CM.test
+  const size_t dot = test_path.rfind('.');
+  const std::string node(dot == std::string_view::npos
+                             ? std::string_view()
+                             : test_path.substr(0, dot));
+  const std::string test_key(test_path.substr(dot + 1));
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed())
+    return record;
+  parser.setWorkingNode(node);
+  const toml::table *table = parser.workingTable();
+  if (table && dot != std::string_view::npos) {
+    for (auto &&[key, value] : *table) {
+      const std::string name{std::string_view(key)};
+      if (name == test_key || name == "data")
+        continue;
+      if (value.is_table())
+        Flatten(*value.as_table(), name + ".", record.params);
+    }
+  }
+  parser.setWorkingNode(node + ".data");
+  parser.parseConfig(record.dataset, "data", false);
+  return record;
+}
+
+void Report::write(const std::string_view sketch,
+                   const std::string_view config_file,
+                   const std::string_view test_path,
+                   const std::vector<Field> &metrics) {
+  std::string file = path();
+  if (file.empty()) {
+    Util::ConfigParser parser(config_file);
+    if (!parser.succeed())
+      return;
+    parser.setWorkingNode(test_path);
+    if (!parser.parseConfig(file, "report", false))
+      return;
+  }
+  const Record record = make(sketch, config_file, test_path, metrics);
+  const std::string_view ext = ".csv";
+  const bool csv = file.size() >= ext.size() &&
+                   file.compare(file.size() - ext.size(), ext.size(), ext) == 0;
+
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  const bool empty = std::ifstream(file, std::ios::ate).tellg() <= 0;
+  std::ofstream out(file, std::ios::app);
+  if (!out) {
+    LOG(ERROR, fmt::format("Fail to open {} for the report.", file));
+    return;
+  }
+  if (csv) {
+    if (empty)
+      writeCsvHeader(out);
+    writeCsv(out, record);
+  } else {
+    writeJson(out, record);
+  }
+  LOG(VERBOSE, fmt::format("Report appended to {}.", file));
+}
+
+void Report::writeJson(std::ostream &out, const Record &record) {
+  auto object = [&out](const std::vector<Field> &fields) {
+    out << "{";
+    for (size_t i = 0; i < fields.size(); ++i) {
+      out << (i ? ", " : "") << Escape(fields[i].first) << ": "
+          << Value(fields[i].second);
+    }
+    out << "}";
+  };
+  out << "{\"run_id\": " << Escape(record.run_id)
+      << ", \"time\": " << Escape(record.time) << ", \"host\": ";
+  object(record.host);
+  out << ", \"git\": " << Escape(record.git)
+      << ", \"sketch\": " << Escape(record.sketch)
+      << ", \"test\": " << Escape(record.test) << ", \"params\": ";
+  object(record.params);
+  out << ", \"dataset\": " << Escape(record.dataset)
+      << ", \"memory\": " << record.memory << ", \"metrics\": ";
+  object(record.metrics);
+  out << "}\n";
+  out.flush();
+}
+
+void Report::writeCsvHeader(std::ostream &out) {
+  out << "RunID,Time,Host,Git,Sketch,Test,Params,Dataset,Memory,Metric,"
+         "Value\n";
+}
+
+void Report::writeCsv(std::ostream &out, const Record &record) {
+  const std::string prefix =
+      Quote(record.run_id) + "," + Quote(record.time) + "," +
+      Quote(Join(record.host)) + "," + Quote(record.git) + "," +
+      Quote(record.sketch) + "," + Quote(record.test) + "," +
+      Quote(Join(record.params)) + "," + Quote(record.dataset) + "," +
+      std::to_string(record.memory) + ",";
+  for (const auto &[metric, value] : record.metrics)
+    out << prefix << Quote(metric) << "," << Quote(value) << "\n";
+  out.flush();
+}
+
+} // namespace OmniSketch::Test
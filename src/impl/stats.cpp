@@ -0,0 +1,122 @@
+/**
+ * @file stats.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Implementation of statistics of sketches
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <cmath>
+#include <common/stats.h>
+#include <stdexcept>
+
+namespace OmniSketch::Util {
+
+/**
+ * @brief Escape a string for JSON
+ *
+ */
+static std::string Escape(std::string_view str) {
+  std::string ans = "\"";
+  for (char c : str) {
+    if (c == '"' || c == '\\')
+      ans += '\\';
+    if (c == '\n')
+      ans += "\\n";
+    else
+      ans += c;
+  }
+  return ans + "\"";
+}
+
+/**
+ * @brief Quote a CSV field if needed
+ *
+ */
+static std::string Quote(std::string_view field) {
+  if (field.find_first_of(",\"\n") == std::string::npos)
+    return std::string(field);
+  std::string ans = "\"";
+  for (char c : field) {
+    if (c == '"')
+      ans += '"';
+    ans += c;
+  }
+  return ans + "\"";
+}
+
+Stats::Entry &Stats::entry(std::string_view scope, std::string_view name,
+                           Kind kind) {
+  Table &tbl = table();
+  auto scope_iter = tbl.find(scope);
+  if (scope_iter == tbl.end())
+    scope_iter = tbl.emplace(std::string(scope), Table::mapped_type{}).first;
+  auto &entries = scope_iter->second;
+  auto iter = entries.find(name);
+  if (iter == entries.end())
+    iter = entries.emplace(std::string(name), Entry{kind}).first;
+  else if (iter->second.kind != kind) {
+    throw std::invalid_argument("Invalid Argument: Statistic " +
+                                std::string(scope) + "." + std::string(name) +
+                                " is recorded as another kind.");
+  }
+  return iter->second;
+}
+
+void Stats::writeJson(std::ostream &out) {
+  out << "{";
+  bool first_scope = true;
+  for (const auto &[scope, entries] : table()) {
+    out << (first_scope ? "" : ", ") << Escape(scope) << ": {";
+    first_scope = false;
+    bool first = true;
+    for (const auto &[name, stat] : entries) {
+      out << (first ? "" : ", ") << Escape(name) << ": ";
+      first = false;
+      switch (stat.kind) {
+      case COUNTER:
+        out << stat.count;
+        break;
+      case GAUGE:
+        if (std::isfinite(stat.value))
+          out << stat.value;
+        else
+          out << "null";
+        break;
+      case HISTOGRAM:
+        out << "[";
+        for (size_t i = 0; i < stat.bins.size(); ++i)
+          out << (i ? ", " : "") << stat.bins[i];
+        out << "]";
+        break;
+      }
+    }
+    out << "}";
+  }
+  out << "}\n";
+  out.flush();
+}
+
+void Stats::writeCsv(std::ostream &out) {
+  out << "Scope,Name,Bin,Value\n";
+  for (const auto &[scope, entries] : table()) {
+    for (const auto &[name, stat] : entries) {
+      const std::string prefix = Quote(scope) + "," + Quote(name) + ",";
+      switch (stat.kind) {
+      case COUNTER:
+        out << prefix << "," << stat.count << "\n";
+        break;
+      case GAUGE:
+        out << prefix << "," << stat.value << "\n";
+        break;
+      case HISTOGRAM:
+        for (size_t i = 0; i < stat.bins.size(); ++i)
+          out << prefix << i << "," << stat.bins[i] << "\n";
+        break;
+      }
+    }
+  }
+  out.flush();
+}
+
+} // namespace OmniSketch::Util
@@ -0,0 +1,199 @@
+/**
+ * @file sweep.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Implementation of parameter sweeps
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <common/data.h>
+#include <common/hash.h>
+#include <common/logger.h>
+#include <common/sweep.h>
+#include <common/thread_pool.h>
+#include <sstream>
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Join a path with '.'
+ *
+ */
+static std::string Join(const std::vector<std::string> &path) {
+  std::string ans = path[0];
+  for (size_t i = 1; i < path.size(); ++i)
+    ans += "." + path[i];
+  return ans;
+}
+
+/**
+ * @brief Quote a CSV field if needed
+ *
+ */
+static std::string Quote(const std::string &field) {
+  if (field.find_first_of(",\"\n") == std::string::npos)
+    return field;
+  std::string ans = "\"";
+  for (char c : field) {
+    if (c == '"')
+      ans += '"';
+    ans += c;
+  }
+  return ans + "\"";
+}
+
+bool Sweep::collect(const toml::table &table, std::vector<std::string> &path,
+                    std::vector<Dimension> &dims) {
+  for (auto &&[key, value] : table) {
+    const std::string name{std::string_view(key)};
+    path.push_back(name);
+    if (value.is_table()) {
+      if (!collect(*value.as_table(), path, dims))
+        return false;
+    } else if (value.is_array() && !value.as_array()->empty()) {
+      dims.push_back({path, value.as_array()});
+    } else {
+      LOG(ERROR, fmt::format("sweep.{} should be a non-empty list of "
+                             "candidates.",
+                             Join(path)));
+      return false;
+    }
+    path.pop_back();
+  }
+  return true;
+}
+
+bool Sweep::add(const Registry::Entry &entry, const std::string &config_file) {
+  toml::table tbl;
+  try {
+    tbl = toml::parse_file(config_file);
+  } catch (const toml::parse_error &err) {
+    LOG(ERROR, fmt::format("Parsing {} failed: {}", config_file,
+                           err.description()));
+    return false;
+  }
+
+  std::vector<Dimension> dims;
+  std::vector<std::string> path = {entry.name};
+  auto grid = tbl["sweep"][entry.name];
+  if (grid.is_table() && !collect(*grid.as_table(), path, dims))
+    return false;
+  if (dims.empty()) {
+    LOG(WARNING, fmt::format("Nothing to sweep in {}. {} runs once.",
+                             config_file, entry.name));
+  }
+
+  // enumerate combinations with the last dimension changing fastest
+  std::vector<size_t> choice(dims.size(), 0);
+  while (true) {
+    Run run;
+    run.entry = &entry;
+    run.config_file = config_file;
+    for (size_t d = 0; d < dims.size(); ++d) {
+      const toml::node &candidate = *dims[d].candidates->get(choice[d]);
+      toml::table *node = &run.patch;
+      for (size_t i = 1; i + 1 < dims[d].path.size(); ++i) {
+        auto iter = node->insert(dims[d].path[i], toml::table{}).first;
+        node = iter->second.as_table();
+      }
+      std::ostringstream value;
+      candidate.visit([&](const auto &val) {
+        node->insert_or_assign(dims[d].path.back(), val);
+        if constexpr (toml::is_string<decltype(val)>)
+          value << val.get(); // unquoted, e.g., memory = "1MB"
+        else
+          value << val;
+      });
+      run.params.emplace_back(
+          Join({dims[d].path.begin() + 1, dims[d].path.end()}), value.str());
+    }
+    runs.push_back(std::move(run));
+
+    size_t d = dims.size();
+    while (d > 0 && ++choice[d - 1] == dims[d - 1].candidates->size())
+      choice[--d] = 0;
+    if (d == 0)
+      break;
+  }
+  return true;
+}
+
+bool Sweep::run(int32_t num_threads, std::ostream &out) {
+  Data::ShareData() = true;
+  {
+    Util::ThreadPool pool(num_threads);
+    LOG(INFO, fmt::format("Sweeping {} runs on {} threads...", runs.size(),
+                          pool.numThreads()));
+    std::vector<std::future<void>> pending;
+    pending.reserve(runs.size());
+    for (Run &run : runs) {
+      pending.push_back(pool.submit([&run]() {
+        Util::ConfigParser::overrides() = run.patch;
+        RowSink() = [&run](std::string_view show_name, const Row &row) {
+          run.rows.emplace_back(std::string(show_name), row);
+        };
+        // seeds of hashing classes depend on the run only
+        Hash::AwareHash::reseed();
+        try {
+          run.entry->run(run.config_file);
+        } catch (const std::exception &exp) {
+          LOG(ERROR,
+              fmt::format("{} aborted: {}", run.entry->name, exp.what()));
+          run.failed = true;
+        }
+        if (run.rows.empty())
+          run.failed = true;
+        RowSink() = nullptr;
+        Util::ConfigParser::overrides() = toml::table{};
+      }));
+    }
+    for (auto &fut : pending)
+      fut.get();
+  }
+
+  // columns in order of appearance
+  std::vector<std::string> params, metrics;
+  auto append = [](std::vector<std::string> &columns, const std::string &col) {
+    if (std::find(columns.begin(), columns.end(), col) == columns.end())
+      columns.push_back(col);
+  };
+  for (const Run &run : runs) {
+    for (const auto &param : run.params)
+      append(params, param.first);
+    for (const auto &[show_name, row] : run.rows) {
+      for (const auto &metric : row)
+        append(metrics, metric.first);
+    }
+  }
+
+  out << "Name,Sketch";
+  for (const auto &col : params)
+    out << "," << Quote(col);
+  for (const auto &col : metrics)
+    out << "," << Quote(col);
+  out << "\n";
+  bool ok = true;
+  for (const Run &run : runs) {
+    ok &= !run.failed;
+    for (const auto &[show_name, row] : run.rows) {
+      out << Quote(run.entry->name) << "," << Quote(show_name);
+      for (const auto &col : params) {
+        auto iter = std::find_if(
+            run.params.begin(), run.params.end(),
+            [&col](const auto &param) { return param.first == col; });
+        out << "," << (iter == run.params.end() ? "" : Quote(iter->second));
+      }
+      for (const auto &col : metrics) {
+        auto iter = std::find_if(
+            row.begin(), row.end(),
+            [&col](const auto &metric) { return metric.first == col; });
+        out << "," << (iter == row.end() ? "" : Quote(iter->second));
+      }
+      out << "\n";
+    }
+  }
+  out.flush();
+  return ok;
+}
+
+} // namespace OmniSketch::Test
@@ -7,6 +7,7 @@
  *
  */
 #include <common/test.h>
+#include <fstream>
 
 namespace OmniSketch::Test {
 
@@ -63,6 +64,8 @@ MetricVec::MetricVec(const std::string_view file_path,
       metric_set.insert(Metric::PODF);
     } else if (!index.compare("RATIO")) {
       metric_set.insert(Metric::RATIO);
+    } else if (!index.compare("PERF")) {
+      metric_set.insert(Metric::PERF);
     }
   }
   // If distribution is specified
@@ -91,6 +94,32 @@ MetricVec::MetricVec(const std::string_view file_path,
       metric_set.erase(Metric::PODF);
     }
   }
+  // If run as one batch
+  parser.parseConfig(batch, std::string(term_name) + "_batch", false);
+}
+
+void ExportStats(const std::string_view config_file,
+                 const std::string_view test_path) {
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed())
+    return;
+  parser.setWorkingNode(test_path);
+
+  std::string file;
+  if (!parser.parseConfig(file, "stats", false))
+    return;
+  std::ofstream out(file);
+  if (!out) {
+    LOG(ERROR, fmt::format("Fail to open {} for statistics.", file));
+    return;
+  }
+  const std::string_view ext = ".json";
+  if (file.size() >= ext.size() &&
+      file.compare(file.size() - ext.size(), ext.size(), ext) == 0)
+    Util::Stats::writeJson(out);
+  else
+    Util::Stats::writeCsv(out);
+  LOG(VERBOSE, fmt::format("Statistics written to {}.", file));
 }
 
 } // namespace OmniSketch::Test
\ No newline at end of file
@@ -0,0 +1,57 @@
+/**
+ * @file thread_pool.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Implementation of the thread pool
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <common/thread_pool.h>
+
+namespace OmniSketch::Util {
+
+ThreadPool::ThreadPool(int32_t num_threads) : stop(false) {
+  if (num_threads <= 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  workers.reserve(num_threads);
+  for (int32_t i = 0; i < num_threads; ++i)
+    workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    stop = true;
+  }
+  cv.notify_all();
+  for (auto &worker : workers)
+    worker.join();
+}
+
+bool &ThreadPool::inWorker() {
+  thread_local bool in_worker = false;
+  return in_worker;
+}
+
+void ThreadPool::work() {
+  inWorker() = true;
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      cv.wait(lock, [this] { return stop || !tasks.empty(); });
+      if (stop && tasks.empty())
+        return;
+      task = std::move(tasks.front());
+      tasks.pop();
+    }
+    task();
+  }
+}
+
+ThreadPool &ThreadPool::global() {
+  static ThreadPool pool;
+  return pool;
+}
+
+} // namespace OmniSketch::Util
@@ -6,6 +6,7 @@
  * @copyright Copyright (c) 2022
  *
  */
+#include <atomic>
 #include <cassert>
 #include <common/logger.h>
 #include <common/utils.h>
@@ -56,8 +57,28 @@ uint32_t Net2Host32(uint32_t val) {
            static_cast<uint32_t>(Net2Host16(static_cast<uint16_t>(val >> 16)));
 }
 
+/**
+ * @brief Merge `src` into `dst`, with values in `src` preferred
+ *
+ */
+static void MergeTable(toml::table &dst, const toml::table &src) {
+  for (auto &&[key, value] : src) {
+    const std::string name{std::string_view(key)};
+    if (value.is_table() && dst[name].is_table()) {
+      MergeTable(*dst[name].as_table(), *value.as_table());
+    } else {
+      value.visit([&](const auto &node) { dst.insert_or_assign(name, node); });
+    }
+  }
+}
+
+toml::table &ConfigParser::overrides() {
+  thread_local toml::table table;
+  return table;
+}
+
 ConfigParser::ConfigParser(const std::string_view config_file) {
-  static bool emitted = false; // avoid burst of logging
+  static std::atomic<bool> emitted = false; // avoid burst of logging
   if (!emitted) {
     LOG(INFO, fmt::format("Loading config from {}...", config_file));
   }
@@ -71,6 +92,7 @@ ConfigParser::ConfigParser(const std::string_view config_file) {
     is_parsed = false;
     return;
   }
+  MergeTable(tbl, overrides());
   is_parsed = true;
   if (!emitted) {
     LOG(VERBOSE, "Config loaded.");
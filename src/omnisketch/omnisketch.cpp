@@ -0,0 +1,133 @@
+/**
+ * @file omnisketch.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief A single driver of all registered sketches
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <common/data.h>
+#include <common/logger.h>
+#include <common/registry.h>
+#include <common/report.h>
+#include <common/sweep.h>
+#include <fmt/core.h>
+#include <fstream>
+#include <getopt.h>
+
+using namespace OmniSketch;
+
+static void Help(const char *ptr);
+static void List();
+
+// Main
+int main(int argc, char *argv[]) {
+  std::string config_file;
+  bool sweep = false;
+  int32_t num_threads = 0;
+  std::string output_file = "sweep.csv";
+
+  // parse command line arguments
+  int opt;
+  option options[] = {{"config", required_argument, nullptr, 'c'},
+                      {"list", no_argument, nullptr, 'l'},
+                      {"sweep", no_argument, nullptr, 's'},
+                      {"jobs", required_argument, nullptr, 'j'},
+                      {"output", required_argument, nullptr, 'o'},
+                      {"report", required_argument, nullptr, 'r'},
+                      {"help", no_argument, nullptr, 'h'},
+                      {nullptr, 0, nullptr, 0}};
+  while ((opt = getopt_long(argc, argv, "c:lsj:o:r:h", options, nullptr)) != -1) {
+    switch (opt) {
+    case 'c':
+      config_file = optarg;
+      break;
+    case 's':
+      sweep = true;
+      break;
+    case 'j':
+      num_threads = std::atoi(optarg);
+      break;
+    case 'o':
+      output_file = optarg;
+      break;
+    case 'r':
+      Test::Report::path() = optarg;
+      break;
+    case 'l':
+      List(); // never return
+      break;
+    case 'h':
+    default:
+      Help(argv[0]); // never return
+      break;
+    }
+  }
+  if (optind == argc)
+    Help(argv[0]);
+
+  // look up all the names before running anything
+  std::vector<const Test::Registry::Entry *> tests;
+  for (int i = optind; i < argc; ++i) {
+    const auto *entry = Test::Registry::find(argv[i]);
+    if (!entry) {
+      LOG(ERROR, fmt::format("Unknown sketch {}. Try {} -l.", argv[i], argv[0]));
+      return -1;
+    }
+    tests.push_back(entry);
+  }
+
+  if (sweep) {
+    Test::Sweep runs;
+    for (const auto *entry : tests) {
+      if (!runs.add(*entry, config_file.empty() ? entry->config : config_file))
+        return -1;
+    }
+    std::ofstream fout(output_file);
+    if (!fout.is_open()) {
+      LOG(FATAL, fmt::format("Failed to open {}.", output_file));
+      return -1;
+    }
+    const bool ok = runs.run(num_threads, fout);
+    LOG(INFO, fmt::format("{} runs written to {}.", runs.size(), output_file));
+    return ok ? 0 : -1;
+  }
+
+  // tests on the same data load and summarize it only once
+  Data::ShareData() = true;
+  int ret = 0;
+  for (const auto *entry : tests) {
+    try {
+      entry->run(config_file.empty() ? entry->config : config_file);
+    } catch (const std::exception &exp) {
+      LOG(ERROR, fmt::format("{} aborted: {}", entry->name, exp.what()));
+      ret = -1;
+    }
+  }
+  return ret;
+}
+
+static void Help(const char *ptr) {
+  fmt::print("Usage: {} [-c config] [-r report] NAME...\n"
+             "       {} -s [-j threads] [-o output] [-r report] [-c config] "
+             "NAME...\n"
+             "       {} -l\n\n"
+             "Run the sketches named in a row, e.g., `{} CM CU CS`.\n"
+             "  -c config : Config file shared by all, or the default of each\n"
+             "  -s        : Sweep the grid in table sweep.NAME of the config\n"
+             "              instead, running concurrently\n"
+             "  -j threads: Threads of the sweep, one per core by default\n"
+             "  -o output : CSV of the sweep, one row per run (sweep.csv)\n"
+             "  -r report : Append a record of each test to the report, as\n"
+             "              CSV if it ends with .csv and JSON lines otherwise\n"
+             "  -l        : List the names of all sketches and exit\n"
+             "  -h        : Display this help message and exit\n",
+             ptr, ptr, ptr, ptr);
+  exit(0);
+}
+
+static void List() {
+  for (const auto *entry : Test::Registry::list())
+    fmt::print("{:<8} {:<32} {}\n", entry->name, entry->test, entry->config);
+  exit(0);
+}
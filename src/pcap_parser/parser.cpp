@@ -7,7 +7,45 @@
  *
  */
 #include "parser.h"
+#include <chrono>
 #include <getopt.h>
+#include <sketch/CMSketch.h>
+
+/**
+ * @brief Update a Count Min Sketch with the records, as `[parser.sketch]` in
+ * the config asks, and show the rate
+ *
+ * @return whether the config is well-formed
+ */
+bool UpdateSketch(const std::string &config_file,
+                  const OmniSketch::Util::PcapParser<13> &pcap_parser) {
+  using namespace OmniSketch;
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed())
+    return false;
+  parser.setWorkingNode("parser.sketch");
+  int32_t depth, width, in_flight = 1;
+  std::string method;
+  if (!parser.parseConfig(depth, "depth") ||
+      !parser.parseConfig(width, "width") ||
+      !parser.parseConfig(method, "cnt_method"))
+    return false;
+  parser.parseConfig(in_flight, "in_flight", false);
+  const Data::CntMethod cnt_method =
+      method == "InPacket" ? Data::InPacket : Data::InLength;
+
+  Sketch::CMSketch<13, int32_t> sketch(depth, width);
+  const auto start = std::chrono::steady_clock::now();
+  const int32_t count =
+      pcap_parser.updateSketch(sketch, cnt_method, in_flight);
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << "Count Min (depth " << depth << ", width " << width
+            << ") updated with " << count << " records at "
+            << count / elapsed.count() / 1e6
+            << " Mpps, parsing included" << std::endl;
+  return true;
+}
 
 int main(int argc, char *argv[]) {
   int option_index = 0;
@@ -62,5 +100,10 @@ int main(int argc, char *argv[]) {
                                                verbose_level);
   if (!pcap_parser.succeed())
     exit(-1);
+  if (pcap_parser.toSketch()) {
+    if (!UpdateSketch(config_file, pcap_parser))
+      exit(-1);
+    return 0;
+  }
   pcap_parser.dumpPcapPacketsInBinary();
 }
\ No newline at end of file
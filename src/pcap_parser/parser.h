@@ -18,7 +18,15 @@
 #include <TcpLayer.h>
 #include <UdpLayer.h>
 #include <common/data.h>
+#include <common/sketch.h>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 /**
  * @todo Support "txt", "null" & "pcap" mode
@@ -45,9 +53,11 @@ template <int32_t key_len> class PcapParser {
   const int32_t verbose_level;
   /**
    * @brief Type of output
+   * @details `SKETCH` writes nothing, as records go to a sketch by
+   * updateSketch().
    *
    */
-  enum Mode { NULLY, BINARY, TXT, PCAP } mode;
+  enum Mode { NULLY, BINARY, TXT, PCAP, SKETCH } mode;
   /**
    * @brief Output format (Only used in txt and binary mode)
    *
@@ -88,6 +98,22 @@ template <int32_t key_len> class PcapParser {
    *
    */
   int32_t flow_count;
+  /**
+   * @brief Whether to parse headers without PcapPlusPlus layers if possible
+   *
+   */
+  bool fast;
+  /**
+   * @brief Records handed over at a time, as well as packets read at a time
+   * while parsing in parallel
+   *
+   */
+  int32_t batch;
+  /**
+   * @brief Threads parsing packets (0 means parsing in the calling thread)
+   *
+   */
+  int32_t threads;
   /**
    * @brief Print file summary
    *
@@ -98,6 +124,43 @@ template <int32_t key_len> class PcapParser {
    *
    */
   pcpp::LinkLayerType getLinkLayerType() const;
+  /**
+   * @brief Outcome of parseHeaders()
+   *
+   */
+  enum Parsed { RECORD, SKIP, FALLBACK };
+  /**
+   * @brief Parse the headers of a packet straight from its bytes
+   * @details Ethernet (possibly with an 802.1Q tag), Linux cooked capture and
+   * raw IP frames carrying IPv4 are parsed here. Anything PcapPlusPlus would
+   * dissect differently, e.g., tunnels, ICMP errors quoting a datagram or
+   * truncated headers, is left to it, so that records are the same either way.
+   *
+   * @return `RECORD` if `record` is filled, `SKIP` if there is no record, or
+   * `FALLBACK` if PcapPlusPlus is needed
+   */
+  static Parsed parseHeaders(const uint8_t *data, int32_t len,
+                             pcpp::LinkLayerType link_type,
+                             Data::Record<key_len> &record);
+  /**
+   * @brief Parse a packet into a record
+   *
+   * @return whether there is a record, i.e., the packet is IPv4 and, for a
+   * 5-tuple, TCP or UDP
+   */
+  bool parsePacket(pcpp::RawPacket &raw_packet,
+                   Data::Record<key_len> &record) const;
+  /**
+   * @brief Parse packets in a pipeline, and hand their records to `take` in
+   * the order of packets until it returns `false`
+   * @details A thread reads batches of raw packets, `threads` threads parse
+   * them into records, and the calling thread takes the records of each batch
+   * in turn. At most `2 * threads + 2` batches are in flight. An exception in
+   * the reading or a parsing thread stops them all, and is rethrown in the
+   * calling thread once they are joined.
+   *
+   */
+  template <typename Take> void parseInParallel(Take &&take) const;
 
 public:
   /**
@@ -116,13 +179,42 @@ public:
    *
    */
   bool succeed() const { return is_succeed; }
+  /**
+   * @brief Return whether records are meant for a sketch rather than a file,
+   * i.e., the mode is "sketch"
+   *
+   */
+  bool toSketch() const { return mode == SKETCH; }
   /**
    * @brief Release the resources
    *
    */
   ~PcapParser();
+  /**
+   * @brief Hand the records of the pcap/snoop packets over in batches
+   * @details `func` is called with a `const std::vector<Data::Record<key_len>>
+   * &` of at most `batch` records each time, in the order of packets. Packets
+   * are filtered and counted just as in dumpPcapPacketsInBinary(). With
+   * `threads` in the config, packets are parsed in parallel, yet the records
+   * are the same; `func` is always called in the calling thread.
+   *
+   * @return Number of packets parsed (exclude filtered packet)
+   */
+  template <typename Func> int32_t parsePcapPackets(Func &&func) const;
+  /**
+   * @brief Update a sketch with the pcap/snoop packets in batches, without a
+   * record file in between
+   *
+   * @param width flowkeys in flight, see Sketch::SketchBase::updateBatch()
+   * @return Number of packets parsed (exclude filtered packet)
+   */
+  template <typename T>
+  int32_t updateSketch(Sketch::SketchBase<key_len, T> &sketch,
+                       Data::CntMethod cnt_method, int32_t width = 1) const;
   /**
    * @brief Dump the pcap/snoop packets in binary
+   * @details The output may also be a FIFO, e.g., read by a
+   * Data::RecordSource, to stream records without a file in between.
    *
    * @return Number of packets parsed (exclude filtered packet)
    */
@@ -150,7 +242,8 @@ PcapParser<key_len>::PcapParser(const std::string_view &config_file,
                                 const std::string_view &parser_path,
                                 const int32_t verbose)
     : verbose_level(verbose), is_succeed(true), reader(nullptr),
-      format(nullptr), packet_count(-1), flow_count(-1) {
+      format(nullptr), packet_count(-1), flow_count(-1), fast(false),
+      batch(4096), threads(0) {
   // Parse config
   ConfigParser parser(config_file);
   if (!parser.succeed()) {
@@ -165,8 +258,8 @@ PcapParser<key_len>::PcapParser(const std::string_view &config_file,
     is_succeed = false;
     input_pcap = "";
   }
-  if (!parser.parseConfig(output_pcap, "output")) {
-    is_succeed = false;
+  // required unless the mode is "null" or "sketch", as checked below
+  if (!parser.parseConfig(output_pcap, "output", false)) {
     output_pcap = "";
   }
   std::string output_mode;
@@ -182,15 +275,18 @@ PcapParser<key_len>::PcapParser(const std::string_view &config_file,
     mode = TXT;
   } else if (output_mode == "pcap") {
     mode = PCAP;
+  } else if (output_mode == "sketch") {
+    mode = SKETCH;
   } else {
     LOG(ERROR, fmt::format("{}: \"mode\" should be one of the \"null\", "
-                           "\"binary\", \"txt\", \"pcap\", but got {} instead.",
+                           "\"binary\", \"txt\", \"pcap\", \"sketch\", but "
+                           "got {} instead.",
                            config_file, output_mode));
     is_succeed = false;
   }
   if (!is_succeed)
     return;
-  if (mode != NULLY && output_pcap == "") {
+  if (mode != NULLY && mode != SKETCH && output_pcap == "") {
     LOG(ERROR, fmt::format("Output file cannot be empty."));
     is_succeed = false;
     return;
@@ -226,6 +322,22 @@ PcapParser<key_len>::PcapParser(const std::string_view &config_file,
   if (!parser.parseConfig(filter, "filter", false)) {
     filter = "";
   }
+  if (!parser.parseConfig(fast, "fast", false)) {
+    fast = false;
+  }
+  if (!parser.parseConfig(batch, "batch", false)) {
+    batch = 4096;
+  }
+  if (!parser.parseConfig(threads, "threads", false)) {
+    threads = 0;
+  }
+  if (batch < 1 || threads < 0) {
+    LOG(ERROR, fmt::format("{}: \"batch\" should be positive and \"threads\" "
+                           "non-negative, but got {} and {} instead.",
+                           config_file, batch, threads));
+    is_succeed = false;
+    return;
+  }
 
   // open pcap file
   reader = pcpp::IFileReaderDevice::getReader(input_pcap);
@@ -323,95 +435,374 @@ template <int32_t key_len> void PcapParser<key_len>::printFileSummary() const {
 }
 
 template <int32_t key_len>
-int32_t PcapParser<key_len>::dumpPcapPacketsInBinary() const {
-  if (!reader) {
-    throw std::runtime_error("Runtime Error: No pcap file is opened.");
+typename PcapParser<key_len>::Parsed
+PcapParser<key_len>::parseHeaders(const uint8_t *data, int32_t len,
+                                  pcpp::LinkLayerType link_type,
+                                  Data::Record<key_len> &record) {
+  // in host order
+  auto load16 = [](const uint8_t *ptr) -> uint16_t {
+    return static_cast<uint16_t>(ptr[0] << 8 | ptr[1]);
+  };
+  auto load32 = [](const uint8_t *ptr) -> uint32_t {
+    return static_cast<uint32_t>(ptr[0]) << 24 |
+           static_cast<uint32_t>(ptr[1]) << 16 |
+           static_cast<uint32_t>(ptr[2]) << 8 | static_cast<uint32_t>(ptr[3]);
+  };
+
+  // link layer
+  int32_t offset;
+  uint16_t ether_type;
+  switch (link_type) {
+  case pcpp::LINKTYPE_ETHERNET:
+    if (len < 14)
+      return FALLBACK;
+    ether_type = load16(data + 12);
+    offset = 14;
+    if (ether_type == 0x8100) { // 802.1Q
+      if (len < 18)
+        return FALLBACK;
+      ether_type = load16(data + 16);
+      offset = 18;
+    }
+    break;
+  case pcpp::LINKTYPE_LINUX_SLL:
+    if (len < 16)
+      return FALLBACK;
+    ether_type = load16(data + 14);
+    offset = 16;
+    break;
+  case pcpp::LINKTYPE_RAW:
+  case pcpp::LINKTYPE_DLT_RAW1:
+  case pcpp::LINKTYPE_DLT_RAW2:
+    ether_type = 0x0800;
+    offset = 0;
+    break;
+  default:
+    return FALLBACK;
   }
-  if (!format) {
-    throw std::runtime_error("Runtime Error: No format is specified.");
+  if (ether_type == 0x0806) // ARP
+    return SKIP;
+  if (ether_type != 0x0800)
+    return FALLBACK;
+
+  // IPv4 header, cut to the total length as PcapPlusPlus does
+  const uint8_t *ip = data + offset;
+  const int32_t ip_len = len - offset;
+  if (ip_len < 20 || (ip[0] >> 4) != 4)
+    return FALLBACK;
+  const int32_t header_len = (ip[0] & 0x0f) * 4;
+  const uint16_t length = load16(ip + 2);
+  if (header_len < 20 || length < header_len || ip_len < header_len)
+    return FALLBACK;
+  const int32_t payload_len = std::min<int32_t>(ip_len, length) - header_len;
+  const uint32_t src_ip = load32(ip + 12);
+  const uint32_t dst_ip = load32(ip + 16);
+  record.length = length;
+  if (key_len == 4) {
+    record.flowkey = FlowKey<key_len>(src_ip);
+    return RECORD;
+  } else if (key_len == 8) {
+    record.flowkey = FlowKey<key_len>(src_ip, dst_ip);
+    return RECORD;
   }
 
-  std::ofstream fout(output_pcap, std::ios::binary); // automatically destroyed
-  if (!fout.is_open()) {
-    throw std::runtime_error("Runtime Error: Could not open output file " +
-                             output_pcap);
+  // a fragment has no transport layer
+  if (load16(ip + 6) & 0x3fff)
+    return SKIP;
+  const uint8_t *l4 = ip + header_len;
+  uint16_t src_port, dst_port;
+  uint8_t protocol;
+  switch (ip[9]) {
+  case 6: // TCP
+    if (payload_len < 20 || (l4[12] >> 4) < 5 ||
+        payload_len < (l4[12] >> 4) * 4)
+      return FALLBACK;
+    src_port = load16(l4);
+    dst_port = load16(l4 + 2);
+    // as got from PcapPlusPlus, so that records stay the same
+    protocol = static_cast<uint8_t>(pcpp::TCP);
+    break;
+  case 17: // UDP
+    if (payload_len < 8)
+      return FALLBACK;
+    src_port = load16(l4);
+    dst_port = load16(l4 + 2);
+    // VXLAN and GTP-U carry packets of their own
+    if (src_port == 4789 || dst_port == 4789 || src_port == 2152 ||
+        dst_port == 2152)
+      return FALLBACK;
+    protocol = static_cast<uint8_t>(pcpp::UDP);
+    break;
+  case 1:  // ICMP
+  case 4:  // IP in IP
+  case 41: // IPv6 in IP
+  case 47: // GRE
+  case 51: // AH
+    return FALLBACK;
+  default:
+    return SKIP;
+  }
+  record.flowkey =
+      FlowKey<key_len>(src_ip, dst_ip, src_port, dst_port, protocol);
+  return RECORD;
+}
+
+template <int32_t key_len>
+bool PcapParser<key_len>::parsePacket(pcpp::RawPacket &raw_packet,
+                                      Data::Record<key_len> &record) const {
+  // timestamp
+  timespec time_nano = raw_packet.getPacketTimeStamp();
+  record.timestamp = time_nano.tv_sec * static_cast<uint64_t>(1000000) +
+                     time_nano.tv_nsec / 1000;
+  if (fast) {
+    switch (parseHeaders(raw_packet.getRawData(), raw_packet.getRawDataLen(),
+                         raw_packet.getLinkLayerType(), record)) {
+    case RECORD:
+      return true;
+    case SKIP:
+      return false;
+    case FALLBACK:
+      break;
+    }
+  }
+
+  // parse the raw packet into a parsed packet
+  pcpp::Packet parsed_packet(&raw_packet);
+  // IPv4 header
+  pcpp::IPv4Layer *ip_layer = parsed_packet.getLayerOfType<pcpp::IPv4Layer>();
+  if (!ip_layer)
+    return false;
+
+  uint32_t src_ip = Net2Host32(ip_layer->getSrcIPv4Address().toInt());
+  uint32_t dst_ip = Net2Host32(ip_layer->getDstIPv4Address().toInt());
+
+  uint8_t protocol;
+  uint16_t src_port, dst_port;
+  record.length = Net2Host16(ip_layer->getIPv4Header()->totalLength);
+
+  pcpp::TcpLayer *tcp_layer = parsed_packet.getLayerOfType<pcpp::TcpLayer>();
+  pcpp::UdpLayer *udp_layer = parsed_packet.getLayerOfType<pcpp::UdpLayer>();
+
+  if (tcp_layer) {
+    src_port = tcp_layer->getSrcPort();
+    dst_port = tcp_layer->getDstPort();
+    protocol = tcp_layer->getProtocol();
+  } else if (udp_layer) {
+    src_port = udp_layer->getSrcPort();
+    dst_port = udp_layer->getDstPort();
+    protocol = udp_layer->getProtocol();
+  } else if (key_len == 13) {
+    return false;
+  }
+
+  if (key_len == 4) {
+    record.flowkey = FlowKey<key_len>(src_ip);
+  } else if (key_len == 8) {
+    record.flowkey = FlowKey<key_len>(src_ip, dst_ip);
+  } else if (key_len == 13) {
+    record.flowkey =
+        FlowKey<key_len>(src_ip, dst_ip, src_port, dst_port, protocol);
+  }
+  return true;
+}
+
+template <int32_t key_len>
+template <typename Take>
+void PcapParser<key_len>::parseInParallel(Take &&take) const {
+  struct Batch {
+    int64_t seq;
+    std::vector<pcpp::RawPacket> packets;
+    int32_t size; // packets read
+    std::vector<Data::Record<key_len>> records;
+  };
+  const int32_t depth = 2 * threads + 2;
+  std::vector<Batch> batches(depth);
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<Batch *> free_batches; // for the reader to fill
+  std::deque<Batch *> raw_batches;  // for the parsers, in order
+  // parsed ones, at `seq % depth`, since batches are freed in order
+  std::vector<Batch *> parsed_batches(depth, nullptr);
+  int64_t num_batches = -1; // known once all packets are read
+  bool stopped = false;
+  std::exception_ptr error; // of the first thread that failed
+  for (auto &b : batches) {
+    b.packets.resize(batch);
+    b.records.reserve(batch);
+    free_batches.push_back(&b);
+  }
+
+  // a thread that fails stops the others, and the caller rethrows
+  auto fail = [&]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!error)
+      error = std::current_exception();
+    stopped = true;
+    cv.notify_all();
+  };
+
+  std::thread read_thread([&]() {
+    try {
+      for (int64_t seq = 0;; ++seq) {
+        Batch *b;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          cv.wait(lock, [&] { return !free_batches.empty() || stopped; });
+          if (stopped)
+            return;
+          b = free_batches.front();
+          free_batches.pop_front();
+        }
+        b->seq = seq;
+        b->size = 0;
+        while (b->size < batch && reader->getNextPacket(b->packets[b->size]))
+          b->size++;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (b->size)
+          raw_batches.push_back(b);
+        else
+          free_batches.push_back(b);
+        cv.notify_all();
+        if (b->size < batch) {
+          num_batches = b->size ? seq + 1 : seq;
+          return;
+        }
+      }
+    } catch (...) {
+      fail();
+    }
+  });
+  std::vector<std::thread> parse_threads;
+  for (int32_t i = 0; i < threads; ++i) {
+    parse_threads.emplace_back([&]() {
+      try {
+        Data::Record<key_len> record;
+        for (;;) {
+          Batch *b;
+          {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] {
+              return !raw_batches.empty() || num_batches >= 0 || stopped;
+            });
+            if (raw_batches.empty() || stopped)
+              return;
+            b = raw_batches.front();
+            raw_batches.pop_front();
+          }
+          b->records.clear();
+          for (int32_t j = 0; j < b->size; ++j) {
+            if (parsePacket(b->packets[j], record))
+              b->records.push_back(record);
+          }
+          std::lock_guard<std::mutex> lock(mutex);
+          parsed_batches[b->seq % depth] = b;
+          cv.notify_all();
+        }
+      } catch (...) {
+        fail();
+      }
+    });
+  }
+  auto finish = [&]() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopped = true;
+      cv.notify_all();
+    }
+    read_thread.join();
+    for (auto &thread : parse_threads)
+      thread.join();
+  };
+
+  try {
+    for (int64_t seq = 0;; ++seq) {
+      Batch *b;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] {
+          return parsed_batches[seq % depth] || num_batches == seq || error;
+        });
+        if (error)
+          break;
+        b = parsed_batches[seq % depth];
+        if (!b) // all taken
+          break;
+        parsed_batches[seq % depth] = nullptr;
+      }
+      bool more = true;
+      for (const auto &record : b->records) {
+        if (!(more = take(record)))
+          break;
+      }
+      if (!more)
+        break;
+      std::lock_guard<std::mutex> lock(mutex);
+      free_batches.push_back(b);
+      cv.notify_all();
+    }
+  } catch (...) {
+    finish();
+    throw;
+  }
+  finish();
+  if (error)
+    std::rethrow_exception(error);
+}
+
+template <int32_t key_len>
+template <typename Func>
+int32_t PcapParser<key_len>::parsePcapPackets(Func &&func) const {
+  if (!reader) {
+    throw std::runtime_error("Runtime Error: No pcap file is opened.");
   }
 
   // packet count
   int32_t packet_count_so_far = 0;
   // flow sets
   Data::Estimation<key_len, int64_t> all_flows;
+  // records of this batch
+  std::vector<Data::Record<key_len>> records;
+  records.reserve(batch);
 
-  pcpp::RawPacket raw_packet;
-  while (reader->getNextPacket(raw_packet) &&
-         packet_count_so_far != packet_count) {
-    // parse the raw packet into a parsed packet
-    pcpp::Packet parsed_packet(&raw_packet);
-    // timestamp
-    timespec time_nano = raw_packet.getPacketTimeStamp();
-    uint64_t timestamp = time_nano.tv_sec * static_cast<uint64_t>(1000000) +
-                         time_nano.tv_nsec / 1000;
-    // IPv4 header
-    pcpp::IPv4Layer *ip_layer = parsed_packet.getLayerOfType<pcpp::IPv4Layer>();
-    if (!ip_layer)
-      continue;
-
-    uint32_t src_ip = Net2Host32(ip_layer->getSrcIPv4Address().toInt());
-    uint32_t dst_ip = Net2Host32(ip_layer->getDstIPv4Address().toInt());
-
-    uint8_t protocol;
-    uint16_t src_port, dst_port;
-    uint64_t length = Net2Host16(ip_layer->getIPv4Header()->totalLength);
-
-    pcpp::TcpLayer *tcp_layer = parsed_packet.getLayerOfType<pcpp::TcpLayer>();
-    pcpp::UdpLayer *udp_layer = parsed_packet.getLayerOfType<pcpp::UdpLayer>();
-
-    if (tcp_layer) {
-      src_port = tcp_layer->getSrcPort();
-      dst_port = tcp_layer->getDstPort();
-      protocol = tcp_layer->getProtocol();
-    } else if (udp_layer) {
-      src_port = udp_layer->getSrcPort();
-      dst_port = udp_layer->getDstPort();
-      protocol = udp_layer->getProtocol();
-    } else if (key_len == 13) {
-      continue;
-    }
-
-    FlowKey<key_len> *key_ptr = nullptr;
-    if (key_len == 4) {
-      key_ptr = new FlowKey<key_len>(src_ip);
-    } else if (key_len == 8) {
-      key_ptr = new FlowKey<key_len>(src_ip, dst_ip);
-    } else if (key_len == 13) {
-      key_ptr =
-          new FlowKey<key_len>(src_ip, dst_ip, src_port, dst_port, protocol);
-    }
-    all_flows.insert(*key_ptr);
-
-    // deserialize flow key
-    OmniSketch::Data::Record<key_len> record;
-    record.flowkey.copy(0, *key_ptr, 0, key_len);
-    record.length = length;
-    record.timestamp = timestamp;
-    int8_t byte[format->getRecordLength()];
-    format->writeAsFormat(record, byte);
-    delete key_ptr;
+  // take records in the order of packets, and tell whether to go on
+  auto take = [&](const Data::Record<key_len> &record) -> bool {
+    all_flows.insert(record.flowkey);
     // flow count
     if (all_flows.size() == flow_count)
-      goto finished;
-    // write to file
-    fout.write(reinterpret_cast<const char *>(byte), format->getRecordLength());
-
-    // verbosity: per-packet info
-    if (verbose_level > 1) {
-      std::cout << "#" << packet_count_so_far << std::endl;
-      std::cout << parsed_packet.toString() << std::endl;
+      return false;
+    records.push_back(record);
+    packet_count_so_far += 1;
+    if (records.size() == static_cast<size_t>(batch)) {
+      func(static_cast<const std::vector<Data::Record<key_len>> &>(records));
+      records.clear();
     }
+    return packet_count_so_far != packet_count;
+  };
 
-    packet_count_so_far += 1;
+  // per-packet info is printed as packets are parsed
+  if (threads > 0 && verbose_level < 2) {
+    if (packet_count != 0)
+      parseInParallel(take);
+  } else {
+    pcpp::RawPacket raw_packet;
+    Data::Record<key_len> record;
+    bool more = packet_count != 0;
+    while (more && reader->getNextPacket(raw_packet)) {
+      if (!parsePacket(raw_packet, record))
+        continue;
+      const int32_t packet_no = packet_count_so_far;
+      more = take(record);
+
+      // verbosity: per-packet info
+      if (verbose_level > 1 && packet_count_so_far != packet_no) {
+        std::cout << "#" << packet_no << std::endl;
+        std::cout << pcpp::Packet(&raw_packet).toString() << std::endl;
+      }
+    }
   }
-finished:
+  if (!records.empty())
+    func(static_cast<const std::vector<Data::Record<key_len>> &>(records));
+
   // verbosity: file info
   if (verbose_level > 0) {
     std::cout << "Finished. Printed " << packet_count_so_far << " packets ("
@@ -422,6 +813,54 @@ finished:
   return packet_count_so_far;
 }
 
+template <int32_t key_len>
+template <typename T>
+int32_t
+PcapParser<key_len>::updateSketch(Sketch::SketchBase<key_len, T> &sketch,
+                                  Data::CntMethod cnt_method,
+                                  int32_t width) const {
+  std::vector<FlowKey<key_len>> flowkeys;
+  std::vector<T> vals;
+  return parsePcapPackets(
+      [&](const std::vector<Data::Record<key_len>> &records) {
+        flowkeys.clear();
+        vals.clear();
+        for (const auto &record : records) {
+          flowkeys.push_back(record.flowkey);
+          vals.push_back(cnt_method == Data::InLength ? record.length : 1);
+        }
+        sketch.updateBatch(flowkeys.data(), vals.data(),
+                           static_cast<int32_t>(flowkeys.size()), width);
+      });
+}
+
+template <int32_t key_len>
+int32_t PcapParser<key_len>::dumpPcapPacketsInBinary() const {
+  if (!reader) {
+    throw std::runtime_error("Runtime Error: No pcap file is opened.");
+  }
+  if (!format) {
+    throw std::runtime_error("Runtime Error: No format is specified.");
+  }
+
+  std::ofstream fout(output_pcap, std::ios::binary); // automatically destroyed
+  if (!fout.is_open()) {
+    throw std::runtime_error("Runtime Error: Could not open output file " +
+                             output_pcap);
+  }
+
+  // a batch of records is written at once
+  const int32_t record_len = format->getRecordLength();
+  std::vector<int8_t> bytes;
+  return parsePcapPackets(
+      [&](const std::vector<Data::Record<key_len>> &records) {
+        bytes.resize(records.size() * record_len);
+        for (size_t i = 0; i < records.size(); ++i)
+          format->writeAsFormat(records[i], bytes.data() + i * record_len);
+        fout.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+      });
+}
+
 template <int32_t key_len>
 int32_t PcapParser<key_len>::dumpPcapPacketInPcap() const {
   if (!reader) {
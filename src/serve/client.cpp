@@ -0,0 +1,176 @@
+/**
+ * @file client.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Load generator of the query server, reporting latency percentiles
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "server.h"
+#include <getopt.h>
+
+using namespace OmniSketch;
+
+/**
+ * @brief Print the rate and latency percentiles of a kind of requests
+ *
+ * @param latency in nanoseconds, sorted in place
+ */
+static void Report(const std::string &name, std::vector<int64_t> &latency,
+                   double seconds, int32_t keys) {
+  if (latency.empty())
+    return;
+  std::sort(latency.begin(), latency.end());
+  auto at = [&](double p) {
+    const size_t idx = static_cast<size_t>(p * latency.size());
+    return latency[std::min(idx, latency.size() - 1)] / 1e3;
+  };
+  fmt::print("{}: {} requests, {:.0f} req/s", name, latency.size(),
+             latency.size() / seconds);
+  if (keys)
+    fmt::print(", {:.0f} keys/s", latency.size() * keys / seconds);
+  fmt::print("\n  latency (us): p50 {:.1f}, p90 {:.1f}, p99 {:.1f}, "
+             "p99.9 {:.1f}, max {:.1f}\n",
+             at(0.5), at(0.9), at(0.99), at(0.999), latency.back() / 1e3);
+}
+
+static void Help(const char *ptr);
+
+// Main
+int main(int argc, char *argv[]) {
+  std::string config_file = "../src/serve/serve.toml";
+  std::string socket;
+
+  // parse command line arguments
+  int opt;
+  option options[] = {{"config", required_argument, nullptr, 'c'},
+                      {"socket", required_argument, nullptr, 's'},
+                      {"help", no_argument, nullptr, 'h'},
+                      {nullptr, 0, nullptr, 0}};
+  while ((opt = getopt_long(argc, argv, "c:s:h", options, nullptr)) != -1) {
+    switch (opt) {
+    case 'c':
+      config_file = optarg;
+      break;
+    case 's':
+      socket = optarg;
+      break;
+    case 'h':
+    default:
+      Help(argv[0]); // never return
+      break;
+    }
+  }
+
+  int32_t connections, requests, batch;
+  int32_t top_k = 0, top_k_every = 0;
+  std::string data_file;
+  toml::array arr;
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed())
+    return -1;
+  parser.setWorkingNode("serve");
+  if ((socket.empty() && !parser.parseConfig(socket, "socket")) ||
+      !parser.parseConfig(arr, "format"))
+    return -1;
+  parser.setWorkingNode("client");
+  if (!parser.parseConfig(connections, "connections") ||
+      !parser.parseConfig(requests, "requests") ||
+      !parser.parseConfig(batch, "batch") ||
+      !parser.parseConfig(data_file, "data"))
+    return -1;
+  /// [Optional] every `top_k_every`-th request of a connection is a TOP_K
+  parser.parseConfig(top_k, "top_k", false);
+  parser.parseConfig(top_k_every, "top_k_every", false);
+  if (connections < 1 || requests < 1 || batch < 1 ||
+      batch > static_cast<int32_t>(Serve::kMaxBatch)) {
+    LOG(ERROR, fmt::format("{}: \"connections\", \"requests\" and \"batch\" "
+                           "should be positive, with batch <= {}.",
+                           config_file, Serve::kMaxBatch));
+    return -1;
+  }
+
+  // flowkeys queried, in the order of records
+  Data::StreamData<13> data(data_file, Data::DataFormat(arr));
+  if (!data.succeed() || data.empty())
+    return -1;
+
+  std::vector<std::vector<int64_t>> point(connections), heavy(connections);
+  std::atomic<bool> failed(false);
+  Serve::Summary before, after;
+  std::chrono::steady_clock::time_point start, stop;
+  try {
+    Serve::Client<13> client(socket);
+    before = client.dump();
+    std::vector<std::thread> threads;
+    start = std::chrono::steady_clock::now();
+    for (int32_t c = 0; c < connections; ++c) {
+      threads.emplace_back([&, c]() {
+        try {
+          Serve::Client<13> client(socket);
+          std::vector<FlowKey<13>> flowkeys(batch);
+          std::vector<int64_t> out(batch);
+          // connections start apart in the records
+          size_t next = data.size() / connections * c;
+          for (int32_t r = 1; r <= requests; ++r) {
+            const bool is_top_k = top_k_every && r % top_k_every == 0;
+            if (!is_top_k) {
+              for (auto &flowkey : flowkeys) {
+                flowkey = data.begin()[next].flowkey;
+                next = next + 1 == data.size() ? 0 : next + 1;
+              }
+            }
+            const auto t0 = std::chrono::steady_clock::now();
+            if (is_top_k)
+              client.getTopK(top_k);
+            else
+              client.query(flowkeys.data(), out.data(), batch);
+            const auto t1 = std::chrono::steady_clock::now();
+            (is_top_k ? heavy : point)[c].push_back(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0)
+                    .count());
+          }
+        } catch (const std::exception &exp) {
+          LOG(ERROR, exp.what());
+          failed = true;
+        }
+      });
+    }
+    for (auto &thread : threads)
+      thread.join();
+    stop = std::chrono::steady_clock::now();
+    after = client.dump();
+  } catch (const std::exception &exp) {
+    LOG(ERROR, exp.what());
+    return -1;
+  }
+  if (failed)
+    return -1;
+
+  const double seconds = std::chrono::duration<double>(stop - start).count();
+  std::vector<int64_t> all_point, all_heavy;
+  for (int32_t c = 0; c < connections; ++c) {
+    all_point.insert(all_point.end(), point[c].begin(), point[c].end());
+    all_heavy.insert(all_heavy.end(), heavy[c].begin(), heavy[c].end());
+  }
+  fmt::print("{} connections for {:.3f}s on a sketch of {} bytes\n",
+             connections, seconds, after.bytes);
+  Report(fmt::format("Point queries of {} keys", batch), all_point, seconds,
+         batch);
+  Report(fmt::format("Top-{} queries", top_k), all_heavy, seconds, 0);
+  fmt::print("Ingest: {} records meanwhile, {:.0f} records/s\n",
+             after.records - before.records,
+             (after.records - before.records) / seconds);
+  return 0;
+}
+
+static void Help(const char *ptr) {
+  fmt::print("Usage: {} [-c config] [-s socket]\n\n"
+             "Query a running server from many connections and report the\n"
+             "latency percentiles.\n"
+             "  -c config : Config file, tables [serve] and [client]\n"
+             "  -s socket : Socket file, overriding that in the config\n"
+             "  -h        : Display this help message and exit\n",
+             ptr);
+  exit(0);
+}
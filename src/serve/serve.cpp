@@ -0,0 +1,197 @@
+/**
+ * @file serve.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Serve a sketch over a Unix domain socket while records stream in
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "server.h"
+#include <common/hash.h>
+#include <csignal>
+#include <getopt.h>
+#include <sketch/CMSketch.h>
+#include <sketch/CountSketch.h>
+#include <sketch/ElasticSketch.h>
+#include <sketch/HeavyKeeper.h>
+
+using namespace OmniSketch;
+
+/**
+ * @brief What is read from [serve], but the sketch
+ *
+ */
+struct Options {
+  std::string socket;
+  int32_t epoch;
+  int32_t width;
+  std::string input;
+  int32_t passes;
+  Data::CntMethod cnt_method;
+  toml::array format;
+};
+
+template <typename server_t> static server_t *g_server = nullptr;
+static Data::RecordSource<13> *g_source = nullptr;
+
+template <typename server_t> static void OnSignal(int) {
+  g_server<server_t>->interrupt();
+  if (g_source)
+    g_source->stop();
+}
+
+/**
+ * @brief Ingest the input and serve until interrupted
+ *
+ */
+template <typename sketch_t, typename... Args>
+static int Run(const Options &opt, const Args &...args) {
+  using Server = Serve::Server<13, int32_t, sketch_t>;
+  const Data::DataFormat format(opt.format);
+  Server server(opt.socket, opt.epoch, args...);
+  g_server<Server> = &server;
+  // no SA_RESTART, so that a read blocked on the input returns
+  struct sigaction action {};
+  action.sa_handler = OnSignal<Server>;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  int64_t count = 0;
+  if (Data::IsStream(opt.input) || opt.passes == 1) {
+    // records as they come, in constant memory
+    Data::RecordSource<13> source(opt.input, format);
+    if (!source.succeed())
+      return -1;
+    g_source = &source;
+    server.start();
+    LOG(INFO, fmt::format("Serving on {}, streaming records from {}.",
+                          opt.socket, opt.input));
+    count = server.ingest(source, opt.cnt_method, opt.width);
+    g_source = nullptr;
+  } else {
+    Data::StreamData<13> data(opt.input, format);
+    if (!data.succeed())
+      return -1;
+    server.start();
+    LOG(INFO, fmt::format("Serving on {}, {} passes over {}.", opt.socket,
+                          opt.passes, opt.input));
+    // 0 passes loop over the records until interrupted
+    for (int32_t i = 0; (!opt.passes || i < opt.passes) && !data.empty() &&
+                        !server.isInterrupted();
+         ++i)
+      count += server.ingest(data.begin(), data.end(), opt.cnt_method,
+                             opt.width);
+  }
+  server.flush();
+  LOG(INFO, fmt::format("{} records ingested. Serving until interrupted.",
+                        count));
+  server.wait();
+  server.stop();
+  return 0;
+}
+
+static void Help(const char *ptr);
+
+// Main
+int main(int argc, char *argv[]) {
+  std::string config_file = "../src/serve/serve.toml";
+  std::string socket;
+
+  // parse command line arguments
+  int opt;
+  option options[] = {{"config", required_argument, nullptr, 'c'},
+                      {"socket", required_argument, nullptr, 's'},
+                      {"help", no_argument, nullptr, 'h'},
+                      {nullptr, 0, nullptr, 0}};
+  while ((opt = getopt_long(argc, argv, "c:s:h", options, nullptr)) != -1) {
+    switch (opt) {
+    case 'c':
+      config_file = optarg;
+      break;
+    case 's':
+      socket = optarg;
+      break;
+    case 'h':
+    default:
+      Help(argv[0]); // never return
+      break;
+    }
+  }
+
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed())
+    return -1;
+  Options conf;
+  std::string sketch, method;
+  parser.setWorkingNode("serve");
+  if (!parser.parseConfig(conf.socket, "socket") ||
+      !parser.parseConfig(sketch, "sketch") ||
+      !parser.parseConfig(conf.epoch, "epoch") ||
+      !parser.parseConfig(conf.input, "input") ||
+      !parser.parseConfig(conf.format, "format") ||
+      !parser.parseConfig(method, "cnt_method"))
+    return -1;
+  if (!socket.empty())
+    conf.socket = socket;
+  conf.cnt_method = method == "InPacket" ? Data::InPacket : Data::InLength;
+  /// [Optional] flowkeys in flight, and passes over a record file
+  conf.width = 1;
+  conf.passes = 1;
+  parser.parseConfig(conf.width, "width", false);
+  parser.parseConfig(conf.passes, "passes", false);
+
+  try {
+    if (sketch == "CM" || sketch == "CS") {
+      int32_t depth, width;
+      parser.setWorkingNode(sketch == "CM" ? "serve.cm" : "serve.cs");
+      if (!parser.parseConfig(depth, "depth") ||
+          !parser.parseConfig(width, "width"))
+        return -1;
+      if (sketch == "CM")
+        return Run<Sketch::CMSketch<13, int32_t, Hash::AwareHash>>(
+            conf, depth, width);
+      return Run<Sketch::CountSketch<13, int32_t, Hash::AwareHash>>(
+          conf, depth, width);
+    } else if (sketch == "ES") {
+      int32_t num_buckets, num_per_bucket, l_depth, l_width;
+      parser.setWorkingNode("serve.es");
+      if (!parser.parseConfig(num_buckets, "num_buckets") ||
+          !parser.parseConfig(num_per_bucket, "num_per_bucket") ||
+          !parser.parseConfig(l_depth, "l_depth") ||
+          !parser.parseConfig(l_width, "l_width"))
+        return -1;
+      return Run<Sketch::ElasticSketch<13, int32_t, Hash::AwareHash>>(
+          conf, num_buckets, num_per_bucket, l_depth, l_width);
+    } else if (sketch == "HK") {
+      int32_t depth, width, num_threshold;
+      double b, alpha;
+      parser.setWorkingNode("serve.hk");
+      if (!parser.parseConfig(depth, "depth") ||
+          !parser.parseConfig(width, "width") ||
+          !parser.parseConfig(num_threshold, "num_threshold") ||
+          !parser.parseConfig(b, "b") ||
+          !parser.parseConfig(alpha, "hash_table_alpha"))
+        return -1;
+      return Run<Sketch::HeavyKeeper<13, int32_t, Hash::AwareHash>>(
+          conf, depth, width, num_threshold, b, alpha);
+    }
+  } catch (const std::exception &exp) {
+    LOG(ERROR, exp.what());
+    return -1;
+  }
+  LOG(ERROR, fmt::format("{}: \"sketch\" should be one of \"CM\", \"CS\", "
+                         "\"ES\", \"HK\", but got {} instead.",
+                         config_file, sketch));
+  return -1;
+}
+
+static void Help(const char *ptr) {
+  fmt::print("Usage: {} [-c config] [-s socket]\n\n"
+             "Ingest records into a sketch and serve queries of it over a\n"
+             "Unix domain socket until interrupted.\n"
+             "  -c config : Config file, table [serve]\n"
+             "  -s socket : Socket file, overriding that in the config\n"
+             "  -h        : Display this help message and exit\n",
+             ptr);
+  exit(0);
+}
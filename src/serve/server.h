@@ -0,0 +1,687 @@
+/**
+ * @file server.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Serve queries of a sketch being updated over a Unix domain socket
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/data.h>
+#include <common/source.h>
+#include <sketch/Snapshot.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief A sketch serving local clients while it is being updated
+ *
+ * @details The protocol is binary, in host byte order, as both ends run on the
+ * same machine. Every request and every reply starts with a Header, followed
+ * by its payload:
+ *
+ * | Op           | Request payload           | Reply payload               |
+ * |:-------------|:--------------------------|:----------------------------|
+ * | QUERY        | `n` flowkeys              | `n` estimates (int64)       |
+ * | HEAVY_HITTER | threshold (double)        | `n` flows                   |
+ * | TOP_K        | none, `n` is k            | `n` largest flows, in order |
+ * | DUMP         | none                      | Summary and `n` flows       |
+ *
+ * A flow is a flowkey followed by its estimate (int64). A client may batch as
+ * many flowkeys as it likes into a QUERY, up to kMaxBatch, and send several
+ * requests before reading the replies, which come back in order. A request
+ * the server does not understand is answered with an error status, and the
+ * connection is closed.
+ *
+ */
+namespace OmniSketch::Serve {
+/**
+ * @brief Operation of a request
+ *
+ */
+enum Op : uint8_t {
+  QUERY = 1 /** Estimates of a batch of flowkeys */,
+  HEAVY_HITTER = 2 /** Flows whose estimates reach a threshold */,
+  TOP_K = 3 /** The k flows of the largest estimates */,
+  DUMP = 4 /** Ingest progress and all flows tracked */
+};
+/**
+ * @brief Status of a reply
+ *
+ */
+enum Status : uint8_t {
+  OK = 0 /** Answered */,
+  BAD_REQUEST = 1 /** Unknown op, oversized batch or wrong key length */,
+  UNSUPPORTED = 2 /** The sketch does not answer such queries */
+};
+/**
+ * @brief Header of requests and replies
+ *
+ */
+struct Header {
+  uint8_t op;
+  uint8_t status;   // of replies
+  uint16_t key_len; // checked against that of the server
+  uint32_t n;
+};
+static_assert(sizeof(Header) == 8, "Header should be packed");
+/**
+ * @brief Ahead of the flows in reply to DUMP
+ *
+ */
+struct Summary {
+  /**
+   * @brief Records ingested so far, of which at most an epoch is not in the
+   * view being read yet
+   *
+   */
+  uint64_t records;
+  /**
+   * @brief Size of the sketch in bytes, views included
+   *
+   */
+  uint64_t bytes;
+};
+/**
+ * @brief Largest batch of a QUERY
+ *
+ */
+constexpr uint32_t kMaxBatch = 1 << 16;
+/**
+ * @brief Flowkeys of a QUERY in flight, cf. Sketch::SketchBase::queryBatch()
+ *
+ */
+constexpr int32_t kQueryWidth = 8;
+
+/**
+ * @brief Read exactly `len` bytes
+ *
+ * @return `false` on end of file or error
+ */
+inline bool ReadFull(int fd, void *buf, size_t len) {
+  auto *ptr = static_cast<char *>(buf);
+  while (len) {
+    const ssize_t got = ::read(fd, ptr, len);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got <= 0)
+      return false;
+    ptr += got;
+    len -= got;
+  }
+  return true;
+}
+/**
+ * @brief Write exactly `len` bytes, without raising SIGPIPE
+ *
+ * @return `false` if the peer is gone
+ */
+inline bool WriteFull(int fd, const void *buf, size_t len) {
+  const auto *ptr = static_cast<const char *>(buf);
+  while (len) {
+    const ssize_t put = ::send(fd, ptr, len, MSG_NOSIGNAL);
+    if (put < 0 && errno == EINTR)
+      continue;
+    if (put <= 0)
+      return false;
+    ptr += put;
+    len -= put;
+  }
+  return true;
+}
+/**
+ * @brief Address of a socket file
+ *
+ * @warning An exception is thrown if the path does not fit.
+ */
+inline sockaddr_un SocketAddress(const std::string &path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(addr.sun_path))
+    throw std::invalid_argument("Invalid Argument: Socket path " + path +
+                                " should have 1 to " +
+                                std::to_string(sizeof(addr.sun_path) - 1) +
+                                " characters.");
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  return addr;
+}
+
+/**
+ * @brief Serve a sketch over a Unix domain socket while it is updated
+ *
+ * @details The sketch is put behind Sketch::Snapshot: the thread calling
+ * ingest() updates it with no lock, and one thread per client answers from
+ * the latest published view. Queries thus never slow down ingest beyond the
+ * copies of the views, and answers are at most `epoch` updates stale while
+ * records keep coming.
+ *
+ * Point queries are answered if the sketch overrides query(), and heavy
+ * hitters, top-k and the flows of a dump if it overrides getHeavyHitter(),
+ * e.g., Elastic Sketch does both, Count Min the former and Heavy Keeper the
+ * latter. Other requests get UNSUPPORTED.
+ *
+ * @tparam key_len  length of flowkey
+ * @tparam T        type of the counter
+ * @tparam sketch_t the sketch, which Sketch::Snapshot accepts
+ */
+template <int32_t key_len, typename T, typename sketch_t> class Server {
+  static_assert(sizeof(FlowKey<key_len>) == key_len,
+                "Flowkeys are sent as they are");
+  using Base = Sketch::SketchBase<key_len, T>;
+  // queries the sketch overrides, which are those it answers
+  static constexpr bool point =
+      !std::is_same_v<decltype(&sketch_t::query), decltype(&Base::query)>;
+  static constexpr bool heavy =
+      !std::is_same_v<decltype(&sketch_t::getHeavyHitter),
+                      decltype(&Base::getHeavyHitter)>;
+
+private:
+  Sketch::Snapshot<key_len, T, sketch_t> snap;
+  const uint64_t bytes;
+  const std::string path;
+  int listen_fd;
+  std::atomic<bool> interrupted;
+  std::atomic<uint64_t> records;
+
+  std::thread acceptor;
+  std::mutex mutex; // guards the three below
+  std::vector<int> clients;
+  std::vector<std::thread> workers;
+  std::vector<std::thread::id> finished; // workers to be joined
+
+  Server(const Server &) = delete;
+  Server(Server &&) = delete;
+
+  /**
+   * @brief Accept clients until stopped
+   * @details Workers of clients that left are joined on the next connection,
+   * so a long-running server holds no more threads than clients.
+   *
+   */
+  void accept();
+  /**
+   * @brief Answer the requests of a client until it leaves
+   *
+   */
+  void serve(int fd);
+  /**
+   * @brief Append flows in the estimation to a reply, largest first if
+   * `sorted`, and at most `k` of them
+   *
+   * @return number of flows appended
+   */
+  uint32_t appendFlows(std::vector<char> &reply,
+                       const Data::Estimation<key_len, T> &flows, bool sorted,
+                       size_t k = std::numeric_limits<size_t>::max()) const;
+
+public:
+  /**
+   * @brief Construct by specifying the socket file, the epoch of publications
+   * and the arguments of the sketch
+   *
+   */
+  template <typename... Args>
+  Server(std::string path, int64_t epoch, const Args &...args);
+  /**
+   * @brief Stop serving and remove the socket file
+   *
+   */
+  ~Server();
+  /**
+   * @brief Listen on the socket file and accept clients in the background
+   * @details An existing socket file is replaced.
+   *
+   * @warning An exception is thrown if it fails to listen.
+   */
+  void start();
+  /**
+   * @brief Update the sketch with records in turn, until they are used up or
+   * interrupt() is called
+   * @details Called by a single thread, the one that updates.
+   *
+   * @param width flowkeys in flight, cf. Sketch::SketchBase::updateBatch()
+   * @return records ingested
+   */
+  template <typename Iter>
+  int64_t ingest(Iter begin, Iter end, Data::CntMethod cnt_method,
+                 int32_t width = 1);
+  /**
+   * @brief Update the sketch with records of a stream as they come, until it
+   * is over or interrupt() is called
+   * @details Called by a single thread, the one that updates. A quiet stream
+   * is only left once stopped, cf. Data::RecordSource::stop().
+   *
+   * @return records ingested
+   */
+  int64_t ingest(Data::RecordSource<key_len> &source,
+                 Data::CntMethod cnt_method, int32_t width = 1);
+  /**
+   * @brief Publish what is ingested so far
+   * @details Called by the thread that updates, e.g., when records pause.
+   *
+   */
+  void flush();
+  /**
+   * @brief Make ingest() return and wait() wake up
+   * @details Async-signal-safe.
+   *
+   */
+  void interrupt() { interrupted.store(true, std::memory_order_relaxed); }
+  /**
+   * @brief Whether interrupt() is called
+   *
+   */
+  bool isInterrupted() const {
+    return interrupted.load(std::memory_order_relaxed);
+  }
+  /**
+   * @brief Keep serving until interrupt() is called
+   *
+   */
+  void wait() const;
+  /**
+   * @brief Stop accepting, disconnect all clients and wait for their threads
+   *
+   */
+  void stop();
+  /**
+   * @brief The sketch, for the thread that updates
+   *
+   */
+  Sketch::Snapshot<key_len, T, sketch_t> &snapshot() { return snap; }
+};
+
+/**
+ * @brief A client of Server
+ *
+ * @details Each call sends one request and waits for its reply. A client is
+ * not to be shared by threads; connect one per thread instead. Requests the
+ * sketch does not answer throw, but for dump(), which leaves flows empty.
+ *
+ * @tparam key_len length of flowkey
+ */
+template <int32_t key_len> class Client {
+private:
+  int fd;
+
+  Client(const Client &) = delete;
+  Client(Client &&) = delete;
+
+  /**
+   * @brief Send a request and read the header of the reply
+   *
+   * @warning An exception is thrown if the server is gone or refuses it.
+   */
+  Header request(const Header &header, const void *payload, size_t len);
+  /**
+   * @brief Read `n` flows of a reply
+   *
+   */
+  void readFlows(std::vector<std::pair<FlowKey<key_len>, int64_t>> &flows,
+                 uint32_t n);
+
+public:
+  /**
+   * @brief Flows along with their estimates
+   *
+   */
+  using Flows = std::vector<std::pair<FlowKey<key_len>, int64_t>>;
+  /**
+   * @brief Connect to the server listening on a socket file
+   *
+   * @warning An exception is thrown if it fails to connect.
+   */
+  explicit Client(const std::string &path);
+  /**
+   * @brief Disconnect
+   *
+   */
+  ~Client();
+  /**
+   * @brief Estimates of `n` flowkeys at once, all from the same view
+   *
+   * @warning An exception is thrown if `n > kMaxBatch`.
+   */
+  void query(const FlowKey<key_len> *flowkeys, int64_t *out, uint32_t n);
+  /**
+   * @brief Flows whose estimates reach `threshold`
+   *
+   */
+  Flows getHeavyHitter(double threshold);
+  /**
+   * @brief At most `k` flows of the largest estimates, largest first
+   *
+   */
+  Flows getTopK(uint32_t k);
+  /**
+   * @brief Ingest progress, and all flows tracked if `flows` is given
+   *
+   */
+  Summary dump(Flows *flows = nullptr);
+};
+
+} // namespace OmniSketch::Serve
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Serve {
+
+template <int32_t key_len, typename T, typename sketch_t>
+template <typename... Args>
+Server<key_len, T, sketch_t>::Server(std::string path, int64_t epoch,
+                                     const Args &...args)
+    : snap(epoch, args...), bytes(snap.size()),
+      path(std::move(path)), listen_fd(-1), interrupted(false), records(0) {}
+
+template <int32_t key_len, typename T, typename sketch_t>
+Server<key_len, T, sketch_t>::~Server() {
+  stop();
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void Server<key_len, T, sketch_t>::start() {
+  const sockaddr_un addr = SocketAddress(path);
+  listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0)
+    throw std::runtime_error("Runtime Error: Could not create a socket.");
+  ::unlink(path.c_str());
+  if (::bind(listen_fd, reinterpret_cast<const sockaddr *>(&addr),
+             sizeof(addr)) < 0 ||
+      ::listen(listen_fd, 64) < 0) {
+    ::close(listen_fd);
+    listen_fd = -1;
+    throw std::runtime_error("Runtime Error: Could not listen on " + path +
+                             ": " + std::strerror(errno));
+  }
+  acceptor = std::thread(&Server::accept, this);
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void Server<key_len, T, sketch_t>::accept() {
+  for (;;) {
+    const int fd = ::accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      return; // shut down by stop()
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto id : finished) {
+      auto worker =
+          std::find_if(workers.begin(), workers.end(),
+                       [id](const auto &w) { return w.get_id() == id; });
+      worker->join();
+      workers.erase(worker);
+    }
+    finished.clear();
+    clients.push_back(fd);
+    workers.emplace_back(&Server::serve, this, fd);
+  }
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+uint32_t Server<key_len, T, sketch_t>::appendFlows(
+    std::vector<char> &reply, const Data::Estimation<key_len, T> &flows,
+    bool sorted, size_t k) const {
+  std::vector<std::pair<int64_t, const FlowKey<key_len> *>> order;
+  order.reserve(flows.size());
+  for (const auto &kv : flows)
+    order.emplace_back(static_cast<int64_t>(kv.get_right()), &kv.get_left());
+  k = std::min(k, order.size());
+  if (sorted) {
+    std::partial_sort(order.begin(), order.begin() + k, order.end(),
+                      [](const auto &a, const auto &b) {
+                        return a.first > b.first;
+                      });
+  }
+  for (size_t i = 0; i < k; ++i) {
+    const char *key = reinterpret_cast<const char *>(order[i].second->cKey());
+    reply.insert(reply.end(), key, key + key_len);
+    const char *val = reinterpret_cast<const char *>(&order[i].first);
+    reply.insert(reply.end(), val, val + sizeof(int64_t));
+  }
+  return static_cast<uint32_t>(k);
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void Server<key_len, T, sketch_t>::serve(int fd) {
+  std::vector<FlowKey<key_len>> flowkeys;
+  std::vector<T> estimates;
+  std::vector<char> reply;
+  Header header;
+  while (ReadFull(fd, &header, sizeof(header))) {
+    Header ans{header.op, OK, key_len, 0};
+    reply.resize(sizeof(Header));
+    bool good = header.key_len == key_len;
+    if (good && header.op == QUERY && header.n <= kMaxBatch) {
+      // read anyway, so that the next request is found
+      flowkeys.resize(header.n);
+      estimates.resize(header.n);
+      good = ReadFull(fd, flowkeys.data(), size_t(header.n) * key_len);
+      if (good && !point) {
+        ans.status = UNSUPPORTED;
+      } else if (good) {
+        snap.queryBatch(flowkeys.data(), estimates.data(), header.n,
+                        kQueryWidth);
+        ans.n = header.n;
+        for (const T val : estimates) {
+          const int64_t est = static_cast<int64_t>(val);
+          const char *ptr = reinterpret_cast<const char *>(&est);
+          reply.insert(reply.end(), ptr, ptr + sizeof(est));
+        }
+      }
+    } else if (good && header.op == HEAVY_HITTER) {
+      double threshold;
+      good = ReadFull(fd, &threshold, sizeof(threshold));
+      if (good && heavy)
+        ans.n = appendFlows(reply, snap.getHeavyHitter(threshold), false);
+      else
+        ans.status = UNSUPPORTED;
+    } else if (good && header.op == TOP_K) {
+      if (heavy)
+        ans.n = appendFlows(reply, snap.getHeavyHitter(0), true, header.n);
+      else
+        ans.status = UNSUPPORTED;
+    } else if (good && header.op == DUMP) {
+      const Summary summary{records.load(std::memory_order_relaxed), bytes};
+      const char *ptr = reinterpret_cast<const char *>(&summary);
+      reply.insert(reply.end(), ptr, ptr + sizeof(summary));
+      if (heavy)
+        ans.n = appendFlows(reply, snap.getHeavyHitter(0), false);
+    } else {
+      good = false;
+    }
+    if (!good)
+      ans.status = BAD_REQUEST;
+    std::memcpy(reply.data(), &ans, sizeof(ans));
+    if (!WriteFull(fd, reply.data(), reply.size()) || !good)
+      break;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  clients.erase(std::find(clients.begin(), clients.end(), fd));
+  ::close(fd);
+  finished.push_back(std::this_thread::get_id());
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+template <typename Iter>
+int64_t Server<key_len, T, sketch_t>::ingest(Iter begin, Iter end,
+                                             Data::CntMethod cnt_method,
+                                             int32_t width) {
+  constexpr int32_t kBatch = 256;
+  FlowKey<key_len> flowkeys[kBatch];
+  T vals[kBatch];
+  int64_t count = 0;
+  while (begin != end && !isInterrupted()) {
+    int32_t n = 0;
+    for (; n < kBatch && begin != end; ++n, ++begin) {
+      flowkeys[n] = begin->flowkey;
+      vals[n] = cnt_method == Data::InPacket ? 1 : begin->length;
+    }
+    snap.updateBatch(flowkeys, vals, n, width);
+    count += n;
+    records.fetch_add(n, std::memory_order_relaxed);
+  }
+  return count;
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+int64_t Server<key_len, T, sketch_t>::ingest(
+    Data::RecordSource<key_len> &source, Data::CntMethod cnt_method,
+    int32_t width) {
+  int64_t count = 0;
+  while (!isInterrupted()) {
+    const auto *chunk = source.next();
+    if (!chunk)
+      break;
+    count += ingest(chunk->begin(), chunk->end(), cnt_method, width);
+  }
+  return count;
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void Server<key_len, T, sketch_t>::flush() {
+  // retried until no slow reader holds the spare view
+  while (!snap.publish())
+    std::this_thread::yield();
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void Server<key_len, T, sketch_t>::wait() const {
+  while (!isInterrupted())
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void Server<key_len, T, sketch_t>::stop() {
+  if (listen_fd < 0)
+    return;
+  // wakes up accept() as well as the workers blocked on reads
+  ::shutdown(listen_fd, SHUT_RDWR);
+  acceptor.join();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int fd : clients)
+      ::shutdown(fd, SHUT_RDWR);
+  }
+  for (auto &worker : workers)
+    worker.join();
+  workers.clear();
+  finished.clear();
+  ::close(listen_fd);
+  listen_fd = -1;
+  ::unlink(path.c_str());
+}
+
+template <int32_t key_len>
+Client<key_len>::Client(const std::string &path) {
+  const sockaddr_un addr = SocketAddress(path);
+  fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    throw std::runtime_error("Runtime Error: Could not create a socket.");
+  if (::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) <
+      0) {
+    ::close(fd);
+    throw std::runtime_error("Runtime Error: Could not connect to " + path +
+                             ": " + std::strerror(errno));
+  }
+}
+
+template <int32_t key_len> Client<key_len>::~Client() { ::close(fd); }
+
+template <int32_t key_len>
+Header Client<key_len>::request(const Header &header, const void *payload,
+                                size_t len) {
+  Header ans;
+  // one write for small requests, so that they leave in a single segment
+  char buf[256];
+  if (len <= sizeof(buf) - sizeof(header)) {
+    std::memcpy(buf, &header, sizeof(header));
+    if (len)
+      std::memcpy(buf + sizeof(header), payload, len);
+    if (!WriteFull(fd, buf, sizeof(header) + len))
+      throw std::runtime_error("Runtime Error: The server is gone.");
+  } else if (!WriteFull(fd, &header, sizeof(header)) ||
+             !WriteFull(fd, payload, len)) {
+    throw std::runtime_error("Runtime Error: The server is gone.");
+  }
+  if (!ReadFull(fd, &ans, sizeof(ans)))
+    throw std::runtime_error("Runtime Error: The server is gone.");
+  if (ans.status == BAD_REQUEST)
+    throw std::runtime_error("Runtime Error: The server refused op " +
+                             std::to_string(header.op) + ".");
+  if (ans.status == UNSUPPORTED)
+    throw std::runtime_error("Runtime Error: The sketch does not answer op " +
+                             std::to_string(header.op) + ".");
+  return ans;
+}
+
+template <int32_t key_len>
+void Client<key_len>::readFlows(Flows &flows, uint32_t n) {
+  flows.resize(n);
+  for (auto &[flowkey, val] : flows) {
+    if (!ReadFull(fd, &flowkey, key_len) || !ReadFull(fd, &val, sizeof(val)))
+      throw std::runtime_error("Runtime Error: The server is gone.");
+  }
+}
+
+template <int32_t key_len>
+void Client<key_len>::query(const FlowKey<key_len> *flowkeys, int64_t *out,
+                            uint32_t n) {
+  if (n > kMaxBatch)
+    throw std::invalid_argument("Invalid Argument: A batch holds at most " +
+                                std::to_string(kMaxBatch) + " flowkeys.");
+  const Header ans =
+      request({QUERY, OK, key_len, n}, flowkeys, size_t(n) * key_len);
+  if (ans.n != n || !ReadFull(fd, out, size_t(n) * sizeof(int64_t)))
+    throw std::runtime_error("Runtime Error: The server is gone.");
+}
+
+template <int32_t key_len>
+typename Client<key_len>::Flows
+Client<key_len>::getHeavyHitter(double threshold) {
+  const Header ans =
+      request({HEAVY_HITTER, OK, key_len, 0}, &threshold, sizeof(threshold));
+  Flows flows;
+  readFlows(flows, ans.n);
+  return flows;
+}
+
+template <int32_t key_len>
+typename Client<key_len>::Flows Client<key_len>::getTopK(uint32_t k) {
+  const Header ans = request({TOP_K, OK, key_len, k}, nullptr, 0);
+  Flows flows;
+  readFlows(flows, ans.n);
+  return flows;
+}
+
+template <int32_t key_len> Summary Client<key_len>::dump(Flows *flows) {
+  const Header ans = request({DUMP, OK, key_len, 0}, nullptr, 0);
+  Summary summary;
+  if (!ReadFull(fd, &summary, sizeof(summary)))
+    throw std::runtime_error("Runtime Error: The server is gone.");
+  Flows tracked;
+  readFlows(flows ? *flows : tracked, ans.n);
+  return summary;
+}
+
+} // namespace OmniSketch::Serve
@@ -0,0 +1,125 @@
+/**
+ * @file BlockedCountSketch.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Implementation of Cache-line-blocked Count Sketch
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/blocked.h>
+#include <common/hash.h>
+#include <common/sketch.h>
+
+namespace OmniSketch::Sketch {
+/**
+ * @brief Cache-line-blocked Count Sketch
+ *
+ * @details A Count Sketch whose rows share cache lines. The signs are drawn
+ * from the same hash as the counters. All `depth` counters of a flowkey are
+ * narrow sub-counters in one 64-byte block picked by a single hash (cf.
+ * BlockedCounter), trading some accuracy for one cache miss per update.
+ *
+ * @tparam key_len  length of flowkey
+ * @tparam T        type of the counter
+ * @tparam narrow_t type of the sub-counter in a block
+ * @tparam hash_t   hashing class
+ */
+template <int32_t key_len, typename T, typename narrow_t = int16_t,
+          typename hash_t = Hash::AwareHash>
+class BlockedCountSketch : public SketchBase<key_len, T> {
+private:
+  int32_t depth;
+  int32_t num_blocks;
+  hash_t hash_fn;
+  BlockedCounter<T, narrow_t> counter;
+
+  BlockedCountSketch(const BlockedCountSketch &) = delete;
+  BlockedCountSketch(BlockedCountSketch &&) = delete;
+
+public:
+  /**
+   * @brief Construct by specifying depth and the number of blocks
+   *
+   */
+  BlockedCountSketch(int32_t depth_, int32_t num_blocks_);
+  /**
+   * @brief Update a flowkey with certain value
+   *
+   */
+  void update(const FlowKey<key_len> &flowkey, T val) override;
+  /**
+   * @brief Query a flowkey
+   *
+   */
+  T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Get the size of the sketch
+   *
+   */
+  size_t size() const override;
+  /**
+   * @brief Reset the sketch
+   *
+   */
+  void clear();
+};
+
+} // namespace OmniSketch::Sketch
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Sketch {
+
+template <int32_t key_len, typename T, typename narrow_t, typename hash_t>
+BlockedCountSketch<key_len, T, narrow_t, hash_t>::BlockedCountSketch(
+    int32_t depth_, int32_t num_blocks_)
+    : depth(depth_), num_blocks(num_blocks_),
+      counter(depth_, num_blocks_, true) {}
+
+template <int32_t key_len, typename T, typename narrow_t, typename hash_t>
+void BlockedCountSketch<key_len, T, narrow_t, hash_t>::update(
+    const FlowKey<key_len> &flowkey, T val) {
+  size_t index[depth];
+  int32_t sign[depth];
+  counter.locate(hash_fn(flowkey), index, sign);
+  for (int32_t i = 0; i < depth; ++i) {
+    counter.add(index[i], val * sign[i]);
+  }
+}
+
+template <int32_t key_len, typename T, typename narrow_t, typename hash_t>
+T BlockedCountSketch<key_len, T, narrow_t, hash_t>::query(
+    const FlowKey<key_len> &flowkey) const {
+  size_t index[depth];
+  int32_t sign[depth];
+  counter.locate(hash_fn(flowkey), index, sign);
+  T values[depth];
+  for (int32_t i = 0; i < depth; ++i) {
+    values[i] = counter.get(index[i]) * sign[i];
+  }
+  std::sort(values, values + depth);
+  if (!(depth & 1)) { // even
+    return std::abs((values[depth / 2 - 1] + values[depth / 2]) / 2);
+  } else { // odd
+    return std::abs(values[depth / 2]);
+  }
+}
+
+template <int32_t key_len, typename T, typename narrow_t, typename hash_t>
+size_t BlockedCountSketch<key_len, T, narrow_t, hash_t>::size() const {
+  return sizeof(*this)     // instance
+         + counter.size(); // blocks and escalated counters
+}
+
+template <int32_t key_len, typename T, typename narrow_t, typename hash_t>
+void BlockedCountSketch<key_len, T, narrow_t, hash_t>::clear() {
+  counter.clear();
+}
+
+} // namespace OmniSketch::Sketch
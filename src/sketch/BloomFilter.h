@@ -8,7 +8,9 @@
  */
 #pragma once
 
+#include <common/budget.h>
 #include <common/hash.h>
+#include <common/index.h>
 #include <common/sketch.h>
 
 #define BYTE(n) ((n) >> 3)
@@ -21,7 +23,8 @@ namespace OmniSketch::Sketch {
  * @tparam key_len  length of flowkey
  * @tparam hash_t   hashing class
  */
-template <int32_t key_len, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename hash_t = Hash::AwareHash,
+          typename index_t = Index::Mod>
 class BloomFilter : public SketchBase<key_len> {
 
 private:
@@ -30,6 +33,7 @@ private:
   int32_t nbytes;
   uint8_t *arr;
   hash_t *hash_fns;
+  index_t index_fn;
 
   BloomFilter(const BloomFilter &) = delete;
   BloomFilter(BloomFilter &&) = delete;
@@ -55,6 +59,13 @@ public:
    * @param num_hash_class  # hash classes
    */
   BloomFilter(int32_t num_bits, int32_t num_hash_class);
+  /**
+   * @brief Largest # bits with which the filter fits in `budget` bytes
+   * @details Same as size(), with the # bits rounded by `index_t`.
+   *
+   * @warning An exception is thrown if not even a single bit fits.
+   */
+  static int32_t solveBits(int32_t num_hash_class, size_t budget);
   /**
    * @brief Destructor
    *
@@ -95,37 +106,39 @@ public:
 
 namespace OmniSketch::Sketch {
 
-template <int32_t key_len, typename hash_t>
-BloomFilter<key_len, hash_t>::BloomFilter(int32_t num_bits,
+template <int32_t key_len, typename hash_t, typename index_t>
+BloomFilter<key_len, hash_t, index_t>::BloomFilter(int32_t num_bits,
                                           int32_t num_hash_class)
     : nbits(num_bits), num_hash(num_hash_class) {
-  nbits = Util::NextPrime(nbits);
+  nbits = index_t::roundWidth(nbits);
+  index_fn = index_t(nbits);
   nbytes = (nbits + 7) >> 3; // ceil(nbits / 8)
   hash_fns = new hash_t[num_hash];
   // Allocate memory, zero initialized
   arr = new uint8_t[nbytes]();
 }
 
-template <int32_t key_len, typename hash_t>
-BloomFilter<key_len, hash_t>::~BloomFilter() {
+template <int32_t key_len, typename hash_t, typename index_t>
+BloomFilter<key_len, hash_t, index_t>::~BloomFilter() {
   delete[] hash_fns;
   delete[] arr;
 }
 
-template <int32_t key_len, typename hash_t>
-void BloomFilter<key_len, hash_t>::insert(const FlowKey<key_len> &flowkey) {
+template <int32_t key_len, typename hash_t, typename index_t>
+void BloomFilter<key_len, hash_t, index_t>::insert(
+    const FlowKey<key_len> &flowkey) {
   for (int32_t i = 0; i < num_hash; ++i) {
-    int32_t idx = hash_fns[i](flowkey) % nbits;
+    int32_t idx = index_fn(hash_fns[i](flowkey));
     setBit(idx);
   }
 }
 
-template <int32_t key_len, typename hash_t>
-bool BloomFilter<key_len, hash_t>::lookup(
+template <int32_t key_len, typename hash_t, typename index_t>
+bool BloomFilter<key_len, hash_t, index_t>::lookup(
     const FlowKey<key_len> &flowkey) const {
   // If every bit is on, return true
   for (int32_t i = 0; i < num_hash; ++i) {
-    int32_t idx = hash_fns[i](flowkey) % nbits;
+    int32_t idx = index_fn(hash_fns[i](flowkey));
     if (!getBit(idx)) {
       return false;
     }
@@ -133,15 +146,26 @@ bool BloomFilter<key_len, hash_t>::lookup(
   return true;
 }
 
-template <int32_t key_len, typename hash_t>
-size_t BloomFilter<key_len, hash_t>::size() const {
+template <int32_t key_len, typename hash_t, typename index_t>
+size_t BloomFilter<key_len, hash_t, index_t>::size() const {
   return sizeof(*this)                // Instance
          + nbytes * sizeof(uint8_t)   // arr
          + num_hash * sizeof(hash_t); // hash_fns
 }
 
-template <int32_t key_len, typename hash_t>
-void BloomFilter<key_len, hash_t>::clear() {
+template <int32_t key_len, typename hash_t, typename index_t>
+int32_t BloomFilter<key_len, hash_t, index_t>::solveBits(int32_t num_hash_class,
+                                                         size_t budget) {
+  return Util::SolveBudget(budget, [num_hash_class](int32_t num_bits) {
+    const size_t nbits = index_t::roundWidth(num_bits);
+    return sizeof(BloomFilter)                // Instance
+           + ((nbits + 7) >> 3)               // arr
+           + num_hash_class * sizeof(hash_t); // hash_fns
+  });
+}
+
+template <int32_t key_len, typename hash_t, typename index_t>
+void BloomFilter<key_len, hash_t, index_t>::clear() {
   std::fill(arr, arr + nbytes, 0);
 }
 
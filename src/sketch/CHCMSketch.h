@@ -8,6 +8,7 @@
  */
 #pragma once
 
+#include <common/budget.h>
 #include <common/hash.h>
 #include <common/hierarchy.h>
 #include <common/sketch.h>
@@ -53,6 +54,17 @@ public:
   CHCMSketch(int32_t depth, int32_t width, double cnt_no_ratio,
              const std::vector<size_t> &width_cnt,
              const std::vector<size_t> &no_hash);
+  /**
+   * @brief Largest width with which the sketch fits in `budget` bytes
+   * @details Same as size(), with the width rounded up to a prime and the
+   * other parameters as in the constructor.
+   *
+   * @warning An exception is thrown if not even a width of 1 fits.
+   */
+  static int32_t solveWidth(int32_t depth, double cnt_no_ratio,
+                            const std::vector<size_t> &width_cnt,
+                            const std::vector<size_t> &no_hash,
+                            size_t budget);
   /**
    * @brief Release the pointer
    *
@@ -105,20 +117,34 @@ CHCMSketch<key_len, no_layer, T, hash_t>::CHCMSketch(
                             std::to_string(cnt_no_ratio) + " instead.");
   }
   // prepare no_cnt
-  no_cnt.push_back(static_cast<size_t>(this->depth) * this->width);
-  for (int32_t i = 1; i < no_layer; ++i) {
-    size_t last_layer = no_cnt.back();
-    no_cnt.push_back(Util::NextPrime(std::ceil(last_layer * cnt_no_ratio)));
-  }
+  no_cnt = CounterHierarchy<no_layer, T, hash_t>::layerCnt(
+      static_cast<size_t>(this->depth) * this->width, cnt_no_ratio);
   // CH
   ch = new CounterHierarchy<no_layer, T, hash_t>(no_cnt, this->width_cnt,
                                                  this->no_hash);
 }
 
+template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
+int32_t CHCMSketch<key_len, no_layer, T, hash_t>::solveWidth(
+    int32_t depth, double cnt_no_ratio, const std::vector<size_t> &width_cnt,
+    const std::vector<size_t> &no_hash, size_t budget) {
+  using CH = CounterHierarchy<no_layer, T, hash_t>;
+  return Util::SolveBudget(budget, [&](int32_t width) -> size_t {
+    const size_t no_cnt_0 = static_cast<size_t>(depth) * Util::NextPrime(width);
+    // counters of CH are numbered in int32_t
+    if (no_cnt_0 > static_cast<size_t>(std::numeric_limits<int32_t>::max()))
+      return Util::kNoFit;
+    return sizeof(CHCMSketch)       // instance
+           + depth * sizeof(hash_t) // hashing class
+           + CH::sizeOf(CH::layerCnt(no_cnt_0, cnt_no_ratio), width_cnt,
+                        no_hash); // ch
+  });
+}
+
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 CHCMSketch<key_len, no_layer, T, hash_t>::~CHCMSketch() {
   delete[] hash_fns;
-  delete[] ch;
+  delete ch;
 }
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
@@ -134,28 +160,6 @@ template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 T CHCMSketch<key_len, no_layer, T, hash_t>::query(
     const FlowKey<key_len> &flowkey) const {
 
-  static bool my_cnt_distrib = true;
-  if (my_cnt_distrib) {
-      std::vector<double> distrib(32);
-      for (int32_t i = 0; i < no_cnt[0]; ++i) {
-      T val = ch->getOriginalCnt(i);
-      for (int32_t k = 0; k < 32; ++k) {
-          if (std::abs(val) >= (1 << k))
-          distrib[k] += 1.0;
-          else
-          break;
-      }
-      }
-      for (int32_t k = 0; k < 32; ++k) {
-      std::cout << k << ": " << distrib[k] / no_cnt[0] << " \n";
-      if (distrib[k] == 0.0) {
-          std::cout << std::endl;
-          break;
-      }
-      }
-      my_cnt_distrib = false;
-  }
-  
   T min_val = std::numeric_limits<T>::max();
   for (int32_t i = 0; i < depth; ++i) {
     int32_t index = hash_fns[i](flowkey) % width;
@@ -166,7 +170,7 @@ T CHCMSketch<key_len, no_layer, T, hash_t>::query(
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 size_t CHCMSketch<key_len, no_layer, T, hash_t>::size() const {
-  ch->print_rate("COUNT MIN CH");
+  ch->reportStats("COUNT MIN CH");
   return sizeof(*this)            // instance
          + depth * sizeof(hash_t) // hashing class
          + ch->size();            // ch
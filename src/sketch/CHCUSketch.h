@@ -7,6 +7,7 @@
  */
 #pragma once
 
+#include <common/budget.h>
 #include <common/hash.h>
 #include <common/hierarchy.h>
 #include <common/sketch.h>
@@ -46,6 +47,18 @@ public:
              const std::vector<size_t> &no_hash_, 
              const int32_t ch_cm_r_, 
              const int32_t ch_cm_w_);
+  /**
+   * @brief Largest width with which the sketch fits in `budget` bytes
+   * @details Same as size(), with the width rounded up to a prime and the
+   * other parameters as in the constructor.
+   *
+   * @warning An exception is thrown if not even a width of 1 fits.
+   */
+  static int32_t solveWidth(int32_t depth, double cnt_no_ratio,
+                            const std::vector<size_t> &width_cnt,
+                            const std::vector<size_t> &no_hash,
+                            int32_t ch_cm_r, int32_t ch_cm_w,
+                            size_t budget);
   /**
    * @brief Release the pointer
    *
@@ -104,22 +117,38 @@ CHCUSketch<key_len, no_layer, T, hash_t>::CHCUSketch(int32_t depth_, int32_t wid
                             std::to_string(cnt_no_ratio_) + " instead.");
   }
   // prepare no_cnt
-  no_cnt.push_back(static_cast<size_t>(this->depth) * this->width);
-  for (int32_t i = 1; i < no_layer; ++i) {
-    size_t last_layer = no_cnt.back();
-    no_cnt.push_back(Util::NextPrime(std::ceil(last_layer * cnt_no_ratio_)));
-  }
+  no_cnt = CounterHierarchy<no_layer, T, hash_t>::layerCnt(
+      static_cast<size_t>(this->depth) * this->width, cnt_no_ratio_);
   // CH
   ch = new CounterHierarchy<no_layer, T, hash_t>(no_cnt, this->width_cnt,
                                                  this->no_hash, false, true, 
                                                  ch_cm_r_, ch_cm_w_);
 }
 
+template <int32_t key_len, int32_t no_layer, typename T,
+          typename hash_t>
+int32_t CHCUSketch<key_len, no_layer, T, hash_t>::solveWidth(
+    int32_t depth, double cnt_no_ratio, const std::vector<size_t> &width_cnt,
+    const std::vector<size_t> &no_hash, int32_t ch_cm_r, int32_t ch_cm_w,
+    size_t budget) {
+  using CH = CounterHierarchy<no_layer, T, hash_t>;
+  return Util::SolveBudget(budget, [&](int32_t width) -> size_t {
+    const size_t no_cnt_0 = static_cast<size_t>(depth) * Util::NextPrime(width);
+    // counters of CH are numbered in int32_t
+    if (no_cnt_0 > static_cast<size_t>(std::numeric_limits<int32_t>::max()))
+      return Util::kNoFit;
+    return sizeof(CHCUSketch)       // instance
+           + sizeof(hash_t) * depth // hashing class
+           + CH::sizeOf(CH::layerCnt(no_cnt_0, cnt_no_ratio), width_cnt,
+                        no_hash, ch_cm_r, Util::NextPrime(ch_cm_w));
+  });
+}
+
 template <int32_t key_len, int32_t no_layer, typename T,
           typename hash_t>
 CHCUSketch<key_len, no_layer, T, hash_t>::~CHCUSketch() {
   delete[] hash_fns;
-  delete[] ch;
+  delete ch;
 }
 
 template <int32_t key_len, int32_t no_layer, typename T,
@@ -161,7 +190,7 @@ T CHCUSketch<key_len, no_layer, T, hash_t>::query(const FlowKey<key_len> &flowke
 template <int32_t key_len, int32_t no_layer, typename T,
           typename hash_t>
 size_t CHCUSketch<key_len, no_layer, T, hash_t>::size() const {
-  ch->print_rate("CH for CU");
+  ch->reportStats("CH for CU");
   return sizeof(*this)                // instance
          + sizeof(hash_t) * depth     // hashing class
          + ch->size();
@@ -11,7 +11,7 @@
 #include <common/hash.h>
 #include <common/hierarchy.h>
 
-// #define DEBUG
+// #define ENABLE_ORACLE
 
 namespace OmniSketch::Sketch {
 /**
@@ -36,7 +36,7 @@ private:
   std::vector<size_t> width_cnt;
   std::vector<size_t> no_hash;
   CH *counter;
-#ifdef DEBUG
+#ifdef ENABLE_ORACLE
   CH_ *counter_;
 #endif
 
@@ -120,7 +120,7 @@ CHCountingBloomFilter<key_len, no_layer, hash_t>::CHCountingBloomFilter(int32_t
   for(int i = 0; i < width_cnt.size(); i++){
     cnt_length += width_cnt[i];
   }
-#ifdef DEBUG
+#ifdef ENABLE_ORACLE
   counter_ = new CH_({static_cast<size_t>(ncnt)},
                    {static_cast<size_t>(cnt_length)}, {});
 #endif
@@ -145,7 +145,10 @@ CHCountingBloomFilter<key_len, no_layer, hash_t>::CHCountingBloomFilter(int32_t
 template <int32_t key_len, int32_t no_layer, typename hash_t>
 CHCountingBloomFilter<key_len, no_layer, hash_t>::~CHCountingBloomFilter() {
   delete[] hash_fns;
-  delete[] counter;
+  delete counter;
+#ifdef ENABLE_ORACLE
+  delete counter_;
+#endif
 }
 
 template <int32_t key_len, int32_t no_layer, typename hash_t>
@@ -156,7 +159,7 @@ void CHCountingBloomFilter<key_len, no_layer, hash_t>::insert(
   while (i < nhash) {
     int32_t idx = hash_fns[i](flowkey) % ncnt;
     if (counter->getEstCnt(idx) == 0){
-    #ifdef DEBUG
+    #ifdef ENABLE_ORACLE
       if(counter_->getCnt(idx) != 0){
         printf("INSERT JUDGE WRONG! COUNTER_: %ld, COUNTER: %ld\n", counter_->getCnt(idx), counter->getEstCnt(idx));
       }
@@ -168,7 +171,7 @@ void CHCountingBloomFilter<key_len, no_layer, hash_t>::insert(
   // increment the buckets
   if (i < nhash) {
     for (int32_t j = 0; j < nhash; ++j) {
-    #ifdef DEBUG
+    #ifdef ENABLE_ORACLE
       counter_->updateCnt(hash_fns[j](flowkey) % ncnt, 1);
     #endif
       counter->updateCnt(hash_fns[j](flowkey) % ncnt, 1);
@@ -182,7 +185,7 @@ bool CHCountingBloomFilter<key_len, no_layer, hash_t>::lookup(
   // if every counter is non-zero, return true
   for (int32_t i = 0; i < nhash; ++i) {
     int32_t idx = hash_fns[i](flowkey) % ncnt;
-    #ifdef DEBUG
+    #ifdef ENABLE_ORACLE
     if (counter_->getCnt(idx) == 0) {
       if(counter->getCnt(idx) != 0){
         printf("LOOK UP WRONG!COUNTER_: %ld, COUNTER: %ld, COUNT_ ORI: %ld, COUNT ORI: %ld\n", 
@@ -206,7 +209,7 @@ void CHCountingBloomFilter<key_len, no_layer, hash_t>::remove(
   int32_t i = 0;
   while (i < nhash) {
     int32_t idx = hash_fns[i](flowkey) % ncnt;
-    #ifdef DEBUG
+    #ifdef ENABLE_ORACLE
     if (counter_->getCnt(idx) == 0)
       break;
     #else
@@ -218,7 +221,7 @@ void CHCountingBloomFilter<key_len, no_layer, hash_t>::remove(
   // decrement the buckets
   if (i == nhash) {
     for (int32_t j = 0; j < nhash; ++j) {
-    #ifdef DEBUG
+    #ifdef ENABLE_ORACLE
       counter_->updateCnt(hash_fns[j](flowkey) % ncnt, -1);
     #endif
       counter->updateCnt(hash_fns[j](flowkey) % ncnt, -1);
@@ -228,7 +231,7 @@ void CHCountingBloomFilter<key_len, no_layer, hash_t>::remove(
 
 template <int32_t key_len, int32_t no_layer, typename hash_t>
 size_t CHCountingBloomFilter<key_len, no_layer, hash_t>::size() const {
-  counter->print_rate("");
+  counter->reportStats("");
   return sizeof(*this)            // instance
          + sizeof(hash_t) * nhash // hash functions
          + counter->size();       // counter size
@@ -237,6 +240,9 @@ size_t CHCountingBloomFilter<key_len, no_layer, hash_t>::size() const {
 template <int32_t key_len, int32_t no_layer, typename hash_t>
 void CHCountingBloomFilter<key_len, no_layer, hash_t>::clear() {
   counter->clear();
+#ifdef ENABLE_ORACLE
+  counter_->clear();
+#endif
 }
 
 } // namespace OmniSketch::Sketch
\ No newline at end of file
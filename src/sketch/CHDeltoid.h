@@ -11,9 +11,11 @@
 #include <common/hash.h>
 #include <common/hierarchy.h>
 #include <common/sketch.h>
+#include <common/thread_pool.h>
 #include <vector>
 #include <algorithm>
 #include <cmath>
+#include <mutex>
 
 // #define MY_DEBUG
 
@@ -181,10 +183,16 @@ void CHDeltoid<key_len, no_layer, T, hash_t>::update(const FlowKey<key_len> &flo
   flow_cnt++;
 #endif
   sum_ += val;
+  // expand the key into bits once for all rows
+  const int8_t *key = flowkey.cKey();
+  bool bits[key_len * 8];
+  for (int32_t j = 0; j < nbits_; ++j) {
+    bits[j] = (key[j >> 3] >> (j & 7)) & 1;
+  }
   for (int32_t i = 0; i < num_hash_; ++i) {
     int32_t idx = hash_fns_[i](flowkey) % num_group_;
     for (int32_t j = 0; j < nbits_; ++j) {
-      if (flowkey.getBit(j)) {
+      if (bits[j]) {
         ch1_->updateCnt(get_idx1_(i, idx, j), val);
       } else {
         ch0_->updateCnt(get_idx0_(i, idx, j), val);
@@ -197,10 +205,11 @@ void CHDeltoid<key_len, no_layer, T, hash_t>::update(const FlowKey<key_len> &flo
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 T CHDeltoid<key_len, no_layer, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
   T min_val = std::numeric_limits<T>::max();
+  const int8_t *key = flowkey.cKey();
   for (int32_t i = 0; i < num_hash_; ++i) {
     int32_t idx = hash_fns_[i](flowkey) % num_group_;
     for (int32_t j = 0; j < nbits_; ++j) {
-      if (flowkey.getBit(j)) {
+      if ((key[j >> 3] >> (j & 7)) & 1) {
         min_val = std::min(min_val, ch1_->getCnt(get_idx1_(i, idx, j)));
       } else {
         min_val = std::min(min_val, ch0_->getCnt(get_idx0_(i, idx, j)));
@@ -214,33 +223,52 @@ template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 Data::Estimation<key_len, T>
 CHDeltoid<key_len, no_layer, T, hash_t>::getHeavyHitter(double threshold) const {
   T thresh = threshold;
-  double val1 = 0;
-  double val0 = 0;
-  Data::Estimation<key_len, T> heavy_hitters;
-  for (int32_t i = 0; i < num_hash_; i++) {
-    for (int32_t j = 0; j < num_group_; j++) {
-      if (ch1_->getCnt(get_idx1_(i, j, nbits_)) <= thresh) { // no heavy hitter in this group
-        continue;
-      }
-      FlowKey<key_len> fk{}; // create a flowkey with full 0
-      bool reject = false;
-      for (int32_t k = 0; k < nbits_; k++) {
-
-        bool t1 = (ch1_->getCnt(get_idx1_(i, j, k)) > thresh);
-        bool t0 = (ch0_->getCnt(get_idx0_(i, j, k)) > thresh);
-        if (t1 == t0) {
-          reject = true;
-          break;
+  // CH decodes on the first read, so do it here once. After that, reads do
+  // not modify CH and groups can be decoded by workers independently.
+  // Candidates are merged in group order, which keeps the result the same as
+  // that of a serial scan.
+  ch1_->getCnt(0);
+  ch0_->getCnt(0);
+  std::vector<std::pair<int64_t, std::vector<FlowKey<key_len>>>> found;
+  std::mutex found_mtx;
+  Util::ThreadPool::global().parallelFor(
+      0, static_cast<int64_t>(num_hash_) * num_group_,
+      [&](int64_t lo, int64_t hi) {
+        std::vector<FlowKey<key_len>> chunk;
+        for (int64_t g = lo; g < hi; ++g) {
+          const int32_t i = g / num_group_;
+          const int32_t j = g % num_group_;
+          if (ch1_->getCnt(get_idx1_(i, j, nbits_)) <= thresh) { // no heavy hitter in this group
+            continue;
+          }
+          FlowKey<key_len> fk{}; // create a flowkey with full 0
+          bool reject = false;
+          for (int32_t k = 0; k < nbits_; k++) {
+            bool t1 = (ch1_->getCnt(get_idx1_(i, j, k)) > thresh);
+            bool t0 = (ch0_->getCnt(get_idx0_(i, j, k)) > thresh);
+            if (t1 == t0) {
+              reject = true;
+              break;
+            }
+            if (t1) {
+              fk.setBit(k, true);
+            }
+          }
+          if (!reject) {
+            chunk.push_back(fk);
+          }
         }
-        if (t1) {
-          fk.setBit(k, true);
-        }
-      }
-      if (reject) {
-        continue;
-      } else if (!heavy_hitters.count(fk)) {
-        T esti_val = query(fk);
-        heavy_hitters[fk] = esti_val;
+        std::lock_guard<std::mutex> lock(found_mtx);
+        found.emplace_back(lo, std::move(chunk));
+      });
+  std::sort(found.begin(), found.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+
+  Data::Estimation<key_len, T> heavy_hitters;
+  for (const auto &chunk : found) {
+    for (const auto &fk : chunk.second) {
+      if (!heavy_hitters.count(fk)) {
+        heavy_hitters[fk] = query(fk);
       }
     }
   }
@@ -249,8 +277,8 @@ CHDeltoid<key_len, no_layer, T, hash_t>::getHeavyHitter(double threshold) const
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 size_t CHDeltoid<key_len, no_layer, T, hash_t>::size() const {
-  ch1_->print_rate("CH1");
-  ch0_->print_rate("CH0");
+  ch1_->reportStats("CH1");
+  ch0_->reportStats("CH0");
   return sizeof(CHDeltoid<key_len, no_layer, T, hash_t>) +
          num_hash_ * sizeof(hash_t) +
          ch1_->size() + ch0_->size();
@@ -250,8 +250,8 @@ CHDeltoid2Tuple<key_len, no_layer, T, hash_t>::getHeavyHitter(double threshold)
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 size_t CHDeltoid2Tuple<key_len, no_layer, T, hash_t>::size() const {
-  ch1_->print_rate("CH1");
-  ch0_->print_rate("CH0");
+  ch1_->reportStats("CH1");
+  ch0_->reportStats("CH0");
   return sizeof(CHDeltoid2Tuple<key_len, no_layer, T, hash_t>) +
          num_hash_ * sizeof(hash_t) +
          ch1_->size() + ch0_->size();
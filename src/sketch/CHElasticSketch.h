@@ -8,6 +8,7 @@
  */
 #pragma once
 
+#include <common/bucket.h>
 #include <common/hash.h>
 #include <common/sketch.h>
 
@@ -31,10 +32,6 @@ private:
     FlowKey<key_len> flowkey_;
     bool flag_;
     Entry() : flowkey_(), flag_(false) {}
-    bool isEmpty() {
-      FlowKey<key_len> emptyKey{};
-      return flowkey_ == emptyKey;
-    }
   };
   // heavy part
   Entry **buckets_;
@@ -50,6 +47,8 @@ private:
 
   int32_t num_buckets_;
   int32_t num_per_bucket_; // each bucket has num_per_bucket_ entries
+  // fingerprints of the entries, probed before any flowkey is visited
+  Util::PackedBuckets<T> fps_;
 
   hash_t hash_h_;
   // light part
@@ -106,7 +105,8 @@ CHElasticSketch<key_len, no_layer, T, hash_t>::CHElasticSketch(int32_t num_bucke
                                                  const std::vector<size_t> &cm_no_hash)
     : num_buckets_(Util::NextPrime(num_buckets)),
       width_cnt(width_cnt), no_hash(no_hash), 
-      num_per_bucket_(num_per_bucket), cm_(l_depth, l_width, cm_cnt_no_ratio, cm_width_cnt, cm_no_hash) {
+      num_per_bucket_(num_per_bucket),
+      fps_(num_buckets_, num_per_bucket, 0), cm_(l_depth, l_width, cm_cnt_no_ratio, cm_width_cnt, cm_no_hash) {
   buckets_ = new Entry *[num_buckets_];
   buckets_[0] = new Entry[num_buckets_ * num_per_bucket_]();
   for (int i = 1; i < num_buckets_; ++i) {
@@ -133,9 +133,9 @@ CHElasticSketch<key_len, no_layer, T, hash_t>::CHElasticSketch(int32_t num_bucke
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 size_t CHElasticSketch<key_len, no_layer, T, hash_t>::size() const {
-  ch->print_rate("HEAVY PART");
+  ch->reportStats("HEAVY PART");
   return sizeof(*this) 
-         + (key_len + 0.125) * num_buckets_ * num_per_bucket_ 
+         + (key_len + 1 + 0.125) * num_buckets_ * num_per_bucket_ 
          + ch->size()
          + cm_.size();
 }
@@ -144,7 +144,8 @@ template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 void CHElasticSketch<key_len, no_layer, T, hash_t>::clear() {
   ch->clear();
   cm_.clear();
-  std::fill(buckets_[0], buckets_[0] + num_buckets_ * num_per_bucket_, 0);
+  fps_.clear();
+  std::fill(buckets_[0], buckets_[0] + num_buckets_ * num_per_bucket_, Entry());
 }
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
@@ -159,23 +160,31 @@ int CHElasticSketch<key_len, no_layer, T, hash_t>::heavypartInsert(
     const FlowKey<key_len> &flowkey, T val, FlowKey<key_len> &swap_key,
     T &swap_val) {
 
-  int32_t index = hash_h_(flowkey) % num_buckets_;
-  int32_t matched = -1;
-  int32_t empty = -1;
+  const uint64_t hash = hash_h_(flowkey);
+  int32_t index = hash % num_buckets_;
+  const uint8_t fp = Util::Fingerprint(hash);
+  uint8_t *fps = fps_.fp(index);
+  // the last entry is the guard, and entries are filled from the front
+  const int32_t n = num_per_bucket_ - 1;
+
+  int32_t matched = Util::FindFingerprint(fps, n, fp, [&](int32_t i) {
+    return buckets_[index][i].flowkey_ == flowkey;
+  });
+  if (matched != -1) { // flowkey is in the bucket
+    ch->updateCnt(getCHIdx(index, matched), val);
+    return 0;
+  }
+  int32_t empty = Util::FindFingerprint(fps, n, 0, [](int32_t) { return true; });
+  if (empty != -1) {
+    fps[empty] = fp;
+    buckets_[index][empty].flowkey_ = flowkey;
+    ch->updateCnt(getCHIdx(index, empty), val);
+    return 0;
+  }
   int32_t min_counter = 0;
   T min_counter_val = ch->getEstCnt(getCHIdx(index, 0));
-  for (int32_t i = 0; i < num_per_bucket_ - 1; ++i) {
+  for (int32_t i = 1; i < n; ++i) {
     int32_t chIdx = getCHIdx(index, i);
-    if (buckets_[index][i].flowkey_ == flowkey) { // flowkey is in the bucket
-      matched = i;
-      ch->updateCnt(chIdx, val);
-      return 0;
-    }
-    if (buckets_[index][i].isEmpty()) {
-      buckets_[index][i].flowkey_ = flowkey;
-      ch->updateCnt(chIdx, val);
-      return 0;
-    }
     if (min_counter_val > ch->getEstCnt(chIdx)) {
       min_counter = i;
       min_counter_val = ch->getEstCnt(chIdx);
@@ -194,6 +203,7 @@ int CHElasticSketch<key_len, no_layer, T, hash_t>::heavypartInsert(
     swap_key = buckets_[index][min_counter].flowkey_;
     swap_val = ch->getEstCnt(minCHIdx);
     ch->resetCnt(chIdx, 0);
+    fps[min_counter] = fp;
     buckets_[index][min_counter].flowkey_ = flowkey;
     ch->resetCnt(minCHIdx, val);
     buckets_[index][min_counter].flag_ = true;
@@ -234,13 +244,14 @@ void CHElasticSketch<key_len, no_layer, T, hash_t>::update(const FlowKey<key_len
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 T CHElasticSketch<key_len, no_layer, T, hash_t>::heavypartQuery(
     const FlowKey<key_len> &flowkey, bool &flag) const {
-  int index = hash_h_(flowkey) % num_buckets_;
-  for (int i = 0; i < num_per_bucket_ - 1; ++i) {
-    int32_t chIdx = getCHIdx(index, i);
-    if (buckets_[index][i].flowkey_ == flowkey) {
-      flag = buckets_[index][i].flag_;
-      return ch->getCnt(chIdx);
-    }
+  const uint64_t hash = hash_h_(flowkey);
+  int index = hash % num_buckets_;
+  int32_t matched = Util::FindFingerprint(
+      fps_.fp(index), num_per_bucket_ - 1, Util::Fingerprint(hash),
+      [&](int32_t i) { return buckets_[index][i].flowkey_ == flowkey; });
+  if (matched != -1) {
+    flag = buckets_[index][matched].flag_;
+    return ch->getCnt(getCHIdx(index, matched));
   }
   return 0;
 }
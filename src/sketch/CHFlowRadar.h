@@ -254,8 +254,8 @@ Data::Estimation<key_len, T> CHFlowRadar<key_len, no_layer, T, hash_t>::decode()
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 size_t CHFlowRadar<key_len, no_layer, T, hash_t>::size() const {
-  flow_ch->print_rate("FLOW");
-  packet_ch->print_rate("PACKET");
+  flow_ch->reportStats("FLOW");
+  packet_ch->reportStats("PACKET");
   #ifndef ONLY_COUNTER_SIZE
   return sizeof(*this)                                 // instance
          + num_count_hash * sizeof(hash_t)             // hashing class
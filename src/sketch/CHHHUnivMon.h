@@ -10,6 +10,7 @@
 #include <iostream>
 
 #include <common/hash.h>
+#include <common/levels.h>
 #include <common/hierarchy.h>
 #include <common/StreamSummary.h>
 #include <common/sketch.h>
@@ -36,6 +37,7 @@ private:
   hash_t *global_hash_fns;
   hash_t **CS_hash_fns;
   hash_t **CS_update_hash_fns;
+  LevelSampler<key_len, hash_t> *sampler; // only in the shared-hash mode
   
   std::vector<size_t> no_cnt;
   std::vector<size_t> width_cnt;
@@ -56,13 +58,15 @@ public:
    * @brief Construct by specifying depth, width and $\log n$, where $n$ is the
    * number of flows to insert.
    *
+   * @param shared_hash whether to sample levels by a single hash and share row
+   * hashes among levels, cf. LevelSampler
    */
   CHHHUnivMon(int32_t depth_, int32_t width_, int32_t log_n, 
             int32_t heap_size, double SSalpha,
             double cnt_no_ratio,
             const std::vector<size_t> &width_cnt,
             const std::vector<size_t> &no_hash,
-            int32_t ch_cm_r, int32_t ch_cm_w);
+            int32_t ch_cm_r, int32_t ch_cm_w, bool shared_hash = false);
   /**
    * @brief Release the pointer
    *
@@ -99,6 +103,15 @@ public:
   void updateSketch(int32_t sketch_idx, const FlowKey<key_len> &flowkey, T val);
   T querySketch(int32_t sketch_idx, const FlowKey<key_len> &flowkey) const;
   T estSketch(int32_t sketch_idx, const FlowKey<key_len> &flowkey) const;
+  /**
+   * @brief Counterparts of the above in the shared-hash mode
+   * @details `hashes` are the hash values of all rows at the level, cf.
+   * LevelSampler::atLevel(). The lowest bit of a hash value is the sign.
+   *
+   */
+  void updateSketch(int32_t sketch_idx, const uint64_t *hashes, T val);
+  T querySketch(int32_t sketch_idx, const uint64_t *hashes) const;
+  T estSketch(int32_t sketch_idx, const uint64_t *hashes) const;
 };
 
 } // namespace OmniSketch::Sketch
@@ -154,6 +167,46 @@ void CHHHUnivMon<key_len, no_layer, T, hash_t>::updateSketch(int32_t sketch_idx,
   }
 }
 
+template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
+void CHHHUnivMon<key_len, no_layer, T, hash_t>::updateSketch(int32_t sketch_idx, const uint64_t *hashes, T val){
+  for(int i = 0; i < depth; i++){
+    int32_t idx = hashes[i] % width[sketch_idx];
+    T update_val = val * (static_cast<int>(hashes[i] & 1) * 2 - 1);
+    ch->updateCnt(getCHIdx(sketch_idx, i, idx), update_val);
+  }
+}
+
+template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
+T CHHHUnivMon<key_len, no_layer, T, hash_t>::querySketch(int32_t sketch_idx, const uint64_t *hashes) const{
+  T values[depth];
+  for (int i = 0; i < depth; ++i) {
+    int32_t chIdx = getCHIdx(sketch_idx, i, hashes[i] % width[sketch_idx]);
+    values[i] = ch->getCnt(chIdx) * (static_cast<int>(hashes[i] & 1) * 2 - 1);
+  }
+  std::sort(values, values + depth);
+  if (!(depth & 1)) { // even
+    return std::abs((values[depth / 2 - 1] + values[depth / 2]) / 2);
+  } else { // odd
+    return std::abs(values[depth / 2]);
+  }
+}
+
+template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
+T CHHHUnivMon<key_len, no_layer, T, hash_t>::estSketch(int32_t sketch_idx, const uint64_t *hashes) const{
+  T values[depth];
+  for (int i = 0; i < depth; ++i) {
+    int32_t chIdx = getCHIdx(sketch_idx, i, hashes[i] % width[sketch_idx]);
+    values[i] =
+        ch->getEstCnt(chIdx) * (static_cast<int>(hashes[i] & 1) * 2 - 1);
+  }
+  std::sort(values, values + depth);
+  if (!(depth & 1)) { // even
+    return std::abs((values[depth / 2 - 1] + values[depth / 2]) / 2);
+  } else { // odd
+    return std::abs(values[depth / 2]);
+  }
+}
+
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 int32_t CHHHUnivMon<key_len, no_layer, T, hash_t>::getCHIdx(int32_t sketch_id, int32_t r, int32_t c) const{
   return (width_idx[sketch_id] + c) + r * total_length;
@@ -174,9 +227,10 @@ CHHHUnivMon<key_len, no_layer, T, hash_t>::CHHHUnivMon(int32_t depth_, int32_t w
                                      double cnt_no_ratio,
                                      const std::vector<size_t> &width_cnt,
                                      const std::vector<size_t> &no_hash,
-                                     int32_t ch_cm_r, int32_t ch_cm_w)
+                                     int32_t ch_cm_r, int32_t ch_cm_w,
+                                     bool shared_hash)
     : depth(depth_), logn(log_n),
-      width_cnt(width_cnt), no_hash(no_hash)  {
+      width_cnt(width_cnt), no_hash(no_hash), sampler(nullptr)  {
 
   global_hash_fns = new hash_t[logn - 1];
   width_ = (Util::NextPrime(width_));
@@ -220,6 +274,8 @@ CHHHUnivMon<key_len, no_layer, T, hash_t>::CHHHUnivMon(int32_t depth_, int32_t w
                                                  ch_cm_r, ch_cm_w);
 
   flows = new Data::Estimation<key_len>[logn];
+  if (shared_hash)
+    sampler = new LevelSampler<key_len, hash_t>(depth, logn);
 
   HHHeaps = new StreamSummary<key_len, T, hash_t>[logn];
   for(int i = 0; i < logn; i++){
@@ -243,6 +299,7 @@ CHHHUnivMon<key_len, no_layer, T, hash_t>::~CHHHUnivMon() {
   delete[] ch;
   if (flows)
     delete[] flows;
+  delete sampler;
   for(int32_t i = 0; i < logn; i++){
     HHHeaps[i].destroy();
   }
@@ -267,6 +324,19 @@ Data::Estimation<key_len, T> CHHHUnivMon<key_len, no_layer, T, hash_t>::getHeavy
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 void CHHHUnivMon<key_len, no_layer, T, hash_t>::update(const FlowKey<key_len> &flowkey,
                                          T val) {
+  if (sampler) {
+    uint64_t rows[depth], hashes[depth];
+    sampler->hashRows(flowkey, rows);
+    const int32_t levels = sampler->numLevels(flowkey);
+    for (int32_t i = 0; i < levels; ++i) {
+      sampler->atLevel(rows, i, hashes);
+      sum[i] += val;
+      updateSketch(i, hashes, val);
+      T est = estSketch(i, hashes);
+      HHHeaps[i].insert(flowkey, est);
+    }
+    return;
+  }
   for (int32_t i = 0; i < logn; ++i) {
     if (getGlobalHash(flowkey, i)) {
       sum[i] += val;
@@ -281,48 +351,17 @@ void CHHHUnivMon<key_len, no_layer, T, hash_t>::update(const FlowKey<key_len> &f
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 T CHHHUnivMon<key_len, no_layer, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
 
-  static bool my_cnt_distrib = true;
-  if (my_cnt_distrib) {
-      std::vector<double> distrib(32);
-      for (int32_t i = 0; i < no_cnt[0]; ++i) {
-      T val = ch->getOriginalCnt(i);
-      for (int32_t k = 0; k < 32; ++k) {
-          if (std::abs(val) >= (1 << k))
-          distrib[k] += 1.0;
-          else
-          break;
-      }
-      }
-      for (int32_t k = 0; k < 32; ++k) {
-      std::cout << k << ": " << distrib[k] / no_cnt[0] << " \n";
-      if (distrib[k] == 0.0) {
-          std::cout << std::endl;
-          break;
-      }
-      }
-      my_cnt_distrib = false;
-  }
-
-  static bool cnt_distrib = true;
-  if (cnt_distrib) {
-    std::vector<double> distrib(32);
-    for (int32_t i = 0; i < no_cnt[0]; ++i) {
-      T val = ch->getOriginalCnt(i);
-      for (int32_t k = 0; k < 32; ++k) {
-        if (std::abs(val) >= (1 << k))
-          distrib[k] += 1.0;
-        else
-          break;
-      }
-    }
-    for (int32_t k = 0; k < 32; ++k) {
-      std::cout << distrib[k] / no_cnt[0] << " ";
-      if (distrib[k] == 0.0) {
-        std::cout << std::endl;
-        break;
-      }
+  if (sampler) {
+    uint64_t rows[depth], hashes[depth];
+    sampler->hashRows(flowkey, rows);
+    const int32_t level = sampler->numLevels(flowkey) - 1;
+    sampler->atLevel(rows, level, hashes);
+    T ret = querySketch(level, hashes);
+    for (int i = level - 1; i >= 0; i--) {
+      sampler->atLevel(rows, i, hashes);
+      ret = 2 * ret - querySketch(i, hashes);
     }
-    cnt_distrib = false;
+    return ret;
   }
   int level;
   for(level = 0; level < logn; level++){
@@ -340,7 +379,7 @@ T CHHHUnivMon<key_len, no_layer, T, hash_t>::query(const FlowKey<key_len> &flowk
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 size_t CHHHUnivMon<key_len, no_layer, T, hash_t>::size() const {
-  ch->print_rate("HHUnivMon CH");
+  ch->reportStats("HHUnivMon CH");
   size_t heap_size = 0;
   #ifndef NO_HEAP_SIZE
   for(int i = 0; i < logn; i++){
@@ -350,6 +389,7 @@ size_t CHHHUnivMon<key_len, no_layer, T, hash_t>::size() const {
   return sizeof(*this) + 
          sizeof(hash_t) * (logn + 2 * logn * depth - 1) + 
          sizeof(int32_t) * 2 * logn + 
+         (sampler ? sampler->size() : 0) + 
          heap_size + 
          ch->size();
 }
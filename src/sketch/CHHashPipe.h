@@ -407,8 +407,8 @@ template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 size_t CHHashPipe<key_len, no_layer, T, hash_t>::size() const {
   #ifndef USE_ONE_CH
   for(int i = normal_depth; i < depth; i++){
-    printf("CH %d: ",i);
-    ch[i - normal_depth]->print_rate("");
+    ch[i - normal_depth]->reportStats(
+        ("CH" + std::to_string(i)).c_str());
   }
   size_t ans = sizeof(*this)                           // instance
                + sizeof(hash_t) * depth                // hashing class
@@ -420,7 +420,7 @@ size_t CHHashPipe<key_len, no_layer, T, hash_t>::size() const {
     ans += ch[i - normal_depth]->size();
   }
   #else
-  ch->print_rate("");
+  ch->reportStats("");
   
   size_t ans = sizeof(*this)                           // instance
                + sizeof(hash_t) * depth                // hashing class
@@ -12,6 +12,8 @@
 #include <common/hierarchy.h>
 #include <common/sketch.h>
 
+#include <random>
+
 // #define DEBUG
 
 namespace OmniSketch::Sketch {
@@ -36,6 +38,7 @@ private:
   int32_t width_;
 
   double b_;
+  std::mt19937_64 rng_; // decides decays, apart from other instances
 
   hash_t *sketch_hash_fun_;
   hash_t fingerprint_hash_fun_;
@@ -519,7 +522,7 @@ template <int32_t key_len, int32_t no_layer, typename T,
           typename hash_t>
 size_t CHHeavyKeeper<key_len, no_layer, T, hash_t>::size() 
   const{
-  ch->print_rate("");
+  ch->reportStats("");
   return depth_ * width_ * (sizeof(uint16_t))
          + ch->size()
          + depth_ * sizeof(hash_t)
@@ -579,7 +582,7 @@ void CHHeavyKeeper<key_len, no_layer, T, hash_t>::update(
       }
     }
     int32_t minIndex = sketch_hash_fun_[minCounterID](flowkey) % width_;
-    if (((double)rand() / RAND_MAX) < (pow(b_, -minC))) {
+    if ((rng_() >> 11) * 0x1p-53 < pow(b_, -minC)) {
       int32_t chIdx = getCHIdx(minCounterID, minIndex);
       bool tmp = (ch->getEstCnt(chIdx) <= val);
       ch->updateCnt(chIdx, -val);
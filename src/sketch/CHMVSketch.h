@@ -8,9 +8,10 @@
  */
 
 #define VAL_WILL_ALWAYS_BE_ONE
+#ifdef ENABLE_ORACLE
 #define RECORD_GUESS_WRONG_TIME
+#endif
 #define USE_CHCM
-#define DEBUG
 
 #include <algorithm>
 #include <map>
@@ -19,6 +20,7 @@
 #include <common/hash.h>
 #include <common/hierarchy.h>
 #include <common/sketch.h>
+#include <common/stats.h>
 #include <common/utils.h>
 
 namespace OmniSketch::Sketch {
@@ -55,6 +57,8 @@ class CHMVSketch : public SketchBase<key_len, T> {
 #endif
 
   CounterHierarchy<no_layer, T, hash_t>* CounterC;
+  // updates whose value is not 1, reported and reset by size()
+  mutable int64_t not_one_updates = 0;
 #ifdef RECORD_GUESS_WRONG_TIME
   int guess_wrong_time = 0;
 #endif
@@ -184,14 +188,8 @@ CHMVSketch<key_len, no_layer, T, hash_t>::~CHMVSketch() {
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 void CHMVSketch<key_len, no_layer, T, hash_t>::update(const FlowKey<key_len> &flow_key,
                                           T val) {
-  #ifdef DEBUG
-  static int calledTimes = 0;
-  calledTimes++;
-  if(calledTimes % 1000 == 0)
-    std::cout << "update " << calledTimes << " Times!\n";
-  #endif
   if(val != 1){
-    printf("NOT 1! VAL = %d\n",val);
+    not_one_updates++;
   }
   for (int i = 0; i < depth_; ++i) {
     int index = hash_fns_[i](flow_key) % width_;
@@ -240,52 +238,6 @@ void CHMVSketch<key_len, no_layer, T, hash_t>::update(const FlowKey<key_len> &fl
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 T CHMVSketch<key_len, no_layer, T, hash_t>::query(const FlowKey<key_len> &flow_key) const {
   
-  static bool my_cnt_distrib = true;
-  if (my_cnt_distrib) {
-      {
-        std::cout << "counter V" << std::endl;
-        std::vector<double> distrib(32);
-        for (int32_t i = 0; i < V_no_cnt[0]; ++i) {
-        T val = CounterV->getOriginalCnt(i);
-        for (int32_t k = 0; k < 32; ++k) {
-            if (std::abs(val) >= (1 << k))
-            distrib[k] += 1.0;
-            else
-            break;
-        }
-        }
-        for (int32_t k = 0; k < 32; ++k) {
-        std::cout << k << ": " << distrib[k] / V_no_cnt[0] << " \n";
-        if (distrib[k] == 0.0) {
-            std::cout << std::endl;
-            break;
-        }
-        }
-        my_cnt_distrib = false;
-      }
-      {
-        std::cout << "counter C" << std::endl;
-        std::vector<double> distrib(32);
-        for (int32_t i = 0; i < C_no_cnt[0]; ++i) {
-        T val = CounterC->getOriginalCnt(i);
-        for (int32_t k = 0; k < 32; ++k) {
-            if (std::abs(val) >= (1 << k))
-            distrib[k] += 1.0;
-            else
-            break;
-        }
-        }
-        for (int32_t k = 0; k < 32; ++k) {
-        std::cout << k << ": " << distrib[k] / C_no_cnt[0] << " \n";
-        if (distrib[k] == 0.0) {
-            std::cout << std::endl;
-            break;
-        }
-        }
-        my_cnt_distrib = false;
-      }
-  }
-  
   std::vector<T> S_cap(depth_);
 
   for(int i = 0; i < depth_; i++){
@@ -310,10 +262,12 @@ void CHMVSketch<key_len, no_layer, T, hash_t>::clear() {
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 size_t CHMVSketch<key_len, no_layer, T, hash_t>::size() const {
 #ifdef RECORD_GUESS_WRONG_TIME
-  printf("GUESS WRONG %d TIMES!\n",guess_wrong_time);
+  STATS_SET("CHMV", "guess_wrong", guess_wrong_time);
 #endif
-  CounterV->print_rate("CounterV");
-  CounterC->print_rate("CounterC");
+  STATS_ADD("CHMV", "not_one_updates", not_one_updates);
+  not_one_updates = 0;
+  CounterV->reportStats("CounterV");
+  CounterC->reportStats("CounterC");
   return sizeof(CHMVSketch<key_len, no_layer, T, hash_t>) + // Instance
          depth_ * sizeof(hash_t) +                          // hash_fns
          sizeof(FlowKey<key_len> *) * depth_ +              // counter
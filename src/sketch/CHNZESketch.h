@@ -244,7 +244,7 @@ T CHNZESketch<key_len, no_layer, T, hash_t>::query(const FlowKey<key_len> &flow_
 template <int32_t key_len, int32_t no_layer, typename T,
           typename hash_t>
 size_t CHNZESketch<key_len, no_layer, T, hash_t>::size() const{
-    FS->print_rate("");
+    FS->reportStats("");
     return sizeof(*this)
            + HTLength * (2 * sizeof(T) + sizeof(FlowKey<key_len>))
            + BF.size()
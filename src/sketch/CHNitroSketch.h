@@ -10,6 +10,7 @@
 
 #include <common/hash.h>
 #include <common/hierarchy.h>
+#include <common/sampling.h>
 #include <common/sketch.h>
 
 #include <algorithm>
@@ -77,7 +78,7 @@ private:
   int32_t next_packet_; // number of skipped packets
 
   double update_prob_; // sampling probability
-  std::default_random_engine generator;
+  Util::GeometricSkip skip_;
 
   bool line_rate_enable_; // enable always line rate
   double switch_thresh_;  // switch to always line rate update
@@ -180,8 +181,7 @@ void CHNitroSketch<key_len, no_layer, T, hash_t>::alwaysCorrectUpdate(
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 std::size_t CHNitroSketch<key_len, no_layer, T, hash_t>::size() const{
-  ch->print_rate("");
-  printf("\n");
+  ch->reportStats("");
   return sizeof(CHNitroSketch<key_len, no_layer, T, hash_t>) 
         + depth_ * 2 * sizeof(hash_t) 
         + ch->size();
@@ -218,28 +218,6 @@ void CHNitroSketch<key_len, no_layer, T, hash_t>::__do_update(const FlowKey<key_
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 T CHNitroSketch<key_len, no_layer, T, hash_t>::query(const FlowKey<key_len> &flowkey) const{
 
-  static bool my_cnt_distrib = true;
-  if (my_cnt_distrib) {
-      std::vector<double> distrib(32);
-      for (int32_t i = 0; i < no_cnt[0]; ++i) {
-      T val = ch->getOriginalCnt(i);
-      for (int32_t k = 0; k < 32; ++k) {
-          if (std::abs(val) >= (1 << k))
-          distrib[k] += 1.0;
-          else
-          break;
-      }
-      }
-      for (int32_t k = 0; k < 32; ++k) {
-      std::cout << k << ": " << distrib[k] / no_cnt[0] << " \n";
-      if (distrib[k] == 0.0) {
-          std::cout << std::endl;
-          break;
-      }
-      }
-      my_cnt_distrib = false;
-  }
-  
   T median;
   T values[depth_];
   for (int i = 0; i < depth_; i++) {
@@ -260,8 +238,9 @@ template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 void CHNitroSketch<key_len, no_layer, T, hash_t>::getNextUpdate(double prob) {
   int sample = 1;
   if (prob < 1.0) {
-    std::geometric_distribution<int> dist(prob);
-    sample = 1 + dist(generator);
+    if (skip_.prob() != prob)
+      skip_.setProb(prob);
+    sample = 1 + skip_.next();
   }
   next_bucket_ = next_bucket_ + sample;
   next_packet_ = ((int)(next_bucket_ / depth_));
@@ -290,7 +269,7 @@ bool CHNitroSketch<key_len, no_layer, T, hash_t>::isLineRateUpdate() {
       median = (values[depth_ / 2 - 1] + values[depth_ / 2]) / 2;
     }
     if (median >= switch_thresh_) {
-      std::cout << "line rate update enable\n";
+      STATS_ADD("CHNitroSketch", "line_rate_switches", 1);
       line_rate_enable_ = true;
     }
     return line_rate_enable_;
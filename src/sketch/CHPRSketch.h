@@ -264,14 +264,15 @@ void CHPRSketch<key_len, no_layer, T, hash_t>::recover(){
 #ifdef TEST_DECODE_TIME
   MY_TOCK = std::chrono::steady_clock::now();
   MY_TIMER = std::chrono::duration_cast<std::chrono::microseconds>(MY_TOCK - MY_TICK);
-  printf("\nDECODE COST %ldms FOR ALL\n", static_cast<int64_t>(MY_TIMER.count()));
+  STATS_ADD("CHPRSketch", "decodes", 1);
+  STATS_ADD("CHPRSketch", "decode_us", MY_TIMER.count());
 #endif
 
 }
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 size_t CHPRSketch<key_len, no_layer, T, hash_t>::size() const{
-    ch->print_rate("");
+    ch->reportStats("");
     return ch->size()
            + (filter_length >> 3)
            + (counter_hash_num + filter_hash_num) * sizeof(hash_t)
@@ -151,7 +151,7 @@ T CHQueryingCountingBloomFilter<key_len, no_layer, T, hash_t>::query(const FlowK
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 size_t CHQueryingCountingBloomFilter<key_len, no_layer, T, hash_t>::size() const {
-  counter->print_rate("");
+  counter->reportStats("");
   return sizeof(*this)            // instance
          + sizeof(hash_t) * nhash // hash functions
          + counter->size();       // counter size
@@ -10,6 +10,7 @@
 #include <iostream>
 
 #include <common/hash.h>
+#include <common/levels.h>
 #include <common/hierarchy.h>
 #include <common/sketch.h>
 #include <sketch/CountSketch.h>
@@ -33,6 +34,7 @@ private:
   hash_t *global_hash_fns;
   hash_t **CS_hash_fns;
   hash_t **CS_update_hash_fns;
+  LevelSampler<key_len, hash_t> *sampler; // only in the shared-hash mode
   
   std::vector<size_t> no_cnt;
   std::vector<size_t> width_cnt;
@@ -50,10 +52,12 @@ public:
    * @brief Construct by specifying depth, width and $\log n$, where $n$ is the
    * number of flows to insert.
    *
+   * @param shared_hash whether to sample levels by a single hash and share row
+   * hashes among levels, cf. LevelSampler
    */
   CHUnivMon(int32_t depth_, int32_t width_, int32_t log_n, double cnt_no_ratio,
             const std::vector<size_t> &width_cnt,
-            const std::vector<size_t> &no_hash);
+            const std::vector<size_t> &no_hash, bool shared_hash = false);
   /**
    * @brief Release the pointer
    *
@@ -84,6 +88,14 @@ public:
   int32_t getCHIdx(int32_t sketch_id, int32_t r, int32_t c) const;
   void updateSketch(int32_t sketch_idx, const FlowKey<key_len> &flowkey, T val);
   T querySketch(int32_t sketch_idx, const FlowKey<key_len> &flowkey) const;
+  /**
+   * @brief Counterparts of the above in the shared-hash mode
+   * @details `hashes` are the hash values of all rows at the level, cf.
+   * LevelSampler::atLevel(). The lowest bit of a hash value is the sign.
+   *
+   */
+  void updateSketch(int32_t sketch_idx, const uint64_t *hashes, T val);
+  T querySketch(int32_t sketch_idx, const uint64_t *hashes) const;
 };
 
 } // namespace OmniSketch::Sketch
@@ -122,6 +134,30 @@ void CHUnivMon<key_len, no_layer, T, hash_t>::updateSketch(int32_t sketch_idx, c
   }
 }
 
+template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
+void CHUnivMon<key_len, no_layer, T, hash_t>::updateSketch(int32_t sketch_idx, const uint64_t *hashes, T val){
+  for(int i = 0; i < depth; i++){
+    int32_t idx = hashes[i] % width[sketch_idx];
+    T update_val = val * (static_cast<int>(hashes[i] & 1) * 2 - 1);
+    ch->updateCnt(getCHIdx(sketch_idx, i, idx), update_val);
+  }
+}
+
+template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
+T CHUnivMon<key_len, no_layer, T, hash_t>::querySketch(int32_t sketch_idx, const uint64_t *hashes) const{
+  T values[depth];
+  for (int i = 0; i < depth; ++i) {
+    int32_t chIdx = getCHIdx(sketch_idx, i, hashes[i] % width[sketch_idx]);
+    values[i] = ch->getCnt(chIdx) * (static_cast<int>(hashes[i] & 1) * 2 - 1);
+  }
+  std::sort(values, values + depth);
+  if (!(depth & 1)) { // even
+    return std::abs((values[depth / 2 - 1] + values[depth / 2]) / 2);
+  } else { // odd
+    return std::abs(values[depth / 2]);
+  }
+}
+
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 int32_t CHUnivMon<key_len, no_layer, T, hash_t>::getCHIdx(int32_t sketch_id, int32_t r, int32_t c) const{
   return (width_idx[sketch_id] + c) + r * total_length;
@@ -139,9 +175,10 @@ template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 CHUnivMon<key_len, no_layer, T, hash_t>::CHUnivMon(int32_t depth_, int32_t width_,
                                      int32_t log_n, double cnt_no_ratio,
                                      const std::vector<size_t> &width_cnt,
-                                     const std::vector<size_t> &no_hash)
+                                     const std::vector<size_t> &no_hash,
+                                     bool shared_hash)
     : depth(depth_), logn(log_n),
-      width_cnt(width_cnt), no_hash(no_hash)  {
+      width_cnt(width_cnt), no_hash(no_hash), sampler(nullptr)  {
 
   global_hash_fns = new hash_t[logn - 1];
   width_ = (Util::NextPrime(width_));
@@ -181,6 +218,8 @@ CHUnivMon<key_len, no_layer, T, hash_t>::CHUnivMon(int32_t depth_, int32_t width
                                                  this->no_hash, true);
 
   flows = new Data::Estimation<key_len>[logn];
+  if (shared_hash)
+    sampler = new LevelSampler<key_len, hash_t>(depth, logn);
 }
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
@@ -198,11 +237,22 @@ CHUnivMon<key_len, no_layer, T, hash_t>::~CHUnivMon() {
   delete[] ch;
   if (flows)
     delete[] flows;
+  delete sampler;
 }
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 void CHUnivMon<key_len, no_layer, T, hash_t>::update(const FlowKey<key_len> &flowkey,
                                          T val) {
+  if (sampler) {
+    uint64_t rows[depth], hashes[depth];
+    sampler->hashRows(flowkey, rows);
+    const int32_t levels = sampler->numLevels(flowkey);
+    for (int32_t i = 0; i < levels; ++i) {
+      sampler->atLevel(rows, i, hashes);
+      updateSketch(i, hashes, val);
+    }
+    return;
+  }
   for (int32_t i = 0; i < logn; ++i) {
     if (getGlobalHash(flowkey, i)) {
       updateSketch(i, flowkey, val);
@@ -213,6 +263,18 @@ void CHUnivMon<key_len, no_layer, T, hash_t>::update(const FlowKey<key_len> &flo
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 T CHUnivMon<key_len, no_layer, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
+  if (sampler) {
+    uint64_t rows[depth], hashes[depth];
+    sampler->hashRows(flowkey, rows);
+    const int32_t level = sampler->numLevels(flowkey) - 1;
+    sampler->atLevel(rows, level, hashes);
+    T ret = querySketch(level, hashes);
+    for (int i = level - 1; i >= 0; i--) {
+      sampler->atLevel(rows, i, hashes);
+      ret = 2 * ret - querySketch(i, hashes);
+    }
+    return ret;
+  }
   int level;
   for(level = 0; level < logn; level++){
     if(!getGlobalHash(flowkey, level)){
@@ -229,10 +291,11 @@ T CHUnivMon<key_len, no_layer, T, hash_t>::query(const FlowKey<key_len> &flowkey
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 size_t CHUnivMon<key_len, no_layer, T, hash_t>::size() const {
-  ch->print_rate("UnivMon CH");
+  ch->reportStats("UnivMon CH");
   return sizeof(*this) + 
          sizeof(hash_t) * (logn + 2 * logn * depth - 1) + 
          sizeof(int32_t) * 2 * logn + 
+         (sampler ? sampler->size() : 0) + 
          ch->size();
 }
 
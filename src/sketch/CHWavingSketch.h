@@ -8,6 +8,7 @@
  */
 #pragma once
 
+#include <common/bucket.h>
 #include <common/hash.h>
 #include <common/hierarchy.h>
 #include <common/sketch.h>
@@ -32,9 +33,11 @@ private:
   hash_t s_;
 
   class heavy_part;
-  class counter;
 
-  counter* CHWavingCounter;
+  // fingerprints of the heavy parts of a counter, probed before any flowkey
+  // is visited
+  Util::PackedBuckets<T> fps;
+  heavy_part* heavy;
 
   std::vector<size_t> counter_no_cnt;
   std::vector<size_t> counter_width_cnt;
@@ -102,6 +105,12 @@ public:
    *
    */
   int32_t getHeavyIdx(int32_t counterIdx, int32_t heavyIdx) const;
+  /**
+   * @brief Find the heavy part of a flowkey in a counter, `-1` if absent
+   *
+   */
+  int32_t findID(int32_t counter_idx, uint8_t fp,
+                 const FlowKey<key_len> &key) const;
 };
 
 } // namespace OmniSketch::Sketch
@@ -123,58 +132,6 @@ public:
     heavy_part(): flag(1){}
 };
 
-template <int32_t key_len, int32_t no_layer, typename T,
-          typename hash_t>
-class CHWavingSketch<key_len, no_layer, T, hash_t>::counter{
-public:
-    int32_t size_;
-    heavy_part* heavy;
-    void init(int32_t heavy_part_length_)
-    {
-        heavy = new heavy_part[heavy_part_length_]();
-        size_ = 0;
-    }
-    void clear()
-    {
-        delete[] heavy;
-    }
-    int32_t smallestID(CounterHierarchy<no_layer, T, hash_t>* heavyCH_, int32_t heavy_part_length_, int32_t counterIdx_)
-    {
-        int32_t ans = 0;
-        int32_t the_id = counterIdx_ * heavy_part_length_;
-        T minn = heavyCH_->getEstCnt(the_id);
-        // T minn = heavyCH_->getOriginalCnt(the_id);
-        for(int i = 1; i < size_; i++)
-        {
-            T fre = heavyCH_->getEstCnt(the_id + i);
-            // T fre = heavyCH_->getOriginalCnt(the_id + i);
-            if(fre < minn)
-            {
-                minn = fre;
-                ans = i;
-            }
-        }
-        return ans;
-    }
-    int32_t findID(const FlowKey<key_len>& key)
-    {
-        for(int i = 0; i < size_; i++)
-        {
-            if(heavy[i].key == key)
-            {
-                return i;
-            }
-        }
-        return -1;
-    }
-    void insert(FlowKey<key_len> e, T val, uint8_t flag, CounterHierarchy<no_layer, T, hash_t>* heavyCH_, int32_t heavy_part_length_, int32_t counterIdx_)
-    {
-        heavy[size_].key = e;
-        heavyCH_->updateCnt(counterIdx_ * heavy_part_length_ + size_, val);
-        heavy[size_++].flag = flag;
-    }
-};
-
 template <int32_t key_len, int32_t no_layer, typename T,
           typename hash_t>
 CHWavingSketch<key_len, no_layer, T, hash_t>::CHWavingSketch(
@@ -191,6 +148,7 @@ CHWavingSketch<key_len, no_layer, T, hash_t>::CHWavingSketch(
     const size_t heavy_cm_w):
     counter_num(Util::NextPrime(bucket_num_)), 
     heavy_part_length(heavy_part_length_),
+    fps(counter_num, heavy_part_length, 0),
     counter_width_cnt(counter_width_cnt_),
     counter_no_hash(counter_no_hash_),
     heavy_width_cnt(heavy_width_cnt_),
@@ -207,7 +165,7 @@ CHWavingSketch<key_len, no_layer, T, hash_t>::CHWavingSketch(
                               "layers in CH should be in (0, 1), but got " +
                               std::to_string(heavy_cnt_no_ratio_) + " instead.");
     }
-    CHWavingCounter = new counter[counter_num];
+    heavy = new heavy_part[counter_num * heavy_part_length]();
     counter_no_cnt.push_back(static_cast<size_t>(this->counter_num));
     for (int32_t i = 1; i < no_layer; ++i) {
       size_t last_layer = counter_no_cnt.back();
@@ -216,10 +174,6 @@ CHWavingSketch<key_len, no_layer, T, hash_t>::CHWavingSketch(
     counterCH = new CounterHierarchy<no_layer, T, hash_t>(counter_no_cnt, this->counter_width_cnt,
                                                           this->counter_no_hash, true, true, 
                                                           counter_cm_r, counter_cm_w);
-    for(int i = 0; i < counter_num; i++)
-    {
-        CHWavingCounter[i].init(heavy_part_length);
-    }
     heavy_no_cnt.push_back(static_cast<size_t>(this->heavy_part_length) * this->counter_num);
     for (int32_t i = 1; i < no_layer; ++i) {
       size_t last_layer = heavy_no_cnt.back();
@@ -234,11 +188,7 @@ template <int32_t key_len, int32_t no_layer, typename T,
           typename hash_t>
 CHWavingSketch<key_len, no_layer, T, hash_t>::~CHWavingSketch()
 {
-    for(int i = 0; i < heavy_part_length; i++)
-    {
-        CHWavingCounter[i].clear();
-    }
-    delete[] CHWavingCounter;
+    delete[] heavy;
     delete[] counterCH;
     delete[] heavyCH;
 }
@@ -249,14 +199,23 @@ int32_t CHWavingSketch<key_len, no_layer, T, hash_t>::getHeavyIdx(int32_t counte
     return counterIdx * heavy_part_length + heavyIdx;
 }
 
+template <int32_t key_len, int32_t no_layer, typename T,
+          typename hash_t>
+int32_t CHWavingSketch<key_len, no_layer, T, hash_t>::findID(int32_t counter_idx,
+    uint8_t fp, const FlowKey<key_len> &key) const
+{
+    const heavy_part* the_heavy = heavy + getHeavyIdx(counter_idx, 0);
+    return Util::FindFingerprint(fps.fp(counter_idx), heavy_part_length, fp,
+        [&](int32_t i){ return the_heavy[i].key == key; });
+}
+
 template <int32_t key_len, int32_t no_layer, typename T,
           typename hash_t>
 size_t CHWavingSketch<key_len, no_layer, T, hash_t>::size() 
   const{
-  counterCH->print_rate("COUNTER CH");
-  heavyCH->print_rate("HEAVY CH");
-  return counter_num * heavy_part_length * (sizeof(FlowKey<key_len>) + 0.125)
-         + counter_num * (sizeof(counter))
+  counterCH->reportStats("COUNTER CH");
+  heavyCH->reportStats("HEAVY CH");
+  return counter_num * heavy_part_length * (sizeof(FlowKey<key_len>) + 1 + 0.125)
          + counterCH->size()
          + heavyCH->size()
          + sizeof(CHWavingSketch<key_len, no_layer, hash_t, T>);
@@ -273,23 +232,32 @@ template <int32_t key_len, int32_t no_layer, typename T,
           typename hash_t>
 void CHWavingSketch<key_len, no_layer, T, hash_t>::update(const FlowKey<key_len> &flowkey, T val)
 {
-    int32_t counter_idx = h(flowkey) % counter_num;
-    counter* the_counter = CHWavingCounter + counter_idx;
-    int32_t heavy_idx = the_counter->findID(flowkey);
+    uint64_t hash = h(flowkey);
+    int32_t counter_idx = hash % counter_num;
+    uint8_t fp = Util::Fingerprint(hash);
+    uint8_t* the_fps = fps.fp(counter_idx);
+    heavy_part* the_heavy = heavy + getHeavyIdx(counter_idx, 0);
+    int32_t heavy_idx = findID(counter_idx, fp, flowkey);
     if(heavy_idx != -1)
     {
-        heavy_part* the_heavy = the_counter->heavy + heavy_idx;
         int32_t heavy_ch_idx = getHeavyIdx(counter_idx, heavy_idx);
         heavyCH->updateCnt(heavy_ch_idx, val);
-        if(the_heavy->flag == false)
+        if(the_heavy[heavy_idx].flag == false)
         {
             T res = s(flowkey);
             counterCH->updateCnt(counter_idx, res);
         }
+        return;
     }
-    else if(the_counter->size_ < heavy_part_length)
+    // heavy parts are filled from the front
+    int32_t empty_idx = Util::FindFingerprint(the_fps, heavy_part_length, 0,
+                                              [](int32_t){ return true; });
+    if(empty_idx != -1)
     {
-        the_counter->insert(flowkey, val, true, heavyCH, heavy_part_length, counter_idx);
+        the_fps[empty_idx] = fp;
+        the_heavy[empty_idx].key = flowkey;
+        heavyCH->updateCnt(getHeavyIdx(counter_idx, empty_idx), val);
+        the_heavy[empty_idx].flag = true;
     }
     else
     {
@@ -297,10 +265,20 @@ void CHWavingSketch<key_len, no_layer, T, hash_t>::update(const FlowKey<key_len>
         T fi = sei * counterCH->getEstCnt(counter_idx);
         // T fi = sei * counterCH->getOriginalCnt(counter_idx);
         counterCH->updateCnt(counter_idx, sei);
-        int32_t smallest_idx = the_counter->smallestID(heavyCH, heavy_part_length, counter_idx);
-        heavy_part* smallest_heavy = the_counter->heavy + smallest_idx;
-        T fr = heavyCH->getEstCnt(getHeavyIdx(counter_idx, smallest_idx));
-        // T fr = heavyCH->getOriginalCnt(getHeavyIdx(counter_idx, smallest_idx));
+        int32_t smallest_idx = 0;
+        T fr = heavyCH->getEstCnt(getHeavyIdx(counter_idx, 0));
+        // T fr = heavyCH->getOriginalCnt(getHeavyIdx(counter_idx, 0));
+        for(int i = 1; i < heavy_part_length; i++)
+        {
+            T fre = heavyCH->getEstCnt(getHeavyIdx(counter_idx, i));
+            // T fre = heavyCH->getOriginalCnt(getHeavyIdx(counter_idx, i));
+            if(fre < fr)
+            {
+                fr = fre;
+                smallest_idx = i;
+            }
+        }
+        heavy_part* smallest_heavy = the_heavy + smallest_idx;
         if(fr <= fi)
         {
             if(smallest_heavy->flag == true)
@@ -310,6 +288,7 @@ void CHWavingSketch<key_len, no_layer, T, hash_t>::update(const FlowKey<key_len>
             }
             smallest_heavy->flag = false;
             heavyCH->resetCnt(getHeavyIdx(counter_idx, smallest_idx), fi + 1);
+            the_fps[smallest_idx] = fp;
             smallest_heavy->key = flowkey;
         }
     }
@@ -318,10 +297,10 @@ void CHWavingSketch<key_len, no_layer, T, hash_t>::update(const FlowKey<key_len>
 template <int32_t key_len, int32_t no_layer, typename T,
           typename hash_t>
 T CHWavingSketch<key_len, no_layer, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
-    int32_t counter_idx = (h(flowkey) % counter_num);
-    counter* the_counter = CHWavingCounter + counter_idx;
-    int32_t flowID = the_counter->findID(flowkey);
-    if(flowID == -1 || the_counter->heavy[flowID].flag == false)
+    uint64_t hash = h(flowkey);
+    int32_t counter_idx = hash % counter_num;
+    int32_t flowID = findID(counter_idx, Util::Fingerprint(hash), flowkey);
+    if(flowID == -1 || heavy[getHeavyIdx(counter_idx, flowID)].flag == false)
     {
         return s(flowkey) * counterCH->getCnt(counter_idx);
     }
@@ -340,10 +319,10 @@ CHWavingSketch<key_len, no_layer, T, hash_t>::getHeavyHitter(
     for(int i = 0; i < counter_num; i++)
     {
         int32_t the_id = getHeavyIdx(i, 0);
-        counter* the_counter = CHWavingCounter + i;
-        for(int j = 0; j < the_counter->size_; j++)
+        const uint8_t* the_fps = fps.fp(i);
+        for(int j = 0; j < heavy_part_length && the_fps[j]; j++)
         {
-            heavy_part* the_heavy = the_counter->heavy + j;
+            heavy_part* the_heavy = heavy + the_id + j;
             if(heavyCH->getCnt(the_id + j) >= val_threshold)
             {
                 heavy_Hitter[the_heavy->key] = heavyCH->getCnt(the_id + j);
@@ -8,7 +8,11 @@
  */
 #pragma once
 
+#include <common/budget.h>
 #include <common/hash.h>
+#include <common/index.h>
+#include <common/interleave.h>
+#include <common/simd.h>
 #include <common/sketch.h>
 
 namespace OmniSketch::Sketch {
@@ -19,12 +23,14 @@ namespace OmniSketch::Sketch {
  * @tparam T        type of the counter
  * @tparam hash_t   hashing class
  */
-template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          typename index_t = Index::Mod>
 class CMSketch : public SketchBase<key_len, T> {
 private:
   int32_t depth;
   int32_t width;
   hash_t *hash_fns;
+  index_t index_fn;
   T **counter;
 
   CMSketch(const CMSketch &) = delete;
@@ -36,6 +42,13 @@ public:
    *
    */
   CMSketch(int32_t depth_, int32_t width_);
+  /**
+   * @brief Largest width with which `depth` rows fit in `budget` bytes
+   * @details Same as size(), with the width rounded by `index_t`.
+   *
+   * @warning An exception is thrown if not even a width of 1 fits.
+   */
+  static int32_t solveWidth(int32_t depth, size_t budget);
   /**
    * @brief Release the pointer
    *
@@ -46,11 +59,32 @@ public:
    *
    */
   void update(const FlowKey<key_len> &flowkey, T val) override;
+  /**
+   * @brief Find the counters of a flowkey and prefetch them
+   * @details Meant for a caller that interleaves updates, cf.
+   * Util::Interleave(), and later calls updateLocated().
+   *
+   * @param indices `depth` counter indices, one per row
+   */
+  void locate(const FlowKey<key_len> &flowkey, int32_t *indices) const;
+  /**
+   * @brief Update the counters found by locate()
+   *
+   */
+  void updateLocated(const int32_t *indices, T val);
   /**
    * @brief Query a flowkey
    *
    */
   T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Query a batch of flowkeys, `in_flight` of them at a time
+   * @details Flowkeys are hashed and their counters prefetched `in_flight`
+   * ahead of the one whose minimum is taken.
+   *
+   */
+  void queryBatch(const FlowKey<key_len> *flowkeys, T *out, int32_t n,
+                  int32_t in_flight) const override;
   /**
    * @brief Get the size of the sketch
    *
@@ -61,6 +95,13 @@ public:
    *
    */
   void clear();
+  /**
+   * @brief Copy the hashing classes and counters of a sketch of the same
+   * depth and width
+   *
+   * @warning An exception is thrown if the shapes differ.
+   */
+  void copyFrom(const CMSketch &other);
 };
 
 } // namespace OmniSketch::Sketch
@@ -73,9 +114,10 @@ public:
 
 namespace OmniSketch::Sketch {
 
-template <int32_t key_len, typename T, typename hash_t>
-CMSketch<key_len, T, hash_t>::CMSketch(int32_t depth_, int32_t width_)
-    : depth(depth_), width(Util::NextPrime(width_)) {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+CMSketch<key_len, T, hash_t, index_t>::CMSketch(int32_t depth_, int32_t width_)
+    : depth(depth_), width(index_t::roundWidth(width_)),
+      index_fn(width) {
 
   hash_fns = new hash_t[depth];
   // Allocate continuous memory
@@ -86,42 +128,105 @@ CMSketch<key_len, T, hash_t>::CMSketch(int32_t depth_, int32_t width_)
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-CMSketch<key_len, T, hash_t>::~CMSketch() {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+CMSketch<key_len, T, hash_t, index_t>::~CMSketch() {
   delete[] hash_fns;
   delete[] counter[0];
   delete[] counter;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void CMSketch<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
-                                          T val) {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void CMSketch<key_len, T, hash_t, index_t>::update(
+    const FlowKey<key_len> &flowkey, T val) {
   for (int32_t i = 0; i < depth; ++i) {
-    int32_t index = hash_fns[i](flowkey) % width;
+    int32_t index = index_fn(hash_fns[i](flowkey));
     counter[i][index] += val;
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-T CMSketch<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
-  T min_val = std::numeric_limits<T>::max();
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void CMSketch<key_len, T, hash_t, index_t>::locate(
+    const FlowKey<key_len> &flowkey, int32_t *indices) const {
   for (int32_t i = 0; i < depth; ++i) {
-    int32_t index = hash_fns[i](flowkey) % width;
-    min_val = std::min(min_val, counter[i][index]);
+    indices[i] = index_fn(hash_fns[i](flowkey));
+    Util::Prefetch(counter[i] + indices[i], sizeof(T));
   }
-  return min_val;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-size_t CMSketch<key_len, T, hash_t>::size() const {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void CMSketch<key_len, T, hash_t, index_t>::updateLocated(
+    const int32_t *indices, T val) {
+  for (int32_t i = 0; i < depth; ++i)
+    counter[i][indices[i]] += val;
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+T CMSketch<key_len, T, hash_t, index_t>::query(
+    const FlowKey<key_len> &flowkey) const {
+  int32_t offsets[depth];
+  for (int32_t i = 0; i < depth; ++i)
+    offsets[i] = i * width + index_fn(hash_fns[i](flowkey));
+  return Util::GatherMin(counter[0], offsets, depth);
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void CMSketch<key_len, T, hash_t, index_t>::queryBatch(
+    const FlowKey<key_len> *flowkeys, T *out, int32_t n,
+    int32_t in_flight) const {
+  struct Machine {
+    const CMSketch &cm;
+    const FlowKey<key_len> *flowkeys;
+    T *out;
+    std::vector<int32_t> jobs;
+    std::vector<int32_t> offsets; // `depth` per slot
+
+    void start(int32_t slot, int32_t job) {
+      jobs[slot] = job;
+      int32_t *off = offsets.data() + slot * cm.depth;
+      for (int32_t i = 0; i < cm.depth; ++i) {
+        off[i] = i * cm.width + cm.index_fn(cm.hash_fns[i](flowkeys[job]));
+        Util::Prefetch(cm.counter[0] + off[i], sizeof(T));
+      }
+    }
+    bool resume(int32_t slot) {
+      out[jobs[slot]] = Util::GatherMin(
+          cm.counter[0], offsets.data() + slot * cm.depth, cm.depth);
+      return false;
+    }
+  } machine{*this, flowkeys, out, std::vector<int32_t>(std::max(in_flight, 1)),
+            std::vector<int32_t>(std::max(in_flight, 1) * depth)};
+  Util::Interleave(machine, n, in_flight);
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+size_t CMSketch<key_len, T, hash_t, index_t>::size() const {
   return sizeof(*this)                // instance
          + sizeof(hash_t) * depth     // hashing class
          + sizeof(T) * depth * width; // counter
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void CMSketch<key_len, T, hash_t>::clear() {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+int32_t CMSketch<key_len, T, hash_t, index_t>::solveWidth(int32_t depth,
+                                                          size_t budget) {
+  return Util::SolveBudget(budget, [depth](int32_t width) -> size_t {
+    return sizeof(CMSketch)                                  // instance
+           + sizeof(hash_t) * depth                          // hashing class
+           + sizeof(T) * depth * index_t::roundWidth(width); // counter
+  });
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void CMSketch<key_len, T, hash_t, index_t>::clear() {
   std::fill(counter[0], counter[0] + depth * width, 0);
 }
 
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void CMSketch<key_len, T, hash_t, index_t>::copyFrom(const CMSketch &other) {
+  if (other.depth != depth || other.width != width)
+    throw std::invalid_argument(
+        "Invalid Argument: Copying a sketch of a different shape");
+  std::copy(other.hash_fns, other.hash_fns + depth, hash_fns);
+  std::copy(other.counter[0], other.counter[0] + depth * width, counter[0]);
+}
+
 } // namespace OmniSketch::Sketch
@@ -9,7 +9,11 @@
  */
 #pragma once
 
+#include <common/budget.h>
 #include <common/hash.h>
+#include <common/index.h>
+#include <common/interleave.h>
+#include <common/simd.h>
 #include <common/sketch.h>
 
 namespace OmniSketch::Sketch {
@@ -20,12 +24,14 @@ namespace OmniSketch::Sketch {
  * @tparam T        type of the counter
  * @tparam hash_t   hashing class
  */
-template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          typename index_t = Index::Mod>
 class CUSketch : public SketchBase<key_len, T> {
 private:
   int32_t depth;
   int32_t width;
   hash_t *hash_fns;
+  index_t index_fn;
   T **counter;
 
   CUSketch(const CUSketch &) = delete;
@@ -37,6 +43,13 @@ public:
    *
    */
   CUSketch(int32_t depth_, int32_t width_);
+  /**
+   * @brief Largest width with which `depth` rows fit in `budget` bytes
+   * @details Same as size(), with the width rounded by `index_t`.
+   *
+   * @warning An exception is thrown if not even a width of 1 fits.
+   */
+  static int32_t solveWidth(int32_t depth, size_t budget);
   /**
    * @brief Release the pointer
    *
@@ -52,6 +65,14 @@ public:
    *
    */
   T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Query a batch of flowkeys, `in_flight` of them at a time
+   * @details Flowkeys are hashed and their counters prefetched `in_flight`
+   * ahead of the one whose minimum is taken.
+   *
+   */
+  void queryBatch(const FlowKey<key_len> *flowkeys, T *out, int32_t n,
+                  int32_t in_flight) const override;
   /**
    * @brief Get the size of the sketch
    *
@@ -73,9 +94,10 @@ public:
 //-----------------------------------------------------------------------------
 
 namespace OmniSketch::Sketch {
-template <int32_t key_len, typename T, typename hash_t>
-CUSketch<key_len, T, hash_t>::CUSketch(int32_t depth_, int32_t width_)
-    : depth(depth_), width(Util::NextPrime(width_)) {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+CUSketch<key_len, T, hash_t, index_t>::CUSketch(int32_t depth_, int32_t width_)
+    : depth(depth_), width(index_t::roundWidth(width_)),
+      index_fn(width) {
   hash_fns = new hash_t[depth];
   // Allocate continuous memory
   counter = new T *[depth];
@@ -85,20 +107,20 @@ CUSketch<key_len, T, hash_t>::CUSketch(int32_t depth_, int32_t width_)
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-CUSketch<key_len, T, hash_t>::~CUSketch() {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+CUSketch<key_len, T, hash_t, index_t>::~CUSketch() {
   delete[] hash_fns;
   delete[] counter[0];
   delete[] counter;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void CUSketch<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
-                                          T val) {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void CUSketch<key_len, T, hash_t, index_t>::update(
+    const FlowKey<key_len> &flowkey, T val) {
   int32_t indices[depth];
   T min_val = std::numeric_limits<T>::max();
   for (int32_t i = 0; i < depth; ++i) {
-    int32_t idx = hash_fns[i](flowkey) % width;
+    int32_t idx = index_fn(hash_fns[i](flowkey));
     indices[i] = idx;
     min_val = std::min(min_val, counter[i][idx]);
   }
@@ -108,25 +130,63 @@ void CUSketch<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-T CUSketch<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
-  T min_val = std::numeric_limits<T>::max();
-  for (int32_t i = 0; i < depth; ++i) {
-    int32_t index = hash_fns[i](flowkey) % width;
-    min_val = std::min(min_val, counter[i][index]);
-  }
-  return min_val;
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+T CUSketch<key_len, T, hash_t, index_t>::query(
+    const FlowKey<key_len> &flowkey) const {
+  int32_t offsets[depth];
+  for (int32_t i = 0; i < depth; ++i)
+    offsets[i] = i * width + index_fn(hash_fns[i](flowkey));
+  return Util::GatherMin(counter[0], offsets, depth);
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-size_t CUSketch<key_len, T, hash_t>::size() const {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void CUSketch<key_len, T, hash_t, index_t>::queryBatch(
+    const FlowKey<key_len> *flowkeys, T *out, int32_t n,
+    int32_t in_flight) const {
+  struct Machine {
+    const CUSketch &cu;
+    const FlowKey<key_len> *flowkeys;
+    T *out;
+    std::vector<int32_t> jobs;
+    std::vector<int32_t> offsets; // `depth` per slot
+
+    void start(int32_t slot, int32_t job) {
+      jobs[slot] = job;
+      int32_t *off = offsets.data() + slot * cu.depth;
+      for (int32_t i = 0; i < cu.depth; ++i) {
+        off[i] = i * cu.width + cu.index_fn(cu.hash_fns[i](flowkeys[job]));
+        Util::Prefetch(cu.counter[0] + off[i], sizeof(T));
+      }
+    }
+    bool resume(int32_t slot) {
+      out[jobs[slot]] = Util::GatherMin(
+          cu.counter[0], offsets.data() + slot * cu.depth, cu.depth);
+      return false;
+    }
+  } machine{*this, flowkeys, out, std::vector<int32_t>(std::max(in_flight, 1)),
+            std::vector<int32_t>(std::max(in_flight, 1) * depth)};
+  Util::Interleave(machine, n, in_flight);
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+size_t CUSketch<key_len, T, hash_t, index_t>::size() const {
   return sizeof(*this)                // instance
          + sizeof(hash_t) * depth     // hashing class
          + sizeof(T) * depth * width; // counter
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void CUSketch<key_len, T, hash_t>::clear() {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+int32_t CUSketch<key_len, T, hash_t, index_t>::solveWidth(int32_t depth,
+                                                          size_t budget) {
+  return Util::SolveBudget(budget, [depth](int32_t width) -> size_t {
+    return sizeof(CUSketch)                                  // instance
+           + sizeof(hash_t) * depth                          // hashing class
+           + sizeof(T) * depth * index_t::roundWidth(width); // counter
+  });
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void CUSketch<key_len, T, hash_t, index_t>::clear() {
   std::fill(counter[0], counter[0] + depth * width, 0);
 }
 
@@ -0,0 +1,179 @@
+/**
+ * @file ConcurrentBloomFilter.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Bloom Filter shared by concurrent inserters
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/budget.h>
+#include <common/hash.h>
+#include <common/index.h>
+#include <common/sketch.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace OmniSketch::Sketch {
+/**
+ * @brief Bloom Filter that many threads insert into at once
+ *
+ * @details Bits are kept in 64-bit atomic words set by a relaxed fetch-or.
+ * A bit already set is left alone, i.e., the word is loaded first and only
+ * written if the bit is clear. Once most bits of a popular flow are set, its
+ * inserts thus only read the lines, which stay shared among the cores
+ * instead of bouncing between them.
+ *
+ * @tparam key_len  length of flowkey
+ * @tparam hash_t   hashing class
+ */
+template <int32_t key_len, typename hash_t = Hash::AwareHash,
+          typename index_t = Index::Mod>
+class ConcurrentBloomFilter : public SketchBase<key_len> {
+private:
+  int32_t nbits;
+  int32_t num_hash;
+  int32_t nwords;
+  std::atomic<uint64_t> *arr;
+  hash_t *hash_fns;
+  index_t index_fn;
+
+  ConcurrentBloomFilter(const ConcurrentBloomFilter &) = delete;
+  ConcurrentBloomFilter(ConcurrentBloomFilter &&) = delete;
+  ConcurrentBloomFilter &operator=(ConcurrentBloomFilter) = delete;
+
+  /**
+   * @brief Words of `nbits` bits, padded to whole cache lines
+   *
+   */
+  static int32_t numWords(int32_t nbits) { return (nbits + 511) / 512 * 8; }
+
+public:
+  /**
+   * @brief Construct by specifying # of bits and hash classes
+   *
+   * @param num_bits        # bit
+   * @param num_hash_class  # hash classes
+   */
+  ConcurrentBloomFilter(int32_t num_bits, int32_t num_hash_class);
+  /**
+   * @brief Largest # bits with which the filter fits in `budget` bytes
+   * @details Same as size(), with the # bits rounded by `index_t`.
+   *
+   * @warning An exception is thrown if not even a single bit fits.
+   */
+  static int32_t solveBits(int32_t num_hash_class, size_t budget);
+  /**
+   * @brief Destructor
+   *
+   */
+  ~ConcurrentBloomFilter();
+  /**
+   * @brief Insert a flowkey into the bloom filter
+   * @details Safe to call from many threads at once.
+   *
+   */
+  void insert(const FlowKey<key_len> &flowkey) override;
+  /**
+   * @brief Look up a flowkey to see whether it exists
+   * @details Safe to call while other threads insert.
+   *
+   */
+  bool lookup(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Size of the sketch
+   *
+   */
+  size_t size() const override;
+  /**
+   * @brief Reset the Bloom Filter
+   * @details Not to be called while other threads insert.
+   *
+   */
+  void clear();
+};
+
+} // namespace OmniSketch::Sketch
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Sketch {
+
+template <int32_t key_len, typename hash_t, typename index_t>
+ConcurrentBloomFilter<key_len, hash_t, index_t>::ConcurrentBloomFilter(
+    int32_t num_bits, int32_t num_hash_class)
+    : nbits(index_t::roundWidth(num_bits)), num_hash(num_hash_class),
+      nwords(numWords(nbits)), index_fn(nbits) {
+  hash_fns = new hash_t[num_hash];
+  // Allocate memory aligned to a cache line, zero initialized
+  arr = static_cast<std::atomic<uint64_t> *>(
+      std::aligned_alloc(64, sizeof(std::atomic<uint64_t>) * nwords));
+  if (!arr)
+    throw std::bad_alloc();
+  for (int32_t i = 0; i < nwords; ++i)
+    new (arr + i) std::atomic<uint64_t>(0);
+}
+
+template <int32_t key_len, typename hash_t, typename index_t>
+ConcurrentBloomFilter<key_len, hash_t, index_t>::~ConcurrentBloomFilter() {
+  delete[] hash_fns;
+  std::free(arr);
+}
+
+template <int32_t key_len, typename hash_t, typename index_t>
+void ConcurrentBloomFilter<key_len, hash_t, index_t>::insert(
+    const FlowKey<key_len> &flowkey) {
+  for (int32_t i = 0; i < num_hash; ++i) {
+    int32_t idx = index_fn(hash_fns[i](flowkey));
+    const uint64_t bit = uint64_t(1) << (idx & 63);
+    std::atomic<uint64_t> &word = arr[idx >> 6];
+    if (!(word.load(std::memory_order_relaxed) & bit))
+      word.fetch_or(bit, std::memory_order_relaxed);
+  }
+}
+
+template <int32_t key_len, typename hash_t, typename index_t>
+bool ConcurrentBloomFilter<key_len, hash_t, index_t>::lookup(
+    const FlowKey<key_len> &flowkey) const {
+  // If every bit is on, return true
+  for (int32_t i = 0; i < num_hash; ++i) {
+    int32_t idx = index_fn(hash_fns[i](flowkey));
+    if (!((arr[idx >> 6].load(std::memory_order_relaxed) >> (idx & 63)) & 1))
+      return false;
+  }
+  return true;
+}
+
+template <int32_t key_len, typename hash_t, typename index_t>
+size_t ConcurrentBloomFilter<key_len, hash_t, index_t>::size() const {
+  return sizeof(*this)                               // Instance
+         + nwords * sizeof(std::atomic<uint64_t>)    // arr
+         + num_hash * sizeof(hash_t);                // hash_fns
+}
+
+template <int32_t key_len, typename hash_t, typename index_t>
+int32_t
+ConcurrentBloomFilter<key_len, hash_t, index_t>::solveBits(int32_t num_hash_class,
+                                                           size_t budget) {
+  return Util::SolveBudget(budget, [num_hash_class](int32_t num_bits) {
+    const int32_t nbits = index_t::roundWidth(num_bits);
+    return sizeof(ConcurrentBloomFilter)                      // Instance
+           + numWords(nbits) * sizeof(std::atomic<uint64_t>) // arr
+           + num_hash_class * sizeof(hash_t);                 // hash_fns
+  });
+}
+
+template <int32_t key_len, typename hash_t, typename index_t>
+void ConcurrentBloomFilter<key_len, hash_t, index_t>::clear() {
+  for (int32_t i = 0; i < nwords; ++i)
+    arr[i].store(0, std::memory_order_relaxed);
+}
+
+} // namespace OmniSketch::Sketch
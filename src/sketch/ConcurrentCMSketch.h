@@ -0,0 +1,186 @@
+/**
+ * @file ConcurrentCMSketch.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Count Min Sketch shared by concurrent updaters
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/budget.h>
+#include <common/hash.h>
+#include <common/index.h>
+#include <common/sketch.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+namespace OmniSketch::Sketch {
+/**
+ * @brief Count Min Sketch that many threads update at once
+ *
+ * @details A single instance is shared by all ingest threads instead of one
+ * replica per thread, so memory does not grow with the number of threads.
+ * Counters are atomics updated by relaxed fetch-adds: no update is lost, but
+ * a query racing with updates may see some of them and not others. Once the
+ * updaters are joined, queries give the same estimates as CMSketch on the
+ * same stream.
+ *
+ * Rows start on a cache line. Threads updating different counters of a line
+ * still contend for it, which is what the Concurrent test measures with
+ * narrow rows.
+ *
+ * @tparam key_len  length of flowkey
+ * @tparam T        type of the counter, e.g., `int32_t` for packed counters
+ * @tparam hash_t   hashing class
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          typename index_t = Index::Mod>
+class ConcurrentCMSketch : public SketchBase<key_len, T> {
+  static_assert(std::atomic<T>::is_always_lock_free,
+                "Counters should be lock-free atomics");
+
+private:
+  int32_t depth;
+  int32_t width;
+  int32_t stride; // counters from one row to the next, a multiple of a line
+  hash_t *hash_fns;
+  index_t index_fn;
+  std::atomic<T> *counter;
+
+  ConcurrentCMSketch(const ConcurrentCMSketch &) = delete;
+  ConcurrentCMSketch(ConcurrentCMSketch &&) = delete;
+
+  /**
+   * @brief Counters per row, padded to whole cache lines
+   *
+   */
+  static int32_t padWidth(int32_t width) {
+    constexpr int32_t per_line = 64 / sizeof(T);
+    return (width + per_line - 1) / per_line * per_line;
+  }
+
+public:
+  /**
+   * @brief Construct by specifying depth and width
+   *
+   */
+  ConcurrentCMSketch(int32_t depth_, int32_t width_);
+  /**
+   * @brief Largest width with which `depth` rows fit in `budget` bytes
+   * @details Same as size(), with the width rounded by `index_t`.
+   *
+   * @warning An exception is thrown if not even a width of 1 fits.
+   */
+  static int32_t solveWidth(int32_t depth, size_t budget);
+  /**
+   * @brief Release the pointer
+   *
+   */
+  ~ConcurrentCMSketch();
+  /**
+   * @brief Update a flowkey with certain value
+   * @details Safe to call from many threads at once.
+   *
+   */
+  void update(const FlowKey<key_len> &flowkey, T val) override;
+  /**
+   * @brief Query a flowkey
+   * @details Safe to call while other threads update.
+   *
+   */
+  T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Get the size of the sketch
+   *
+   */
+  size_t size() const override;
+  /**
+   * @brief Reset the sketch
+   * @details Not to be called while other threads update.
+   *
+   */
+  void clear();
+};
+
+} // namespace OmniSketch::Sketch
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Sketch {
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+ConcurrentCMSketch<key_len, T, hash_t, index_t>::ConcurrentCMSketch(
+    int32_t depth_, int32_t width_)
+    : depth(depth_), width(index_t::roundWidth(width_)),
+      stride(padWidth(width)), index_fn(width) {
+  hash_fns = new hash_t[depth];
+  // Allocate continuous memory, aligned to a cache line
+  const size_t bytes = sizeof(std::atomic<T>) * depth * stride;
+  counter = static_cast<std::atomic<T> *>(std::aligned_alloc(64, bytes));
+  if (!counter)
+    throw std::bad_alloc();
+  for (int32_t i = 0; i < depth * stride; ++i)
+    new (counter + i) std::atomic<T>(0);
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+ConcurrentCMSketch<key_len, T, hash_t, index_t>::~ConcurrentCMSketch() {
+  delete[] hash_fns;
+  std::free(counter);
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void ConcurrentCMSketch<key_len, T, hash_t, index_t>::update(
+    const FlowKey<key_len> &flowkey, T val) {
+  for (int32_t i = 0; i < depth; ++i) {
+    int32_t index = index_fn(hash_fns[i](flowkey));
+    counter[i * stride + index].fetch_add(val, std::memory_order_relaxed);
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+T ConcurrentCMSketch<key_len, T, hash_t, index_t>::query(
+    const FlowKey<key_len> &flowkey) const {
+  T ret = std::numeric_limits<T>::max();
+  for (int32_t i = 0; i < depth; ++i) {
+    int32_t index = index_fn(hash_fns[i](flowkey));
+    const T val = counter[i * stride + index].load(std::memory_order_relaxed);
+    ret = val < ret ? val : ret;
+  }
+  return ret;
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+size_t ConcurrentCMSketch<key_len, T, hash_t, index_t>::size() const {
+  return sizeof(*this)                              // instance
+         + sizeof(hash_t) * depth                   // hashing class
+         + sizeof(std::atomic<T>) * depth * stride; // counter
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+int32_t
+ConcurrentCMSketch<key_len, T, hash_t, index_t>::solveWidth(int32_t depth,
+                                                            size_t budget) {
+  return Util::SolveBudget(budget, [depth](int32_t width) -> size_t {
+    return sizeof(ConcurrentCMSketch) // instance
+           + sizeof(hash_t) * depth   // hashing class
+           + sizeof(std::atomic<T>) * depth *
+                 padWidth(index_t::roundWidth(width)); // counter
+  });
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void ConcurrentCMSketch<key_len, T, hash_t, index_t>::clear() {
+  for (int32_t i = 0; i < depth * stride; ++i)
+    counter[i].store(0, std::memory_order_relaxed);
+}
+
+} // namespace OmniSketch::Sketch
@@ -0,0 +1,184 @@
+/**
+ * @file ConcurrentCountSketch.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Count Sketch shared by concurrent updaters
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/budget.h>
+#include <common/hash.h>
+#include <common/index.h>
+#include <common/simd.h>
+#include <common/sketch.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace OmniSketch::Sketch {
+/**
+ * @brief Count Sketch that many threads update at once
+ *
+ * @details Counterpart of ConcurrentCMSketch: one instance shared by all
+ * ingest threads, with signed counters updated by relaxed fetch-adds and rows
+ * starting on a cache line. Once the updaters are joined, queries give the
+ * same estimates as CountSketch on the same stream.
+ *
+ * @tparam key_len  length of flowkey
+ * @tparam T        type of the counter, e.g., `int32_t` for packed counters
+ * @tparam hash_t   hashing class
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          typename index_t = Index::Mod>
+class ConcurrentCountSketch : public SketchBase<key_len, T> {
+  static_assert(std::atomic<T>::is_always_lock_free,
+                "Counters should be lock-free atomics");
+
+private:
+  int32_t depth;
+  int32_t width;
+  int32_t stride; // counters from one row to the next, a multiple of a line
+  hash_t *hash_fns;
+  index_t index_fn;
+  std::atomic<T> *counter;
+
+  ConcurrentCountSketch(const ConcurrentCountSketch &) = delete;
+  ConcurrentCountSketch(ConcurrentCountSketch &&) = delete;
+
+  /**
+   * @brief Counters per row, padded to whole cache lines
+   *
+   */
+  static int32_t padWidth(int32_t width) {
+    constexpr int32_t per_line = 64 / sizeof(T);
+    return (width + per_line - 1) / per_line * per_line;
+  }
+
+public:
+  /**
+   * @brief Construct by specifying depth and width
+   *
+   */
+  ConcurrentCountSketch(int32_t depth_, int32_t width_);
+  /**
+   * @brief Largest width with which `depth` rows fit in `budget` bytes
+   * @details Same as size(), with the width rounded by `index_t`.
+   *
+   * @warning An exception is thrown if not even a width of 1 fits.
+   */
+  static int32_t solveWidth(int32_t depth, size_t budget);
+  /**
+   * @brief Release the pointer
+   *
+   */
+  ~ConcurrentCountSketch();
+  /**
+   * @brief Update a flowkey with certain value
+   * @details Safe to call from many threads at once.
+   *
+   */
+  void update(const FlowKey<key_len> &flowkey, T val) override;
+  /**
+   * @brief Query a flowkey
+   * @details Safe to call while other threads update.
+   *
+   */
+  T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Get the size of the sketch
+   *
+   */
+  size_t size() const override;
+  /**
+   * @brief Reset the sketch
+   * @details Not to be called while other threads update.
+   *
+   */
+  void clear();
+};
+
+} // namespace OmniSketch::Sketch
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Sketch {
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+ConcurrentCountSketch<key_len, T, hash_t, index_t>::ConcurrentCountSketch(
+    int32_t depth_, int32_t width_)
+    : depth(depth_), width(index_t::roundWidth(width_)),
+      stride(padWidth(width)), index_fn(width) {
+  // The first depth hash functions: CM
+  // The last depth hash function: signed bit
+  hash_fns = new hash_t[depth * 2];
+  // Allocate continuous memory, aligned to a cache line
+  const size_t bytes = sizeof(std::atomic<T>) * depth * stride;
+  counter = static_cast<std::atomic<T> *>(std::aligned_alloc(64, bytes));
+  if (!counter)
+    throw std::bad_alloc();
+  for (int32_t i = 0; i < depth * stride; ++i)
+    new (counter + i) std::atomic<T>(0);
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+ConcurrentCountSketch<key_len, T, hash_t, index_t>::~ConcurrentCountSketch() {
+  delete[] hash_fns;
+  std::free(counter);
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void ConcurrentCountSketch<key_len, T, hash_t, index_t>::update(
+    const FlowKey<key_len> &flowkey, T val) {
+  for (int32_t i = 0; i < depth; ++i) {
+    int32_t idx = index_fn(hash_fns[i](flowkey));
+    counter[i * stride + idx].fetch_add(
+        val * (static_cast<int>(hash_fns[depth + i](flowkey) & 1) * 2 - 1),
+        std::memory_order_relaxed);
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+T ConcurrentCountSketch<key_len, T, hash_t, index_t>::query(
+    const FlowKey<key_len> &flowkey) const {
+  T values[depth];
+  for (int32_t i = 0; i < depth; ++i) {
+    int32_t idx = index_fn(hash_fns[i](flowkey));
+    values[i] = counter[i * stride + idx].load(std::memory_order_relaxed) *
+                (static_cast<int>(hash_fns[depth + i](flowkey) & 1) * 2 - 1);
+  }
+  return std::abs(Util::Median(values, depth));
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+size_t ConcurrentCountSketch<key_len, T, hash_t, index_t>::size() const {
+  return sizeof(*this)                              // instance
+         + sizeof(hash_t) * depth * 2               // hashing class
+         + sizeof(std::atomic<T>) * depth * stride; // counter
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+int32_t
+ConcurrentCountSketch<key_len, T, hash_t, index_t>::solveWidth(int32_t depth,
+                                                               size_t budget) {
+  return Util::SolveBudget(budget, [depth](int32_t width) -> size_t {
+    return sizeof(ConcurrentCountSketch) // instance
+           + sizeof(hash_t) * depth * 2  // hashing class
+           + sizeof(std::atomic<T>) * depth *
+                 padWidth(index_t::roundWidth(width)); // counter
+  });
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void ConcurrentCountSketch<key_len, T, hash_t, index_t>::clear() {
+  for (int32_t i = 0; i < depth * stride; ++i)
+    counter[i].store(0, std::memory_order_relaxed);
+}
+
+} // namespace OmniSketch::Sketch
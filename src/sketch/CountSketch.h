@@ -8,7 +8,11 @@
  */
 #pragma once
 
+#include <common/budget.h>
 #include <common/hash.h>
+#include <common/index.h>
+#include <common/interleave.h>
+#include <common/simd.h>
 #include <common/sketch.h>
 
 namespace OmniSketch::Sketch {
@@ -19,23 +23,38 @@ namespace OmniSketch::Sketch {
  * @tparam T        type of the counter
  * @tparam hash_t   hashing class
  */
-template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          typename index_t = Index::Mod>
 class CountSketch : public SketchBase<key_len, T> {
 private:
   int32_t depth;
   int32_t width;
   hash_t *hash_fns;
+  index_t index_fn;
   T **counter;
 
   CountSketch(const CountSketch &) = delete;
   CountSketch(CountSketch &&) = delete;
 
+  /**
+   * @brief Median of the signed counters of all rows, in absolute value
+   *
+   */
+  T median(T *values) const;
+
 public:
   /**
    * @brief Construct by specifying depth and width
    *
    */
   CountSketch(int32_t depth_, int32_t width_);
+  /**
+   * @brief Largest width with which `depth` rows fit in `budget` bytes
+   * @details Same as size(), with the width rounded by `index_t`.
+   *
+   * @warning An exception is thrown if not even a width of 1 fits.
+   */
+  static int32_t solveWidth(int32_t depth, size_t budget);
   /**
    * @brief Release the pointer
    *
@@ -51,6 +70,28 @@ public:
    *
    */
   T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Query a batch of flowkeys, `in_flight` of them at a time
+   * @details Flowkeys are hashed and their counters prefetched `in_flight`
+   * ahead of the one whose median is taken.
+   *
+   */
+  void queryBatch(const FlowKey<key_len> *flowkeys, T *out, int32_t n,
+                  int32_t in_flight) const override;
+  /**
+   * @brief Update with one precomputed hash value per row
+   * @details Row `i` picks its counter by `hashes[i]` and its sign by the
+   * lowest bit of `hashes[i]`, so that a caller may hash a flowkey once and
+   * share the result among sketches, cf. LevelSampler.
+   *
+   */
+  void updateHashed(const uint64_t *hashes, T val);
+  /**
+   * @brief Query with one precomputed hash value per row
+   * @see updateHashed()
+   *
+   */
+  T queryHashed(const uint64_t *hashes) const;
   /**
    * @brief Get the size of the sketch
    *
@@ -61,6 +102,13 @@ public:
    *
    */
   void clear();
+  /**
+   * @brief Copy the hashing classes and counters of a sketch of the same
+   * depth and width
+   *
+   * @warning An exception is thrown if the shapes differ.
+   */
+  void copyFrom(const CountSketch &other);
   int32_t getDepth() const;
   int32_t getWidth() const;
   T getCnt(int32_t i, int32_t j);
@@ -76,24 +124,26 @@ public:
 
 namespace OmniSketch::Sketch {
 
-template <int32_t key_len, typename T, typename hash_t>
-int32_t CountSketch<key_len, T, hash_t>::getDepth() const{
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+int32_t CountSketch<key_len, T, hash_t, index_t>::getDepth() const{
   return depth;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-int32_t CountSketch<key_len, T, hash_t>::getWidth() const{
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+int32_t CountSketch<key_len, T, hash_t, index_t>::getWidth() const{
   return width;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-T CountSketch<key_len, T, hash_t>::getCnt(int32_t i, int32_t j){
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+T CountSketch<key_len, T, hash_t, index_t>::getCnt(int32_t i, int32_t j){
   return counter[i][j];
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-CountSketch<key_len, T, hash_t>::CountSketch(int32_t depth_, int32_t width_)
-    : depth(depth_), width(Util::NextPrime(width_)) {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+CountSketch<key_len, T, hash_t, index_t>::CountSketch(int32_t depth_,
+                                                      int32_t width_)
+    : depth(depth_), width(index_t::roundWidth(width_)),
+      index_fn(width) {
 
   // The first depth hash functions: CM
   // The last depth hash function: signed bit
@@ -106,50 +156,133 @@ CountSketch<key_len, T, hash_t>::CountSketch(int32_t depth_, int32_t width_)
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-CountSketch<key_len, T, hash_t>::~CountSketch() {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+CountSketch<key_len, T, hash_t, index_t>::~CountSketch() {
   delete[] hash_fns;
   delete[] counter[0];
   delete[] counter;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void CountSketch<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
-                                             T val) {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void CountSketch<key_len, T, hash_t, index_t>::update(
+    const FlowKey<key_len> &flowkey, T val) {
   for (int i = 0; i < depth; ++i) {
-    int idx = hash_fns[i](flowkey) % width;
+    int idx = index_fn(hash_fns[i](flowkey));
     counter[i][idx] +=
         val * (static_cast<int>(hash_fns[depth + i](flowkey) & 1) * 2 - 1);
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-T CountSketch<key_len, T, hash_t>::query(
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+T CountSketch<key_len, T, hash_t, index_t>::query(
     const FlowKey<key_len> &flowkey) const {
   T values[depth];
   for (int i = 0; i < depth; ++i) {
-    int idx = hash_fns[i](flowkey) % width;
+    int idx = index_fn(hash_fns[i](flowkey));
     values[i] = counter[i][idx] *
                 (static_cast<int>(hash_fns[depth + i](flowkey) & 1) * 2 - 1);
   }
-  std::sort(values, values + depth);
-  if (!(depth & 1)) { // even
-    return std::abs((values[depth / 2 - 1] + values[depth / 2]) / 2);
-  } else { // odd
-    return std::abs(values[depth / 2]);
+  return median(values);
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void CountSketch<key_len, T, hash_t, index_t>::queryBatch(
+    const FlowKey<key_len> *flowkeys, T *out, int32_t n,
+    int32_t in_flight) const {
+  struct Machine {
+    const CountSketch &cs;
+    const FlowKey<key_len> *flowkeys;
+    T *out;
+    std::vector<int32_t> jobs;
+    std::vector<int32_t> offsets; // `depth` per slot
+    std::vector<int32_t> signs;   // `depth` per slot
+    std::vector<T> values;        // `depth`
+
+    void start(int32_t slot, int32_t job) {
+      jobs[slot] = job;
+      int32_t *off = offsets.data() + slot * cs.depth;
+      int32_t *sign = signs.data() + slot * cs.depth;
+      for (int32_t i = 0; i < cs.depth; ++i) {
+        off[i] = i * cs.width + cs.index_fn(cs.hash_fns[i](flowkeys[job]));
+        sign[i] =
+            static_cast<int>(cs.hash_fns[cs.depth + i](flowkeys[job]) & 1) * 2 -
+            1;
+        Util::Prefetch(cs.counter[0] + off[i], sizeof(T));
+      }
+    }
+    bool resume(int32_t slot) {
+      const int32_t *off = offsets.data() + slot * cs.depth;
+      const int32_t *sign = signs.data() + slot * cs.depth;
+      for (int32_t i = 0; i < cs.depth; ++i)
+        values[i] = cs.counter[0][off[i]] * sign[i];
+      out[jobs[slot]] = cs.median(values.data());
+      return false;
+    }
+  } machine{*this,
+            flowkeys,
+            out,
+            std::vector<int32_t>(std::max(in_flight, 1)),
+            std::vector<int32_t>(std::max(in_flight, 1) * depth),
+            std::vector<int32_t>(std::max(in_flight, 1) * depth),
+            std::vector<T>(depth)};
+  Util::Interleave(machine, n, in_flight);
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void CountSketch<key_len, T, hash_t, index_t>::updateHashed(
+    const uint64_t *hashes, T val) {
+  for (int i = 0; i < depth; ++i) {
+    counter[i][index_fn(hashes[i])] +=
+        val * (static_cast<int>(hashes[i] & 1) * 2 - 1);
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+T CountSketch<key_len, T, hash_t, index_t>::queryHashed(
+    const uint64_t *hashes) const {
+  T values[depth];
+  for (int i = 0; i < depth; ++i) {
+    values[i] = counter[i][index_fn(hashes[i])] *
+                (static_cast<int>(hashes[i] & 1) * 2 - 1);
   }
+  return median(values);
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+T CountSketch<key_len, T, hash_t, index_t>::median(T *values) const {
+  return std::abs(Util::Median(values, depth));
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-size_t CountSketch<key_len, T, hash_t>::size() const {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+size_t CountSketch<key_len, T, hash_t, index_t>::size() const {
   return sizeof(*this)                // instance
          + sizeof(hash_t) * depth * 2 // hashing class
          + sizeof(T) * depth * width; // counter
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void CountSketch<key_len, T, hash_t>::clear() {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+int32_t CountSketch<key_len, T, hash_t, index_t>::solveWidth(int32_t depth,
+                                                             size_t budget) {
+  return Util::SolveBudget(budget, [depth](int32_t width) -> size_t {
+    return sizeof(CountSketch)                               // instance
+           + sizeof(hash_t) * depth * 2                      // hashing class
+           + sizeof(T) * depth * index_t::roundWidth(width); // counter
+  });
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void CountSketch<key_len, T, hash_t, index_t>::clear() {
   std::fill(counter[0], counter[0] + depth * width, 0);
 }
 
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void CountSketch<key_len, T, hash_t, index_t>::copyFrom(
+    const CountSketch &other) {
+  if (other.depth != depth || other.width != width)
+    throw std::invalid_argument(
+        "Invalid Argument: Copying a sketch of a different shape");
+  std::copy(other.hash_fns, other.hash_fns + depth * 2, hash_fns);
+  std::copy(other.counter[0], other.counter[0] + depth * width, counter[0]);
+}
+
 } // namespace OmniSketch::Sketch
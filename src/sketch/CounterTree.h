@@ -10,16 +10,23 @@
 
 #include <common/hash.h>
 #include <common/sketch.h>
+#include <common/stats.h>
 
 #include<stdlib.h>
-#include<time.h>
 #include<string.h>
 #include<algorithm>
+#include<random>
+
+// #define ENABLE_ORACLE
 
 namespace OmniSketch::Sketch {
 /**
  * @brief Counter Tree
  *
+ * @details size() gauges `overflow_rate` of the leaves in Util::Stats. With
+ * `ENABLE_ORACLE`, the true value of each leaf is kept alongside to also gauge
+ * `correct_rate`, `average_ratio` and `est_are` of the leaf estimates.
+ *
  * @tparam key_len  length of flowkey
  * @tparam T        type of the counter
  * @tparam hash_t   hashing class
@@ -34,13 +41,16 @@ private:
     int32_t m; // number of virtual leaves
     int32_t r; // number of buckets a flow has
     T n;       // number of packets
+    std::mt19937_64 rng; // picks buckets, apart from other instances
     int32_t bound_of_counters;
     int32_t counter_num;
     int32_t true_m; // number of true leaves
 
     counter_t* counter;
-    T* real_val;
     uint8_t* flag;
+#ifdef ENABLE_ORACLE
+    T* real_val;
+#endif
 #ifdef USE_RANDKEY
     int8_t** rand_key;
     hash_t hash_func;
@@ -117,10 +127,12 @@ CounterTree<key_len, T, hash_t>::CounterTree(
     bound_of_counters = (1 << b);
     counter = new counter_t[counter_num];
     flag = new uint8_t[counter_num];
-    real_val = new T[true_m];
     memset(counter, 0, counter_num * sizeof(counter_t));
     memset(flag, 0, counter_num * sizeof(uint8_t));
+#ifdef ENABLE_ORACLE
+    real_val = new T[true_m];
     memset(real_val, 0, true_m * sizeof(T));
+#endif
 #ifdef USE_RANDKEY
     rand_key = new int8_t *[r];
     rand_key[0] = new int8_t[r * key_len];
@@ -129,13 +141,11 @@ CounterTree<key_len, T, hash_t>::CounterTree(
         rand_key[i] = rand_key[i - 1] + key_len;
     }
 
-    std::srand((unsigned)time(NULL));
-
     for(int i = 0; i < r; i++)
     {
         for(int j = 0; j < key_len; j++)
         {
-            rand_key[i][j] = rand() % (1 << (8 * sizeof(int8_t)));
+            rand_key[i][j] = rng() % (1 << (8 * sizeof(int8_t)));
         }
     }
 #else
@@ -153,7 +163,9 @@ CounterTree<key_len, T, hash_t>::~CounterTree(){
 #else
     delete[] hash_func;
 #endif
+#ifdef ENABLE_ORACLE
     delete[] real_val;
+#endif
 }
 
 template <int32_t key_len, typename T, typename hash_t>
@@ -221,13 +233,15 @@ void CounterTree<key_len, T, hash_t>::update(
     n += val;
 #ifdef USE_RANDKEY
     FlowKey<key_len> tmp_key = flowkey;
-    tmp_key ^= (FlowKey<key_len>) (rand_key[rand() % r]);
+    tmp_key ^= (FlowKey<key_len>) (rand_key[rng() % r]);
     int32_t idx = hash_func(tmp_key) % m;
 #else
-    int32_t idx = hash_func[rand() % r](flowkey) % m;
+    int32_t idx = hash_func[rng() % r](flowkey) % m;
 #endif
     update_counter(idx, val);
+#ifdef ENABLE_ORACLE
     real_val[idx] += val;
+#endif
 }
 
 template <int32_t key_len, typename T, typename hash_t>
@@ -284,18 +298,22 @@ T CounterTree<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const{
 
 template <int32_t key_len, typename T, typename hash_t>
 size_t CounterTree<key_len, T, hash_t>::size() const{
-#ifdef MY_DEBUG
     int32_t overflow_num = 0;
-    int32_t correct_num = 0;
-    double total_est_val = 0;
-    T total_val = 0;
-    double are = 0;
     for(int i = 0; i < m; i++)
     {
         if(flag[i] == 1)
         {
             overflow_num++;
         }
+    }
+    STATS_SET("CounterTree", "overflow_rate", (double)overflow_num / m);
+#ifdef ENABLE_ORACLE
+    int32_t correct_num = 0;
+    double total_est_val = 0;
+    double total_val = 0;
+    double are = 0;
+    for(int i = 0; i < m; i++)
+    {
         double est_tmp = get_estimated_val(i);
         if((T)est_tmp == real_val[i])
         {
@@ -303,75 +321,15 @@ size_t CounterTree<key_len, T, hash_t>::size() const{
         }
         total_est_val += est_tmp;
         total_val += real_val[i];
-        double r = (double)est_tmp / real_val[i];
-        are += (r > 1)? (r - 1) : (1 - r);
-    }
-    T total_rec_val = 0;
-    for(int i = 0; i < counter_num; i++)
-    {
-        int idx = i;
-        int pow = 1;
-        while(idx >= true_m)
-        {
-            idx = get_left_son(idx);
-            pow = pow * bound_of_counters;
-        }
-        total_rec_val += counter[i] * pow;
-    }
-    int32_t my_k = 1;
-    for(int32_t i = 1; i < h; i++)
-    {
-        my_k *= d;
-    }
-    are /= m;
-    printf("RECORD %d PACKETS, THERE ARE %d PACKETS FOR REAL\n", total_rec_val, total_val);
-    printf("OVERFLOW RATE: %lf\n",(double)overflow_num / m);
-    printf("CORRECT RATE: %lf\n",(double)correct_num / m);
-    printf("AVERAGE RATIO: %lf\n",(double)total_est_val / total_val);
-    printf("TOTAL EST VAL: %lf\n",total_est_val);
-    printf("n * k = %d\n", n * my_k);
-    printf("EST ARE: %lf\n",are);
-
-    printf("=============================================\n");
-    int32_t l = 0;
-    int32_t r = true_m - 1;
-    int32_t k = 1;
-    for(int j = l; j <= r; j++)
-    {
-        printf("EST[%d]: %lf\n", j, get_estimated_val(j));
-    }
-    for(int j = l; j <= r; j++)
-    {
-        for(int t = 0; t < k; t++)
-        {
-            printf(" ");
-        }
-        printf("%d",real_val[j]);
-        for(int t = 0; t < k; t++)
-        {
-            printf(" ");
-        }
-    }
-    printf("\n");
-    for(int i = 0; i < h; i++)
-    {
-        for(int j = l; j <= r; j++)
+        if(real_val[i] != 0)
         {
-            for(int t = 0; t < k; t++)
-            {
-                printf(" ");
-            }
-            printf("%d",counter[j]);
-            for(int t = 0; t < k; t++)
-            {
-                printf(" ");
-            }
+            double ratio = est_tmp / real_val[i];
+            are += (ratio > 1)? (ratio - 1) : (1 - ratio);
         }
-        k *= 2;
-        l = get_parent(l);
-        r = get_parent(r);
-        printf("\n");
     }
+    STATS_SET("CounterTree", "correct_rate", (double)correct_num / m);
+    STATS_SET("CounterTree", "average_ratio", total_est_val / total_val);
+    STATS_SET("CounterTree", "est_are", are / m);
 #endif
 
 #ifdef USE_RANDKEY
@@ -160,7 +160,7 @@ void CountingBloomFilter<key_len, hash_t>::remove(
 
 template <int32_t key_len, typename hash_t>
 size_t CountingBloomFilter<key_len, hash_t>::size() const {
-  counter->print_rate("");
+  counter->reportStats("");
   return sizeof(*this)            // instance
          + sizeof(hash_t) * nhash // hash functions
          + counter->size()        // counter size
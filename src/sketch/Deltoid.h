@@ -9,10 +9,14 @@
 #pragma once
 
 #include <common/hash.h>
+#include <common/index.h>
+#include <common/simd.h>
 #include <common/sketch.h>
+#include <common/thread_pool.h>
 #include <vector>
 #include <algorithm>
 #include <cmath>
+#include <mutex>
 
 namespace OmniSketch::Sketch {
 /**
@@ -23,21 +27,32 @@ namespace OmniSketch::Sketch {
  * @tparam hash_t   hashing class
  */
 template <int32_t key_len, typename T, 
-          typename hash_t = Hash::AwareHash>
+          typename hash_t = Hash::AwareHash,
+          typename index_t = Index::Mod>
 class Deltoid : public SketchBase<key_len, T> {
 private:
   T sum_;
   int32_t num_hash_;
   int32_t num_group_;
   int32_t nbits_;
-  T ***arr1_; // 3d array:
-              //  num_hash*num_group*(nbits_+1). Corresponds to T_{a,b,c} in the
-              //  paper Here arr1_[a][b][nbits_] is used to represent T_{a, b,
-              //  0} in the paper
-  T ***arr0_; // 3d array:
-              //  num_hash*num_group*(nbits_). Corresponds to T'_{a,b,c} in the
-              //  paper
+  T *counter_; // num_hash*num_group groups of (2*nbits_+1) counters, laid
+               //  out as [arr0 | arr1 | total], see group()
   hash_t *hash_fns_; // hash funcs
+  index_t index_fn_; // reduce hashes to groups
+
+  /**
+   * @brief Counters of a group
+   *
+   * @details `group(a, b)[c]` and `group(a, b)[nbits_ + c]` correspond to
+   * T'_{a,b,c} and T_{a,b,c} in the paper respectively, while
+   * `group(a, b)[2 * nbits_]` is T_{a,b,0}, i.e., the total of the group.
+   * Keeping a group contiguous lets update() add to all its counters with a
+   * single masked pass.
+   */
+  T *group(int32_t a, int32_t b) const {
+    return counter_ +
+           (static_cast<size_t>(a) * num_group_ + b) * (2 * nbits_ + 1);
+  }
 
 public:
   /**
@@ -86,147 +101,119 @@ public:
 
 namespace OmniSketch::Sketch {
 
-template <int32_t key_len, typename T, typename hash_t>
-Deltoid<key_len, T, hash_t>::Deltoid(int32_t num_hash, int32_t num_group)
-    : num_hash_(num_hash), num_group_(Util::NextPrime(num_group)),
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+Deltoid<key_len, T, hash_t, index_t>::Deltoid(int32_t num_hash,
+                                              int32_t num_group)
+    : num_hash_(num_hash), num_group_(index_t::roundWidth(num_group)),
+      index_fn_(num_group_),
       nbits_(key_len * 8), sum_(0) {
 
   // allocate continuous memory
-  arr1_ = new T **[num_hash_];
-  for (int32_t i = 0; i < num_hash_; ++i) {
-    arr1_[i] = new T *[num_group_];
-  }
-  arr1_[0][0] = new T[num_hash_ * num_group_ * (nbits_ + 1)]();
-  for (int32_t j = 1; j < num_group_; ++j) {
-    arr1_[0][j] = arr1_[0][j - 1] + (nbits_ + 1);
-  }
-  for (int32_t i = 1; i < num_hash_; ++i) {
-    arr1_[i][0] = arr1_[i - 1][0] + num_group_ * (nbits_ + 1);
-    for (int32_t j = 1; j < num_group_; ++j) {
-      arr1_[i][j] = arr1_[i][j - 1] + (nbits_ + 1);
-    }
-  }
-  arr0_ = new T **[num_hash_];
-  for (int32_t i = 0; i < num_hash_; ++i) {
-    arr0_[i] = new T *[num_group_];
-  }
-  arr0_[0][0] = new T[num_hash_ * num_group_ * nbits_]();
-  for (int32_t j = 1; j < num_group_; ++j) {
-    arr0_[0][j] = arr0_[0][j - 1] + nbits_;
-  }
-  for (int32_t i = 1; i < num_hash_; ++i) {
-    arr0_[i][0] = arr0_[i - 1][0] + num_group_ * nbits_;
-    for (int32_t j = 1; j < num_group_; ++j) {
-      arr0_[i][j] = arr0_[i][j - 1] + nbits_;
-    }
-  }
+  counter_ = new T[static_cast<size_t>(num_hash_) * num_group_ *
+                   (2 * nbits_ + 1)]();
   // hash functions
   hash_fns_ = new hash_t[num_hash_];
 
   sum_ = 0;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-Deltoid<key_len, T, hash_t>::~Deltoid() {
-  if (arr1_ != nullptr) {
-    delete[] arr1_[0][0];
-    for (int32_t i = 0; i < num_hash_; ++i) {
-      delete[] arr1_[i];
-    }
-    delete[] arr1_;
-  }
-  if (arr0_ != nullptr) {
-    delete[] arr0_[0][0];
-    for (int32_t i = 0; i < num_hash_; ++i) {
-      delete[] arr0_[i];
-    }
-    delete[] arr0_;
-  }
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+Deltoid<key_len, T, hash_t, index_t>::~Deltoid() {
+  delete[] counter_;
   delete[] hash_fns_;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void Deltoid<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
-                                         T val) {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void Deltoid<key_len, T, hash_t, index_t>::update(
+    const FlowKey<key_len> &flowkey, T val) {
   sum_ += val;
   for (int32_t i = 0; i < num_hash_; ++i) {
-    int32_t idx = hash_fns_[i](flowkey) % num_group_;
-    for (int32_t j = 0; j < nbits_; ++j) {
-      if (flowkey.getBit(j)) {
-        arr1_[i][idx][j] += val;
-      } else {
-        arr0_[i][idx][j] += val;
-      }
-    }
-    arr1_[i][idx][nbits_] += val;
+    T *grp = group(i, index_fn_(hash_fns_[i](flowkey)));
+    Util::SplitAddBits(grp, grp + nbits_, flowkey.cKey(), key_len, val);
+    grp[2 * nbits_] += val;
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-T Deltoid<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+T Deltoid<key_len, T, hash_t, index_t>::query(
+    const FlowKey<key_len> &flowkey) const {
   T min_val = std::numeric_limits<T>::max();
+  const int8_t *key = flowkey.cKey();
   for (int32_t i = 0; i < num_hash_; ++i) {
-    int32_t idx = hash_fns_[i](flowkey) % num_group_;
+    const T *grp = group(i, index_fn_(hash_fns_[i](flowkey)));
     for (int32_t j = 0; j < nbits_; ++j) {
-      if (flowkey.getBit(j)) {
-        min_val = std::min(min_val, arr1_[i][idx][j]);
-      } else {
-        min_val = std::min(min_val, arr0_[i][idx][j]);
-      }
+      const int32_t bit = (key[j >> 3] >> (j & 7)) & 1;
+      min_val = std::min(min_val, grp[bit * nbits_ + j]);
     }
   }
   return min_val;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
 Data::Estimation<key_len, T>
-Deltoid<key_len, T, hash_t>::getHeavyHitter(double threshold) const {
+Deltoid<key_len, T, hash_t, index_t>::getHeavyHitter(double threshold) const {
   T thresh = threshold;
-  double val1 = 0;
-  double val0 = 0;
-  Data::Estimation<key_len, T> heavy_hitters;
-  for (int32_t i = 0; i < num_hash_; i++) {
-    for (int32_t j = 0; j < num_group_; j++) {
-      if (arr1_[i][j][nbits_] <= thresh) { // no heavy hitter in this group
-        continue;
-      }
-      FlowKey<key_len> fk{}; // create a flowkey with full 0
-      bool reject = false;
-      for (int32_t k = 0; k < nbits_; k++) {
-
-        bool t1 = (arr1_[i][j][k] > thresh);
-        bool t0 = (arr0_[i][j][k] > thresh);
-        if (t1 == t0) {
-          reject = true;
-          break;
-        }
-        if (t1) {
-          fk.setBit(k, true);
+  // Groups are decoded independently, so workers take contiguous ranges of
+  // them. Candidates are merged in group order, which keeps the result the
+  // same as that of a serial scan.
+  std::vector<std::pair<int64_t, std::vector<FlowKey<key_len>>>> found;
+  std::mutex found_mtx;
+  Util::ThreadPool::global().parallelFor(
+      0, static_cast<int64_t>(num_hash_) * num_group_,
+      [&](int64_t lo, int64_t hi) {
+        std::vector<FlowKey<key_len>> chunk;
+        for (int64_t g = lo; g < hi; ++g) {
+          const T *grp = group(g / num_group_, g % num_group_);
+          if (grp[2 * nbits_] <= thresh) { // no heavy hitter in this group
+            continue;
+          }
+          FlowKey<key_len> fk{}; // create a flowkey with full 0
+          bool reject = false;
+          for (int32_t k = 0; k < nbits_; k++) {
+            bool t1 = (grp[nbits_ + k] > thresh);
+            bool t0 = (grp[k] > thresh);
+            if (t1 == t0) {
+              reject = true;
+              break;
+            }
+            if (t1) {
+              fk.setBit(k, true);
+            }
+          }
+          if (!reject) {
+            chunk.push_back(fk);
+          }
         }
-      }
-      if (reject) {
-        continue;
-      } else if (!heavy_hitters.count(fk)) {
-        T esti_val = query(fk);
-        heavy_hitters[fk] = esti_val;
+        std::lock_guard<std::mutex> lock(found_mtx);
+        found.emplace_back(lo, std::move(chunk));
+      });
+  std::sort(found.begin(), found.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+
+  Data::Estimation<key_len, T> heavy_hitters;
+  for (const auto &chunk : found) {
+    for (const auto &fk : chunk.second) {
+      if (!heavy_hitters.count(fk)) {
+        heavy_hitters[fk] = query(fk);
       }
     }
   }
   return heavy_hitters;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-size_t Deltoid<key_len, T, hash_t>::size() const {
-  return sizeof(Deltoid<key_len, T, hash_t>) +
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+size_t Deltoid<key_len, T, hash_t, index_t>::size() const {
+  return sizeof(Deltoid<key_len, T, hash_t, index_t>) +
          (2 * num_group_ * num_hash_ * nbits_ + 1) * sizeof(T) +
          num_hash_ * sizeof(hash_t);
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void Deltoid<key_len, T, hash_t>::clear() {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void Deltoid<key_len, T, hash_t, index_t>::clear() {
   sum_ = 0;
-  std::fill(arr0_[0][0], arr0_[0][0] + num_hash_ * num_group_ * nbits_, 0);
-  std::fill(arr1_[0][0], arr1_[0][0] + num_hash_ * num_group_ * (nbits_ + 1),
+  std::fill(counter_,
+            counter_ + static_cast<size_t>(num_hash_) * num_group_ *
+                           (2 * nbits_ + 1),
             0);
 }
 
@@ -8,8 +8,11 @@
  */
 #pragma once
 
+#include <common/bucket.h>
 #include <common/hash.h>
+#include <common/interleave.h>
 #include <common/sketch.h>
+#include <common/stats.h>
 
 #include <sketch/CMSketch.h>
 
@@ -29,22 +32,25 @@ class ElasticSketch : public SketchBase<key_len, T> {
 private:
   struct Entry {
     FlowKey<key_len> flowkey_;
-    T val_;
     bool flag_;
-    Entry() : flowkey_(), val_(0), flag_(false) {}
-    bool isEmpty() {
-      FlowKey<key_len> emptyKey{};
-      return flowkey_ == emptyKey;
-    }
+    Entry() : flowkey_(), flag_(false) {}
   };
-  // heavy part
-  Entry **buckets_;
   int32_t num_buckets_;
   int32_t num_per_bucket_; // each bucket has num_per_bucket_ entries
+  // heavy part: fingerprints and counters of a bucket are packed in a block,
+  // while flowkeys are only visited on a fingerprint hit
+  Util::PackedBuckets<T> heavy_;
+  Entry *entries_;
 
   hash_t hash_h_;
   // light part
+  int32_t l_depth_;
   CMSketch<key_len, T, hash_t> cm_;
+  // number of flows evicted from the heavy part, reported by size()
+  int64_t evictions_;
+
+  int heavypartInsert(const FlowKey<key_len> &flowkey, uint64_t hash, T val,
+                      FlowKey<key_len> &swap_key, T &swap_val);
 
 public:
   ElasticSketch(int32_t num_buckets, int32_t num_per_bucket, int32_t l_depth,
@@ -56,11 +62,33 @@ public:
 
   void lightpartInsert(const FlowKey<key_len> &flowkey, T val);
   void update(const FlowKey<key_len> &flowkey, T val);
+  /**
+   * @brief Update a batch of flowkeys, with `width` of them in flight
+   * @details A job first prefetches its heavy bucket, then updates it and
+   * prefetches the light part if anything is evicted, and finally updates the
+   * light part. Heavy buckets are only touched at a fixed step and light
+   * counters are only added to, so the result is the same as updating them
+   * one by one.
+   *
+   */
+  void updateBatch(const FlowKey<key_len> *flowkeys, const T *vals, int32_t n,
+                   int32_t width) override;
   T heavypartQuery(const FlowKey<key_len> &flowkey, bool &flag) const;
   T lightpartQuery(const FlowKey<key_len> &flowkey) const;
   T query(const FlowKey<key_len> &flowkey) const;
+  /**
+   * @brief Flows in the heavy part whose estimates reach the threshold
+   *
+   */
+  Data::Estimation<key_len, T> getHeavyHitter(double threshold) const override;
   size_t size() const;
   void clear();
+  /**
+   * @brief Copy the whole state of a sketch of the same shape
+   *
+   * @warning An exception is thrown if the shapes differ.
+   */
+  void copyFrom(const ElasticSketch &other);
 };
 
 } // namespace OmniSketch::Sketch
@@ -79,73 +107,84 @@ ElasticSketch<key_len, T, hash_t>::ElasticSketch(int32_t num_buckets,
                                                  int32_t l_depth,
                                                  int32_t l_width)
     : num_buckets_(Util::NextPrime(num_buckets)),
-      num_per_bucket_(num_per_bucket), cm_(l_depth, l_width) {
-  buckets_ = new Entry *[num_buckets_];
-  buckets_[0] = new Entry[num_buckets_ * num_per_bucket_]();
-  for (int i = 1; i < num_buckets_; ++i) {
-    buckets_[i] = buckets_[i - 1] + num_per_bucket_;
-  }
+      num_per_bucket_(num_per_bucket),
+      heavy_(num_buckets_, num_per_bucket, num_per_bucket), l_depth_(l_depth),
+      cm_(l_depth, l_width), evictions_(0) {
+  entries_ = new Entry[num_buckets_ * num_per_bucket_]();
 }
 
 template <int32_t key_len, typename T, typename hash_t>
 size_t ElasticSketch<key_len, T, hash_t>::size() const {
+  STATS_SET("ElasticSketch", "evictions", evictions_);
   return sizeof(*this) 
-         + (key_len + sizeof(T) + 0.125) * num_buckets_ * num_per_bucket_ 
+         + (key_len + sizeof(T) + 1 + 0.125) * num_buckets_ * num_per_bucket_ 
          + cm_.size();
 }
 
 template <int32_t key_len, typename T, typename hash_t>
 void ElasticSketch<key_len, T, hash_t>::clear() {
   cm_.clear();
-  std::fill(buckets_[0], buckets_[0] + num_buckets_ * num_per_bucket_, 0);
+  heavy_.clear();
+  std::fill(entries_, entries_ + num_buckets_ * num_per_bucket_, Entry());
+  evictions_ = 0;
 }
 
 template <int32_t key_len, typename T, typename hash_t>
 ElasticSketch<key_len, T, hash_t>::~ElasticSketch() {
-  delete[] buckets_[0];
-  delete[] buckets_;
+  delete[] entries_;
 }
 
 template <int32_t key_len, typename T, typename hash_t>
 int ElasticSketch<key_len, T, hash_t>::heavypartInsert(
     const FlowKey<key_len> &flowkey, T val, FlowKey<key_len> &swap_key,
     T &swap_val) {
+  return heavypartInsert(flowkey, hash_h_(flowkey), val, swap_key, swap_val);
+}
 
-  int32_t index = hash_h_(flowkey) % num_buckets_;
-  int32_t matched = -1;
-  int32_t empty = -1;
-  int32_t min_counter = 0;
-  T min_counter_val = buckets_[index][0].val_;
-  for (int32_t i = 0; i < num_per_bucket_ - 1; ++i) {
-    if (buckets_[index][i].flowkey_ == flowkey) { // flowkey is in the bucket
-      matched = i;
-      buckets_[index][i].val_ += val;
-      return 0;
-    }
-    if (buckets_[index][i].isEmpty()) {
-      buckets_[index][i].flowkey_ = flowkey;
-      buckets_[index][i].val_ = val;
-      return 0;
-    }
-    if (min_counter_val > buckets_[index][i].val_) {
-      min_counter = i;
-      min_counter_val = buckets_[index][i].val_;
-    }
+template <int32_t key_len, typename T, typename hash_t>
+int ElasticSketch<key_len, T, hash_t>::heavypartInsert(
+    const FlowKey<key_len> &flowkey, uint64_t hash, T val,
+    FlowKey<key_len> &swap_key, T &swap_val) {
+
+  const int32_t index = hash % num_buckets_;
+  const uint8_t fp = Util::Fingerprint(hash);
+  uint8_t *fps = heavy_.fp(index);
+  T *vals = heavy_.val(index);
+  Entry *entries = entries_ + index * num_per_bucket_;
+  // the last entry is the guard, and entries are filled from the front
+  const int32_t n = num_per_bucket_ - 1;
+
+  int32_t matched = Util::FindFingerprint(
+      fps, n, fp, [&](int32_t i) { return entries[i].flowkey_ == flowkey; });
+  if (matched != -1) { // flowkey is in the bucket
+    vals[matched] += val;
+    return 0;
+  }
+  int32_t empty = Util::FindFingerprint(fps, n, 0, [](int32_t) { return true; });
+  if (empty != -1) {
+    fps[empty] = fp;
+    entries[empty].flowkey_ = flowkey;
+    vals[empty] = val;
+    return 0;
   }
+  int32_t min_counter = Util::MinIndex(vals, std::max(n, 1));
+  T min_counter_val = vals[min_counter];
   /* update guard val and comparison */
-  T guard_val = buckets_[index][num_per_bucket_ - 1].val_;
+  T guard_val = vals[num_per_bucket_ - 1];
   guard_val += 1;
 
   if (!JUDGE_IF_SWAP(min_counter_val, guard_val)) {
-    buckets_[index][num_per_bucket_ - 1].val_ = guard_val;
+    vals[num_per_bucket_ - 1] = guard_val;
     return 2;
   } else {
-    swap_key = buckets_[index][min_counter].flowkey_;
-    swap_val = buckets_[index][min_counter].val_;
-    buckets_[index][num_per_bucket_ - 1].val_ = 0;
-    buckets_[index][min_counter].flowkey_ = flowkey;
-    buckets_[index][min_counter].val_ = val;
-    buckets_[index][min_counter].flag_ = true;
+    swap_key = entries[min_counter].flowkey_;
+    swap_val = vals[min_counter];
+    vals[num_per_bucket_ - 1] = 0;
+    fps[min_counter] = fp;
+    entries[min_counter].flowkey_ = flowkey;
+    vals[min_counter] = val;
+    entries[min_counter].flag_ = true;
+    evictions_++;
     return 1;
   }
 }
@@ -180,15 +219,71 @@ void ElasticSketch<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
   }
 }
 
+template <int32_t key_len, typename T, typename hash_t>
+void ElasticSketch<key_len, T, hash_t>::updateBatch(
+    const FlowKey<key_len> *flowkeys, const T *vals, int32_t n,
+    int32_t width) {
+  struct Machine {
+    struct State {
+      int32_t job;
+      int32_t step;
+      uint64_t hash;
+      FlowKey<key_len> light_key; // what goes to the light part
+      T light_val;
+    };
+    ElasticSketch &es;
+    const FlowKey<key_len> *flowkeys;
+    const T *vals;
+    std::vector<State> states;
+    std::vector<int32_t> indices; // `l_depth_` per slot
+
+    void start(int32_t slot, int32_t job) {
+      State &st = states[slot];
+      st.job = job;
+      st.step = 0;
+      st.hash = es.hash_h_(flowkeys[job]);
+      const int32_t index = st.hash % es.num_buckets_;
+      Util::Prefetch(es.heavy_.fp(index), 1);
+      Util::Prefetch(es.entries_ + index * es.num_per_bucket_,
+                     sizeof(Entry) * es.num_per_bucket_);
+    }
+    bool resume(int32_t slot) {
+      State &st = states[slot];
+      int32_t *idx = indices.data() + slot * es.l_depth_;
+      if (st.step++) { // the light part
+        es.cm_.updateLocated(idx, st.light_val);
+        return false;
+      }
+      switch (es.heavypartInsert(flowkeys[st.job], st.hash, vals[st.job],
+                                 st.light_key, st.light_val)) {
+      case 0:
+        return false;
+      case 2:
+        st.light_key = flowkeys[st.job];
+        st.light_val = vals[st.job];
+        break;
+      }
+      es.cm_.locate(st.light_key, idx);
+      return true;
+    }
+  } machine{*this, flowkeys, vals,
+            std::vector<typename Machine::State>(std::max(width, 1)),
+            std::vector<int32_t>(std::max(width, 1) * l_depth_)};
+  Util::Interleave(machine, n, width);
+}
+
 template <int32_t key_len, typename T, typename hash_t>
 T ElasticSketch<key_len, T, hash_t>::heavypartQuery(
     const FlowKey<key_len> &flowkey, bool &flag) const {
-  int index = hash_h_(flowkey) % num_buckets_;
-  for (int i = 0; i < num_per_bucket_ - 1; ++i) {
-    if (buckets_[index][i].flowkey_ == flowkey) {
-      flag = buckets_[index][i].flag_;
-      return buckets_[index][i].val_;
-    }
+  const uint64_t hash = hash_h_(flowkey);
+  const int32_t index = hash % num_buckets_;
+  const Entry *entries = entries_ + index * num_per_bucket_;
+  int32_t matched = Util::FindFingerprint(
+      heavy_.fp(index), num_per_bucket_ - 1, Util::Fingerprint(hash),
+      [&](int32_t i) { return entries[i].flowkey_ == flowkey; });
+  if (matched != -1) {
+    flag = entries[matched].flag_;
+    return heavy_.val(index)[matched];
   }
   return 0;
 }
@@ -211,4 +306,37 @@ T ElasticSketch<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) cons
   return heavy_result + light_result;
 }
 
+template <int32_t key_len, typename T, typename hash_t>
+Data::Estimation<key_len, T>
+ElasticSketch<key_len, T, hash_t>::getHeavyHitter(double threshold) const {
+  Data::Estimation<key_len, T> ans;
+  for (int32_t i = 0; i < num_buckets_; ++i) {
+    const uint8_t *fps = heavy_.fp(i);
+    for (int32_t j = 0; j < num_per_bucket_ - 1; ++j) {
+      if (!fps[j])
+        continue;
+      const FlowKey<key_len> &flowkey =
+          entries_[i * num_per_bucket_ + j].flowkey_;
+      const T estimate = query(flowkey);
+      if (estimate >= threshold)
+        ans[flowkey] = estimate;
+    }
+  }
+  return ans;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+void ElasticSketch<key_len, T, hash_t>::copyFrom(const ElasticSketch &other) {
+  if (other.num_buckets_ != num_buckets_ ||
+      other.num_per_bucket_ != num_per_bucket_)
+    throw std::invalid_argument(
+        "Invalid Argument: Copying a sketch of a different shape");
+  heavy_.copyFrom(other.heavy_);
+  std::copy(other.entries_, other.entries_ + num_buckets_ * num_per_bucket_,
+            entries_);
+  hash_h_ = other.hash_h_;
+  cm_.copyFrom(other.cm_);
+  evictions_ = other.evictions_;
+}
+
 } // namespace OmniSketch::Sketch
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <common/hash.h>
+#include <common/stats.h>
 #include <sketch/BloomFilter.h>
 #include <ctime>
 
@@ -194,7 +195,8 @@ Data::Estimation<key_len, T> FlowRadar<key_len, T, hash_t>::decode() {
 #ifdef TEST_DECODE_TIME
   MY_TOCK = std::chrono::steady_clock::now();
   MY_TIMER = std::chrono::duration_cast<std::chrono::microseconds>(MY_TOCK - MY_TICK);
-  printf("\nDECODE COST %ldms\n", static_cast<int64_t>(MY_TIMER.count()));
+  STATS_ADD("FlowRadar", "decodes", 1);
+  STATS_ADD("FlowRadar", "decode_us", MY_TIMER.count());
 #endif
 
   return est;
@@ -11,6 +11,7 @@
 #include <iostream>
 
 #include <common/hash.h>
+#include <common/levels.h>
 #include <common/StreamSummary.h>
 #include <common/sketch.h>
 #include <sketch/CountSketch.h>
@@ -33,6 +34,7 @@ private:
   int32_t logn;
   hash_t *hash_fns;
   CountSketch<key_len, T, hash_t> **sketch;
+  LevelSampler<key_len, hash_t> *sampler; // only in the shared-hash mode
   Data::Estimation<key_len> *flows;
 
   HHUnivMon(const HHUnivMon &) = delete;
@@ -46,9 +48,11 @@ public:
    * @brief Construct by specifying depth, width and $\log n$, where $n$ is the
    * number of flows to insert.
    *
+   * @param shared_hash whether to sample levels by a single hash and share row
+   * hashes among levels, cf. LevelSampler
    */
   HHUnivMon(int32_t depth_, int32_t width_, int32_t log_n, 
-            int32_t heap_size, double SSalpha);
+            int32_t heap_size, double SSalpha, bool shared_hash = false);
   /**
    * @brief Release the pointer
    *
@@ -102,8 +106,10 @@ int32_t HHUnivMon<key_len, T, hash_t>::getHash(const FlowKey<key_len> &flowkey,
 
 template <int32_t key_len, typename T, typename hash_t>
 HHUnivMon<key_len, T, hash_t>::HHUnivMon(int32_t depth_, int32_t width_,
-                                     int32_t log_n, int32_t heap_size, double SSalpha)
-    : depth(depth_), width(Util::NextPrime(width_)), logn(log_n) {
+                                     int32_t log_n, int32_t heap_size, double SSalpha,
+                                     bool shared_hash)
+    : depth(depth_), width(Util::NextPrime(width_)), logn(log_n),
+      sampler(nullptr) {
 
   hash_fns = new hash_t[logn - 1];
   // Allocate continuous memory
@@ -119,6 +125,8 @@ HHUnivMon<key_len, T, hash_t>::HHUnivMon(int32_t depth_, int32_t width_,
     HHHeaps[i].init(heap_size, SSalpha);
   }
   sum = new T[logn];
+  if (shared_hash)
+    sampler = new LevelSampler<key_len, hash_t>(depth, logn);
 }
 
 template <int32_t key_len, typename T, typename hash_t>
@@ -132,6 +140,7 @@ HHUnivMon<key_len, T, hash_t>::~HHUnivMon() {
   }
   if (flows)
     delete[] flows;
+  delete sampler;
   for(int32_t i = 0; i < logn; i++){
     HHHeaps[i].destroy();
   }
@@ -156,6 +165,19 @@ Data::Estimation<key_len, T> HHUnivMon<key_len, T, hash_t>::getHeavyHitter(doubl
 template <int32_t key_len, typename T, typename hash_t>
 void HHUnivMon<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
                                          T val) {
+  if (sampler) {
+    uint64_t rows[depth], hashes[depth];
+    sampler->hashRows(flowkey, rows);
+    const int32_t levels = sampler->numLevels(flowkey);
+    for (int32_t i = 0; i < levels; ++i) {
+      sampler->atLevel(rows, i, hashes);
+      sum[i] += val;
+      sketch[i]->updateHashed(hashes, val);
+      T est = sketch[i]->queryHashed(hashes);
+      HHHeaps[i].insert(flowkey, est);
+    }
+    return;
+  }
   for (int32_t i = 0; i < logn; ++i) {
     if (getHash(flowkey, i)) {
       sum[i] += val;
@@ -169,6 +191,18 @@ void HHUnivMon<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
 
 template <int32_t key_len, typename T, typename hash_t>
 T HHUnivMon<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
+  if (sampler) {
+    uint64_t rows[depth], hashes[depth];
+    sampler->hashRows(flowkey, rows);
+    const int32_t level = sampler->numLevels(flowkey) - 1;
+    sampler->atLevel(rows, level, hashes);
+    T ret = sketch[level]->queryHashed(hashes);
+    for (int i = level - 1; i >= 0; i--) {
+      sampler->atLevel(rows, i, hashes);
+      ret = 2 * ret - sketch[i]->queryHashed(hashes);
+    }
+    return ret;
+  }
   int level;
   for(level = 0; level < logn; level++){
     if(!getHash(flowkey, level)){
@@ -189,6 +223,8 @@ size_t HHUnivMon<key_len, T, hash_t>::size() const {
   for (int32_t i = 0; i < logn; ++i)
     total += sketch[i]->size(); // L2 HH
   total += sizeof(hash_t) * (logn - 1);
+  if (sampler)
+    total += sampler->size();
   #ifndef NO_HEAP_SIZE
   for(int32_t i = 0; i < logn; i++){
     total += HHHeaps[i].memory_size();
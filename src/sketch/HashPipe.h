@@ -8,8 +8,11 @@
  */
 #pragma once
 
+#include <common/budget.h>
 #include <common/hash.h>
+#include <common/interleave.h>
 #include <common/sketch.h>
+#include <common/stats.h>
 
 // #define DO_NOT_CONSIDER_FLOWKEY_SIZE
 
@@ -33,17 +36,40 @@ private:
   int32_t width;
   hash_t *hash_fns;
   Entry **slots;
+  /**
+   * @brief Number of flowkeys evicted out of the last stage
+   *
+   */
+  int64_t evictions;
 
   HashPipe(const HashPipe &) = delete;
   HashPipe(HashPipe &&) = delete;
   HashPipe &operator=(HashPipe) = delete;
 
+  /**
+   * @brief Pass the carried flowkey through a stage
+   *
+   * @param c_key   the carried flowkey, swapped with the resident one if any
+   * @param c_val   its value, swapped likewise
+   * @param stage   the stage
+   * @param idx     slot of the carried flowkey in the stage
+   * @return whether a flowkey is still carried to the next stage
+   */
+  bool step(FlowKey<key_len> &c_key, T &c_val, int32_t stage, int32_t idx);
+
 public:
   /**
    * @brief Construct by specifying depth and width
    *
    */
   HashPipe(int32_t depth_, int32_t width_);
+  /**
+   * @brief Largest width with which `depth` stages fit in `budget` bytes
+   * @details Same as size(), with the width rounded to a prime.
+   *
+   * @warning An exception is thrown if not even a width of 1 fits.
+   */
+  static int32_t solveWidth(int32_t depth, size_t budget);
   /**
    * @brief Release the pointer
    *
@@ -54,6 +80,14 @@ public:
    *
    */
   void update(const FlowKey<key_len> &flowkey, T val) override;
+  /**
+   * @brief Update a batch of flowkeys, with `width` of them in flight
+   * @details A stage is only visited at a fixed step, so the result is the
+   * same as updating them one by one, much as in the hardware pipeline.
+   *
+   */
+  void updateBatch(const FlowKey<key_len> *flowkeys, const T *vals, int32_t n,
+                   int32_t width) override;
   /**
    * @brief Query a flowkey
    *
@@ -89,7 +123,7 @@ namespace OmniSketch::Sketch {
 
 template <int32_t key_len, typename T, typename hash_t>
 HashPipe<key_len, T, hash_t>::HashPipe(int32_t depth_, int32_t width_)
-    : depth(depth_), width(Util::NextPrime(width_)) {
+    : depth(depth_), width(Util::NextPrime(width_)), evictions(0) {
 
   hash_fns = new hash_t[depth];
   // Allocate continuous memory
@@ -108,50 +142,81 @@ HashPipe<key_len, T, hash_t>::~HashPipe() {
 }
 
 template <int32_t key_len, typename T, typename hash_t>
-void HashPipe<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
-                                          T val) {
-  // The first stage
-  int idx = hash_fns[0](flowkey) % width;
+bool HashPipe<key_len, T, hash_t>::step(FlowKey<key_len> &c_key, T &c_val,
+                                        int32_t stage, int32_t idx) {
   FlowKey<key_len> empty_key;
-  FlowKey<key_len> c_key;
-  T c_val;
-  if (slots[0][idx].flowkey == flowkey) {
+  Entry &slot = slots[stage][idx];
+  if (slot.flowkey == c_key) {
     // flowkey hit
-    slots[0][idx].val += val;
-    return;
-  } else if (slots[0][idx].flowkey == empty_key) {
+    slot.val += c_val;
+    return false;
+  } else if (slot.flowkey == empty_key) {
     // empty
-    slots[0][idx].val = val;
-    slots[0][idx].flowkey = flowkey;
-    return;
-  } else {
-    // swap
-    c_key = slots[0][idx].flowkey;
-    c_val = slots[0][idx].val;
-    slots[0][idx].flowkey = flowkey;
-    slots[0][idx].val = val;
+    slot.flowkey = c_key;
+    slot.val = c_val;
+    return false;
+  } else if (stage == 0 || slot.val < c_val) {
+    // swap, always at the first stage
+    std::swap(c_key, slot.flowkey);
+    std::swap(c_val, slot.val);
   }
-  // Later stages
-  for (int i = 1; i < depth; ++i) {
-    idx = hash_fns[i](c_key) % width;
-    if (slots[i][idx].flowkey == c_key) {
-      slots[i][idx].val += c_val;
-      return;
-    } else if (slots[i][idx].flowkey == empty_key) {
-      slots[i][idx].flowkey = c_key;
-      slots[i][idx].val = c_val;
+  if (stage == depth - 1)
+    evictions++;
+  return true;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+void HashPipe<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
+                                          T val) {
+  FlowKey<key_len> c_key = flowkey;
+  T c_val = val;
+  for (int32_t i = 0; i < depth; ++i) {
+    if (!step(c_key, c_val, i, hash_fns[i](c_key) % width))
       return;
-    } else if (slots[i][idx].val < c_val) {
-      // swap
-      // slots[i][idx].swap(c_key);
-      auto tmpkey = c_key;
-      c_key = slots[i][idx].flowkey;
-      slots[i][idx].flowkey = tmpkey;
-      std::swap(c_val, slots[i][idx].val);
-    }
   }
 }
 
+template <int32_t key_len, typename T, typename hash_t>
+void HashPipe<key_len, T, hash_t>::updateBatch(
+    const FlowKey<key_len> *flowkeys, const T *vals, int32_t n,
+    int32_t width) {
+  // step `s` of a job passes stage `s - 1`
+  struct Machine {
+    struct State {
+      FlowKey<key_len> c_key;
+      T c_val;
+      int32_t stage;
+      int32_t idx;
+    };
+    HashPipe &hp;
+    const FlowKey<key_len> *flowkeys;
+    const T *vals;
+    std::vector<State> states;
+
+    void fetch(State &st) {
+      st.idx = hp.hash_fns[st.stage](st.c_key) % hp.width;
+      Util::Prefetch(hp.slots[st.stage] + st.idx, sizeof(Entry));
+    }
+    void start(int32_t slot, int32_t job) {
+      State &st = states[slot];
+      st.c_key = flowkeys[job];
+      st.c_val = vals[job];
+      st.stage = 0;
+      fetch(st);
+    }
+    bool resume(int32_t slot) {
+      State &st = states[slot];
+      if (!hp.step(st.c_key, st.c_val, st.stage, st.idx) ||
+          ++st.stage == hp.depth)
+        return false;
+      fetch(st);
+      return true;
+    }
+  } machine{*this, flowkeys, vals,
+            std::vector<typename Machine::State>(std::max(width, 1))};
+  Util::Interleave(machine, n, width);
+}
+
 template <int32_t key_len, typename T, typename hash_t>
 T HashPipe<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
   T ret = 0;
@@ -187,6 +252,7 @@ HashPipe<key_len, T, hash_t>::getHeavyHitter(double threshold) const {
 
 template <int32_t key_len, typename T, typename hash_t>
 size_t HashPipe<key_len, T, hash_t>::size() const {
+  STATS_SET("HashPipe", "evictions", evictions);
 #ifndef DO_NOT_CONSIDER_FLOWKEY_SIZE
   return sizeof(*this)                    // instance
          + sizeof(hash_t) * depth         // hashing class
@@ -198,6 +264,21 @@ size_t HashPipe<key_len, T, hash_t>::size() const {
 #endif
 }
 
+template <int32_t key_len, typename T, typename hash_t>
+int32_t HashPipe<key_len, T, hash_t>::solveWidth(int32_t depth,
+                                                 size_t budget) {
+#ifndef DO_NOT_CONSIDER_FLOWKEY_SIZE
+  constexpr size_t slot = sizeof(FlowKey<key_len>) + sizeof(T);
+#else
+  constexpr size_t slot = sizeof(T);
+#endif
+  return Util::SolveBudget(budget, [depth](int32_t width) -> size_t {
+    return sizeof(HashPipe)                         // instance
+           + sizeof(hash_t) * depth                 // hashing class
+           + slot * depth * Util::NextPrime(width); // slots
+  });
+}
+
 template <int32_t key_len, typename T, typename hash_t>
 void HashPipe<key_len, T, hash_t>::clear() {
   FlowKey<key_len> empty_key;
@@ -207,6 +288,7 @@ void HashPipe<key_len, T, hash_t>::clear() {
       slots[i][j].val = 0;
     }
   }
+  evictions = 0;
 }
 
 } // namespace OmniSketch::Sketch
\ No newline at end of file
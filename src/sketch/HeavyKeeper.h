@@ -9,9 +9,13 @@
 #pragma once
 
 #include <common/hash.h>
+#include <common/index.h>
+#include <common/interleave.h>
 #include <common/sketch.h>
 #include <common/StreamSummary.h>
 
+#include <random>
+
 // #define USE_MAP
 // #define DEBUG
 
@@ -23,7 +27,8 @@ namespace OmniSketch::Sketch {
  * @tparam T        type of the counter
  * @tparam hash_t   hashing class
  */
-template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          typename index_t = Index::Mod>
 class HeavyKeeper : public SketchBase<key_len, T> {
 private:
 
@@ -36,8 +41,10 @@ private:
   int32_t width_;
 
   double b_;
+  std::mt19937_64 rng_; // decides decays, apart from other instances
 
   hash_t *sketch_hash_fun_;
+  index_t index_fn_;
   hash_t fingerprint_hash_fun_;
 
   class counter_t {
@@ -71,6 +78,13 @@ private:
   HeavyKeeper(HeavyKeeper &&) = delete;
   HeavyKeeper &operator=(HeavyKeeper) = delete;
 
+  /**
+   * @brief Update a flowkey whose counter indices are already known
+   *
+   * @param indices `depth_` counter indices, one per row
+   */
+  void update(const FlowKey<key_len> &flowkey, const int32_t *indices, T val);
+
 public:
   /**
    * @brief Construct by specifying depth, width, threshold size
@@ -90,6 +104,14 @@ public:
    *
    */
   void update(const FlowKey<key_len> &flowkey, T val);
+  /**
+   * @brief Update a batch of flowkeys, with `width` of them in flight
+   * @details A job first prefetches its counters and then does the update,
+   * in the same order as one by one.
+   *
+   */
+  void updateBatch(const FlowKey<key_len> *flowkeys, const T *vals, int32_t n,
+                   int32_t width) override;
   /**
    * @brief Get the K_th largest elem of the Array who has
    *        length elems.
@@ -110,6 +132,12 @@ public:
    *
    */
   Data::Estimation<key_len, T> getHeavyHitter(double val_threshold) const;
+  /**
+   * @brief Copy the whole state of a sketch of the same shape
+   *
+   * @warning An exception is thrown if the shapes differ.
+   */
+  void copyFrom(const HeavyKeeper &other);
 };
 
 } // namespace OmniSketch::Sketch
@@ -122,10 +150,11 @@ public:
 
 namespace OmniSketch::Sketch {
 
-template <int32_t key_len, typename T, typename hash_t>
-HeavyKeeper<key_len, T, hash_t>::HeavyKeeper(
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+HeavyKeeper<key_len, T, hash_t, index_t>::HeavyKeeper(
     int32_t depth, int32_t width, int32_t num_threshold, double b, double hash_table_alpha)
-    : depth_(depth), width_(Util::NextPrime(width)), hash_table_alpha(hash_table_alpha), 
+    : depth_(depth), width_(index_t::roundWidth(width)), index_fn_(width_),
+      hash_table_alpha(hash_table_alpha), 
       num_threshold_(num_threshold), b_(b), n_min_(0) {
 
   sketch_hash_fun_ = new hash_t[depth_];
@@ -143,8 +172,8 @@ HeavyKeeper<key_len, T, hash_t>::HeavyKeeper(
 
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-HeavyKeeper<key_len, T, hash_t>::~HeavyKeeper() {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+HeavyKeeper<key_len, T, hash_t, index_t>::~HeavyKeeper() {
   delete[] sketch_hash_fun_;
 
   delete[] counter_[0];
@@ -152,8 +181,8 @@ HeavyKeeper<key_len, T, hash_t>::~HeavyKeeper() {
   StreamSummary_.destroy();
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-size_t HeavyKeeper<key_len, T, hash_t>::size() 
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+size_t HeavyKeeper<key_len, T, hash_t, index_t>::size() 
   const{
   return depth_ * width_ * (sizeof(T) + sizeof(uint16_t))
          + depth_ * sizeof(hash_t)
@@ -161,9 +190,47 @@ size_t HeavyKeeper<key_len, T, hash_t>::size()
          + StreamSummary_.memory_size();
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void HeavyKeeper<key_len, T, hash_t>::update(
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void HeavyKeeper<key_len, T, hash_t, index_t>::update(
     const FlowKey<key_len> &flowkey, T val) {
+  int32_t indices[depth_];
+  for (int i = 0; i < depth_; i++)
+    indices[i] = index_fn_(sketch_hash_fun_[i](flowkey));
+  update(flowkey, indices, val);
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void HeavyKeeper<key_len, T, hash_t, index_t>::updateBatch(
+    const FlowKey<key_len> *flowkeys, const T *vals, int32_t n,
+    int32_t width) {
+  struct Machine {
+    HeavyKeeper &hk;
+    const FlowKey<key_len> *flowkeys;
+    const T *vals;
+    std::vector<int32_t> jobs;
+    std::vector<int32_t> indices; // `depth_` per slot
+
+    void start(int32_t slot, int32_t job) {
+      jobs[slot] = job;
+      int32_t *idx = indices.data() + slot * hk.depth_;
+      for (int i = 0; i < hk.depth_; i++) {
+        idx[i] = hk.index_fn_(hk.sketch_hash_fun_[i](flowkeys[job]));
+        Util::Prefetch(hk.counter_[i] + idx[i], sizeof(counter_t));
+      }
+    }
+    bool resume(int32_t slot) {
+      const int32_t job = jobs[slot];
+      hk.update(flowkeys[job], indices.data() + slot * hk.depth_, vals[job]);
+      return false;
+    }
+  } machine{*this, flowkeys, vals, std::vector<int32_t>(std::max(width, 1)),
+            std::vector<int32_t>(std::max(width, 1) * depth_)};
+  Util::Interleave(machine, n, width);
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void HeavyKeeper<key_len, T, hash_t, index_t>::update(
+    const FlowKey<key_len> &flowkey, const int32_t *indices, T val) {
   auto iter = StreamSummary_.find(flowkey);
   #ifndef USE_MAP
   bool flag = (iter != NULL);
@@ -177,7 +244,7 @@ void HeavyKeeper<key_len, T, hash_t>::update(
   bool done = false;
 
   for (int i = 0; i < depth_; i++) {
-      int32_t index = sketch_hash_fun_[i](flowkey) % width_;
+      int32_t index = indices[i];
       int32_t counterC = counter_[i][index].C;
       if (counterC > 0 && (flag || counterC < n_min_) && counter_[i][index].FP == FlowFP) {
       counterC += val;
@@ -189,7 +256,7 @@ void HeavyKeeper<key_len, T, hash_t>::update(
 
   if (!done) {
     for (int i = 0; i < depth_; i++) {
-      int32_t index = sketch_hash_fun_[i](flowkey) % width_;
+      int32_t index = indices[i];
       if (counter_[i][index].C == 0) {
         counter_[i][index].C = val;
         counter_[i][index].FP = FlowFP;
@@ -201,18 +268,18 @@ void HeavyKeeper<key_len, T, hash_t>::update(
   }
 
   if (!done) {
-    int32_t minC = counter_[0][sketch_hash_fun_[0](flowkey) % width_].C;
+    int32_t minC = counter_[0][indices[0]].C;
     int32_t minCounterID = 0;
     for (int i = 1; i < depth_; i++) {
-      int32_t index = sketch_hash_fun_[i](flowkey) % width_;
+      int32_t index = indices[i];
       int32_t counterC = counter_[i][index].C;
       if (counterC < minC) {
         minC = counterC;
         minCounterID = i;
       }
     }
-    int32_t minIndex = sketch_hash_fun_[minCounterID](flowkey) % width_;
-    if (((double)rand() / RAND_MAX) < (pow(b_, -minC))) {
+    int32_t minIndex = indices[minCounterID];
+    if ((rng_() >> 11) * 0x1p-53 < pow(b_, -minC)) {
       counter_[minCounterID][minIndex].C -= val;
       if (counter_[minCounterID][minIndex].C <= 0) {
         counter_[minCounterID][minIndex].C = 1;
@@ -272,8 +339,8 @@ void HeavyKeeper<key_len, T, hash_t>::update(
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-T HeavyKeeper<key_len, T, hash_t>::findKth(
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+T HeavyKeeper<key_len, T, hash_t, index_t>::findKth(
     T *Array, int32_t k, int32_t length) {
   int32_t left = 0, right = length - 1;
   while (left < right) {
@@ -299,9 +366,9 @@ T HeavyKeeper<key_len, T, hash_t>::findKth(
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
 Data::Estimation<key_len, T>
-HeavyKeeper<key_len, T, hash_t>::getTopK(int32_t k) const{
+HeavyKeeper<key_len, T, hash_t, index_t>::getTopK(int32_t k) const{
   T ValueArray[num_threshold_];
   int32_t ArrayLength = 0;
   #ifndef USE_MAP
@@ -342,9 +409,9 @@ HeavyKeeper<key_len, T, hash_t>::getTopK(int32_t k) const{
   return TopK;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
 Data::Estimation<key_len, T>
-HeavyKeeper<key_len, T, hash_t>::getHeavyHitter(
+HeavyKeeper<key_len, T, hash_t, index_t>::getHeavyHitter(
     double val_threshold) const {
   #ifndef USE_MAP
   return StreamSummary_.getHeavyHitter(val_threshold);
@@ -365,4 +432,24 @@ HeavyKeeper<key_len, T, hash_t>::getHeavyHitter(
   #endif
 }
 
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void HeavyKeeper<key_len, T, hash_t, index_t>::copyFrom(
+    const HeavyKeeper &other) {
+  if (other.depth_ != depth_ || other.width_ != width_ ||
+      other.num_threshold_ != num_threshold_)
+    throw std::invalid_argument(
+        "Invalid Argument: Copying a sketch of a different shape");
+  std::copy(other.sketch_hash_fun_, other.sketch_hash_fun_ + depth_,
+            sketch_hash_fun_);
+  fingerprint_hash_fun_ = other.fingerprint_hash_fun_;
+  std::copy(other.counter_[0], other.counter_[0] + depth_ * width_,
+            counter_[0]);
+  n_min_ = other.n_min_;
+#ifndef USE_MAP
+  StreamSummary_.copyFrom(other.StreamSummary_);
+#else
+  StreamSummary_ = other.StreamSummary_;
+#endif
+}
+
 } // namespace OmniSketch
\ No newline at end of file
@@ -7,23 +7,31 @@
  *
  */
 
-#define RECORD_PACKET_NUM
-#define RECORD_MAP_MEM
-
 #pragma once
 
+#include <common/arena.h>
 #include <common/hash.h>
+#include <common/index.h>
 #include <common/sketch.h>
+#include <common/stats.h>
 
 namespace OmniSketch::Sketch {
 /**
  * @brief LD Sketch
  *
+ * @details The flows of a bucket live in a small open-addressing table,
+ * carved out of an arena owned by the sketch and grown by doubling, so
+ * neither a new flow nor the expansion of a bucket costs a heap allocation
+ * once the arena has warmed up. size() gauges the number of updates and the
+ * bytes of buckets and flow tables as `LD.updates` and `LD.map_bytes` of
+ * Util::Stats.
+ *
  * @tparam key_len  length of flowkey
  * @tparam T        type of the counter
  * @tparam hash_t   hashing class
  */
-template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          typename index_t = Index::Mod>
 class LDSketch : public SketchBase<key_len, T> {
 private:
   int32_t depth_;
@@ -32,23 +40,62 @@ private:
   double thre;
 
   hash_t *hash_fns_;
+  index_t index_fn_;
 
   struct Bounds {
     T lower, upper;
   };
 
+  /**
+   * @brief An entry of the flow table of a bucket
+   * @details `tag` is a 32-bit digest of the hash value, with the lowest bit
+   * always on, so that 0 marks an empty slot.
+   *
+   */
+  struct Slot {
+    FlowKey<key_len> key;
+    T val;
+    uint32_t tag;
+
+    Slot() : val(0), tag(0) {}
+  };
+
+  /**
+   * @brief A bucket, whose flow table is a linear-probing hash table of
+   * `2^bits` slots in the arena of the sketch
+   *
+   */
   struct Bucket {
     T V, e;
     int32_t l;
-    std::map<FlowKey<key_len>, T> A;
+    int32_t n;    // number of flows in the table
+    int32_t bits; // -1 if the table is not allocated
+    Slot *slots;
 
     Bucket();
-    void update(const FlowKey<key_len> &flowkey, T val, double expansion);
-    Bounds query(const FlowKey<key_len> &flowkey) const;
+    void update(const FlowKey<key_len> &flowkey, uint32_t tag, T val,
+                double expansion, Util::SlabArena<Slot> &arena);
+    Bounds query(const FlowKey<key_len> &flowkey, uint32_t tag) const;
     void clear();
-    size_t size() const;
+
+  private:
+    int32_t find(const FlowKey<key_len> &flowkey, uint32_t tag) const;
+    void insert(const FlowKey<key_len> &flowkey, uint32_t tag, T val,
+                Util::SlabArena<Slot> &arena);
+    void grow(int32_t new_bits, Util::SlabArena<Slot> &arena);
+    void decrement(T dec);
   };
   Bucket **counter_;
+  Util::SlabArena<Slot> arena_;
+  int64_t updates_;
+
+  /**
+   * @brief Digest of a hash value used in flow tables
+   *
+   */
+  static uint32_t getTag(uint64_t hash) {
+    return static_cast<uint32_t>(Util::Mix64(hash) >> 32) | 1;
+  }
 
   LDSketch(const LDSketch &) = delete;
   LDSketch(LDSketch &&) = delete;
@@ -98,81 +145,152 @@ public:
 namespace OmniSketch::Sketch {
 
 
-template <int32_t key_len, typename T, typename hash_t>
-LDSketch<key_len, T, hash_t>::Bucket::Bucket() : V(0), e(0), l(0) {}
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+LDSketch<key_len, T, hash_t, index_t>::Bucket::Bucket()
+    : V(0), e(0), l(0), n(0), bits(-1), slots(nullptr) {}
 
-template <int32_t key_len, typename T, typename hash_t>
-void LDSketch<key_len, T, hash_t>::Bucket::update(
-    const FlowKey<key_len> &flowkey, T val, double expansion) {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+int32_t LDSketch<key_len, T, hash_t, index_t>::Bucket::find(
+    const FlowKey<key_len> &flowkey, uint32_t tag) const {
+  if (bits < 0)
+    return -1;
+  const uint32_t mask = (1u << bits) - 1;
+  for (uint32_t i = (tag >> 1) & mask; slots[i].tag; i = (i + 1) & mask) {
+    if (slots[i].tag == tag && slots[i].key == flowkey)
+      return i;
+  }
+  return -1;
+}
 
-#ifdef RECORD_PACKET_NUM
-  static int tmp = 0;
-  tmp++;
-  if(tmp % 100000 == 0){
-    printf("FINISH UPDATING %d PACKETS\n", tmp);
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void LDSketch<key_len, T, hash_t, index_t>::Bucket::insert(
+    const FlowKey<key_len> &flowkey, uint32_t tag, T val,
+    Util::SlabArena<Slot> &arena) {
+  // keep the load factor within 3/4
+  if (bits < 0 || 4 * (n + 1) > 3 * (1 << bits)) {
+    int32_t new_bits = std::max(bits + 1, 2);
+    while (4 * (n + 1) > 3 * (1 << new_bits))
+      ++new_bits;
+    grow(new_bits, arena);
   }
-#endif
-  
+  const uint32_t mask = (1u << bits) - 1;
+  uint32_t i = (tag >> 1) & mask;
+  while (slots[i].tag)
+    i = (i + 1) & mask;
+  slots[i].key = flowkey;
+  slots[i].val = val;
+  slots[i].tag = tag;
+  ++n;
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void LDSketch<key_len, T, hash_t, index_t>::Bucket::grow(
+    int32_t new_bits, Util::SlabArena<Slot> &arena) {
+  Slot *old_slots = slots;
+  const int32_t old_bits = bits;
+  slots = arena.allocate(new_bits);
+  bits = new_bits;
+  if (old_bits < 0)
+    return;
+  const uint32_t mask = (1u << bits) - 1;
+  for (int32_t j = 0; j < (1 << old_bits); ++j) {
+    if (!old_slots[j].tag)
+      continue;
+    uint32_t i = (old_slots[j].tag >> 1) & mask;
+    while (slots[i].tag)
+      i = (i + 1) & mask;
+    slots[i] = old_slots[j];
+  }
+  arena.release(old_slots, old_bits);
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void LDSketch<key_len, T, hash_t, index_t>::Bucket::decrement(T dec) {
+  // Decrement every flow in place and drop those that no longer count by
+  // backward-shift deletion. Sweeping from an empty slot, whatever is shifted
+  // into a deleted slot comes from ahead, i.e., has not been visited yet.
+  const uint32_t mask = (1u << bits) - 1;
+  uint32_t start = 0;
+  while (slots[start].tag)
+    ++start;
+  for (uint32_t step = 1, i = (start + 1) & mask; step < (1u << bits);) {
+    if (!slots[i].tag || slots[i].val - dec > 0) {
+      slots[i].val -= slots[i].tag ? dec : 0;
+      i = (i + 1) & mask;
+      ++step;
+      continue;
+    }
+    // delete slot i, and stay there to visit what is shifted into it
+    --n;
+    uint32_t hole = i;
+    for (uint32_t j = (i + 1) & mask; slots[j].tag; j = (j + 1) & mask) {
+      const uint32_t home = (slots[j].tag >> 1) & mask;
+      // slot j may fill the hole unless its home lies in (hole, j]
+      if (((j - home) & mask) >= ((j - hole) & mask)) {
+        slots[hole] = slots[j];
+        hole = j;
+      }
+    }
+    slots[hole].tag = 0;
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void LDSketch<key_len, T, hash_t, index_t>::Bucket::update(
+    const FlowKey<key_len> &flowkey, uint32_t tag, T val, double expansion,
+    Util::SlabArena<Slot> &arena) {
   V += val;
 
-  auto it = A.find(flowkey);
-  if (it != A.end())
-    it->second += val;
-  else if (A.size() < l)
-    A.emplace(flowkey, val);
+  const int32_t pos = find(flowkey, tag);
+  if (pos >= 0)
+    slots[pos].val += val;
+  else if (n < l)
+    insert(flowkey, tag, val, arena);
   else {
     T k = V / expansion;
     if ((k + 1) * (k + 2) - 1 <= l) {
       T e_cap = val;
-      for (const auto &kv : A)
-        e_cap = std::min(e_cap, kv.second);
-      e += e_cap;
-      for (auto it = A.begin(); it != A.end();) {
-        it->second -= e_cap;
-        if (it->second <= 0)
-          it = A.erase(it);
-        else
-          ++it;
+      for (int32_t j = 0; n && j < (1 << bits); ++j) {
+        if (slots[j].tag)
+          e_cap = std::min(e_cap, slots[j].val);
       }
+      e += e_cap;
+      if (n)
+        decrement(e_cap);
       if (val > e_cap)
-        A.emplace(flowkey, val - e_cap);
+        insert(flowkey, tag, val - e_cap, arena);
     } else {
       l = (k + 1) * (k + 2) - 1;
-      A.emplace(flowkey, val);
+      insert(flowkey, tag, val, arena);
     }
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-typename LDSketch<key_len, T, hash_t>::Bounds
-LDSketch<key_len, T, hash_t>::Bucket::query(
-    const FlowKey<key_len> &flowkey) const {
-  auto it = A.find(flowkey);
-  if (it == A.end())
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+typename LDSketch<key_len, T, hash_t, index_t>::Bounds
+LDSketch<key_len, T, hash_t, index_t>::Bucket::query(
+    const FlowKey<key_len> &flowkey, uint32_t tag) const {
+  const int32_t pos = find(flowkey, tag);
+  if (pos < 0)
     return {0, e};
   else
-    return {it->second, it->second + e};
+    return {slots[pos].val, slots[pos].val + e};
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void LDSketch<key_len, T, hash_t>::Bucket::clear() {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void LDSketch<key_len, T, hash_t, index_t>::Bucket::clear() {
   V = e = 0;
-  l = 0;
-  A.clear();
-}
-
-template <int32_t key_len, typename T, typename hash_t>
-size_t LDSketch<key_len, T, hash_t>::Bucket::size() const{
-  // Not accurate
-  return sizeof(LDSketch<key_len, T, hash_t>::Bucket) +
-         A.size() * (key_len + sizeof(T));
+  l = n = 0;
+  bits = -1;
+  slots = nullptr; // the arena is reset by the sketch
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-LDSketch<key_len, T, hash_t>::LDSketch(int32_t depth, int32_t width, 
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+LDSketch<key_len, T, hash_t, index_t>::LDSketch(int32_t depth, int32_t width, 
                                        double eps, double threshold)
-    : depth_(depth), width_(Util::NextPrime(width)), 
-      expansion_(eps * threshold), thre(threshold) {
+    : depth_(depth), width_(index_t::roundWidth(width)),
+      expansion_(eps * threshold), thre(threshold), index_fn_(width_),
+      updates_(0) {
 
   hash_fns_ = new hash_t[depth_];
 
@@ -183,25 +301,34 @@ LDSketch<key_len, T, hash_t>::LDSketch(int32_t depth, int32_t width,
     counter_[i] = counter_[i - 1] + width_;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-LDSketch<key_len, T, hash_t>::~LDSketch() {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+LDSketch<key_len, T, hash_t, index_t>::~LDSketch() {
   delete[] hash_fns_;
 
   delete[] counter_[0];
   delete[] counter_;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void LDSketch<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
-                                          T val) {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void LDSketch<key_len, T, hash_t, index_t>::update(
+    const FlowKey<key_len> &flowkey, T val) {
+  updates_++;
+  // locate all buckets first, so that their cache misses overlap
+  Bucket *buckets[depth_];
+  uint32_t tags[depth_];
   for (int i = 0; i < depth_; ++i) {
-    int32_t index = hash_fns_[i](flowkey) % width_;
-    counter_[i][index].update(flowkey, val, expansion_);
+    const uint64_t hash = hash_fns_[i](flowkey);
+    buckets[i] = counter_[i] + index_fn_(hash);
+    tags[i] = getTag(hash);
+    __builtin_prefetch(buckets[i]);
   }
+  for (int i = 0; i < depth_; ++i)
+    buckets[i]->update(flowkey, tags[i], val, expansion_, arena_);
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-Data::Estimation<key_len, T> LDSketch<key_len, T, hash_t>::getHeavyHitter(
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+Data::Estimation<key_len, T>
+LDSketch<key_len, T, hash_t, index_t>::getHeavyHitter(
   double val_threshold) const{
 
   assert((thre > val_threshold - 1e-6) && 
@@ -215,19 +342,22 @@ Data::Estimation<key_len, T> LDSketch<key_len, T, hash_t>::getHeavyHitter(
       if (bucket.V < val_threshold)
         continue;
 
-      for (const auto &kv : bucket.A) {
-        if (heavy_hitters.count(kv.first))
+      for (int32_t t = 0; bucket.n && t < (1 << bucket.bits); ++t) {
+        const Slot &slot = bucket.slots[t];
+        if (!slot.tag || heavy_hitters.count(slot.key))
           continue;
 
-        std::vector<T> upper_bounds(depth_);
-        for (int k = 0; k < depth_; ++k) {
-          int32_t index = hash_fns_[k](kv.first) % width_;
-          upper_bounds[k] = counter_[k][index].query(kv.first).upper;
+        T u = slot.val + bucket.e;
+        for (int k = 0; k < depth_ && u >= val_threshold; ++k) {
+          if (k == i)
+            continue;
+          const uint64_t hash = hash_fns_[k](slot.key);
+          u = std::min(u, counter_[k][index_fn_(hash)]
+                              .query(slot.key, getTag(hash))
+                              .upper);
         }
-
-        T u = *std::min_element(upper_bounds.begin(), upper_bounds.end());
         if (u >= val_threshold)
-          heavy_hitters[kv.first] = u;
+          heavy_hitters[slot.key] = u;
       }
     }
 
@@ -235,37 +365,26 @@ Data::Estimation<key_len, T> LDSketch<key_len, T, hash_t>::getHeavyHitter(
   
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-size_t LDSketch<key_len, T, hash_t>::size() const {
-  #ifdef RECORD_MAP_MEM
-  size_t map_mem = 0;
-  #endif
-  size_t s = sizeof(LDSketch<key_len, T, hash_t>) + // Instance
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+size_t LDSketch<key_len, T, hash_t, index_t>::size() const {
+  size_t s = sizeof(LDSketch<key_len, T, hash_t, index_t>) + // Instance
              sizeof(hash_t) * depth_ +              // hash_fns
-             sizeof(Bucket *) * depth_;
-  for (int i = 0; i < depth_; ++i){
-    for (int j = 0; j < width_; ++j){
-      #ifndef RECORD_MAP_MEM
-      s += counter_[i][j].size(); // Respective sizes
-      #else
-      size_t tmp = counter_[i][j].size();
-      s += tmp;
-      map_mem += tmp;
-      #endif
-    }
-  }
-  #ifdef RECORD_MAP_MEM
-  printf("MAP MEM: %ld BYTES, %lf KB, %lf MB\n", 
-          map_mem, (double)map_mem / 1024, (double)map_mem / (1024 * 1024));
-  #endif
+             sizeof(Bucket *) * depth_ +            // counter_
+             sizeof(Bucket) * depth_ * width_ +     // Buckets
+             arena_.bytesUsed();                    // Flow tables
+  STATS_SET("LD", "updates", updates_);
+  STATS_SET("LD", "map_bytes",
+            sizeof(Bucket) * depth_ * width_ + arena_.bytesUsed());
   return s;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void LDSketch<key_len, T, hash_t>::clear() {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void LDSketch<key_len, T, hash_t, index_t>::clear() {
   for (int i = 0; i < depth_; ++i)
     for (int j = 0; j < width_; ++j)
       counter_[i][j].clear();
+  arena_.reset();
+  updates_ = 0;
 }
 
 } // namespace OmniSketch::Sketch
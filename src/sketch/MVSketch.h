@@ -11,17 +11,21 @@
 #include <map>
 #include <vector>
 
+#include <common/budget.h>
 #include <common/hash.h>
+#include <common/index.h>
 #include <common/sketch.h>
 #include <common/utils.h>
 
 namespace OmniSketch::Sketch {
-template <int32_t key_len, typename T, typename hash_t> 
+template <int32_t key_len, typename T, typename hash_t,
+          typename index_t = Index::Mod> 
 class MVSketch : public SketchBase<key_len, T> {
   int32_t depth_;
   int32_t width_;
 
   hash_t *hash_fns_;
+  index_t index_fn_;
 
   struct Bounds {
     T lower;
@@ -38,6 +42,13 @@ class MVSketch : public SketchBase<key_len, T> {
 
 public:
   MVSketch(int32_t depth, int32_t width);
+  /**
+   * @brief Largest width with which `depth` rows fit in `budget` bytes
+   * @details Same as size(), with the width rounded by `index_t`.
+   *
+   * @warning An exception is thrown if not even a width of 1 fits.
+   */
+  static int32_t solveWidth(int32_t depth, size_t budget);
   MVSketch(MVSketch &&) = delete;
   ~MVSketch();
   MVSketch &operator=(const MVSketch &) = delete;
@@ -63,9 +74,10 @@ public:
 
 namespace OmniSketch::Sketch {
 
-template <int32_t key_len, typename T, typename hash_t>
-MVSketch<key_len, T, hash_t>::MVSketch(int32_t depth, int32_t width)
-    : depth_(depth), width_(Util::NextPrime(width)) {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+MVSketch<key_len, T, hash_t, index_t>::MVSketch(int32_t depth, int32_t width)
+    : depth_(depth), width_(index_t::roundWidth(width)),
+      index_fn_(width_) {
   hash_fns_ = new hash_t[depth_];
 
   // Allocate continuous memory
@@ -75,19 +87,19 @@ MVSketch<key_len, T, hash_t>::MVSketch(int32_t depth, int32_t width)
     counter_[i] = counter_[i - 1] + width_;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-MVSketch<key_len, T, hash_t>::~MVSketch() {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+MVSketch<key_len, T, hash_t, index_t>::~MVSketch() {
   delete[] hash_fns_;
 
   delete[] counter_[0];
   delete[] counter_;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void MVSketch<key_len, T, hash_t>::update(const FlowKey<key_len> &flow_key,
-                                          T val) {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void MVSketch<key_len, T, hash_t, index_t>::update(
+    const FlowKey<key_len> &flow_key, T val) {
   for (int i = 0; i < depth_; ++i) {
-    int index = hash_fns_[i](flow_key) % width_;
+    int index = index_fn_(hash_fns_[i](flow_key));
     counter_[i][index].V += val;
     if (counter_[i][index].K == flow_key)
       counter_[i][index].C += val;
@@ -101,12 +113,13 @@ void MVSketch<key_len, T, hash_t>::update(const FlowKey<key_len> &flow_key,
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-T MVSketch<key_len, T, hash_t>::query(const FlowKey<key_len> &flow_key) const {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+T MVSketch<key_len, T, hash_t, index_t>::query(
+    const FlowKey<key_len> &flow_key) const {
   std::vector<T> S_cap(depth_);
 
   for (int i = 0; i < depth_; ++i) {
-    int index = hash_fns_[i](flow_key) % width_;
+    int index = index_fn_(hash_fns_[i](flow_key));
     if (counter_[i][index].K == flow_key)
       S_cap[i] = (counter_[i][index].V + counter_[i][index].C) / 2;
     else
@@ -116,36 +129,48 @@ T MVSketch<key_len, T, hash_t>::query(const FlowKey<key_len> &flow_key) const {
   return *min_element(S_cap.begin(), S_cap.end());
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void MVSketch<key_len, T, hash_t>::clear() {
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+void MVSketch<key_len, T, hash_t, index_t>::clear() {
   std::fill(counter_[0], counter_[0] + depth_ * width_, {0, 0, 0});
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-size_t MVSketch<key_len, T, hash_t>::size() const {
-  return sizeof(MVSketch<key_len, T, hash_t>) + // Instance
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+size_t MVSketch<key_len, T, hash_t, index_t>::size() const {
+  return sizeof(MVSketch<key_len, T, hash_t, index_t>) + // Instance
          depth_ * sizeof(hash_t) +              // hash_fns
          sizeof(Bucket *) * depth_ +            // counter
          (2 * sizeof(T) + sizeof(FlowKey<key_len>)) * depth_ * width_;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-typename MVSketch<key_len, T, hash_t>::Bounds
-MVSketch<key_len, T, hash_t>::queryBounds(
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+int32_t MVSketch<key_len, T, hash_t, index_t>::solveWidth(int32_t depth,
+                                                          size_t budget) {
+  return Util::SolveBudget(budget, [depth](int32_t width) -> size_t {
+    return sizeof(MVSketch) +         // Instance
+           depth * sizeof(hash_t) +   // hash_fns
+           sizeof(Bucket *) * depth + // counter
+           (2 * sizeof(T) + sizeof(FlowKey<key_len>)) * depth *
+               index_t::roundWidth(width);
+  });
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
+typename MVSketch<key_len, T, hash_t, index_t>::Bounds
+MVSketch<key_len, T, hash_t, index_t>::queryBounds(
     const FlowKey<key_len> &flow_key) const {
   std::vector<T> L(depth_);
 
   for (int i = 0; i < depth_; ++i) {
-    int index = hash_fns_[i](flow_key) % width_;
+    int index = index_fn_(hash_fns_[i](flow_key));
     L[i] = counter_[i][index].K == flow_key ? counter_[i][index].C : 0;
   }
 
   return {*max_element(L.begin(), L.end()), query(flow_key)};
 }
 
-template <int32_t key_len, typename T, typename hash_t>
+template <int32_t key_len, typename T, typename hash_t, typename index_t>
 Data::Estimation<key_len, T> 
-MVSketch<key_len, T, hash_t>::getHeavyHitter(double threshold) const {
+MVSketch<key_len, T, hash_t, index_t>::getHeavyHitter(double threshold) const {
   Data::Estimation<key_len, T> heavy_hitters;
   std::set<FlowKey<key_len>> heavy_set;
 
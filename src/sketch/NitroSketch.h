@@ -8,8 +8,13 @@
  */
 #pragma once
 
+#include <common/budget.h>
 #include <common/hash.h>
+#include <common/interleave.h>
+#include <common/sampling.h>
+#include <common/simd.h>
 #include <common/sketch.h>
+#include <common/stats.h>
 
 #include <algorithm>
 #include <cmath>
@@ -35,6 +40,13 @@ public:
    *
    */
   NitroSketch(int depth, int width);
+  /**
+   * @brief Largest width with which `depth` rows fit in `budget` bytes
+   * @details Same as size(), with the width rounded to a prime.
+   *
+   * @warning An exception is thrown if not even a width of 1 fits.
+   */
+  static int32_t solveWidth(int32_t depth, size_t budget);
   /**
    * @brief Release the pointer
    *
@@ -51,6 +63,14 @@ public:
   void alwaysCorrectUpdate(const FlowKey<key_len> &flowkey, T value);
 
   T query(const FlowKey<key_len> &flowkey) const;
+  /**
+   * @brief Query a batch of flowkeys, `in_flight` of them at a time
+   * @details Flowkeys are hashed and their counters prefetched `in_flight`
+   * ahead of the one whose median is taken.
+   *
+   */
+  void queryBatch(const FlowKey<key_len> *flowkeys, T *out, int32_t n,
+                  int32_t in_flight) const;
 
   void adjustUpdateProb(double traffic_rate);
 
@@ -71,7 +91,7 @@ private:
   int32_t next_packet_; // number of skipped packets
 
   double update_prob_; // sampling probability
-  std::default_random_engine generator;
+  Util::GeometricSkip skip_;
 
   bool line_rate_enable_; // enable always line rate
   double switch_thresh_;  // switch to always line rate update
@@ -123,6 +143,7 @@ NitroSketch<key_len, T, hash_t>::NitroSketch(int depth, int width)
 template <int32_t key_len, typename T, typename hash_t>
 NitroSketch<key_len, T, hash_t>::~NitroSketch() {
   delete[] hash_fns_;
+  delete[] square_sum_;
   delete[] array_[0];
   delete[] array_;
 }
@@ -145,20 +166,59 @@ void NitroSketch<key_len, T, hash_t>::alwaysCorrectUpdate(
 
 template <int32_t key_len, typename T, typename hash_t>
 T NitroSketch<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const{
-  T median;
   T values[depth_];
   for (int i = 0; i < depth_; i++) {
     int index = hash_fns_[i](flowkey) % width_;
     values[i] = array_[i][index] *
                 (2 * static_cast<int>(hash_fns_[depth_ + i](flowkey) & 1) - 1);
   }
-  std::sort(values, values + depth_);
-  if (depth_ & 1) {
-    median = std::abs(values[depth_ / 2]);
-  } else {
-    median = std::abs((values[depth_ / 2 - 1] + values[depth_ / 2]) / 2);
-  }
-  return median;
+  return std::abs(Util::Median(values, depth_));
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+void NitroSketch<key_len, T, hash_t>::queryBatch(
+    const FlowKey<key_len> *flowkeys, T *out, int32_t n,
+    int32_t in_flight) const {
+  struct Machine {
+    const NitroSketch &nitro;
+    const FlowKey<key_len> *flowkeys;
+    T *out;
+    std::vector<int32_t> jobs;
+    std::vector<int32_t> offsets; // `depth_` per slot
+    std::vector<int32_t> signs;   // `depth_` per slot
+    std::vector<T> values;        // `depth_`
+
+    void start(int32_t slot, int32_t job) {
+      jobs[slot] = job;
+      const int depth = nitro.depth_;
+      int32_t *off = offsets.data() + slot * depth;
+      int32_t *sign = signs.data() + slot * depth;
+      for (int i = 0; i < depth; i++) {
+        off[i] = i * nitro.width_ +
+                 nitro.hash_fns_[i](flowkeys[job]) % nitro.width_;
+        sign[i] =
+            2 * static_cast<int>(nitro.hash_fns_[depth + i](flowkeys[job]) & 1) -
+            1;
+        Util::Prefetch(nitro.array_[0] + off[i], sizeof(T));
+      }
+    }
+    bool resume(int32_t slot) {
+      const int depth = nitro.depth_;
+      const int32_t *off = offsets.data() + slot * depth;
+      const int32_t *sign = signs.data() + slot * depth;
+      for (int i = 0; i < depth; i++)
+        values[i] = nitro.array_[0][off[i]] * sign[i];
+      out[jobs[slot]] = std::abs(Util::Median(values.data(), depth));
+      return false;
+    }
+  } machine{*this,
+            flowkeys,
+            out,
+            std::vector<int32_t>(std::max(in_flight, 1)),
+            std::vector<int32_t>(std::max(in_flight, 1) * depth_),
+            std::vector<int32_t>(std::max(in_flight, 1) * depth_),
+            std::vector<T>(depth_)};
+  Util::Interleave(machine, n, in_flight);
 }
 
 template <int32_t key_len, typename T, typename hash_t>
@@ -167,9 +227,18 @@ std::size_t NitroSketch<key_len, T, hash_t>::size() const{
          depth_ * sizeof(T *) + depth_ * width_ * sizeof(T);
 }
 
+template <int32_t key_len, typename T, typename hash_t>
+int32_t NitroSketch<key_len, T, hash_t>::solveWidth(int32_t depth,
+                                                    size_t budget) {
+  return Util::SolveBudget(budget, [depth](int32_t width) -> size_t {
+    return sizeof(NitroSketch) + depth * 2 * sizeof(hash_t) +
+           depth * sizeof(T *) + depth * sizeof(T) * Util::NextPrime(width);
+  });
+}
+
 template <int32_t key_len, typename T, typename hash_t>
 void NitroSketch<key_len, T, hash_t>::clear() {
-  std::fill(array_[0], array_[0] + depth_ * width_);
+  std::fill(array_[0], array_[0] + depth_ * width_, 0);
 }
 
 template <int32_t key_len, typename T, typename hash_t>
@@ -201,8 +270,9 @@ template <int32_t key_len, typename T, typename hash_t>
 void NitroSketch<key_len, T, hash_t>::getNextUpdate(double prob) {
   int sample = 1;
   if (prob < 1.0) {
-    std::geometric_distribution<int> dist(prob);
-    sample = 1 + dist(generator);
+    if (skip_.prob() != prob)
+      skip_.setProb(prob);
+    sample = 1 + skip_.next();
   }
   next_bucket_ = next_bucket_ + sample;
   next_packet_ = ((int)(next_bucket_ / depth_));
@@ -214,19 +284,13 @@ bool NitroSketch<key_len, T, hash_t>::isLineRateUpdate() {
   if (line_rate_enable_) {
     return true;
   } else {
-    double median;
     double values[depth_];
     for (int i = 0; i < depth_; i++) {
       values[i] = square_sum_[i];
     }
-    std::sort(values, values + depth_);
-    if (depth_ & 1) {
-      median = values[depth_ / 2];
-    } else {
-      median = (values[depth_ / 2 - 1] + values[depth_ / 2]) / 2;
-    }
+    const double median = Util::Median(values, depth_);
     if (median >= switch_thresh_) {
-      std::cout << "line rate update enable\n";
+      STATS_ADD("NitroSketch", "line_rate_switches", 1);
       line_rate_enable_ = true;
     }
     return line_rate_enable_;
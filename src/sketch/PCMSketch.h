@@ -10,11 +10,20 @@
 
 #include <common/hash.h>
 #include <common/sketch.h>
+#include <common/stats.h>
+
+// #define ENABLE_ORACLE
 
 namespace OmniSketch::Sketch {
 /**
  * @brief Pyramid Count Min Sketch
  *
+ * @details With `ENABLE_ORACLE`, full-width counters are kept alongside to
+ * record the ARE of queries against them, as `oracle_are` of Util::Stats.
+ * They cost more memory and writes than the pyramid saves, so they are
+ * compiled out by default, and accuracy is measured against the ground truth
+ * by the test instead.
+ *
  * @tparam key_len  length of flowkey
  * @tparam T        type of the counter
  * @tparam hash_t   hashing class
@@ -43,9 +52,11 @@ private:
 
   hash_t hash_fns;
 
+#ifdef ENABLE_ORACLE
   T* original_counter;
-  double ARE;
-  int32_t query_time;
+  mutable double ARE;
+  mutable int32_t query_time;
+#endif
 
   PCMSketch(const PCMSketch &) = delete;
   PCMSketch(PCMSketch &&) = delete;
@@ -124,18 +135,22 @@ PCMSketch<key_len, T, hash_t>::PCMSketch(int32_t word_num_, int32_t hash_num, in
     total_counter_num += cur_length;
   }
 
-  original_counter = new T[counter_num];
+#ifdef ENABLE_ORACLE
+  original_counter = new T[counter_num]();
   ARE = 0;
-
+  query_time = 0;
+#endif
 }
 
 template <int32_t key_len, typename T, typename hash_t>
 PCMSketch<key_len, T, hash_t>::~PCMSketch() {
-  delete hash_fns;
-  for(int i = 0; i < d; i++){
+  for(int i = 0; i < pyramid_depth; i++){
     delete[] counter[i];
   }
   delete[] counter;
+#ifdef ENABLE_ORACLE
+  delete[] original_counter;
+#endif
 }
 
 template <int32_t key_len, typename T, typename hash_t>
@@ -157,7 +172,9 @@ void PCMSketch<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
   {
   	counter_offset[i] = (hash_value & 0xFFF) % (1 << counter_index_size);
   	index[i] = ((my_word_index << counter_index_size) + counter_offset[i]) % counter_num;
+#ifdef ENABLE_ORACLE
     original_counter[index[i]] += val;
+#endif
   	hash_value >>= counter_index_size;
   
   	value[i] = (counter[0][my_word_index] >> (counter_offset[i] << lg_used_bits)) & MY_MASK;
@@ -186,7 +203,9 @@ void PCMSketch<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
 template <int32_t key_len, typename T, typename hash_t>
 T PCMSketch<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
   T min_value = 1 << 30;
+#ifdef ENABLE_ORACLE
   T original_min_value = 1 << 30;
+#endif
 
   T value[MAX_HASH_NUM];
   int index[MAX_HASH_NUM];
@@ -200,9 +219,11 @@ T PCMSketch<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
   {
   	counter_offset[i] = (hash_value & 0xFFF) % (1 << counter_index_size);
   	index[i] = ((my_word_index << counter_index_size) + counter_offset[i]) % counter_num;
-    
+
+#ifdef ENABLE_ORACLE
     T ori_val = original_counter[index[i]];
     original_min_value = ori_val < original_min_value ? ori_val : original_min_value;
+#endif
 
   	hash_value >>= counter_index_size;
 
@@ -211,17 +232,21 @@ T PCMSketch<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
   	min_value = value[i] < min_value ? value[i] : min_value;
   }
 
-  const_cast<PCMSketch<key_len, T, hash_t>*>(this)->query_time++;
-
+#ifdef ENABLE_ORACLE
+  query_time++;
   if(original_min_value != 0)
-    const_cast<PCMSketch<key_len, T, hash_t>*>(this)->ARE += ((double)std::abs(min_value - original_min_value)) / original_min_value;
+    ARE += ((double)std::abs(min_value - original_min_value)) / original_min_value;
+#endif
 
   return min_value;
 }
 
 template <int32_t key_len, typename T, typename hash_t>
 size_t PCMSketch<key_len, T, hash_t>::size() const {
-  printf("ARE: %lf\n", ARE / query_time);
+#ifdef ENABLE_ORACLE
+  if (query_time)
+    STATS_SET("PCM", "oracle_are", ARE / query_time);
+#endif
   return sizeof(*this)                // instance
          + sizeof(uint64_t) * total_counter_num; // counter
 }
@@ -232,6 +257,11 @@ void PCMSketch<key_len, T, hash_t>::clear() {
     int cur_length = (word_num + (1 << i) - 1) >> i;
     std::fill(counter[i], counter[i] + cur_length, 0);
   }
+#ifdef ENABLE_ORACLE
+  std::fill(original_counter, original_counter + counter_num, 0);
+  ARE = 0;
+  query_time = 0;
+#endif
 }
 
 template <int32_t key_len, typename T, typename hash_t>
@@ -10,6 +10,7 @@
 
 #include <common/hash.h>
 #include <common/sketch.h>
+#include <common/stats.h>
 #include <Eigen/Dense>
 #include <Eigen/IterativeLinearSolvers>
 #include <Eigen/SparseCore>
@@ -232,7 +233,8 @@ void PRSketch<key_len, T, hash_t>::recover(){
 #ifdef TEST_DECODE_TIME
   MY_TOCK = std::chrono::steady_clock::now();
   MY_TIMER = std::chrono::duration_cast<std::chrono::microseconds>(MY_TOCK - MY_TICK);
-  printf("\nDECODE COST %ldms\n", static_cast<int64_t>(MY_TIMER.count()));
+  STATS_ADD("PRSketch", "decodes", 1);
+  STATS_ADD("PRSketch", "decode_us", MY_TIMER.count());
 #endif
 
 }
@@ -119,7 +119,7 @@ T QueryingCountingBloomFilter<key_len, T, hash_t>::query(const FlowKey<key_len>
 
 template <int32_t key_len, typename T, typename hash_t>
 size_t QueryingCountingBloomFilter<key_len, T, hash_t>::size() const {
-  counter->print_rate("");
+  counter->reportStats("");
   return sizeof(*this)            // instance
          + sizeof(hash_t) * nhash // hash functions
          + counter->size()        // counter size
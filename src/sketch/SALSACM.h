@@ -7,24 +7,29 @@
  *
  */
 #pragma once
-// #define DEBUG
+// #define ENABLE_ORACLE
 
 #include <common/hash.h>
+#include <common/salsa.h>
 #include <common/sketch.h>
 
 namespace OmniSketch::Sketch {
 /**
  * @brief SALSA Count Min Sketch
+ * @details With `ENABLE_ORACLE`, unmerged counters are kept alongside and
+ * every query is checked never to exceed them. They are compiled out by
+ * default, as they take more memory than SALSA saves.
  *
  * @tparam key_len  length of flowkey
  * @tparam T        type of the counter
  * @tparam hash_t   hashing class
+ * @tparam row_t    primitives on a row of counters, see Util::SalsaRow
  */
-template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          typename row_t = Util::SalsaRow>
 class SALSACM : public SketchBase<key_len, T> {
 private:
   static int32_t maxCounterLen;
-  static uint32_t upperBoundofUnitCounter;
 
   int32_t depth;
   int32_t width;
@@ -32,7 +37,7 @@ private:
   uint8_t **counter;
   uint8_t **bitMap;
 
-  #ifdef DEBUG
+  #ifdef ENABLE_ORACLE
   int32_t oriLen;
   T **oriCounter;
   #endif
@@ -91,42 +96,32 @@ public:
 
 namespace OmniSketch::Sketch {
 
-template <int32_t key_len, typename T, typename hash_t>
-int32_t SALSACM<key_len, T, hash_t>::maxCounterLen = sizeof(T) / sizeof(uint8_t);
+template <int32_t key_len, typename T, typename hash_t, typename row_t>
+int32_t SALSACM<key_len, T, hash_t, row_t>::maxCounterLen = sizeof(T) / sizeof(uint8_t);
 
-template <int32_t key_len, typename T, typename hash_t>
-uint32_t SALSACM<key_len, T, hash_t>::upperBoundofUnitCounter = (1 << 8);
-
-template <int32_t key_len, typename T, typename hash_t>
-bool SALSACM<key_len, T, hash_t>::getFlagBit(const int32_t& rowIdx, const int32_t& idx) const{
+template <int32_t key_len, typename T, typename hash_t, typename row_t>
+bool SALSACM<key_len, T, hash_t, row_t>::getFlagBit(const int32_t& rowIdx, const int32_t& idx) const{
     return (bitMap[rowIdx][idx / 8] >> (idx % 8)) & 1;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void SALSACM<key_len, T, hash_t>::setFlagBit(const int32_t& rowIdx, const int32_t& idx){
+template <int32_t key_len, typename T, typename hash_t, typename row_t>
+void SALSACM<key_len, T, hash_t, row_t>::setFlagBit(const int32_t& rowIdx, const int32_t& idx){
     bitMap[rowIdx][idx / 8] |= (1 << (idx % 8));
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void SALSACM<key_len, T, hash_t>::getBoundary(const int32_t& rowIdx, const int32_t& idx, int32_t& left, int32_t& right) const {
-    left = idx;
-    right = idx;
-    while(left >= 1 && getFlagBit(rowIdx, left - 1)){
-        left--;
-    }
-    while(right < width - 1 && getFlagBit(rowIdx, right)){
-        right++;
-    }
+template <int32_t key_len, typename T, typename hash_t, typename row_t>
+void SALSACM<key_len, T, hash_t, row_t>::getBoundary(const int32_t& rowIdx, const int32_t& idx, int32_t& left, int32_t& right) const {
+    row_t::boundary(bitMap[rowIdx], width, idx, left, right);
     assert(right - left + 1 <= maxCounterLen);
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void SALSACM<key_len, T, hash_t>::updateCounter(const int32_t& rowIdx, const int32_t& idx, T val){
+template <int32_t key_len, typename T, typename hash_t, typename row_t>
+void SALSACM<key_len, T, hash_t, row_t>::updateCounter(const int32_t& rowIdx, const int32_t& idx, T val){
     int32_t left, right;
     getBoundary(rowIdx, idx, left, right);
     int32_t len = right - left + 1;
     T counterVal = getCounterVal(rowIdx, left, right) + val;
-    if(counterVal < (1 << (len << 3))){
+    if(row_t::fits(counterVal, len)){
         // set counter val
         setCounterVal(rowIdx, left, right, counterVal);
     } else{
@@ -135,33 +130,21 @@ void SALSACM<key_len, T, hash_t>::updateCounter(const int32_t& rowIdx, const int
     }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void SALSACM<key_len, T, hash_t>::setCounterVal(const int32_t& rowIdx, const int32_t& left, const int32_t& right, T val){
+template <int32_t key_len, typename T, typename hash_t, typename row_t>
+void SALSACM<key_len, T, hash_t, row_t>::setCounterVal(const int32_t& rowIdx, const int32_t& left, const int32_t& right, T val){
     // if(left <= 450795 && right >= 450795){
     //     printf("falty link caught! update value is %d, row is %d, left is %d, right is %d, left bit is %d, right bit is %d\n", val, rowIdx, left, right, (int)getFlagBit(rowIdx, left), (int)getFlagBit(rowIdx, right));
     // }
-    int32_t runner = right;
-    while(runner >= left){
-        counter[rowIdx][runner] = val % upperBoundofUnitCounter;
-        val >>= 8;
-        runner--;
-    }
-    assert(val == 0);
+    row_t::set(counter[rowIdx], left, right, val);
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-T SALSACM<key_len, T, hash_t>::getCounterVal(const int32_t& rowIdx, const int32_t& left, const int32_t& right) const{
-    uint64_t ret = counter[rowIdx][left];
-    int32_t runner = left + 1;
-    while(runner <= right){
-        ret = (ret << 8) + counter[rowIdx][runner];
-        runner++;
-    }
-    return (T)ret;
+template <int32_t key_len, typename T, typename hash_t, typename row_t>
+T SALSACM<key_len, T, hash_t, row_t>::getCounterVal(const int32_t& rowIdx, const int32_t& left, const int32_t& right) const{
+    return (T)row_t::get(counter[rowIdx], left, right);
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void SALSACM<key_len, T, hash_t>::mergeCounter(const int32_t& rowIdx, const int32_t& left, const int32_t& right, T val){
+template <int32_t key_len, typename T, typename hash_t, typename row_t>
+void SALSACM<key_len, T, hash_t, row_t>::mergeCounter(const int32_t& rowIdx, const int32_t& left, const int32_t& right, T val){
     int32_t leftPower = (left) & (- (left));
     int32_t rightPower = (right + 1) & (-(right + 1));
     if(left == 0 || leftPower > rightPower){
@@ -184,23 +167,23 @@ void SALSACM<key_len, T, hash_t>::mergeCounter(const int32_t& rowIdx, const int3
     }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-SALSACM<key_len, T, hash_t>::SALSACM(int32_t depth_, int32_t width_)
+template <int32_t key_len, typename T, typename hash_t, typename row_t>
+SALSACM<key_len, T, hash_t, row_t>::SALSACM(int32_t depth_, int32_t width_)
     : depth(depth_), width(maxCounterLen * Util::NextPrime((int32_t)(width_ / maxCounterLen))){
 
     hash_fns = new hash_t[depth];
     counter = new uint8_t* [depth];
-    counter[0] = new uint8_t[depth * width]();
+    counter[0] = new uint8_t[depth * width + row_t::kPadding]();
     for(int32_t i = 1; i < depth; ++i){
         counter[i] = counter[i - 1] + width;
     }
-    int32_t counterNo = (width + 7) / 8;
+    int32_t counterNo = row_t::bitmapBytes(width);
     bitMap = new uint8_t* [depth];
-    bitMap[0] = new uint8_t[depth * counterNo]();
+    bitMap[0] = new uint8_t[depth * counterNo + row_t::kPadding]();
     for(int32_t i = 1; i < depth; ++i){
         bitMap[i] = bitMap[i - 1] + counterNo;
     }
-    #ifdef DEBUG
+    #ifdef ENABLE_ORACLE
     oriLen = width / maxCounterLen;
     assert(oriLen * maxCounterLen == width);
     oriCounter = new T*[depth];
@@ -211,36 +194,34 @@ SALSACM<key_len, T, hash_t>::SALSACM(int32_t depth_, int32_t width_)
     #endif
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-SALSACM<key_len, T, hash_t>::~SALSACM(){
+template <int32_t key_len, typename T, typename hash_t, typename row_t>
+SALSACM<key_len, T, hash_t, row_t>::~SALSACM(){
     delete[] hash_fns;
     delete[] counter[0];
     delete[] counter;
     delete[] bitMap[0];
     delete[] bitMap;
-    #ifdef DEBUG
+    #ifdef ENABLE_ORACLE
     delete[] oriCounter[0];
     delete[] oriCounter;
     #endif
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void SALSACM<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
+template <int32_t key_len, typename T, typename hash_t, typename row_t>
+void SALSACM<key_len, T, hash_t, row_t>::update(const FlowKey<key_len> &flowkey,
                                          T val){
     for(int32_t i = 0; i < depth; ++i){
         int32_t index = hash_fns[i](flowkey) % width;
 
-        #ifdef DEBUG
-        static int times = 0;
-        times++;
+        #ifdef ENABLE_ORACLE
         int32_t oriIdx = index / maxCounterLen;
-        // printf("index: %d / %d, original index: %d / %d, times: %d\n", index, width, oriIdx, oriLen, times);
+        // printf("index: %d / %d, original index: %d / %d\n", index, width, oriIdx, oriLen);
         // fflush(stdout);
         #endif
 
         updateCounter(i, index, val);
 
-        #ifdef DEBUG
+        #ifdef ENABLE_ORACLE
         int32_t left, right;
         getBoundary(i, index, left, right);
         // printf("update counter done. value = %d\n", getCounterVal(i, left, right));
@@ -252,9 +233,9 @@ void SALSACM<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
     }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-T SALSACM<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
-    #ifdef DEBUG
+template <int32_t key_len, typename T, typename hash_t, typename row_t>
+T SALSACM<key_len, T, hash_t, row_t>::query(const FlowKey<key_len> &flowkey) const {
+    #ifdef ENABLE_ORACLE
     // printf("query called!\n");
     // fflush(stdout);
     #endif
@@ -263,7 +244,7 @@ T SALSACM<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
         int32_t index = hash_fns[i](flowkey) % width;
         int32_t left, right;
         getBoundary(i, index, left, right);
-        #ifndef DEBUG
+        #ifndef ENABLE_ORACLE
         min_val = std::min(min_val, getCounterVal(i, left, right));
         #else
         T est = getCounterVal(i, left, right);
@@ -286,8 +267,8 @@ T SALSACM<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
     return min_val;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-size_t SALSACM<key_len, T, hash_t>::size() const{
+template <int32_t key_len, typename T, typename hash_t, typename row_t>
+size_t SALSACM<key_len, T, hash_t, row_t>::size() const{
     int32_t counterNo = (width + 7) / 8;
     return sizeof(*this) + 
            sizeof(hash_t) * depth + 
@@ -295,11 +276,14 @@ size_t SALSACM<key_len, T, hash_t>::size() const{
            sizeof(uint8_t) * depth * counterNo;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void SALSACM<key_len, T, hash_t>::clear() {
+template <int32_t key_len, typename T, typename hash_t, typename row_t>
+void SALSACM<key_len, T, hash_t, row_t>::clear() {
     int32_t counterNo = (width + 7) / 8;
     std::fill(counter[0], counter[0] + depth * width, 0);
     std::fill(bitMap[0], bitMap[0] + depth * counterNo, 0);
+    #ifdef ENABLE_ORACLE
+    std::fill(oriCounter[0], oriCounter[0] + depth * oriLen, 0);
+    #endif
 }
 
 } // namespace OmniSketch::Sketch
@@ -0,0 +1,299 @@
+/**
+ * @file Sampled.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Packet sampling in front of any sketch
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/sampling.h>
+#include <common/sketch.h>
+#include <common/stats.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace OmniSketch::Sketch {
+/**
+ * @brief A sketch that only sees a sample of the packets
+ *
+ * @details Each packet is passed on to the underlying sketch with probability
+ * `p`, the packets in between being skipped by Util::GeometricSkip as in
+ * NitroSketch, so a skipped packet costs a decrement. Estimates of the
+ * underlying sketch are divided by the base probability `p0` given at
+ * construction, which makes those of a linear sketch (CM, CU, Count Sketch,
+ * UnivMon, Deltoid, ...) unbiased for the whole stream.
+ *
+ * Under overload, the probability may drop below `p0` to `p0 / 2^level`, for
+ * `level` up to #kMaxLevel, either by hand (setLevel() or adjustUpdateProb(),
+ * which follows NitroSketch) or adaptively. A packet sampled at `level` is
+ * passed on with its value times `2^level`, so that estimates are still
+ * rescaled by `p0` alone, whatever the levels the stream went through.
+ *
+ * Adaptation is enabled by giving the packet rate the underlying sketch is
+ * meant to handle, i.e., its `capacity`. The arrival rate of update() calls is
+ * then measured every #kWindow packets by the wall clock, and the level is
+ * set to the least one at which the sampled rate stays within the capacity.
+ * The rate is the one at which the caller hands over packets, so it reflects
+ * the traffic when packets are handed over as they arrive, e.g., from a
+ * capture.
+ *
+ * @tparam key_len  length of flowkey
+ * @tparam T        type of the counter
+ * @tparam sketch_t the underlying sketch, derived from SketchBase<key_len, T>
+ */
+template <int32_t key_len, typename T, typename sketch_t>
+class Sampled : public SketchBase<key_len, T> {
+public:
+  /**
+   * @brief Highest level, i.e., a probability of `p0 / 128`
+   *
+   */
+  static constexpr int32_t kMaxLevel = 7;
+  /**
+   * @brief Packets per measurement of the arrival rate
+   *
+   */
+  static constexpr int32_t kWindow = 1 << 16;
+
+private:
+  sketch_t sketch;
+  const double base_prob;
+  int32_t level;
+  T weight; // 2^level
+  Util::GeometricSkip skip;
+  int32_t countdown; // packets to skip before the next sampled one
+  int64_t sampled;   // packets passed on
+
+  double capacity; // 0 if not adaptive
+  int64_t arrivals;
+  std::chrono::steady_clock::time_point window_start;
+
+  std::vector<FlowKey<key_len>> batch_keys;
+  std::vector<T> batch_vals;
+
+  Sampled(const Sampled &) = delete;
+  Sampled(Sampled &&) = delete;
+
+  /**
+   * @brief Adapt the level to the arrival rate of the last window
+   *
+   */
+  void adapt();
+  /**
+   * @brief Divide an estimate of the underlying sketch by `p0`
+   *
+   */
+  T rescale(T val) const {
+    return static_cast<T>(std::round(static_cast<double>(val) / base_prob));
+  }
+
+public:
+  /**
+   * @brief Construct by specifying the base probability and the arguments of
+   * the underlying sketch
+   *
+   * @warning An exception is thrown unless `0 < prob <= 1`.
+   */
+  template <typename... Args>
+  explicit Sampled(double prob, Args &&...args);
+  /**
+   * @brief Enable adaptation to a capacity in packets per second, or disable
+   * it with 0
+   *
+   */
+  void setCapacity(double pps);
+  /**
+   * @brief Sample with probability `p0 / 2^level`
+   *
+   */
+  void setLevel(int32_t new_level);
+  /**
+   * @brief Set the level by the load, i.e., the traffic rate over the
+   * capacity, as NitroSketch does
+   * @details The level is the least one with `load / 2^level <= 1`.
+   *
+   */
+  void adjustUpdateProb(double load);
+  /**
+   * @brief Current sampling probability
+   *
+   */
+  double updateProb() const { return skip.prob(); }
+  /**
+   * @brief The underlying sketch
+   *
+   */
+  const sketch_t &base() const { return sketch; }
+  /**
+   * @brief Update a flowkey with certain value, if sampled
+   *
+   */
+  void update(const FlowKey<key_len> &flowkey, T val) override;
+  /**
+   * @brief Update a batch of flowkeys
+   * @details Jumps from one sampled packet to the next, and hands the sampled
+   * ones over to the underlying sketch as a batch.
+   *
+   */
+  void updateBatch(const FlowKey<key_len> *flowkeys, const T *vals,
+                   int32_t n, int32_t width) override;
+  /**
+   * @brief Query a flowkey
+   *
+   */
+  T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Query a batch of flowkeys
+   *
+   */
+  void queryBatch(const FlowKey<key_len> *flowkeys, T *out, int32_t n,
+                  int32_t width) const override;
+  /**
+   * @brief Heavy hitters of the underlying sketch, with the threshold scaled
+   * by `p0` and the estimates rescaled
+   *
+   */
+  Data::Estimation<key_len, T> getHeavyHitter(double threshold) const override;
+  /**
+   * @brief Get the size of the sketch
+   * @details Also records the number of packets passed on and the current
+   * level as statistics.
+   *
+   */
+  size_t size() const override;
+};
+
+} // namespace OmniSketch::Sketch
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Sketch {
+
+template <int32_t key_len, typename T, typename sketch_t>
+template <typename... Args>
+Sampled<key_len, T, sketch_t>::Sampled(double prob, Args &&...args)
+    : sketch(std::forward<Args>(args)...), base_prob(prob), level(0),
+      weight(1), skip(prob), sampled(0), capacity(0.0), arrivals(0),
+      window_start(std::chrono::steady_clock::now()) {
+  countdown = skip.next();
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void Sampled<key_len, T, sketch_t>::setCapacity(double pps) {
+  if (pps < 0.0)
+    throw std::invalid_argument(
+        "Invalid Argument: Capacity should be non-negative");
+  capacity = pps;
+  arrivals = 0;
+  window_start = std::chrono::steady_clock::now();
+  if (capacity == 0.0)
+    setLevel(0);
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void Sampled<key_len, T, sketch_t>::setLevel(int32_t new_level) {
+  new_level = std::max(0, std::min(new_level, kMaxLevel));
+  if (new_level == level)
+    return;
+  STATS_ADD("Sampled", "level_changes", 1);
+  level = new_level;
+  weight = static_cast<T>(1 << level);
+  skip.setProb(base_prob / (1 << level));
+  countdown = skip.next();
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void Sampled<key_len, T, sketch_t>::adjustUpdateProb(double load) {
+  if (!(load > 1.0)) {
+    setLevel(0);
+    return;
+  }
+  const double least = std::ceil(std::log2(load) - 1e-9);
+  setLevel(least > kMaxLevel ? kMaxLevel : static_cast<int32_t>(least));
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void Sampled<key_len, T, sketch_t>::adapt() {
+  const auto now = std::chrono::steady_clock::now();
+  const double secs = std::chrono::duration<double>(now - window_start).count();
+  if (secs > 0.0)
+    adjustUpdateProb(arrivals / secs / capacity);
+  arrivals = 0;
+  window_start = now;
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void Sampled<key_len, T, sketch_t>::update(const FlowKey<key_len> &flowkey,
+                                           T val) {
+  if (capacity > 0.0 && ++arrivals == kWindow)
+    adapt();
+  if (countdown > 0) {
+    countdown--;
+    return;
+  }
+  countdown = skip.next();
+  sampled++;
+  sketch.update(flowkey, val * weight);
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void Sampled<key_len, T, sketch_t>::updateBatch(
+    const FlowKey<key_len> *flowkeys, const T *vals, int32_t n,
+    int32_t width) {
+  batch_keys.clear();
+  batch_vals.clear();
+  int64_t i = countdown;
+  for (; i < n; i += 1 + skip.next()) {
+    batch_keys.push_back(flowkeys[i]);
+    batch_vals.push_back(vals[i] * weight);
+  }
+  countdown = static_cast<int32_t>(i - n);
+  sampled += batch_keys.size();
+  sketch.updateBatch(batch_keys.data(), batch_vals.data(),
+                     static_cast<int32_t>(batch_keys.size()), width);
+  if (capacity > 0.0 && (arrivals += n) >= kWindow)
+    adapt();
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+T Sampled<key_len, T, sketch_t>::query(const FlowKey<key_len> &flowkey) const {
+  return rescale(sketch.query(flowkey));
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void Sampled<key_len, T, sketch_t>::queryBatch(const FlowKey<key_len> *flowkeys,
+                                               T *out, int32_t n,
+                                               int32_t width) const {
+  sketch.queryBatch(flowkeys, out, n, width);
+  for (int32_t i = 0; i < n; ++i)
+    out[i] = rescale(out[i]);
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+Data::Estimation<key_len, T>
+Sampled<key_len, T, sketch_t>::getHeavyHitter(double threshold) const {
+  Data::Estimation<key_len, T> ans;
+  for (const auto &kv : sketch.getHeavyHitter(threshold * base_prob))
+    ans.update(kv.get_left(), rescale(kv.get_right()));
+  return ans;
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+size_t Sampled<key_len, T, sketch_t>::size() const {
+  STATS_SET("Sampled", "sampled", sampled);
+  STATS_SET("Sampled", "level", level);
+  return sizeof(*this) - sizeof(sketch_t) + sketch.size();
+}
+
+} // namespace OmniSketch::Sketch
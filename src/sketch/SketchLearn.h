@@ -9,7 +9,13 @@
 #pragma once
 
 #include <common/hash.h>
+#include <common/simd.h>
 #include <common/sketch.h>
+#include <common/stats.h>
+#include <common/thread_pool.h>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <algorithm>
 #include <cmath>
@@ -71,7 +77,10 @@ private:
    *         The width of sketches
    * 
    * @param V
-   *         The sketches
+   *         The sketches, stored cell by cell: the l + 1 bit-level
+   *         counters of stack (i, j) are contiguous, with V0 first,
+   *         so that an update touches r short runs of memory instead
+   *         of r * (l + 1) scattered counters. See cell().
    * 
    * @param p
    *         The array of mean values of Vk/V0
@@ -97,7 +106,7 @@ private:
   int32_t c;                                                 
 
   hash_t* hash_function;
-  T ***V;
+  T *V;
   double* p;
   double* sigma;
   bool updated;
@@ -153,12 +162,37 @@ private:
     }
   };
 
-  char* current_string;
-  int32_t num_of_star;
-  std::vector<two_types_of_flow> possible_flows;
+  /**
+   * @brief Scratch space of extracting large flows from a stack.
+   *        Every worker owns one, so that stacks can be learned
+   *        in parallel.
+   *
+   */
+  class workspace_t
+  {
+  public:
+    char current_string[l + 2];
+    int32_t num_of_star = 0;
+    std::vector<two_types_of_flow> possible_flows;
+    std::vector<ans_t> extracted_large_flows;
+  };
+
   std::vector<ans_t> large_flows;
-  std::vector<ans_t> extracted_large_flows;
   std::vector<ans_t> flows_to_remove;
+  /**
+   * @brief Position of every learned flow in large_flows
+   *
+   */
+  std::unordered_map<FlowKey<key_len>, size_t> large_flow_index;
+
+  /**
+   * @brief The l + 1 counters of stack (i, j), i.e., Vk[i][j] is
+   *        cell(i, j)[k]
+   *
+   */
+  T *cell(int32_t i, int32_t j) const {
+    return V + (static_cast<size_t>(i) * (c + 1) + j) * (l + 1);
+  }
 
   int32_t get_bit(char* a, int32_t pos);
   void set_bit(char* a, int32_t pos, int32_t v);
@@ -171,15 +205,15 @@ private:
    *
    */
   void find_possible_flows(int32_t i, int32_t j, 
-                           int32_t k, char* my_T);
+                           int32_t k, char* my_T, workspace_t &ws);
   /**
-   * @brief Assume that a large flow is hash into V[k][i][j],
+   * @brief Assume that a large flow is hash into cell(i, j)[k],
    *        this function calculate the possibility of that, 
    *        the k-th bit of the flow is 1
    *
    */
   double cal_hat_p(double theta, int32_t i, int32_t j,
-                     T*** V, double* p, 
+                     double* p, 
                      double* sigma, int32_t k);
   /**
    * @brief Filter out fake streams, using the calculated prob_vector.
@@ -199,7 +233,7 @@ private:
    *
    */
   void ExtractLargeFlows(double theta, int32_t i, int32_t j,
-                         T*** V, double* p, double* sigma);
+                         double* p, double* sigma, workspace_t &ws);
   /**
    * @brief Remove the extracted large flows from the sketches
    *        The large flows should be provided in flows_to_remove
@@ -295,34 +329,46 @@ void SketchLearn<key_len, T, hash_t>::set_bit(char* a, int32_t pos, int32_t v){
 
 template <int32_t key_len, typename T, typename hash_t>
 void SketchLearn<key_len, T, hash_t>::Sketch2N_p_sigma(){
-    double sum;
-    double square_sum;
-    double tmp_r;
-    int32_t total_times = r * c;
-    for (size_t k = 0; k <= key_len * 8; k++)
+    // Stacks with V0 = 0 carry no information and are skipped. They are
+    // discounted cumulatively over bit levels, exactly as the serial loop
+    // used to do, so that the learned flows stay the same.
+    int32_t empty_stacks = 0;
+    for (int32_t i = 0; i < r; i++)
     {
-        sum = 0;
-        square_sum = 0;
-        for (size_t i = 0; i < r; i++)
+        for (int32_t j = 1; j <= c; j++)
         {
-            for (size_t j = 1; j <= c; j++)
+            empty_stacks += (cell(i, j)[0] == 0);
+        }
+    }
+    // Bit levels are independent, so every worker takes a range of them
+    // and collects their statistics in a single pass over the stacks.
+    Util::ThreadPool::global().parallelFor(0, l + 1, [&](int64_t lo, int64_t hi) {
+        std::vector<double> sum(hi - lo), square_sum(hi - lo);
+        for (int32_t i = 0; i < r; i++)
+        {
+            for (int32_t j = 1; j <= c; j++)
             {
-                if(V[0][i][j] != 0)
+                const T *vc = cell(i, j);
+                if(vc[0] == 0)
                 {
-                    tmp_r = (double)(V[k][i][j]) / (double)(V[0][i][j]);
-                    sum += tmp_r;
-                    square_sum += tmp_r * tmp_r;
+                    continue;
                 }
-                else
+                for (int64_t k = lo; k < hi; k++)
                 {
-                    total_times--;
+                    double tmp_r = (double)(vc[k]) / (double)(vc[0]);
+                    sum[k - lo] += tmp_r;
+                    square_sum[k - lo] += tmp_r * tmp_r;
                 }
             }
         }
-        p[k] = (double)sum / (double)total_times;
-        double sigma2 = square_sum / (double)total_times- p[k] * p[k];
-        sigma[k] = (sigma2 >= 0)? sqrt(sigma2) : 0;
-    }
+        for (int64_t k = lo; k < hi; k++)
+        {
+            const int32_t total_times = r * c - (k + 1) * empty_stacks;
+            p[k] = sum[k - lo] / (double)total_times;
+            double sigma2 = square_sum[k - lo] / (double)total_times- p[k] * p[k];
+            sigma[k] = (sigma2 >= 0)? sqrt(sigma2) : 0;
+        }
+    });
 }
 
 template <int32_t key_len, typename T, typename hash_t>
@@ -332,21 +378,21 @@ double SketchLearn<key_len, T, hash_t>::normalCFD(double value){
 
 template <int32_t key_len, typename T, typename hash_t>
 void SketchLearn<key_len, T, hash_t>::find_possible_flows
-  (int32_t i, int32_t j, int32_t k, char* candidate_string){
+  (int32_t i, int32_t j, int32_t k, char* candidate_string,
+   workspace_t &ws){
     if (k == l + 1)
     {
         char ans[(l + 7) / 8 + 1];
 
         for (int32_t kk = 1; kk <= l; kk++)
         {
-            set_bit((char*)ans, kk - 1, current_string[kk] == '1' ? 1 : 0);
+            set_bit((char*)ans, kk - 1, ws.current_string[kk] == '1' ? 1 : 0);
         }
 
         ans[(l + 7) / 8] = '\0';
         if ((hash_function[i]((FlowKey<key_len>)((int8_t *)ans)) % c + 1) == j)
         {
-            int32_t flag = 0;
-            possible_flows.push_back(two_types_of_flow(current_string, ans));
+            ws.possible_flows.push_back(two_types_of_flow(ws.current_string, ans));
         }
         return;
     }
@@ -354,15 +400,15 @@ void SketchLearn<key_len, T, hash_t>::find_possible_flows
     {
         if (candidate_string[k] != '*')
         {
-            current_string[k] = candidate_string[k];
-            find_possible_flows(i, j, k + 1, candidate_string);
+            ws.current_string[k] = candidate_string[k];
+            find_possible_flows(i, j, k + 1, candidate_string, ws);
         }
         else
         {
-            current_string[k] = '0';
-            find_possible_flows(i, j, k + 1, candidate_string);
-            current_string[k] = '1';
-            find_possible_flows(i, j, k + 1, candidate_string);
+            ws.current_string[k] = '0';
+            find_possible_flows(i, j, k + 1, candidate_string, ws);
+            ws.current_string[k] = '1';
+            find_possible_flows(i, j, k + 1, candidate_string, ws);
         }
     }
     return;
@@ -370,19 +416,20 @@ void SketchLearn<key_len, T, hash_t>::find_possible_flows
 
 template <int32_t key_len, typename T, typename hash_t>
 void SketchLearn<key_len, T, hash_t>::ExtractLargeFlows
-  (double theta, int32_t i, int32_t j,T*** V, double* p, double* sigma){
+  (double theta, int32_t i, int32_t j, double* p, double* sigma,
+   workspace_t &ws){
     
-    extracted_large_flows.clear();
+    ws.extracted_large_flows.clear();
     
     // 第一步，计算每个bit的概率估值
     double hat_p[l + 1];
     for (int32_t k = 1; k <= l; k++)
     {
-        hat_p[k] = cal_hat_p(theta, i, j, V, p, sigma, k);
+        hat_p[k] = cal_hat_p(theta, i, j, p, sigma, k);
     }
     
     //  第二步，找到所有候选的大流，存在possible_flows里面
-    num_of_star = 0;
+    ws.num_of_star = 0;
     char candidate_string[l + 2];
     for (int32_t k = 1; k <= l; k++)
     {
@@ -397,41 +444,41 @@ void SketchLearn<key_len, T, hash_t>::ExtractLargeFlows
         else
         {
             candidate_string[k] = '*';
-            num_of_star++;
+            ws.num_of_star++;
         }
     }
     candidate_string[l + 1] = '\0';
     candidate_string[0] = '#';
-    if (num_of_star > STAR_THRESHOLD)
+    if (ws.num_of_star > STAR_THRESHOLD)
     {
         return;
     }
-    current_string[l + 1] = '\0';
-    current_string[0] = '#';
-    possible_flows.clear();
-    find_possible_flows(i, j, 1, candidate_string);
+    ws.current_string[l + 1] = '\0';
+    ws.current_string[0] = '#';
+    ws.possible_flows.clear();
+    find_possible_flows(i, j, 1, candidate_string, ws);
     
     //  第三步，估计大流的频率和可能性向量
     double estimated_frequency[l + 1];
     double estimated_p[l + 1];
-    for (auto item = possible_flows.begin();
-        item != possible_flows.end(); item++)
+    for (auto item = ws.possible_flows.begin();
+        item != ws.possible_flows.end(); item++)
     {
         int32_t min_sketch = 0xfffffff;
         for (int32_t k = 1; k <= l; k++)
         {
             if (item->bit_flow[k] == '1')
             {
-                min_sketch = (V[k][i][j] < min_sketch)? V[k][i][j] : min_sketch;
-                double rate = (double)V[k][i][j] / V[0][i][j];
-                estimated_frequency[k] = ((rate - p[k]) / (1 - p[k])) * V[0][i][j];
+                min_sketch = (cell(i, j)[k] < min_sketch)? cell(i, j)[k] : min_sketch;
+                double rate = (double)cell(i, j)[k] / cell(i, j)[0];
+                estimated_frequency[k] = ((rate - p[k]) / (1 - p[k])) * cell(i, j)[0];
                 estimated_p[k] = hat_p[k];
             }
             else
             {
-                min_sketch = (V[0][i][j] - V[k][i][j] < min_sketch)? V[0][i][j] - V[k][i][j] : min_sketch;
-                double rate = (double)V[k][i][j] / V[0][i][j];
-                estimated_frequency[k] = (1 - rate / p[k]) * V[0][i][j];
+                min_sketch = (cell(i, j)[0] - cell(i, j)[k] < min_sketch)? cell(i, j)[0] - cell(i, j)[k] : min_sketch;
+                double rate = (double)cell(i, j)[k] / cell(i, j)[0];
+                estimated_frequency[k] = (1 - rate / p[k]) * cell(i, j)[0];
 
                 estimated_p[k] = 1 - hat_p[k];
             }
@@ -441,17 +488,17 @@ void SketchLearn<key_len, T, hash_t>::ExtractLargeFlows
         if(ans_estimated_frequency > min_sketch)
         {
             if(ans_estimated_frequency > MY_ERROR_THRESHOLD_SKETCH * min_sketch && 
-               ans_estimated_frequency > MY_ERROR_THRESHOLD_V0 * V[0][i][j])
+               ans_estimated_frequency > MY_ERROR_THRESHOLD_V0 * cell(i, j)[0])
             {
                 break;
             }
             ans_estimated_frequency = min_sketch;
         }
-        extracted_large_flows.push_back(ans_t(item->bit_flow, item->flow, ans_estimated_frequency, estimated_p));
+        ws.extracted_large_flows.push_back(ans_t(item->bit_flow, item->flow, ans_estimated_frequency, estimated_p));
     }
     
     //  第四步，去sketch里查候选流的数据，删掉过小的
-    for (auto item = extracted_large_flows.begin(); item != extracted_large_flows.end(); )
+    for (auto item = ws.extracted_large_flows.begin(); item != ws.extracted_large_flows.end(); )
     {
         for (int32_t ii = 0; ii < r; ii++)
         {
@@ -462,20 +509,20 @@ void SketchLearn<key_len, T, hash_t>::ExtractLargeFlows
             int32_t jj = hash_function[ii](FlowKey<key_len>((const int8_t *)(item->flow))) % c + 1;
             for (int32_t k = 1; k <= l; k++)
             {
-                if (item->bit_flow[k] == '0' && V[0][ii][jj] - V[k][ii][jj] < item->size)
+                if (item->bit_flow[k] == '0' && cell(ii, jj)[0] - cell(ii, jj)[k] < item->size)
                 {
-                    item->size = V[0][ii][jj] - V[k][ii][jj];
+                    item->size = cell(ii, jj)[0] - cell(ii, jj)[k];
                 }
-                else if (item->bit_flow[k] == '1' && V[k][ii][jj] < item->size)
+                else if (item->bit_flow[k] == '1' && cell(ii, jj)[k] < item->size)
                 {
-                    item->size = V[k][ii][jj];
+                    item->size = cell(ii, jj)[k];
                 }
             }
         }
-        if (item->size < theta * V[0][i][j])
+        if (item->size < theta * cell(i, j)[0])
         {
-            item = extracted_large_flows.erase(item);
-            if (item == extracted_large_flows.end())break;
+            item = ws.extracted_large_flows.erase(item);
+            if (item == ws.extracted_large_flows.end())break;
         }
         else 
         {
@@ -487,9 +534,9 @@ void SketchLearn<key_len, T, hash_t>::ExtractLargeFlows
 
 template <int32_t key_len, typename T, typename hash_t>
 double SketchLearn<key_len, T, hash_t>::cal_hat_p
-  (double theta, int32_t i, int32_t j, T*** V, 
+  (double theta, int32_t i, int32_t j, 
   double* p, double* sigma, int32_t k){
-    double rate = (double)V[k][i][j] / V[0][i][j];
+    double rate = (double)cell(i, j)[k] / cell(i, j)[0];
     if (rate < theta)
     {
         return 0;
@@ -499,10 +546,10 @@ double SketchLearn<key_len, T, hash_t>::cal_hat_p
         return 1;
     }
     double ans = 0;
-    double prob_1 = (V[k][i][j] - theta * V[0][i][j]) /
-        (V[0][i][j] - theta * V[0][i][j]);
-    double prob_0 = (V[k][i][j]) /
-        (V[0][i][j] - theta * V[0][i][j]);
+    double prob_1 = (cell(i, j)[k] - theta * cell(i, j)[0]) /
+        (cell(i, j)[0] - theta * cell(i, j)[0]);
+    double prob_0 = (cell(i, j)[k]) /
+        (cell(i, j)[0] - theta * cell(i, j)[0]);
     double normal_val1 = normalCFD((prob_1 - p[k]) / sigma[k]);
     double normal_val0 = normalCFD((prob_0 - p[k]) / sigma[k]);
     return normal_val1 * p[k] + (1 - normal_val0) * (1 - p[k]);
@@ -511,25 +558,16 @@ double SketchLearn<key_len, T, hash_t>::cal_hat_p
 template <int32_t key_len, typename T, typename hash_t>
 void SketchLearn<key_len, T, hash_t>::RemoveFlows(){
     std::vector<ans_t> FF = flows_to_remove;
-    uint32_t tmp_hash[r + 1];
     for (int32_t it = 0; it < FF.size(); it++)
     {
         char* ans = FF[it].flow;
+        const T val = -static_cast<T>(FF[it].size);
 
         for (size_t i = 0; i < r; i++)
         {
-            tmp_hash[i] = hash_function[i]((FlowKey<key_len>)((int8_t*)ans)) % c + 1;
-            V[0][i][tmp_hash[i]] -= FF[it].size;
-        }
-        for (size_t k = 1; k <= key_len * 8; k++)
-        {
-            if (0 != get_bit((char*)ans, k - 1))
-            {
-                for (size_t i = 0; i < r; i++)
-                {
-                    V[k][i][tmp_hash[i]] -= FF[it].size;
-                }
-            }
+            T *vc = cell(i, hash_function[i]((FlowKey<key_len>)((int8_t*)ans)) % c + 1);
+            vc[0] += val;
+            Util::MaskedAddBits(vc + 1, (const int8_t *)ans, key_len, val);
         }
     }
 }
@@ -541,53 +579,47 @@ bool SketchLearn<key_len, T, hash_t>::Terminate(double theta){
     double RATE2 = 0.9544 + STEP * log2(theta);
     double RATE3 = 0.9973 + STEP * log2(theta);
 
-    for (size_t k = 1; k <= key_len * 8; k++)
-    {
-        T sumV = 0;
-        T sumV0 = 0;
-        size_t sigma_num1 = 0, sigma_num2 = 0, sigma_num3 = 0;
+    // Learning terminates only if every bit level looks normal. Bit levels
+    // are checked in parallel.
+    std::vector<char> passed(l + 1, 1);
+    Util::ThreadPool::global().parallelFor(1, l + 1, [&](int64_t lo, int64_t hi) {
+        std::vector<size_t> sigma_num1(hi - lo), sigma_num2(hi - lo), sigma_num3(hi - lo);
         for (int32_t i = 0; i < r; i++)
         {
             for (int32_t j = 1; j <= c; j++)
             {
-                sumV += V[k][i][j];
-                sumV0 += V[0][i][j];
-                double rate = (double)V[k][i][j] / V[0][i][j];
-                if(sigma[k] != 0)
-                {
-                    if (rate <= p[k] + 3.0 * sigma[k] && rate >= p[k] - 3.0 * sigma[k])
-                        sigma_num3++;
-                    if (rate <= p[k] + 2.0 * sigma[k] && rate >= p[k] - 2.0 * sigma[k])
-                        sigma_num2++;
-                    if (rate <= p[k] + 1.0 * sigma[k] && rate >= p[k] - 1.0 * sigma[k])
-                        sigma_num1++;
-                }
-                else
+                const T *vc = cell(i, j);
+                for (int64_t k = lo; k < hi; k++)
                 {
-                    sigma_num1++;
-                    sigma_num2++;
-                    sigma_num3++;
+                    double rate = (double)vc[k] / vc[0];
+                    if(sigma[k] != 0)
+                    {
+                        if (rate <= p[k] + 3.0 * sigma[k] && rate >= p[k] - 3.0 * sigma[k])
+                            sigma_num3[k - lo]++;
+                        if (rate <= p[k] + 2.0 * sigma[k] && rate >= p[k] - 2.0 * sigma[k])
+                            sigma_num2[k - lo]++;
+                        if (rate <= p[k] + 1.0 * sigma[k] && rate >= p[k] - 1.0 * sigma[k])
+                            sigma_num1[k - lo]++;
+                    }
+                    else
+                    {
+                        sigma_num1[k - lo]++;
+                        sigma_num2[k - lo]++;
+                        sigma_num3[k - lo]++;
+                    }
                 }
             }
         }
-        /*
-        if(sigma_num1 == 0 && sigma_num2 == 0 && sigma_num3 == 0)
+        for (int64_t k = lo; k < hi; k++)
         {
-            printf("I WONDER WHY PROGRAME RUNNING REACH HERE, k IS %ld, sumV IS %d, sumV0 IS %d, p[k] is %lf, sigma[k] is %lf\n", k, sumV, sumV0, p[k], sigma[k]);
+            double rate1 = (double)sigma_num1[k - lo] / (double)(r * c);
+            double rate2 = (double)sigma_num2[k - lo] / (double)(r * c);
+            double rate3 = (double)sigma_num3[k - lo] / (double)(r * c);
+            passed[k] = (rate1 >= RATE1 && rate2 >= RATE2 && rate3 >= RATE3);
         }
-        */
-        double rate1 = (double)sigma_num1 / (double)(r * c);
-        double rate2 = (double)sigma_num2 / (double)(r * c);
-        double rate3 = (double)sigma_num3 / (double)(r * c);
-        
-        if (rate1 < RATE1)
-            return false;
-        if (rate2 < RATE2)
-            return false;
-        if (rate3 < RATE3)
-            return false;
-    }
-    return true;
+    });
+    return std::all_of(passed.begin() + 1, passed.end(),
+                       [](char ok) { return ok; });
 }
 
 template <int32_t key_len, typename T, typename hash_t>
@@ -606,39 +638,22 @@ template <int32_t key_len, typename T, typename hash_t>
 SketchLearn<key_len, T, hash_t>::SketchLearn(int32_t depth_, int32_t width_)
     : r(depth_), c(Util::NextPrime(width_)){
     hash_function = new hash_t[r];
-    V = new T **[l + 1];
-    for(int32_t i = 0; i < l + 1; i++)
-    {
-      V[i] = new T *[r];
-      V[i][0] = new T[r * (c + 1)]();
-      for(int32_t j = 1; j < r; j++)
-      {
-        V[i][j] = V[i][j-1] + (c + 1);
-      }
-    }
+    // one contiguous run of l + 1 counters per stack
+    V = new T[static_cast<size_t>(r) * (c + 1) * (l + 1)]();
     p = new double[l + 1]();
     sigma = new double[l + 1]();
-    current_string = new char[l + 2]();
-    num_of_star = 0;
     updated = true;
 }
 
 template <int32_t key_len, typename T, typename hash_t>
 SketchLearn<key_len, T, hash_t>::~SketchLearn(){
    delete[] hash_function;
-   for(int32_t i = 0; i < l + 1; i++)
-   {
-     delete[] V[i][0];
-     delete[] V[i];
-   }
    delete[] V;
    delete[] p;
    delete[] sigma;
-   delete[] current_string;
 
-   possible_flows.clear();
    large_flows.clear();
-   extracted_large_flows.clear();
+   large_flow_index.clear();
    flows_to_remove.clear();
 }
 
@@ -652,28 +667,18 @@ size_t SketchLearn<key_len, T, hash_t>::size() const{
 template <int32_t key_len, typename T, typename hash_t>
 void SketchLearn<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey, T val){
 
-    uint32_t tmp_hash[r + 1];
     for (size_t i = 0; i < r; i++)
     {
-        tmp_hash[i] = hash_function[i](flowkey) % c + 1;
-        V[0][i][tmp_hash[i]] += val;
-    }
-    for (size_t k = 1; k <= key_len * 8; k++)
-    {
-        // 0 则对 V[k] 无影响
-        if (0 != flowkey.getBit(k - 1))
-        {
-            for (size_t i = 0; i < r; i++)
-            {
-                V[k][i][tmp_hash[i]] += val;
-            }
-        }
+        T *vc = cell(i, hash_function[i](flowkey) % c + 1);
+        vc[0] += val;
+        // 0 则对 V[k] 无影响: branch-free masked add driven by the key bits
+        Util::MaskedAddBits(vc + 1, flowkey.cKey(), key_len, val);
     }
 }
 
 template <int32_t key_len, typename T, typename hash_t>
 void SketchLearn<key_len, T, hash_t>::Sketch_Learning(){
-    printf("LEARNING START!\n");
+    STATS_ADD("SketchLearn", "learns", 1);
 
 
 #ifdef TEST_DECODE_TIME
@@ -685,41 +690,44 @@ void SketchLearn<key_len, T, hash_t>::Sketch_Learning(){
     double theta = START_THETA;
     int32_t nnnn = 0;
     large_flows.clear();
+    large_flow_index.clear();
     while (1)
     {
-        int32_t my_flow_num = 0;
-        std::vector<ans_t> FF;
-        for (int32_t i = 0; i < r; i++)
-        {
-            for (int32_t j = 1; j <= c; j++)
+        // Extract large flows from all stacks in parallel. Every chunk of
+        // stacks keeps what it finds in stack order, and chunks are merged
+        // in order as well, so FF is exactly what a serial scan yields.
+        std::vector<std::pair<int64_t, std::vector<ans_t>>> found;
+        std::mutex found_mtx;
+        Util::ThreadPool::global().parallelFor(0, static_cast<int64_t>(r) * c,
+                                               [&](int64_t lo, int64_t hi) {
+            workspace_t ws;
+            std::vector<ans_t> chunk;
+            for (int64_t s = lo; s < hi; s++)
             {
-                if (0 == V[0][i][j])
+                int32_t i = s / c;
+                int32_t j = s % c + 1;
+                if (0 == cell(i, j)[0])
                 {
                     continue;
                 }
-                ExtractLargeFlows(theta, i, j, V, p, sigma);
-                std::vector<ans_t> temp_F = extracted_large_flows;
-                if (!temp_F.empty())
-                {
-                    my_flow_num++;
-                    for (auto it = temp_F.begin(); it < temp_F.end(); it++)
-                    {
-                        bool temp_Fin = false;
-                        if (!FF.empty())
-                        {
-                            for (auto iter = FF.begin(); iter < FF.end(); iter++)
-                            {
-                                if (strcmp(iter->bit_flow, it->bit_flow) == 0)
-                                {
-                                    temp_Fin = true;
-                                    break;
-                                }
-                            }
-                        }
-                        if (!temp_Fin)
-                            FF.push_back(*it);
-                    }
-                }
+                ExtractLargeFlows(theta, i, j, p, sigma, ws);
+                chunk.insert(chunk.end(), ws.extracted_large_flows.begin(),
+                             ws.extracted_large_flows.end());
+            }
+            std::lock_guard<std::mutex> lock(found_mtx);
+            found.emplace_back(lo, std::move(chunk));
+        });
+        std::sort(found.begin(), found.end(),
+                  [](const auto &a, const auto &b) { return a.first < b.first; });
+
+        std::vector<ans_t> FF;
+        std::unordered_set<FlowKey<key_len>> in_FF;
+        for (auto &chunk : found)
+        {
+            for (auto &it : chunk.second)
+            {
+                if (in_FF.insert(FlowKey<key_len>((const int8_t *)it.flow)).second)
+                    FF.push_back(it);
             }
         }
 
@@ -728,25 +736,16 @@ void SketchLearn<key_len, T, hash_t>::Sketch_Learning(){
         {
             for (auto it = FF.begin(); it < FF.end(); it++)
             {
-                bool FF_in = false;
-                auto temp_pos = large_flows.end();
-                if (!large_flows.empty())
+                FlowKey<key_len> key((const int8_t *)it->flow);
+                auto pos = large_flow_index.find(key);
+                if (pos == large_flow_index.end())
                 {
-                    for (auto iter = large_flows.begin(); iter < large_flows.end(); iter++)
-                    {
-                        if (strcmp(iter->bit_flow, it->bit_flow) == 0)
-                        {
-                            FF_in = true;
-                            temp_pos = iter;
-                            break;
-                        }
-                    }
-                }
-                if (!FF_in)
+                    large_flow_index.emplace(key, large_flows.size());
                     large_flows.push_back(*it);
-                else if (FF_in)
+                }
+                else
                 {
-                    temp_pos->size += it->size;
+                    large_flows[pos->second].size += it->size;
                 }
             }
             flows_to_remove.clear();
@@ -768,10 +767,9 @@ void SketchLearn<key_len, T, hash_t>::Sketch_Learning(){
 #ifdef TEST_DECODE_TIME
   MY_TOCK = std::chrono::steady_clock::now();
   MY_TIMER = std::chrono::duration_cast<std::chrono::microseconds>(MY_TOCK - MY_TICK);
-  printf("\nDECODE COST %ldms\n", static_cast<int64_t>(MY_TIMER.count()));
+  STATS_ADD("SketchLearn", "decode_us", MY_TIMER.count());
 #endif
 
-    printf("LEARNING END!\n");
 }
 
 template <int32_t key_len, typename T, typename hash_t>
@@ -787,7 +785,7 @@ Data::Estimation<key_len, T> SketchLearn<key_len, T, hash_t>::getHeavyHitter(dou
       const_cast<SketchLearn<key_len, T, hash_t>*>(this)->updated = false;
     }
     Data::Estimation<key_len, T> heavy_hitters;
-    for(auto it : large_flows)
+    for(const auto &it : large_flows)
     {
       if(it.size >= threshold)
       {
@@ -804,26 +802,24 @@ T SketchLearn<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const{
       const_cast<SketchLearn<key_len, T, hash_t>*>(this)->Sketch_Learning();
       const_cast<SketchLearn<key_len, T, hash_t>*>(this)->updated = false;
     }
-    for(auto it : large_flows)
+    auto pos = large_flow_index.find(flowkey);
+    if (pos != large_flow_index.end())
     {
-      if(FlowKey<key_len>((const int8_t *)it.flow) == flowkey)
-      {
-        return it.size;
-      }
+      return large_flows[pos->second].size;
     }
     T result = 0xfffffff;
     for (int32_t ii = 0; ii < r; ii++)
     {
-        int32_t jj = hash_function[ii](flowkey) % c + 1;
+        const T *vc = cell(ii, hash_function[ii](flowkey) % c + 1);
         for (int32_t k = 1; k <= l; k++)
         {
-            if ( flowkey.getBit(k - 1) == 0 && V[0][ii][jj] - V[k][ii][jj] < result)
+            if ( flowkey.getBit(k - 1) == 0 && vc[0] - vc[k] < result)
             {
-                result = V[0][ii][jj] - V[k][ii][jj];
+                result = vc[0] - vc[k];
             }
-            else if (flowkey.getBit(k - 1) == 1 && V[k][ii][jj] < result)
+            else if (flowkey.getBit(k - 1) == 1 && vc[k] < result)
             {
-                result = V[k][ii][jj];
+                result = vc[k];
             }
         }
     }
@@ -832,26 +828,15 @@ T SketchLearn<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const{
 
 template <int32_t key_len, typename T, typename hash_t>
 void SketchLearn<key_len, T, hash_t>::clear(){
-  for(int32_t i = 0; i < l + 1; i++)
-  {
-    for(int32_t j = 0; j < r; j++)
-    {
-      for(int32_t k = 0; k < c + 1; k++)
-      {
-        V[i][j][k] = 0;
-      }
-    }
-  }
+  std::fill(V, V + static_cast<size_t>(r) * (c + 1) * (l + 1), 0);
   for(int32_t i = 0; i < l + 1; i++)
   {
     p[i] = sigma[i] = 0;
   }
   updated = false;
-  possible_flows.clear();
   large_flows.clear();
-  extracted_large_flows.clear();
+  large_flow_index.clear();
   flows_to_remove.clear();
-  num_of_star = 0;
 }
 
 }
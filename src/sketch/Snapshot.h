@@ -0,0 +1,254 @@
+/**
+ * @file Snapshot.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Consistent reads of a sketch while it is being updated
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/sketch.h>
+#include <common/stats.h>
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace OmniSketch::Sketch {
+/**
+ * @brief A sketch updated by one thread and read by others at the same time
+ *
+ * @details The ingest thread updates a live sketch that no one else reads,
+ * with no lock or atomic on the way. Every `epoch` updates, it copies the
+ * live sketch into one of two views, i.e., sketches of the same shape, and
+ * publishes that view. Queries from any thread are answered by the latest
+ * published view, which is a consistent state of the sketch.
+ *
+ * A reader announces the view it reads by a count, and the ingest thread
+ * never copies into a view being read: if the spare view is still read by a
+ * slow reader when an epoch ends, the copy is retried on the next update
+ * instead of waited for. So updates never block, readers never see a view
+ * being written, and a reader only retries if a publication happens between
+ * picking a view and announcing it. The latest view is thus at most `epoch`
+ * updates old, unless a publication is deferred by a reader still holding the
+ * previous view: then it ages by every update until that reader is done, which
+ * may span many epochs. Deferred copies are counted as `Snapshot.deferred` by
+ * size().
+ *
+ * Copying costs `size() / epoch` bytes per update, amortized. The sketch
+ * type should provide `copyFrom()`, as CMSketch, CountSketch, ElasticSketch
+ * and HeavyKeeper do, copying hashing classes as well.
+ *
+ * @tparam key_len  length of flowkey
+ * @tparam T        type of the counter
+ * @tparam sketch_t the underlying sketch, derived from SketchBase<key_len, T>
+ */
+template <int32_t key_len, typename T, typename sketch_t>
+class Snapshot : public SketchBase<key_len, T> {
+private:
+  sketch_t live;
+  sketch_t views[2];
+  const int64_t epoch;
+  int64_t pending;   // updates since the last publication
+  int64_t published; // publications
+  int64_t deferred;  // copies retried as the spare view was read
+
+  // written by the ingest thread, read by readers
+  alignas(64) std::atomic<int32_t> current;
+  // one line per view, written by readers
+  struct alignas(64) Count {
+    std::atomic<int32_t> val;
+  };
+  mutable Count readers[2];
+
+  Snapshot(const Snapshot &) = delete;
+  Snapshot(Snapshot &&) = delete;
+
+  /**
+   * @brief Count updates and publish when an epoch is over
+   *
+   */
+  void tick(int64_t n) {
+    pending += n;
+    if (pending >= epoch)
+      publish();
+  }
+
+public:
+  /**
+   * @brief Construct by specifying the epoch in updates and the arguments of
+   * the underlying sketch
+   *
+   * @warning An exception is thrown unless `epoch >= 1`.
+   */
+  template <typename... Args>
+  explicit Snapshot(int64_t epoch, const Args &...args);
+  /**
+   * @brief Copy the live sketch into the spare view and publish it, unless
+   * the spare view is being read
+   * @details Called by the ingest thread only, e.g., when the stream pauses.
+   *
+   * @return whether it is published
+   */
+  bool publish();
+  /**
+   * @brief Run `f` on the latest published view
+   * @details Safe to call from any thread while the ingest thread updates.
+   * The view stays valid during `f`, which should not hold on to it.
+   *
+   * @param f callable of signature `R(const sketch_t &)`
+   */
+  template <typename F> auto read(F &&f) const;
+  /**
+   * @brief The live sketch, for the ingest thread only
+   *
+   */
+  sketch_t &base() { return live; }
+  /**
+   * @brief Update the live sketch with a flowkey
+   *
+   */
+  void update(const FlowKey<key_len> &flowkey, T val) override;
+  /**
+   * @brief Update the live sketch with a batch of flowkeys
+   *
+   */
+  void updateBatch(const FlowKey<key_len> *flowkeys, const T *vals,
+                   int32_t n, int32_t width) override;
+  /**
+   * @brief Query the latest view
+   *
+   */
+  T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Query the latest view for a batch of flowkeys
+   * @details All of them see the same view.
+   *
+   */
+  void queryBatch(const FlowKey<key_len> *flowkeys, T *out, int32_t n,
+                  int32_t width) const override;
+  /**
+   * @brief Heavy hitters of the latest view
+   *
+   */
+  Data::Estimation<key_len, T> getHeavyHitter(double threshold) const override;
+  /**
+   * @brief Get the size of the sketch, views included
+   * @details Also records the numbers of publications and of deferred copies
+   * as statistics. For the ingest thread only.
+   *
+   */
+  size_t size() const override;
+};
+
+} // namespace OmniSketch::Sketch
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Sketch {
+
+template <int32_t key_len, typename T, typename sketch_t>
+template <typename... Args>
+Snapshot<key_len, T, sketch_t>::Snapshot(int64_t epoch, const Args &...args)
+    : live(args...), views{sketch_t(args...), sketch_t(args...)},
+      epoch(epoch), pending(0), published(0), deferred(0), current(0) {
+  if (epoch < 1)
+    throw std::invalid_argument("Invalid Argument: Epoch should be positive");
+  readers[0].val = readers[1].val = 0;
+  // the views hash as the live sketch does
+  views[0].copyFrom(live);
+  views[1].copyFrom(live);
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+bool Snapshot<key_len, T, sketch_t>::publish() {
+  const int32_t spare = 1 - current.load(std::memory_order_relaxed);
+  // a reader announcing itself from now on re-checks `current` and backs off
+  if (readers[spare].val.load()) {
+    deferred++;
+    return false;
+  }
+  views[spare].copyFrom(live);
+  current.store(spare);
+  pending = 0;
+  published++;
+  return true;
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+template <typename F>
+auto Snapshot<key_len, T, sketch_t>::read(F &&f) const {
+  for (;;) {
+    const int32_t idx = current.load();
+    readers[idx].val.fetch_add(1);
+    // still the latest, so the ingest thread cannot have started copying
+    if (current.load() == idx) {
+      struct Release {
+        std::atomic<int32_t> &count;
+        ~Release() { count.fetch_sub(1); }
+      } release{readers[idx].val};
+      return f(static_cast<const sketch_t &>(views[idx]));
+    }
+    readers[idx].val.fetch_sub(1);
+    std::this_thread::yield();
+  }
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void Snapshot<key_len, T, sketch_t>::update(const FlowKey<key_len> &flowkey,
+                                            T val) {
+  live.update(flowkey, val);
+  tick(1);
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void Snapshot<key_len, T, sketch_t>::updateBatch(
+    const FlowKey<key_len> *flowkeys, const T *vals, int32_t n,
+    int32_t width) {
+  // publications are tried every epoch, as with update()
+  for (int32_t i = 0; i < n;) {
+    const int32_t len = static_cast<int32_t>(
+        std::min<int64_t>(n - i, pending < epoch ? epoch - pending : epoch));
+    live.updateBatch(flowkeys + i, vals + i, len, width);
+    i += len;
+    tick(len);
+  }
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+T Snapshot<key_len, T, sketch_t>::query(const FlowKey<key_len> &flowkey) const {
+  return read([&](const sketch_t &view) { return view.query(flowkey); });
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void Snapshot<key_len, T, sketch_t>::queryBatch(
+    const FlowKey<key_len> *flowkeys, T *out, int32_t n, int32_t width) const {
+  read([&](const sketch_t &view) {
+    view.queryBatch(flowkeys, out, n, width);
+    return 0;
+  });
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+Data::Estimation<key_len, T>
+Snapshot<key_len, T, sketch_t>::getHeavyHitter(double threshold) const {
+  return read(
+      [&](const sketch_t &view) { return view.getHeavyHitter(threshold); });
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+size_t Snapshot<key_len, T, sketch_t>::size() const {
+  STATS_SET("Snapshot", "published", published);
+  STATS_SET("Snapshot", "deferred", deferred);
+  return sizeof(*this) - 3 * sizeof(sketch_t) + live.size() +
+         views[0].size() + views[1].size();
+}
+
+} // namespace OmniSketch::Sketch
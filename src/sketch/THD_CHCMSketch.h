@@ -143,7 +143,7 @@ T THD_CHCMSketch<key_len, no_layer, T, hash_t>::query(
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 size_t THD_CHCMSketch<key_len, no_layer, T, hash_t>::size() const {
-  ch->print_rate("COUNT MIN CH");
+  ch->reportStats("COUNT MIN CH");
   return sizeof(*this)            // instance
          + depth * sizeof(hash_t) // hashing class
          + ch->size();            // ch
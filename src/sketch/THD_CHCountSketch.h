@@ -161,7 +161,7 @@ T THD_CHCountSketch<key_len, no_layer, T, hash_t>::query(
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 size_t THD_CHCountSketch<key_len, no_layer, T, hash_t>::size() const {
-  ch->print_rate("");
+  ch->reportStats("");
   return sizeof(*this)                // instance
          + sizeof(hash_t) * depth * 2 // hashing class
          + ch->size(); // counter
@@ -252,8 +252,8 @@ Data::Estimation<key_len, T> THD_CHFlowRadar<key_len, no_layer, T, hash_t>::deco
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 size_t THD_CHFlowRadar<key_len, no_layer, T, hash_t>::size() const {
-  flow_ch->print_rate("FLOW");
-  packet_ch->print_rate("PACKET");
+  flow_ch->reportStats("FLOW");
+  packet_ch->reportStats("PACKET");
   return sizeof(*this)                                 // instance
          + num_count_hash * sizeof(hash_t)             // hashing class
          + num_count_table * key_len
@@ -10,7 +10,9 @@
 
 #include <common/hash.h>
 #include <common/hierarchy_thd.h>
+#include <common/sampling.h>
 #include <common/sketch.h>
+#include <common/stats.h>
 
 #include <algorithm>
 #include <cmath>
@@ -77,7 +79,7 @@ private:
   int32_t next_packet_; // number of skipped packets
 
   double update_prob_; // sampling probability
-  std::default_random_engine generator;
+  Util::GeometricSkip skip_;
 
   bool line_rate_enable_; // enable always line rate
   double switch_thresh_;  // switch to always line rate update
@@ -180,8 +182,7 @@ void THD_CHNitroSketch<key_len, no_layer, T, hash_t>::alwaysCorrectUpdate(
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 std::size_t THD_CHNitroSketch<key_len, no_layer, T, hash_t>::size() const{
-  ch->print_rate("");
-  printf("\n");
+  ch->reportStats("");
   return sizeof(THD_CHNitroSketch<key_len, no_layer, T, hash_t>) 
         + depth_ * 2 * sizeof(hash_t) 
         + ch->size();
@@ -237,8 +238,9 @@ template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 void THD_CHNitroSketch<key_len, no_layer, T, hash_t>::getNextUpdate(double prob) {
   int sample = 1;
   if (prob < 1.0) {
-    std::geometric_distribution<int> dist(prob);
-    sample = 1 + dist(generator);
+    if (skip_.prob() != prob)
+      skip_.setProb(prob);
+    sample = 1 + skip_.next();
   }
   next_bucket_ = next_bucket_ + sample;
   next_packet_ = ((int)(next_bucket_ / depth_));
@@ -267,7 +269,7 @@ bool THD_CHNitroSketch<key_len, no_layer, T, hash_t>::isLineRateUpdate() {
       median = (values[depth_ / 2 - 1] + values[depth_ / 2]) / 2;
     }
     if (median >= switch_thresh_) {
-      std::cout << "line rate update enable\n";
+      STATS_ADD("THD_CHNitroSketch", "line_rate_switches", 1);
       line_rate_enable_ = true;
     }
     return line_rate_enable_;
@@ -11,6 +11,11 @@
 #include <common/hash.h>
 #include <common/hierarchy_thd.h>
 #include <common/sketch.h>
+#include <common/stats.h>
+#include <common/thread_pool.h>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <algorithm>
 #include <cmath>
@@ -158,12 +163,28 @@ private:
     }
   };
 
-  char* current_string;
-  int32_t num_of_star;
-  std::vector<two_types_of_flow> possible_flows;
+  /**
+   * @brief Scratch space of extracting large flows from a stack.
+   *        Every worker owns one, so that stacks can be learned
+   *        in parallel.
+   *
+   */
+  class workspace_t
+  {
+  public:
+    char current_string[l + 2];
+    int32_t num_of_star = 0;
+    std::vector<two_types_of_flow> possible_flows;
+    std::vector<ans_t> extracted_large_flows;
+  };
+
   std::vector<ans_t> large_flows;
-  std::vector<ans_t> extracted_large_flows;
   std::vector<ans_t> flows_to_remove;
+  /**
+   * @brief Position of every learned flow in large_flows
+   *
+   */
+  std::unordered_map<FlowKey<key_len>, size_t> large_flow_index;
 
   int32_t get_bit(char* a, int32_t pos);
   void set_bit(char* a, int32_t pos, int32_t v);
@@ -182,7 +203,7 @@ private:
    *
    */
   void find_possible_flows(int32_t i, int32_t j, 
-                           int32_t k, char* my_T);
+                           int32_t k, char* my_T, workspace_t &ws);
   /**
    * @brief Assume that a large flow is hash into V[k][i][j],
    *        this function calculate the possibility of that, 
@@ -210,7 +231,8 @@ private:
    *
    */
   void ExtractLargeFlows(double theta, int32_t i, int32_t j,
-                         T*** V, double* p, double* sigma);
+                         T*** V, double* p, double* sigma,
+                         workspace_t &ws);
   /**
    * @brief Remove the extracted large flows from the sketches
    *        The large flows should be provided in flows_to_remove
@@ -326,34 +348,41 @@ void THD_CHSketchLearn<key_len, no_layer, T, hash_t>::set_bit(char* a, int32_t p
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 void THD_CHSketchLearn<key_len, no_layer, T, hash_t>::Sketch2N_p_sigma(){
-    double sum;
-    double square_sum;
-    double tmp_r;
-    int32_t total_times = r * c;
-    for (size_t k = 0; k <= key_len * 8; k++)
+    // Stacks with V0 = 0 carry no information and are skipped. They are
+    // discounted cumulatively over bit levels, exactly as the serial loop
+    // used to do, so that the learned flows stay the same.
+    int32_t empty_stacks = 0;
+    for (int32_t i = 0; i < r; i++)
     {
-        sum = 0;
-        square_sum = 0;
-        for (size_t i = 0; i < r; i++)
+        for (int32_t j = 1; j <= c; j++)
         {
-            for (size_t j = 1; j <= c; j++)
+            empty_stacks += (V[0][i][j] == 0);
+        }
+    }
+    // Bit levels are independent, so every worker takes a range of them.
+    Util::ThreadPool::global().parallelFor(0, l + 1, [&](int64_t lo, int64_t hi) {
+        for (int64_t k = lo; k < hi; k++)
+        {
+            const int32_t total_times = r * c - (k + 1) * empty_stacks;
+            double sum = 0;
+            double square_sum = 0;
+            for (int32_t i = 0; i < r; i++)
             {
-                if(V[0][i][j] != 0)
-                {
-                    tmp_r = (double)(V[k][i][j]) / (double)(V[0][i][j]);
-                    sum += tmp_r;
-                    square_sum += tmp_r * tmp_r;
-                }
-                else
+                for (int32_t j = 1; j <= c; j++)
                 {
-                    total_times--;
+                    if(V[0][i][j] != 0)
+                    {
+                        double tmp_r = (double)(V[k][i][j]) / (double)(V[0][i][j]);
+                        sum += tmp_r;
+                        square_sum += tmp_r * tmp_r;
+                    }
                 }
             }
+            p[k] = (double)sum / (double)total_times;
+            double sigma2 = square_sum / (double)total_times- p[k] * p[k];
+            sigma[k] = (sigma2 >= 0)? sqrt(sigma2) : 0;
         }
-        p[k] = (double)sum / (double)total_times;
-        double sigma2 = square_sum / (double)total_times- p[k] * p[k];
-        sigma[k] = (sigma2 >= 0)? sqrt(sigma2) : 0;
-    }
+    });
 }
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
@@ -363,21 +392,21 @@ double THD_CHSketchLearn<key_len, no_layer, T, hash_t>::normalCFD(double value){
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 void THD_CHSketchLearn<key_len, no_layer, T, hash_t>::find_possible_flows
-  (int32_t i, int32_t j, int32_t k, char* candidate_string){
+  (int32_t i, int32_t j, int32_t k, char* candidate_string,
+   workspace_t &ws){
     if (k == l + 1)
     {
         char ans[(l + 7) / 8 + 1];
 
         for (int32_t kk = 1; kk <= l; kk++)
         {
-            set_bit((char*)ans, kk - 1, current_string[kk] == '1' ? 1 : 0);
+            set_bit((char*)ans, kk - 1, ws.current_string[kk] == '1' ? 1 : 0);
         }
 
         ans[(l + 7) / 8] = '\0';
         if ((hash_function[i]((FlowKey<key_len>)((int8_t *)ans)) % c + 1) == j)
         {
-            int32_t flag = 0;
-            possible_flows.push_back(two_types_of_flow(current_string, ans));
+            ws.possible_flows.push_back(two_types_of_flow(ws.current_string, ans));
         }
         return;
     }
@@ -385,15 +414,15 @@ void THD_CHSketchLearn<key_len, no_layer, T, hash_t>::find_possible_flows
     {
         if (candidate_string[k] != '*')
         {
-            current_string[k] = candidate_string[k];
-            find_possible_flows(i, j, k + 1, candidate_string);
+            ws.current_string[k] = candidate_string[k];
+            find_possible_flows(i, j, k + 1, candidate_string, ws);
         }
         else
         {
-            current_string[k] = '0';
-            find_possible_flows(i, j, k + 1, candidate_string);
-            current_string[k] = '1';
-            find_possible_flows(i, j, k + 1, candidate_string);
+            ws.current_string[k] = '0';
+            find_possible_flows(i, j, k + 1, candidate_string, ws);
+            ws.current_string[k] = '1';
+            find_possible_flows(i, j, k + 1, candidate_string, ws);
         }
     }
     return;
@@ -401,9 +430,10 @@ void THD_CHSketchLearn<key_len, no_layer, T, hash_t>::find_possible_flows
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 void THD_CHSketchLearn<key_len, no_layer, T, hash_t>::ExtractLargeFlows
-  (double theta, int32_t i, int32_t j,T*** V, double* p, double* sigma){
+  (double theta, int32_t i, int32_t j,T*** V, double* p, double* sigma,
+   workspace_t &ws){
     
-    extracted_large_flows.clear();
+    ws.extracted_large_flows.clear();
     
     // 第一步，计算每个bit的概率估值
     double hat_p[l + 1];
@@ -413,7 +443,7 @@ void THD_CHSketchLearn<key_len, no_layer, T, hash_t>::ExtractLargeFlows
     }
     
     //  第二步，找到所有候选的大流，存在possible_flows里面
-    num_of_star = 0;
+    ws.num_of_star = 0;
     char candidate_string[l + 2];
     for (int32_t k = 1; k <= l; k++)
     {
@@ -428,25 +458,25 @@ void THD_CHSketchLearn<key_len, no_layer, T, hash_t>::ExtractLargeFlows
         else
         {
             candidate_string[k] = '*';
-            num_of_star++;
+            ws.num_of_star++;
         }
     }
     candidate_string[l + 1] = '\0';
     candidate_string[0] = '#';
-    if (num_of_star > STAR_THRESHOLD)
+    if (ws.num_of_star > STAR_THRESHOLD)
     {
         return;
     }
-    current_string[l + 1] = '\0';
-    current_string[0] = '#';
-    possible_flows.clear();
-    find_possible_flows(i, j, 1, candidate_string);
+    ws.current_string[l + 1] = '\0';
+    ws.current_string[0] = '#';
+    ws.possible_flows.clear();
+    find_possible_flows(i, j, 1, candidate_string, ws);
     
     //  第三步，估计大流的频率和可能性向量
     double estimated_frequency[l + 1];
     double estimated_p[l + 1];
-    for (auto item = possible_flows.begin();
-        item != possible_flows.end(); item++)
+    for (auto item = ws.possible_flows.begin();
+        item != ws.possible_flows.end(); item++)
     {
         int32_t min_sketch = 0xfffffff;
         for (int32_t k = 1; k <= l; k++)
@@ -478,11 +508,11 @@ void THD_CHSketchLearn<key_len, no_layer, T, hash_t>::ExtractLargeFlows
             }
             ans_estimated_frequency = min_sketch;
         }
-        extracted_large_flows.push_back(ans_t(item->bit_flow, item->flow, ans_estimated_frequency, estimated_p));
+        ws.extracted_large_flows.push_back(ans_t(item->bit_flow, item->flow, ans_estimated_frequency, estimated_p));
     }
     
     //  第四步，去sketch里查候选流的数据，删掉过小的
-    for (auto item = extracted_large_flows.begin(); item != extracted_large_flows.end(); )
+    for (auto item = ws.extracted_large_flows.begin(); item != ws.extracted_large_flows.end(); )
     {
         for (int32_t ii = 0; ii < r; ii++)
         {
@@ -505,8 +535,8 @@ void THD_CHSketchLearn<key_len, no_layer, T, hash_t>::ExtractLargeFlows
         }
         if (item->size < theta * V[0][i][j])
         {
-            item = extracted_large_flows.erase(item);
-            if (item == extracted_large_flows.end())break;
+            item = ws.extracted_large_flows.erase(item);
+            if (item == ws.extracted_large_flows.end())break;
         }
         else 
         {
@@ -572,53 +602,43 @@ bool THD_CHSketchLearn<key_len, no_layer, T, hash_t>::Terminate(double theta){
     double RATE2 = 0.9544 + STEP * log2(theta);
     double RATE3 = 0.9973 + STEP * log2(theta);
 
-    for (size_t k = 1; k <= key_len * 8; k++)
-    {
-        T sumV = 0;
-        T sumV0 = 0;
-        size_t sigma_num1 = 0, sigma_num2 = 0, sigma_num3 = 0;
-        for (int32_t i = 0; i < r; i++)
+    // Learning terminates only if every bit level looks normal. Bit levels
+    // are checked in parallel.
+    std::vector<char> passed(l + 1, 1);
+    Util::ThreadPool::global().parallelFor(1, l + 1, [&](int64_t lo, int64_t hi) {
+        for (int64_t k = lo; k < hi; k++)
         {
-            for (int32_t j = 1; j <= c; j++)
+            size_t sigma_num1 = 0, sigma_num2 = 0, sigma_num3 = 0;
+            for (int32_t i = 0; i < r; i++)
             {
-                sumV += V[k][i][j];
-                sumV0 += V[0][i][j];
-                double rate = (double)V[k][i][j] / V[0][i][j];
-                if(sigma[k] != 0)
+                for (int32_t j = 1; j <= c; j++)
                 {
-                    if (rate <= p[k] + 3.0 * sigma[k] && rate >= p[k] - 3.0 * sigma[k])
-                        sigma_num3++;
-                    if (rate <= p[k] + 2.0 * sigma[k] && rate >= p[k] - 2.0 * sigma[k])
-                        sigma_num2++;
-                    if (rate <= p[k] + 1.0 * sigma[k] && rate >= p[k] - 1.0 * sigma[k])
+                    double rate = (double)V[k][i][j] / V[0][i][j];
+                    if(sigma[k] != 0)
+                    {
+                        if (rate <= p[k] + 3.0 * sigma[k] && rate >= p[k] - 3.0 * sigma[k])
+                            sigma_num3++;
+                        if (rate <= p[k] + 2.0 * sigma[k] && rate >= p[k] - 2.0 * sigma[k])
+                            sigma_num2++;
+                        if (rate <= p[k] + 1.0 * sigma[k] && rate >= p[k] - 1.0 * sigma[k])
+                            sigma_num1++;
+                    }
+                    else
+                    {
                         sigma_num1++;
-                }
-                else
-                {
-                    sigma_num1++;
-                    sigma_num2++;
-                    sigma_num3++;
+                        sigma_num2++;
+                        sigma_num3++;
+                    }
                 }
             }
+            double rate1 = (double)sigma_num1 / (double)(r * c);
+            double rate2 = (double)sigma_num2 / (double)(r * c);
+            double rate3 = (double)sigma_num3 / (double)(r * c);
+            passed[k] = (rate1 >= RATE1 && rate2 >= RATE2 && rate3 >= RATE3);
         }
-        /*
-        if(sigma_num1 == 0 && sigma_num2 == 0 && sigma_num3 == 0)
-        {
-            printf("I WONDER WHY PROGRAME RUNNING REACH HERE, k IS %ld, sumV IS %d, sumV0 IS %d, p[k] is %lf, sigma[k] is %lf\n", k, sumV, sumV0, p[k], sigma[k]);
-        }
-        */
-        double rate1 = (double)sigma_num1 / (double)(r * c);
-        double rate2 = (double)sigma_num2 / (double)(r * c);
-        double rate3 = (double)sigma_num3 / (double)(r * c);
-        
-        if (rate1 < RATE1)
-            return false;
-        if (rate2 < RATE2)
-            return false;
-        if (rate3 < RATE3)
-            return false;
-    }
-    return true;
+    });
+    return std::all_of(passed.begin() + 1, passed.end(),
+                       [](char ok) { return ok; });
 }
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
@@ -669,8 +689,6 @@ THD_CHSketchLearn<key_len, no_layer, T, hash_t>::THD_CHSketchLearn(int32_t depth
     }
     p = new double[l + 1]();
     sigma = new double[l + 1]();
-    current_string = new char[l + 2]();
-    num_of_star = 0;
     updated = true;
 }
 
@@ -686,17 +704,15 @@ THD_CHSketchLearn<key_len, no_layer, T, hash_t>::~THD_CHSketchLearn(){
    delete[] ch;
    delete[] p;
    delete[] sigma;
-   delete[] current_string;
 
-   possible_flows.clear();
    large_flows.clear();
-   extracted_large_flows.clear();
+   large_flow_index.clear();
    flows_to_remove.clear();
 }
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 size_t THD_CHSketchLearn<key_len, no_layer, T, hash_t>::size() const{
-   ch->print_rate("");
+   ch->reportStats("");
    return sizeof(*this)
           + r * sizeof(hash_t)
           + ch->size();
@@ -726,7 +742,7 @@ void THD_CHSketchLearn<key_len, no_layer, T, hash_t>::update(const FlowKey<key_l
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 void THD_CHSketchLearn<key_len, no_layer, T, hash_t>::Sketch_Learning(){
-    printf("LEARNING START!\n");
+    STATS_ADD("THD_CHSketchLearn", "learns", 1);
     for(int k = 0; k <= l; k++){
         for(int i = 0; i < r; i++){
             for(int j = 1; j <= c; j++){
@@ -738,41 +754,44 @@ void THD_CHSketchLearn<key_len, no_layer, T, hash_t>::Sketch_Learning(){
     double theta = START_THETA;
     int32_t nnnn = 0;
     large_flows.clear();
+    large_flow_index.clear();
     while (1)
     {
-        int32_t my_flow_num = 0;
-        std::vector<ans_t> FF;
-        for (int32_t i = 0; i < r; i++)
-        {
-            for (int32_t j = 1; j <= c; j++)
+        // Extract large flows from all stacks in parallel. Every chunk of
+        // stacks keeps what it finds in stack order, and chunks are merged
+        // in order as well, so FF is exactly what a serial scan yields.
+        std::vector<std::pair<int64_t, std::vector<ans_t>>> found;
+        std::mutex found_mtx;
+        Util::ThreadPool::global().parallelFor(0, static_cast<int64_t>(r) * c,
+                                               [&](int64_t lo, int64_t hi) {
+            workspace_t ws;
+            std::vector<ans_t> chunk;
+            for (int64_t s = lo; s < hi; s++)
             {
+                int32_t i = s / c;
+                int32_t j = s % c + 1;
                 if (0 == V[0][i][j])
                 {
                     continue;
                 }
-                ExtractLargeFlows(theta, i, j, V, p, sigma);
-                std::vector<ans_t> temp_F = extracted_large_flows;
-                if (!temp_F.empty())
-                {
-                    my_flow_num++;
-                    for (auto it = temp_F.begin(); it < temp_F.end(); it++)
-                    {
-                        bool temp_Fin = false;
-                        if (!FF.empty())
-                        {
-                            for (auto iter = FF.begin(); iter < FF.end(); iter++)
-                            {
-                                if (strcmp(iter->bit_flow, it->bit_flow) == 0)
-                                {
-                                    temp_Fin = true;
-                                    break;
-                                }
-                            }
-                        }
-                        if (!temp_Fin)
-                            FF.push_back(*it);
-                    }
-                }
+                ExtractLargeFlows(theta, i, j, V, p, sigma, ws);
+                chunk.insert(chunk.end(), ws.extracted_large_flows.begin(),
+                             ws.extracted_large_flows.end());
+            }
+            std::lock_guard<std::mutex> lock(found_mtx);
+            found.emplace_back(lo, std::move(chunk));
+        });
+        std::sort(found.begin(), found.end(),
+                  [](const auto &a, const auto &b) { return a.first < b.first; });
+
+        std::vector<ans_t> FF;
+        std::unordered_set<FlowKey<key_len>> in_FF;
+        for (auto &chunk : found)
+        {
+            for (auto &it : chunk.second)
+            {
+                if (in_FF.insert(FlowKey<key_len>((const int8_t *)it.flow)).second)
+                    FF.push_back(it);
             }
         }
 
@@ -781,25 +800,16 @@ void THD_CHSketchLearn<key_len, no_layer, T, hash_t>::Sketch_Learning(){
         {
             for (auto it = FF.begin(); it < FF.end(); it++)
             {
-                bool FF_in = false;
-                auto temp_pos = large_flows.end();
-                if (!large_flows.empty())
+                FlowKey<key_len> key((const int8_t *)it->flow);
+                auto pos = large_flow_index.find(key);
+                if (pos == large_flow_index.end())
                 {
-                    for (auto iter = large_flows.begin(); iter < large_flows.end(); iter++)
-                    {
-                        if (strcmp(iter->bit_flow, it->bit_flow) == 0)
-                        {
-                            FF_in = true;
-                            temp_pos = iter;
-                            break;
-                        }
-                    }
-                }
-                if (!FF_in)
+                    large_flow_index.emplace(key, large_flows.size());
                     large_flows.push_back(*it);
-                else if (FF_in)
+                }
+                else
                 {
-                    temp_pos->size += it->size;
+                    large_flows[pos->second].size += it->size;
                 }
             }
             flows_to_remove.clear();
@@ -817,7 +827,6 @@ void THD_CHSketchLearn<key_len, no_layer, T, hash_t>::Sketch_Learning(){
             theta /= 2;
     }
     large_flow_filter();
-    printf("LEARNING END!\n");
 }
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
@@ -833,7 +842,7 @@ Data::Estimation<key_len, T> THD_CHSketchLearn<key_len, no_layer, T, hash_t>::ge
       const_cast<THD_CHSketchLearn<key_len, no_layer, T, hash_t>*>(this)->updated = false;
     }
     Data::Estimation<key_len, T> heavy_hitters;
-    for(auto it : large_flows)
+    for(const auto &it : large_flows)
     {
       if(it.size >= threshold)
       {
@@ -850,12 +859,10 @@ T THD_CHSketchLearn<key_len, no_layer, T, hash_t>::query(const FlowKey<key_len>
       const_cast<THD_CHSketchLearn<key_len, no_layer, T, hash_t>*>(this)->Sketch_Learning();
       const_cast<THD_CHSketchLearn<key_len, no_layer, T, hash_t>*>(this)->updated = false;
     }
-    for(auto it : large_flows)
+    auto pos = large_flow_index.find(flowkey);
+    if (pos != large_flow_index.end())
     {
-      if(FlowKey<key_len>((const int8_t *)it.flow) == flowkey)
-      {
-        return it.size;
-      }
+      return large_flows[pos->second].size;
     }
     T result = 0xfffffff;
     for (int32_t ii = 0; ii < r; ii++)
@@ -895,11 +902,9 @@ void THD_CHSketchLearn<key_len, no_layer, T, hash_t>::clear(){
     p[i] = sigma[i] = 0;
   }
   updated = false;
-  possible_flows.clear();
   large_flows.clear();
-  extracted_large_flows.clear();
+  large_flow_index.clear();
   flows_to_remove.clear();
-  num_of_star = 0;
 }
 
 }
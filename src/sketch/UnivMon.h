@@ -10,6 +10,7 @@
 #include <iostream>
 
 #include <common/hash.h>
+#include <common/levels.h>
 #include <common/sketch.h>
 #include <sketch/CountSketch.h>
 
@@ -29,6 +30,7 @@ private:
   int32_t logn;
   hash_t *hash_fns;
   CountSketch<key_len, T, hash_t> **sketch;
+  LevelSampler<key_len, hash_t> *sampler; // only in the shared-hash mode
   Data::Estimation<key_len> *flows;
 
   UnivMon(const UnivMon &) = delete;
@@ -39,8 +41,11 @@ public:
    * @brief Construct by specifying depth, width and $\log n$, where $n$ is the
    * number of flows to insert.
    *
+   * @param shared_hash whether to sample levels by a single hash and share row
+   * hashes among levels, cf. LevelSampler
    */
-  UnivMon(int32_t depth_, int32_t width_, int32_t log_n);
+  UnivMon(int32_t depth_, int32_t width_, int32_t log_n,
+          bool shared_hash = false);
   /**
    * @brief Release the pointer
    *
@@ -89,8 +94,9 @@ int32_t UnivMon<key_len, T, hash_t>::getHash(const FlowKey<key_len> &flowkey, in
 
 template <int32_t key_len, typename T, typename hash_t>
 UnivMon<key_len, T, hash_t>::UnivMon(int32_t depth_, int32_t width_,
-                                     int32_t log_n)
-    : depth(depth_), width(Util::NextPrime(width_)), logn(log_n) {
+                                     int32_t log_n, bool shared_hash)
+    : depth(depth_), width(Util::NextPrime(width_)), logn(log_n),
+      sampler(nullptr) {
 
   hash_fns = new hash_t[logn - 1];
   // Allocate continuous memory
@@ -100,6 +106,8 @@ UnivMon<key_len, T, hash_t>::UnivMon(int32_t depth_, int32_t width_,
     width_ = std::max(1, width_ / 2);
   }
   flows = new Data::Estimation<key_len>[logn];
+  if (shared_hash)
+    sampler = new LevelSampler<key_len, hash_t>(depth, logn);
 }
 
 template <int32_t key_len, typename T, typename hash_t>
@@ -113,11 +121,22 @@ UnivMon<key_len, T, hash_t>::~UnivMon() {
   }
   if (flows)
     delete[] flows;
+  delete sampler;
 }
 
 template <int32_t key_len, typename T, typename hash_t>
 void UnivMon<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
                                          T val) {
+  if (sampler) {
+    uint64_t rows[depth], hashes[depth];
+    sampler->hashRows(flowkey, rows);
+    const int32_t levels = sampler->numLevels(flowkey);
+    for (int32_t i = 0; i < levels; ++i) {
+      sampler->atLevel(rows, i, hashes);
+      sketch[i]->updateHashed(hashes, val);
+    }
+    return;
+  }
   for (int32_t i = 0; i < logn; ++i) {
     if (getHash(flowkey, i)) {
       sketch[i]->update(flowkey, val);
@@ -128,6 +147,18 @@ void UnivMon<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
 
 template <int32_t key_len, typename T, typename hash_t>
 T UnivMon<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
+  if (sampler) {
+    uint64_t rows[depth], hashes[depth];
+    sampler->hashRows(flowkey, rows);
+    const int32_t level = sampler->numLevels(flowkey) - 1;
+    sampler->atLevel(rows, level, hashes);
+    T ret = sketch[level]->queryHashed(hashes);
+    for (int i = level - 1; i >= 0; i--) {
+      sampler->atLevel(rows, i, hashes);
+      ret = 2 * ret - sketch[i]->queryHashed(hashes);
+    }
+    return ret;
+  }
   int level;
   for(level = 0; level < logn; level++){
     if(!getHash(flowkey, level)){
@@ -180,6 +211,8 @@ size_t UnivMon<key_len, T, hash_t>::size() const {
   for (int32_t i = 0; i < logn; ++i)
     total += sketch[i]->size(); // L2 HH
   total += sizeof(hash_t) * (logn - 1);
+  if (sampler)
+    total += sampler->size();
   return total;
 }
 
@@ -8,6 +8,7 @@
  */
 #pragma once
 
+#include <common/bucket.h>
 #include <common/hash.h>
 #include <common/sketch.h>
 
@@ -32,9 +33,19 @@ private:
   hash_t s_;
 
   class heavy_part;
-  class counter;
 
-  counter* WavingCounter;
+  // fingerprints and frequencies of the heavy parts of a counter, followed by
+  // the counter itself, are packed in one block; heavy parts (flowkeys and
+  // flags) are only visited on a fingerprint hit
+  Util::PackedBuckets<T> buckets;
+  heavy_part* heavy;
+
+  /**
+   * @brief Find the heavy part of a flowkey in a counter, `-1` if absent
+   *
+   */
+  int32_t findID(int32_t counter_idx, uint8_t fp,
+                 const FlowKey<key_len> &key) const;
 public:
   /**
    * @brief Construct by specifying counter_num and heavy_part_length
@@ -96,97 +107,51 @@ namespace OmniSketch::Sketch {
 template <int32_t key_len, typename T, typename hash_t>
 class WavingSketch<key_len, T, hash_t>::heavy_part{
 public:
-    T frequency;
     FlowKey<key_len> key;
     uint8_t flag;
-    heavy_part(): frequency(0), flag(1){}
-    bool operator<(const heavy_part& h) const
-    {
-        return frequency < h.frequency;
-    }
-};
-
-template <int32_t key_len, typename T, typename hash_t>
-class WavingSketch<key_len, T, hash_t>::counter{
-public:
-    T counter;
-    int32_t size_;
-    heavy_part* heavy;
-    void init(int32_t heavy_part_length_)
-    {
-        heavy = new heavy_part[heavy_part_length_]();
-        counter = 0;
-        size_ = 0;
-    }
-    void clear()
-    {
-        delete[] heavy;
-    }
-    int32_t smallestID()
-    {
-        int32_t ans = 0;
-        T minn = heavy[0].frequency;
-        for(int i = 1; i < size_; i++)
-        {
-            T fre = heavy[i].frequency;
-            if(fre < minn)
-            {
-                minn = fre;
-                ans = i;
-            }
-        }
-        return ans;
-    }
-    int32_t findID(const FlowKey<key_len>& key)
-    {
-        for(int i = 0; i < size_; i++)
-        {
-            if(heavy[i].key == key)
-            {
-                return i;
-            }
-        }
-        return -1;
-    }
-    void insert(FlowKey<key_len> e, T val, uint8_t flag)
-    {
-        heavy[size_].key = e;
-        heavy[size_].frequency = val;
-        heavy[size_++].flag = flag;
-    }
+    heavy_part(): flag(1){}
 };
 
 template <int32_t key_len, typename T, typename hash_t>
 WavingSketch<key_len, T, hash_t>::WavingSketch(
     int32_t bucket_num_, int32_t heavy_part_length_):
-    counter_num(Util::NextPrime(bucket_num_)), heavy_part_length(heavy_part_length_)
+    counter_num(Util::NextPrime(bucket_num_)), heavy_part_length(heavy_part_length_),
+    buckets(counter_num, heavy_part_length, heavy_part_length + 1)
 {
-    WavingCounter = new counter[counter_num];
-    for(int i = 0; i < counter_num; i++)
-    {
-        WavingCounter[i].init(heavy_part_length);
-    }
+    heavy = new heavy_part[counter_num * heavy_part_length]();
 }
 
 template <int32_t key_len, typename T, typename hash_t>
 WavingSketch<key_len, T, hash_t>::~WavingSketch()
 {
-    for(int i = 0; i < heavy_part_length; i++)
-    {
-        WavingCounter[i].clear();
-    }
-    delete[] WavingCounter;
+    delete[] heavy;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+void WavingSketch<key_len, T, hash_t>::clear()
+{
+    buckets.clear();
+    std::fill(heavy, heavy + counter_num * heavy_part_length, heavy_part());
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+int32_t WavingSketch<key_len, T, hash_t>::findID(int32_t counter_idx,
+    uint8_t fp, const FlowKey<key_len> &key) const
+{
+    const heavy_part* the_heavy = heavy + counter_idx * heavy_part_length;
+    return Util::FindFingerprint(buckets.fp(counter_idx), heavy_part_length, fp,
+        [&](int32_t i){ return the_heavy[i].key == key; });
 }
 
 template <int32_t key_len, typename T, typename hash_t>
 size_t WavingSketch<key_len, T, hash_t>::size() 
   const{
 #ifndef DO_NOT_CONSIDER_FLOWKEY_SIZE
-  return counter_num * heavy_part_length * (sizeof(T) + sizeof(FlowKey<key_len>) + 0.125)
-         + counter_num * sizeof(counter)
+  return counter_num * heavy_part_length * (sizeof(T) + sizeof(FlowKey<key_len>) + 1 + 0.125)
+         + counter_num * sizeof(T)
          + sizeof(WavingSketch<key_len, hash_t, T>);
 #else
-  return counter_num * sizeof(counter)
+  return counter_num * sizeof(T)
          + sizeof(WavingSketch<key_len, hash_t, T>)
          + counter_num * heavy_part_length * (8 * sizeof(T) + 1) / 8;
 #endif
@@ -201,38 +166,50 @@ int32_t WavingSketch<key_len, T, hash_t>::s (const FlowKey<key_len> &key) const
 template <int32_t key_len, typename T, typename hash_t>
 void WavingSketch<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey, T val)
 {
-    int32_t counter_idx = h(flowkey) % counter_num;
-    counter* the_counter = WavingCounter + counter_idx;
-    int32_t heavy_idx = the_counter->findID(flowkey);
+    uint64_t hash = h(flowkey);
+    int32_t counter_idx = hash % counter_num;
+    uint8_t fp = Util::Fingerprint(hash);
+    uint8_t* fps = buckets.fp(counter_idx);
+    T* frequency = buckets.val(counter_idx);
+    T& the_counter = frequency[heavy_part_length];
+    heavy_part* the_heavy = heavy + counter_idx * heavy_part_length;
+    int32_t heavy_idx = findID(counter_idx, fp, flowkey);
     if(heavy_idx != -1)
     {
-        heavy_part* the_heavy = the_counter->heavy + heavy_idx;
-        the_heavy->frequency += val;
-        if(the_heavy->flag == false)
+        frequency[heavy_idx] += val;
+        if(the_heavy[heavy_idx].flag == false)
         {
-            the_counter->counter += s(flowkey);
+            the_counter += s(flowkey);
         }
+        return;
     }
-    else if(the_counter->size_ < heavy_part_length)
+    // heavy parts are filled from the front
+    int32_t empty_idx = Util::FindFingerprint(fps, heavy_part_length, 0,
+                                              [](int32_t){ return true; });
+    if(empty_idx != -1)
     {
-        the_counter->insert(flowkey, val, true);
+        fps[empty_idx] = fp;
+        frequency[empty_idx] = val;
+        the_heavy[empty_idx].key = flowkey;
+        the_heavy[empty_idx].flag = true;
     }
     else
     {
         int32_t sei = s(flowkey);
-        T fi = sei * the_counter->counter;
-        the_counter->counter += sei;
-        int32_t smallest_idx = the_counter->smallestID();
-        heavy_part* smallest_heavy = the_counter->heavy + smallest_idx;
-        T fr = smallest_heavy->frequency;
+        T fi = sei * the_counter;
+        the_counter += sei;
+        int32_t smallest_idx = Util::MinIndex(frequency, heavy_part_length);
+        heavy_part* smallest_heavy = the_heavy + smallest_idx;
+        T fr = frequency[smallest_idx];
         if(fr <= fi)
         {
             if(smallest_heavy->flag == true)
             {
-                the_counter->counter = the_counter->counter + fr * s(smallest_heavy->key);
+                the_counter = the_counter + fr * s(smallest_heavy->key);
             }
             smallest_heavy->flag = false;
-            smallest_heavy->frequency = fi + 1;
+            frequency[smallest_idx] = fi + 1;
+            fps[smallest_idx] = fp;
             smallest_heavy->key = flowkey;
         }
     }
@@ -240,15 +217,17 @@ void WavingSketch<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey, T
 
 template <int32_t key_len, typename T, typename hash_t>
 T WavingSketch<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
-    counter* the_counter = WavingCounter + (h(flowkey) % counter_num);
-    int32_t flowID = the_counter->findID(flowkey);
-    if(flowID == -1 || the_counter->heavy[flowID].flag == false)
+    uint64_t hash = h(flowkey);
+    int32_t counter_idx = hash % counter_num;
+    int32_t flowID = findID(counter_idx, Util::Fingerprint(hash), flowkey);
+    const T* frequency = buckets.val(counter_idx);
+    if(flowID == -1 || heavy[counter_idx * heavy_part_length + flowID].flag == false)
     {
-        return s(flowkey) * the_counter->counter;
+        return s(flowkey) * frequency[heavy_part_length];
     }
     else
     {
-        return the_counter->heavy[flowID].frequency;
+        return frequency[flowID];
     }
 }
 
@@ -259,13 +238,14 @@ WavingSketch<key_len, T, hash_t>::getHeavyHitter(
     Data::Estimation<key_len, T> heavy_Hitter;
     for(int i = 0; i < counter_num; i++)
     {
-        counter* the_counter = WavingCounter + i;
-        for(int j = 0; j < the_counter->size_; j++)
+        const uint8_t* fps = buckets.fp(i);
+        const T* frequency = buckets.val(i);
+        const heavy_part* the_heavy = heavy + i * heavy_part_length;
+        for(int j = 0; j < heavy_part_length && fps[j]; j++)
         {
-            heavy_part* the_heavy = the_counter->heavy + j;
-            if(the_heavy->frequency >= val_threshold)
+            if(frequency[j] >= val_threshold)
             {
-                heavy_Hitter[the_heavy->key] = the_heavy->frequency;
+                heavy_Hitter[the_heavy[j].key] = frequency[j];
             }
         }
     }
@@ -0,0 +1,177 @@
+/**
+ * @file BlockedCompareTest.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Compare blocked sketches with the classic ones under equal memory
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/test.h>
+#include <sketch/BlockedCMSketch.h>
+#include <sketch/BlockedCUSketch.h>
+#include <sketch/BlockedCountSketch.h>
+#include <sketch/CMSketch.h>
+#include <sketch/CUSketch.h>
+#include <sketch/CountSketch.h>
+
+#define BLK_PARA_PATH "BLK.para"
+#define BLK_TEST_PATH "BLK.test"
+#define BLK_DATA_PATH "BLK.data"
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Testing class that compares blocked and classic sketches
+ *
+ * @details Count Min, CU and Count Sketch are each tested in the classic
+ * layout (one array per row) and in the cache-line-blocked layout, with the
+ * same depth and the same counter memory, on the same data. Metrics of all six
+ * sketches are shown one after another.
+ *
+ */
+template <int32_t key_len, typename T, typename narrow_t = int16_t,
+          typename hash_t = Hash::AwareHash>
+class BlockedCompareTest : public TestBase<key_len, T> {
+  using TestBase<key_len, T>::config_file;
+
+public:
+  /**
+   * @brief Constructor
+   * @details Names from left to right are
+   * - show name
+   * - config file
+   * - path to the node that contains metrics of interest (concatenated with
+   * '.')
+   */
+  BlockedCompareTest(const std::string_view config_file)
+      : TestBase<key_len, T>("Blocked vs. Classic", config_file,
+                             BLK_TEST_PATH) {}
+
+  /**
+   * @brief Test all sketches
+   * @details An overriden method
+   */
+  void runTest() override;
+};
+
+} // namespace OmniSketch::Test
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Test {
+
+template <int32_t key_len, typename T, typename narrow_t, typename hash_t>
+void BlockedCompareTest<key_len, T, narrow_t, hash_t>::runTest() {
+  /**
+   * @brief shorthand for convenience
+   *
+   */
+  using StreamData = Data::StreamData<key_len>;
+  using Ptr = std::unique_ptr<Sketch::SketchBase<key_len, T>>;
+
+  /// Part I.
+  ///   Parse the config file
+  ///
+  /// Step i.  First we list the variables to parse, namely:
+  ///
+  int32_t depth, memory; // sketch config
+  std::string data_file; // data config
+  toml::array arr;       // shortly we will convert it to format
+  /// Step ii. Open the config file
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed()) {
+    return;
+  }
+  /// Step iii. Set the working node of the parser.
+  parser.setWorkingNode(
+      BLK_PARA_PATH); // do not forget to to enclose it with braces
+  /// Step iv. Parse depth and memory (in bytes) of counters
+  if (!parser.parseConfig(depth, "depth"))
+    return;
+  if (!parser.parseConfig(memory, "memory"))
+    return;
+  /// Step v. Move to the data node
+  parser.setWorkingNode(BLK_DATA_PATH);
+  /// Step vi. Parse data and format
+  if (!parser.parseConfig(data_file, "data"))
+    return;
+  if (!parser.parseConfig(arr, "format"))
+    return;
+  Data::DataFormat format(arr); // conver from toml::array to Data::DataFormat
+  /// [Optional] User-defined rules
+  ///
+  /// Step vii. Parse Cnt Method.
+  std::string method;
+  Data::CntMethod cnt_method = Data::InLength;
+  if (!parser.parseConfig(method, "cnt_method"))
+    return;
+  if (!method.compare("InPacket")) {
+    cnt_method = Data::InPacket;
+  }
+
+  /// Part II.
+  ///   Prepare data
+  ///
+  /// Step i. Get ground truth
+  ///
+  ///       1. read data
+  StreamData data(data_file, format); // specify both data file and data format
+  if (!data.succeed())
+    return;
+  Data::GndTruth<key_len, T> gnd_truth;
+  gnd_truth.getGroundTruth(data.begin(), data.end(), cnt_method);
+  ///       2. [optional] show data info
+  fmt::print("DataSet: {:d} records with {:d} keys ({})\n", data.size(),
+             gnd_truth.size(), data_file);
+  /// Step ii. Split the memory. Classic sketches spend `memory` on `depth`
+  /// rows of T, while blocked ones spend it on 64-byte blocks.
+  const int32_t width = memory / depth / static_cast<int32_t>(sizeof(T));
+  const int32_t num_blocks =
+      memory / Sketch::BlockedCounter<T, narrow_t>::block_size;
+  fmt::print("Counter Memory: {:d} B (classic width {:d}, {:d} blocks of "
+             "{:d}-bit sub-counters)\n",
+             memory, width, num_blocks, 8 * sizeof(narrow_t));
+
+  /// Part III.
+  ///   Test each sketch on the same data, one at a time
+  ///
+  auto run = [&](const std::string_view name, Ptr ptr) {
+    TestBase<key_len, T> tester(name, config_file, BLK_TEST_PATH);
+    tester.testUpdate(ptr, data.begin(), data.end(), cnt_method);
+    tester.testQuery(ptr, gnd_truth);
+    tester.testSize(ptr);
+    tester.show();
+  };
+  run("Count Min", Ptr(new Sketch::CMSketch<key_len, T, hash_t>(depth, width)));
+  run("Blocked Count Min",
+      Ptr(new Sketch::BlockedCMSketch<key_len, T, narrow_t, hash_t>(
+          depth, num_blocks)));
+  run("CU Sketch", Ptr(new Sketch::CUSketch<key_len, T, hash_t>(depth, width)));
+  run("Blocked CU Sketch",
+      Ptr(new Sketch::BlockedCUSketch<key_len, T, narrow_t, hash_t>(
+          depth, num_blocks)));
+  run("Count Sketch",
+      Ptr(new Sketch::CountSketch<key_len, T, hash_t>(depth, width)));
+  run("Blocked Count Sketch",
+      Ptr(new Sketch::BlockedCountSketch<key_len, T, narrow_t, hash_t>(
+          depth, num_blocks)));
+
+  return;
+}
+
+} // namespace OmniSketch::Test
+
+#undef BLK_PARA_PATH
+#undef BLK_TEST_PATH
+#undef BLK_DATA_PATH
+
+// Driver instance:
+//      AUTHOR: XierLabber
+//      CONFIG: sketch_config.toml  # with respect to the `src/` directory
+//    TEMPLATE: <13, int32_t, int16_t, Hash::AwareHash>
@@ -77,10 +77,16 @@ void BloomFilterTest<key_len, hash_t>::runTest() {
   /// Step iii. Set the working node of the parser.
   parser.setWorkingNode(BF_PARA_PATH);
   /// Step iv. Parse num_bits and num_hash
-  if (!parser.parseConfig(nbit, "num_bits"))
+  /// [Optional] Memory budget in place of num_bits, e.g., "1.5MB"
+  std::string memory;
+  if (!parser.parseConfig(memory, "memory", false) &&
+      !parser.parseConfig(nbit, "num_bits"))
     return;
   if (!parser.parseConfig(nhash, "num_hash"))
     return;
+  /// [Optional] Indexing policy of the sketch, cf. Index::Dispatch()
+  std::string index = "mod";
+  parser.parseConfig(index, "index", false);
   /// Step v. Ready to read data configurations
   parser.setWorkingNode(BF_DATA_PATH);
   /// Step vi. Parse data and format
@@ -109,8 +115,16 @@ void BloomFilterTest<key_len, hash_t>::runTest() {
   ///   Prepare sketch and data
   ///
   /// Step i. Initialize a sketch
-  std::unique_ptr<Sketch::SketchBase<key_len>> ptr(
-      new Sketch::BloomFilter<key_len, hash_t>(nbit, nhash));
+  std::unique_ptr<Sketch::SketchBase<key_len>> ptr(Index::Dispatch(
+      index, [&](auto policy) -> Sketch::SketchBase<key_len> * {
+        using index_t = decltype(policy);
+        using Sketch_t = Sketch::BloomFilter<key_len, hash_t, index_t>;
+        if (!memory.empty()) {
+          nbit = Sketch_t::solveBits(nhash, Util::ParseMemory(memory));
+          LOG(INFO, fmt::format("{} bits fit in {}.", nbit, memory));
+        }
+        return new Sketch_t(nbit, nhash);
+      }));
   /// remember that the left ptr must point to the base class in order to call
   /// the methods in it
 
@@ -84,7 +84,10 @@ void CHCUSketchTest<key_len, no_layer, T, hash_t>::runTest() {
   /// Step iv. Parse num_bits and num_hash
   if (!parser.parseConfig(depth, "depth"))
     return;
-  if (!parser.parseConfig(width, "width"))
+  /// [Optional] Memory budget in place of the width, e.g., "1.5MB"
+  std::string memory;
+  if (!parser.parseConfig(memory, "memory", false) &&
+      !parser.parseConfig(width, "width"))
     return;
   /// Step v. Move to the data node
   parser.setWorkingNode(CHCU_DATA_PATH);
@@ -123,6 +126,12 @@ void CHCUSketchTest<key_len, no_layer, T, hash_t>::runTest() {
   ///   Prepare sketch and data
   ///
   /// Step i. Initialize a sketch
+  if (!memory.empty()) {
+    width = Sketch::CHCUSketch<key_len, no_layer, T, hash_t>::solveWidth(
+        depth, cnt_no_ratio, width_cnt, no_hash, ch_cm_r, ch_cm_w,
+        Util::ParseMemory(memory));
+    LOG(INFO, fmt::format("Width of {} fits in {}.", width, memory));
+  }
   std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
       new Sketch::CHCUSketch<key_len, no_layer, T, hash_t>(
           depth, width, cnt_no_ratio, width_cnt, no_hash, 
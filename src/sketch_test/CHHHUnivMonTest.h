@@ -92,6 +92,9 @@ void CHHHUnivMonTest<key_len, no_layer, T, hash_t>::runTest() {
     return;
   if (!parser.parseConfig(SSalpha, "StreamSummary_alpha"))
     return;
+  /// [Optional] Sample levels by a single hash and share row hashes
+  bool shared_hash = false;
+  parser.parseConfig(shared_hash, "shared_hash", false);
   /// Step v. Move to the data node
   parser.setWorkingNode(CHHHUM_DATA_PATH);
   /// Step vi. Parse data and format
@@ -160,7 +163,7 @@ void CHHHUnivMonTest<key_len, no_layer, T, hash_t>::runTest() {
   std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
       new Sketch::CHHHUnivMon<key_len, no_layer, T, hash_t>(
           depth, width, logn, heap_size, SSalpha, cnt_no_ratio, 
-          width_cnt, no_hash, ch_cm_r, ch_cm_w));
+          width_cnt, no_hash, ch_cm_r, ch_cm_w, shared_hash));
   /// remember that the left ptr must point to the base class in order to call
   /// the methods in it
 
@@ -85,6 +85,9 @@ void CHUnivMonTest<key_len, no_layer, T, hash_t>::runTest() {
     return;
   if (!parser.parseConfig(width, "width"))
     return;
+  /// [Optional] Sample levels by a single hash and share row hashes
+  bool shared_hash = false;
+  parser.parseConfig(shared_hash, "shared_hash", false);
   /// Step v. Move to the data node
   parser.setWorkingNode(CHUM_DATA_PATH);
   /// Step vi. Parse data and format
@@ -138,7 +141,7 @@ void CHUnivMonTest<key_len, no_layer, T, hash_t>::runTest() {
   OmniSketch::Hash::AwareHash(1);
   std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
       new Sketch::CHUnivMon<key_len, no_layer, T, hash_t>(
-          depth, width, logn, cnt_no_ratio, width_cnt, no_hash));
+          depth, width, logn, cnt_no_ratio, width_cnt, no_hash, shared_hash));
   /// remember that the left ptr must point to the base class in order to call
   /// the methods in it
 
@@ -82,8 +82,14 @@ void CUSketchTest<key_len, T, hash_t>::runTest() {
   /// Step iv. Parse num_bits and num_hash
   if (!parser.parseConfig(depth, "depth"))
     return;
-  if (!parser.parseConfig(width, "width"))
+  /// [Optional] Memory budget in place of the width, e.g., "1.5MB"
+  std::string memory;
+  if (!parser.parseConfig(memory, "memory", false) &&
+      !parser.parseConfig(width, "width"))
     return;
+  /// [Optional] Indexing policy of the sketch, cf. Index::Dispatch()
+  std::string index = "mod";
+  parser.parseConfig(index, "index", false);
   /// Step v. Move to the data node
   parser.setWorkingNode(CU_DATA_PATH);
   /// Step vi. Parse data and format
@@ -107,11 +113,33 @@ void CUSketchTest<key_len, T, hash_t>::runTest() {
   ///   Prepare sketch and data
   ///
   /// Step i. Initialize a sketch
-  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
-      new Sketch::CUSketch<key_len, T, hash_t>(depth, width));
+  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(Index::Dispatch(
+      index, [&](auto policy) -> Sketch::SketchBase<key_len, T> * {
+        using index_t = decltype(policy);
+        using Sketch_t = Sketch::CUSketch<key_len, T, hash_t, index_t>;
+        if (!memory.empty()) {
+          width = Sketch_t::solveWidth(depth, Util::ParseMemory(memory));
+          LOG(INFO, fmt::format("Width of {} fits in {}.", width, memory));
+        }
+        return new Sketch_t(depth, width);
+      }));
   /// remember that the left ptr must point to the base class in order to call
   /// the methods in it
 
+  /// [Optional] A FIFO or "-" for the standard input, e.g., fed by the pcap
+  /// parser, is streamed in constant memory instead. No record is kept, so
+  /// there is no ground truth to query against.
+  if (Data::IsStream(data_file)) {
+    Data::RecordSource<key_len> source(data_file, format);
+    if (!source.succeed())
+      return;
+    const int64_t count = this->testUpdateStream(ptr, source, cnt_method, 1);
+    fmt::print("DataStream: {:d} records ({})\n", count, data_file);
+    this->testSize(ptr);
+    this->show();
+    return;
+  }
+
   /// Step ii. Get ground truth
   ///
   ///       1. read data
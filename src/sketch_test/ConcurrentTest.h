@@ -0,0 +1,239 @@
+/**
+ * @file ConcurrentTest.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Scaling of Count Min, Count Sketch and Bloom Filter shared by
+ * concurrent threads
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/test.h>
+#include <sketch/BloomFilter.h>
+#include <sketch/CMSketch.h>
+#include <sketch/ConcurrentBloomFilter.h>
+#include <sketch/ConcurrentCMSketch.h>
+#include <sketch/ConcurrentCountSketch.h>
+#include <sketch/CountSketch.h>
+
+#define CC_PARA_PATH "CC.para"
+#define CC_TEST_PATH "CC.test"
+#define CC_DATA_PATH "CC.data"
+#define CC_CM_PATH "CC.cm"
+#define CC_BF_PATH "CC.bf"
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Testing class of sketches shared by concurrent threads
+ *
+ * @details For each size, the plain sketch is first updated by a single
+ * thread, which is the baseline the atomics are paid against. Its concurrent
+ * counterpart is then updated by every configured number of threads, starting
+ * afresh each time, and queried once the threads are done, which gives the
+ * same accuracy as the baseline unless updates were lost.
+ *
+ * Sizes come in pairs: a small sketch whose rows span a few cache lines,
+ * which all threads keep stealing from one another (false sharing, and true
+ * sharing on the counters of heavy flows), and a large one on which threads
+ * rarely meet.
+ *
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+class ConcurrentTest : public TestBase<key_len, T> {
+  using TestBase<key_len, T>::config_file;
+
+public:
+  /**
+   * @brief Constructor
+   * @details Names from left to right are
+   * - show name
+   * - config file
+   * - path to the node that contains metrics of interest (concatenated with
+   * '.')
+   */
+  ConcurrentTest(const std::string_view config_file)
+      : TestBase<key_len, T>("Concurrent", config_file, CC_TEST_PATH) {}
+
+  /**
+   * @brief Test all sketches
+   * @details An overriden method
+   */
+  void runTest() override;
+};
+
+} // namespace OmniSketch::Test
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Test {
+
+template <int32_t key_len, typename T, typename hash_t>
+void ConcurrentTest<key_len, T, hash_t>::runTest() {
+  /**
+   * @brief shorthand for convenience
+   *
+   */
+  using StreamData = Data::StreamData<key_len>;
+  using Ptr = std::unique_ptr<Sketch::SketchBase<key_len, T>>;
+  using BFPtr = std::unique_ptr<Sketch::SketchBase<key_len>>;
+
+  /// Part I.
+  ///   Parse the config file
+  ///
+  /// Step i.  First we list the variables to parse, namely:
+  ///
+  std::vector<int32_t> threads;   // numbers of threads
+  std::string partition = "flow"; // how records are split
+  int32_t depth;                  // CM and Count Sketch
+  std::vector<int32_t> widths;
+  int32_t num_hash; // Bloom Filter
+  std::vector<int32_t> num_bits;
+  std::string data_file; // data config
+  toml::array arr;       // shortly we will convert it to format
+  /// Step ii. Open the config file
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed()) {
+    return;
+  }
+  /// Step iii. Parse the numbers of threads
+  parser.setWorkingNode(CC_PARA_PATH);
+  if (!parser.parseConfig(threads, "threads"))
+    return;
+  /// [Optional] "flow" to split records by flowkey, "chunk" to split them into
+  /// contiguous chunks
+  parser.parseConfig(partition, "partition", false);
+  if (partition != "flow" && partition != "chunk")
+    throw std::invalid_argument(
+        "Invalid Argument: Partition should be \"flow\" or \"chunk\", but got " +
+        partition + " instead.");
+  const bool by_flow = partition == "flow";
+  /// Step iv. Parse each sketch
+  parser.setWorkingNode(CC_CM_PATH);
+  if (!parser.parseConfig(depth, "depth"))
+    return;
+  if (!parser.parseConfig(widths, "width"))
+    return;
+  parser.setWorkingNode(CC_BF_PATH);
+  if (!parser.parseConfig(num_hash, "num_hash"))
+    return;
+  if (!parser.parseConfig(num_bits, "num_bits"))
+    return;
+  /// Step v. Move to the data node
+  parser.setWorkingNode(CC_DATA_PATH);
+  /// Step vi. Parse data and format
+  if (!parser.parseConfig(data_file, "data"))
+    return;
+  if (!parser.parseConfig(arr, "format"))
+    return;
+  Data::DataFormat format(arr); // conver from toml::array to Data::DataFormat
+  /// [Optional] User-defined rules
+  ///
+  /// Step vii. Parse Cnt Method.
+  std::string method;
+  Data::CntMethod cnt_method = Data::InLength;
+  if (!parser.parseConfig(method, "cnt_method"))
+    return;
+  if (!method.compare("InPacket")) {
+    cnt_method = Data::InPacket;
+  }
+
+  /// Part II.
+  ///   Prepare data
+  ///
+  StreamData data(data_file, format); // specify both data file and data format
+  if (!data.succeed())
+    return;
+  Data::GndTruth<key_len, T> gnd_truth;
+  gnd_truth.getGroundTruth(data.begin(), data.end(), cnt_method);
+  Data::GndTruth<key_len> bf_truth;
+  bf_truth.getGroundTruth(data.begin(), data.end(), Data::InPacket);
+  fmt::print("DataSet: {:d} records with {:d} keys ({}), split by {}\n",
+             data.size(), gnd_truth.size(), data_file, partition);
+
+  /// Part III.
+  ///   Test each sketch of each size with each number of threads
+  ///
+  auto run = [&](const std::string &name, int32_t num_threads, Ptr ptr) {
+    TestBase<key_len, T> tester(
+        fmt::format("{} ({} threads)", name, num_threads), config_file,
+        CC_TEST_PATH);
+    if (num_threads)
+      tester.testUpdateParallel(ptr, data.begin(), data.end(), cnt_method,
+                                num_threads, by_flow);
+    else
+      tester.testUpdate(ptr, data.begin(), data.end(), cnt_method);
+    tester.testQuery(ptr, gnd_truth);
+    tester.testSize(ptr);
+    tester.show();
+  };
+  auto run_bf = [&](const std::string &name, int32_t num_threads, BFPtr ptr) {
+    TestBase<key_len> tester(fmt::format("{} ({} threads)", name, num_threads),
+                             config_file, CC_TEST_PATH);
+    if (num_threads)
+      tester.testInsertParallel(ptr, data.begin(), data.end(), num_threads,
+                                by_flow);
+    else
+      tester.testInsert(ptr, data.begin(), data.end());
+    tester.testLookup(ptr, bf_truth, bf_truth);
+    tester.testSize(ptr);
+    tester.show();
+  };
+  // 0 threads stands for the plain sketch, updated by the caller, and hashing
+  // is reset before each sketch so that all of a kind hash alike
+  for (int32_t width : widths) {
+    const std::string name = fmt::format("Count Min, width {}", width);
+    Hash::AwareHash(1);
+    run(name, 0, Ptr(new Sketch::CMSketch<key_len, T, hash_t>(depth, width)));
+    for (int32_t num_threads : threads) {
+      Hash::AwareHash(1);
+      run(name, num_threads,
+          Ptr(new Sketch::ConcurrentCMSketch<key_len, T, hash_t>(depth,
+                                                                 width)));
+    }
+  }
+  for (int32_t width : widths) {
+    const std::string name = fmt::format("Count Sketch, width {}", width);
+    Hash::AwareHash(1);
+    run(name, 0,
+        Ptr(new Sketch::CountSketch<key_len, T, hash_t>(depth, width)));
+    for (int32_t num_threads : threads) {
+      Hash::AwareHash(1);
+      run(name, num_threads,
+          Ptr(new Sketch::ConcurrentCountSketch<key_len, T, hash_t>(depth,
+                                                                    width)));
+    }
+  }
+  for (int32_t nbits : num_bits) {
+    const std::string name = fmt::format("Bloom Filter, {} bits", nbits);
+    Hash::AwareHash(1);
+    run_bf(name, 0,
+           BFPtr(new Sketch::BloomFilter<key_len, hash_t>(nbits, num_hash)));
+    for (int32_t num_threads : threads) {
+      Hash::AwareHash(1);
+      run_bf(name, num_threads,
+             BFPtr(new Sketch::ConcurrentBloomFilter<key_len, hash_t>(
+                 nbits, num_hash)));
+    }
+  }
+
+  return;
+}
+
+} // namespace OmniSketch::Test
+
+#undef CC_PARA_PATH
+#undef CC_TEST_PATH
+#undef CC_DATA_PATH
+#undef CC_CM_PATH
+#undef CC_BF_PATH
+
+// Driver instance:
+//      AUTHOR: XierLabber
+//      CONFIG: sketch_config.toml  # with respect to the `src/` directory
+//    TEMPLATE: <13, int32_t, Hash::AwareHash>
@@ -84,6 +84,9 @@ void DeltoidTest<key_len, T, hash_t>::runTest() {
     return;
   if (!parser.parseConfig(num_group, "num_group"))
     return;
+  /// [Optional] Indexing policy of the sketch, cf. Index::Dispatch()
+  std::string index = "mod";
+  parser.parseConfig(index, "index", false);
   /// Step v. To know about the data, we move to the [Deltoid.data] node.
   parser.setWorkingNode(DT_DATA_PATH);
   /// Step vi. Parse data and format
@@ -130,8 +133,12 @@ void DeltoidTest<key_len, T, hash_t>::runTest() {
   ///   Prepare sketch and data
   ///
   /// Step i. Initialize a sketch
-  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
-      new Sketch::Deltoid<key_len, T, hash_t>(num_hash, num_group));
+  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(Index::Dispatch(
+      index, [&](auto policy) -> Sketch::SketchBase<key_len, T> * {
+        using index_t = decltype(policy);
+        return new Sketch::Deltoid<key_len, T, hash_t, index_t>(
+            num_hash, num_group);
+      }));
   /// remember that the left ptr must point to the base class in order to call
   /// the methods in it
   /// Step iii. Insert the samples and then look up all the flows
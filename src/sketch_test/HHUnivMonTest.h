@@ -89,6 +89,9 @@ void HHUnivMonTest<key_len, T, hash_t>::runTest() {
     return;
   if (!parser.parseConfig(SS_alpha, "StreamSummary_alpha"))
     return;
+  /// [Optional] Sample levels by a single hash and share row hashes
+  bool shared_hash = false;
+  parser.parseConfig(shared_hash, "shared_hash", false);
   /// Step v. Move to the data node
   parser.setWorkingNode(HHUM_DATA_PATH);
   /// Step vi. Parse data and format
@@ -131,7 +134,7 @@ void HHUnivMonTest<key_len, T, hash_t>::runTest() {
   std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
       new Sketch::HHUnivMon<key_len, T, hash_t>(
           depth, width, static_cast<int32_t>(std::log2(gnd_truth.size())), 
-          heap_size, SS_alpha));
+          heap_size, SS_alpha, shared_hash));
   /// remember that the left ptr must point to the base class in order to call
   /// the methods in it
 
@@ -83,7 +83,10 @@ void HashPipeTest<key_len, T, hash_t>::runTest() {
   /// Step iv. Parse num_bits and num_hash
   if (!parser.parseConfig(depth, "depth"))
     return;
-  if (!parser.parseConfig(width, "width"))
+  /// [Optional] Memory budget in place of the width, e.g., "1.5MB"
+  std::string memory;
+  if (!parser.parseConfig(memory, "memory", false) &&
+      !parser.parseConfig(width, "width"))
     return;
   /// Step v. To know about the data, we  switch to [HP.data].
   parser.setWorkingNode(HP_DATA_PATH);
@@ -114,6 +117,11 @@ void HashPipeTest<key_len, T, hash_t>::runTest() {
   ///   Prepare sketch and data
   ///
   /// Step i. Initialize a sketch
+  if (!memory.empty()) {
+    width = Sketch::HashPipe<key_len, T, hash_t>::solveWidth(
+        depth, Util::ParseMemory(memory));
+    LOG(INFO, fmt::format("Width of {} fits in {}.", width, memory));
+  }
   std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
       new Sketch::HashPipe<key_len, T, hash_t>(depth, width));
   /// remember that the left ptr must point to the base class in order to call
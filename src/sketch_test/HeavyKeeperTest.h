@@ -94,6 +94,9 @@ namespace OmniSketch::Test {
     return;
   if (!parser.parseConfig(hash_table_alpha, "hash_table_alpha"))
     return;
+  /// [Optional] Indexing policy of the sketch, cf. Index::Dispatch()
+  std::string index = "mod";
+  parser.parseConfig(index, "index", false);
   /// Step v. To know about the data, we move to the [HK.data] node.
   parser.setWorkingNode(HK_DATA_PATH);
   /// Step vi. Parse data and format
@@ -123,9 +126,12 @@ namespace OmniSketch::Test {
   ///   Prepare sketch and data
   ///
   /// Step i. Initialize a sketch
-  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
-      new Sketch::HeavyKeeper<key_len, T, hash_t>
-                             (depth_, width_, num_threshold_, b_, hash_table_alpha));
+  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(Index::Dispatch(
+      index, [&](auto policy) -> Sketch::SketchBase<key_len, T> * {
+        using index_t = decltype(policy);
+        return new Sketch::HeavyKeeper<key_len, T, hash_t, index_t>(
+            depth_, width_, num_threshold_, b_, hash_table_alpha);
+      }));
   /// remember that the left ptr must point to the base class in order to call
   /// the methods in it
 
@@ -0,0 +1,165 @@
+/**
+ * @file IndexCompareTest.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Compare indexing policies on Count Min, CU and Count Sketch
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/index.h>
+#include <common/test.h>
+#include <sketch/CMSketch.h>
+#include <sketch/CUSketch.h>
+#include <sketch/CountSketch.h>
+
+#define IDX_PARA_PATH "IDX.para"
+#define IDX_TEST_PATH "IDX.test"
+#define IDX_DATA_PATH "IDX.data"
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Testing class that compares indexing policies
+ *
+ * @details Count Min, CU and Count Sketch are each tested with every policy
+ * in Index, with the same depth and configured width, on the same data. Since
+ * the policies may round the width differently, the actual size is shown as
+ * well.
+ *
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+class IndexCompareTest : public TestBase<key_len, T> {
+  using TestBase<key_len, T>::config_file;
+
+public:
+  /**
+   * @brief Constructor
+   * @details Names from left to right are
+   * - show name
+   * - config file
+   * - path to the node that contains metrics of interest (concatenated with
+   * '.')
+   */
+  IndexCompareTest(const std::string_view config_file)
+      : TestBase<key_len, T>("Indexing Policies", config_file,
+                             IDX_TEST_PATH) {}
+
+  /**
+   * @brief Test all sketches
+   * @details An overriden method
+   */
+  void runTest() override;
+};
+
+} // namespace OmniSketch::Test
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Test {
+
+template <int32_t key_len, typename T, typename hash_t>
+void IndexCompareTest<key_len, T, hash_t>::runTest() {
+  /**
+   * @brief shorthand for convenience
+   *
+   */
+  using StreamData = Data::StreamData<key_len>;
+  using Ptr = std::unique_ptr<Sketch::SketchBase<key_len, T>>;
+
+  /// Part I.
+  ///   Parse the config file
+  ///
+  /// Step i.  First we list the variables to parse, namely:
+  ///
+  int32_t depth, width;  // sketch config
+  std::string data_file; // data config
+  toml::array arr;       // shortly we will convert it to format
+  /// Step ii. Open the config file
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed()) {
+    return;
+  }
+  /// Step iii. Set the working node of the parser.
+  parser.setWorkingNode(
+      IDX_PARA_PATH); // do not forget to to enclose it with braces
+  /// Step iv. Parse depth and width
+  if (!parser.parseConfig(depth, "depth"))
+    return;
+  if (!parser.parseConfig(width, "width"))
+    return;
+  /// Step v. Move to the data node
+  parser.setWorkingNode(IDX_DATA_PATH);
+  /// Step vi. Parse data and format
+  if (!parser.parseConfig(data_file, "data"))
+    return;
+  if (!parser.parseConfig(arr, "format"))
+    return;
+  Data::DataFormat format(arr); // conver from toml::array to Data::DataFormat
+  /// [Optional] User-defined rules
+  ///
+  /// Step vii. Parse Cnt Method.
+  std::string method;
+  Data::CntMethod cnt_method = Data::InLength;
+  if (!parser.parseConfig(method, "cnt_method"))
+    return;
+  if (!method.compare("InPacket")) {
+    cnt_method = Data::InPacket;
+  }
+
+  /// Part II.
+  ///   Prepare data
+  ///
+  /// Step i. Get ground truth
+  ///
+  ///       1. read data
+  StreamData data(data_file, format); // specify both data file and data format
+  if (!data.succeed())
+    return;
+  Data::GndTruth<key_len, T> gnd_truth;
+  gnd_truth.getGroundTruth(data.begin(), data.end(), cnt_method);
+  ///       2. [optional] show data info
+  fmt::print("DataSet: {:d} records with {:d} keys ({})\n", data.size(),
+             gnd_truth.size(), data_file);
+
+  /// Part III.
+  ///   Test each sketch with each policy on the same data, one at a time
+  ///
+  auto run = [&](const std::string &name, Ptr ptr) {
+    TestBase<key_len, T> tester(name, config_file, IDX_TEST_PATH);
+    tester.testUpdate(ptr, data.begin(), data.end(), cnt_method);
+    tester.testQuery(ptr, gnd_truth);
+    tester.testSize(ptr);
+    tester.show();
+  };
+  for (const std::string index : {"mod", "reciprocal", "fastrange", "pow2"}) {
+    Index::Dispatch(index, [&](auto policy) {
+      using index_t = decltype(policy);
+      run("Count Min (" + index + ")",
+          Ptr(new Sketch::CMSketch<key_len, T, hash_t, index_t>(depth, width)));
+      run("CU Sketch (" + index + ")",
+          Ptr(new Sketch::CUSketch<key_len, T, hash_t, index_t>(depth, width)));
+      run("Count Sketch (" + index + ")",
+          Ptr(new Sketch::CountSketch<key_len, T, hash_t, index_t>(depth,
+                                                                   width)));
+    });
+  }
+
+  return;
+}
+
+} // namespace OmniSketch::Test
+
+#undef IDX_PARA_PATH
+#undef IDX_TEST_PATH
+#undef IDX_DATA_PATH
+
+// Driver instance:
+//      AUTHOR: XierLabber
+//      CONFIG: sketch_config.toml  # with respect to the `src/` directory
+//    TEMPLATE: <13, int32_t, Hash::AwareHash>
@@ -0,0 +1,193 @@
+/**
+ * @file InterleaveTest.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Update rate of Hash Pipe, Elastic Sketch and Heavy Keeper versus the
+ * number of packets in flight
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/test.h>
+#include <sketch/ElasticSketch.h>
+#include <sketch/HashPipe.h>
+#include <sketch/HeavyKeeper.h>
+
+#define IL_PARA_PATH "IL.para"
+#define IL_TEST_PATH "IL.test"
+#define IL_DATA_PATH "IL.data"
+#define IL_HP_PATH "IL.hp"
+#define IL_ES_PATH "IL.es"
+#define IL_HK_PATH "IL.hk"
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Testing class of interleaved updates
+ *
+ * @details Each sketch is updated by Sketch::SketchBase::updateBatch() with
+ * every configured number of packets in flight, starting afresh each time.
+ * Interleaving only pays off once the sketch is much larger than the LLC, so
+ * the default sizes are in tens of megabytes.
+ *
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+class InterleaveTest : public TestBase<key_len, T> {
+  using TestBase<key_len, T>::config_file;
+
+public:
+  /**
+   * @brief Constructor
+   * @details Names from left to right are
+   * - show name
+   * - config file
+   * - path to the node that contains metrics of interest (concatenated with
+   * '.')
+   */
+  InterleaveTest(const std::string_view config_file)
+      : TestBase<key_len, T>("Interleaved Updates", config_file,
+                             IL_TEST_PATH) {}
+
+  /**
+   * @brief Test all sketches
+   * @details An overriden method
+   */
+  void runTest() override;
+};
+
+} // namespace OmniSketch::Test
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Test {
+
+template <int32_t key_len, typename T, typename hash_t>
+void InterleaveTest<key_len, T, hash_t>::runTest() {
+  /**
+   * @brief shorthand for convenience
+   *
+   */
+  using StreamData = Data::StreamData<key_len>;
+  using Ptr = std::unique_ptr<Sketch::SketchBase<key_len, T>>;
+
+  /// Part I.
+  ///   Parse the config file
+  ///
+  /// Step i.  First we list the variables to parse, namely:
+  ///
+  std::vector<int32_t> widths;          // packets in flight
+  int32_t hp_depth, hp_width;           // Hash Pipe
+  int32_t es_num_buckets, es_num_per_bucket, es_l_depth, es_l_width; // ES
+  int32_t hk_depth, hk_width, hk_num_threshold; // Heavy Keeper
+  double hk_b, hk_alpha;
+  std::string data_file; // data config
+  toml::array arr;       // shortly we will convert it to format
+  /// Step ii. Open the config file
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed()) {
+    return;
+  }
+  /// Step iii. Parse the numbers of packets in flight
+  parser.setWorkingNode(IL_PARA_PATH);
+  if (!parser.parseConfig(widths, "width"))
+    return;
+  /// Step iv. Parse each sketch, with the same names as in its own section
+  parser.setWorkingNode(IL_HP_PATH);
+  if (!parser.parseConfig(hp_depth, "depth"))
+    return;
+  if (!parser.parseConfig(hp_width, "width"))
+    return;
+  parser.setWorkingNode(IL_ES_PATH);
+  if (!parser.parseConfig(es_num_buckets, "num_buckets"))
+    return;
+  if (!parser.parseConfig(es_num_per_bucket, "num_per_bucket"))
+    return;
+  if (!parser.parseConfig(es_l_depth, "l_depth"))
+    return;
+  if (!parser.parseConfig(es_l_width, "l_width"))
+    return;
+  parser.setWorkingNode(IL_HK_PATH);
+  if (!parser.parseConfig(hk_depth, "depth"))
+    return;
+  if (!parser.parseConfig(hk_width, "width"))
+    return;
+  if (!parser.parseConfig(hk_num_threshold, "num_threshold"))
+    return;
+  if (!parser.parseConfig(hk_b, "b"))
+    return;
+  if (!parser.parseConfig(hk_alpha, "hash_table_alpha"))
+    return;
+  /// Step v. Move to the data node
+  parser.setWorkingNode(IL_DATA_PATH);
+  /// Step vi. Parse data and format
+  if (!parser.parseConfig(data_file, "data"))
+    return;
+  if (!parser.parseConfig(arr, "format"))
+    return;
+  Data::DataFormat format(arr); // conver from toml::array to Data::DataFormat
+  /// [Optional] User-defined rules
+  ///
+  /// Step vii. Parse Cnt Method.
+  std::string method;
+  Data::CntMethod cnt_method = Data::InLength;
+  if (!parser.parseConfig(method, "cnt_method"))
+    return;
+  if (!method.compare("InPacket")) {
+    cnt_method = Data::InPacket;
+  }
+
+  /// Part II.
+  ///   Prepare data
+  ///
+  StreamData data(data_file, format); // specify both data file and data format
+  if (!data.succeed())
+    return;
+  fmt::print("DataSet: {:d} records ({})\n", data.size(), data_file);
+
+  /// Part III.
+  ///   Test each sketch with each number of packets in flight
+  ///
+  auto run = [&](const std::string &name, int32_t width, Ptr ptr) {
+    TestBase<key_len, T> tester(name + " (" + std::to_string(width) +
+                                    " in flight)",
+                                config_file, IL_TEST_PATH);
+    tester.testUpdateBatch(ptr, data.begin(), data.end(), cnt_method, width);
+    tester.testSize(ptr);
+    tester.show();
+  };
+  for (int32_t width : widths) {
+    run("Hash Pipe", width,
+        Ptr(new Sketch::HashPipe<key_len, T, hash_t>(hp_depth, hp_width)));
+  }
+  for (int32_t width : widths) {
+    run("Elastic Sketch", width,
+        Ptr(new Sketch::ElasticSketch<key_len, T, hash_t>(
+            es_num_buckets, es_num_per_bucket, es_l_depth, es_l_width)));
+  }
+  for (int32_t width : widths) {
+    run("Heavy Keeper", width,
+        Ptr(new Sketch::HeavyKeeper<key_len, T, hash_t>(
+            hk_depth, hk_width, hk_num_threshold, hk_b, hk_alpha)));
+  }
+
+  return;
+}
+
+} // namespace OmniSketch::Test
+
+#undef IL_PARA_PATH
+#undef IL_TEST_PATH
+#undef IL_DATA_PATH
+#undef IL_HP_PATH
+#undef IL_ES_PATH
+#undef IL_HK_PATH
+
+// Driver instance:
+//      AUTHOR: XierLabber
+//      CONFIG: sketch_config.toml  # with respect to the `src/` directory
+//    TEMPLATE: <13, int32_t, Hash::AwareHash>
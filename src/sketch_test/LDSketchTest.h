@@ -90,6 +90,9 @@ namespace OmniSketch::Test {
     return;
   if (!parser.parseConfig(eps_, "eps"))
     return;
+  /// [Optional] Indexing policy of the sketch, cf. Index::Dispatch()
+  std::string index = "mod";
+  parser.parseConfig(index, "index", false);
   /// Step v. To know about the data, we move to the [LD.data] node.
   parser.setWorkingNode(LD_DATA_PATH);
   /// Step vi. Parse data and format
@@ -141,9 +144,12 @@ namespace OmniSketch::Test {
   ///   Prepare sketch and data
   ///
   /// Step i. Initialize a sketch
-  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
-      new Sketch::LDSketch<key_len, T, hash_t>
-                             (depth_, width_, eps_, thre_));
+  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(Index::Dispatch(
+      index, [&](auto policy) -> Sketch::SketchBase<key_len, T> * {
+        using index_t = decltype(policy);
+        return new Sketch::LDSketch<key_len, T, hash_t, index_t>(
+            depth_, width_, eps_, thre_);
+      }));
   /// remember that the left ptr must point to the base class in order to call
   /// the methods in it
   /// Step iii. Insert the samples and then look up all the flows
@@ -81,7 +81,10 @@ void NitroSketchTest<key_len, T, hash_t>::runTest() {
   /// Step iv. Parse num_bits and num_hash
   if (!parser.parseConfig(depth, "depth"))
     return;
-  if (!parser.parseConfig(width, "width"))
+  /// [Optional] Memory budget in place of the width, e.g., "1.5MB"
+  std::string memory;
+  if (!parser.parseConfig(memory, "memory", false) &&
+      !parser.parseConfig(width, "width"))
     return;
   /// Step v. Move to the data node
   parser.setWorkingNode(NS_DATA_PATH);
@@ -106,6 +109,11 @@ void NitroSketchTest<key_len, T, hash_t>::runTest() {
   ///   Prepare sketch and data
   ///
   /// Step i. Initialize a sketch
+  if (!memory.empty()) {
+    width = Sketch::NitroSketch<key_len, T, hash_t>::solveWidth(
+        depth, Util::ParseMemory(memory));
+    LOG(INFO, fmt::format("Width of {} fits in {}.", width, memory));
+  }
   std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
       new Sketch::NitroSketch<key_len, T, hash_t>(depth, width));
   /// remember that the left ptr must point to the base class in order to call
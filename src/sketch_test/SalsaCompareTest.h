@@ -0,0 +1,241 @@
+/**
+ * @file SalsaCompareTest.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Compare SALSA counters accessed by words and by bytes on a Zipf trace
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <common/salsa.h>
+#include <common/test.h>
+#include <random>
+#include <sketch/SALSACM.h>
+#include <sketch/SALSACU.h>
+
+#define SSC_PARA_PATH "SSC.para"
+#define SSC_TEST_PATH "SSC.test"
+#define SSC_DATA_PATH "SSC.data"
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Testing class that compares the primitives of SALSA
+ *
+ * @details SALSA Count Min and SALSA CU are each tested with Util::SalsaRow,
+ * which reads a counter by a word, and with Util::SalsaBytes, which reads it
+ * byte by byte, on a Zipf trace generated from a seed. Hashing is reset before
+ * each sketch, so that both primitives see the same rows and should estimate
+ * alike, which is checked as well.
+ *
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+class SalsaCompareTest : public TestBase<key_len, T> {
+  using TestBase<key_len, T>::config_file;
+
+public:
+  /**
+   * @brief Constructor
+   * @details Names from left to right are
+   * - show name
+   * - config file
+   * - path to the node that contains metrics of interest (concatenated with
+   * '.')
+   */
+  SalsaCompareTest(const std::string_view config_file)
+      : TestBase<key_len, T>("SALSA Words vs. Bytes", config_file,
+                             SSC_TEST_PATH) {}
+
+  /**
+   * @brief Test all sketches
+   * @details An overriden method
+   */
+  void runTest() override;
+
+  /**
+   * @brief Generate `num_packets` records of `num_flows` flows, whose ranks
+   * follow a Zipf distribution of parameter `skew`
+   * @details Flowkeys are random bytes, and lengths are uniform in
+   * [64, 1500]. The same seed gives the same trace.
+   *
+   */
+  static std::vector<Data::Record<key_len>>
+  zipfRecords(int32_t num_packets, int32_t num_flows, double skew,
+              int32_t seed);
+};
+
+} // namespace OmniSketch::Test
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Test {
+
+template <int32_t key_len, typename T, typename hash_t>
+std::vector<Data::Record<key_len>>
+SalsaCompareTest<key_len, T, hash_t>::zipfRecords(int32_t num_packets,
+                                                  int32_t num_flows,
+                                                  double skew, int32_t seed) {
+  if (num_packets <= 0 || num_flows <= 0 || skew < 0.0) {
+    throw std::invalid_argument(
+        "Invalid Argument: Zipf trace needs positive packets and flows and a "
+        "non-negative skew.");
+  }
+  std::mt19937_64 rng(seed);
+  // flowkeys of the ranks
+  std::vector<FlowKey<key_len>> keys;
+  keys.reserve(num_flows);
+  for (int32_t i = 0; i < num_flows; ++i) {
+    int8_t bytes[key_len];
+    for (int32_t j = 0; j < key_len; ++j)
+      bytes[j] = static_cast<int8_t>(rng());
+    keys.emplace_back(bytes);
+  }
+  // cumulative weights of the ranks, to be searched by inversion
+  std::vector<double> cdf(num_flows);
+  double sum = 0.0;
+  for (int32_t i = 0; i < num_flows; ++i) {
+    sum += 1.0 / std::pow(i + 1.0, skew);
+    cdf[i] = sum;
+  }
+  std::uniform_real_distribution<double> uniform(0.0, sum);
+  std::uniform_int_distribution<int64_t> length(64, 1500);
+
+  std::vector<Data::Record<key_len>> records(num_packets);
+  for (int32_t i = 0; i < num_packets; ++i) {
+    const auto rank =
+        std::upper_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+    records[i].flowkey = keys[std::min<int64_t>(rank, num_flows - 1)];
+    records[i].timestamp = i;
+    records[i].length = length(rng);
+  }
+  return records;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+void SalsaCompareTest<key_len, T, hash_t>::runTest() {
+  /**
+   * @brief shorthand for convenience
+   *
+   */
+  using Ptr = std::unique_ptr<Sketch::SketchBase<key_len, T>>;
+
+  /// Part I.
+  ///   Parse the config file
+  ///
+  /// Step i.  First we list the variables to parse, namely:
+  ///
+  int32_t depth, width;                 // sketch config
+  int32_t num_packets, num_flows, seed; // data config
+  double skew;
+  /// Step ii. Open the config file
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed()) {
+    return;
+  }
+  /// Step iii. Set the working node of the parser.
+  parser.setWorkingNode(
+      SSC_PARA_PATH); // do not forget to to enclose it with braces
+  /// Step iv. Parse depth and width
+  if (!parser.parseConfig(depth, "depth"))
+    return;
+  if (!parser.parseConfig(width, "width"))
+    return;
+  /// Step v. Move to the data node
+  parser.setWorkingNode(SSC_DATA_PATH);
+  /// Step vi. Parse the trace to generate
+  if (!parser.parseConfig(num_packets, "packets"))
+    return;
+  if (!parser.parseConfig(num_flows, "flows"))
+    return;
+  if (!parser.parseConfig(skew, "skew"))
+    return;
+  if (!parser.parseConfig(seed, "seed"))
+    return;
+  /// [Optional] User-defined rules
+  ///
+  /// Step vii. Parse Cnt Method.
+  std::string method;
+  Data::CntMethod cnt_method = Data::InLength;
+  if (!parser.parseConfig(method, "cnt_method"))
+    return;
+  if (!method.compare("InPacket")) {
+    cnt_method = Data::InPacket;
+  }
+
+  /// Part II.
+  ///   Prepare data
+  ///
+  /// Step i. Generate the trace and get ground truth
+  const auto data = zipfRecords(num_packets, num_flows, skew, seed);
+  Data::GndTruth<key_len, T> gnd_truth;
+  gnd_truth.getGroundTruth(data.begin(), data.end(), cnt_method);
+  /// Step ii. [optional] show data info
+  fmt::print("DataSet: {:d} records with {:d} keys (Zipf {:g} over {:d} "
+             "flows, seed {:d})\n",
+             data.size(), gnd_truth.size(), skew, num_flows, seed);
+
+  /// Part III.
+  ///   Test each sketch with either primitive on the same data, one at a
+  ///   time, keeping the estimates for comparison
+  ///
+  auto run = [&](const std::string_view name, Ptr ptr) {
+    TestBase<key_len, T> tester(name, config_file, SSC_TEST_PATH);
+    tester.testUpdate(ptr, data.begin(), data.end(), cnt_method);
+    tester.testQuery(ptr, gnd_truth);
+    tester.testSize(ptr);
+    tester.show();
+    std::vector<T> estimates;
+    estimates.reserve(gnd_truth.size());
+    for (const auto &kv : gnd_truth)
+      estimates.push_back(ptr->query(kv.get_left()));
+    return estimates;
+  };
+  auto check = [](const std::string_view name, const std::vector<T> &words,
+                  const std::vector<T> &bytes) {
+    fmt::print("{}: estimates by words and by bytes {}\n", name,
+               words == bytes ? "agree" : "DIFFER");
+  };
+
+  Hash::AwareHash(1);
+  const auto cm_words =
+      run("SALSA Count Min (words)",
+          Ptr(new Sketch::SALSACM<key_len, T, hash_t, Util::SalsaRow>(depth,
+                                                                      width)));
+  Hash::AwareHash(1);
+  const auto cm_bytes =
+      run("SALSA Count Min (bytes)",
+          Ptr(new Sketch::SALSACM<key_len, T, hash_t, Util::SalsaBytes>(
+              depth, width)));
+  Hash::AwareHash(1);
+  const auto cu_words =
+      run("SALSA CU Sketch (words)",
+          Ptr(new Sketch::SALSACU<key_len, T, hash_t, Util::SalsaRow>(depth,
+                                                                      width)));
+  Hash::AwareHash(1);
+  const auto cu_bytes =
+      run("SALSA CU Sketch (bytes)",
+          Ptr(new Sketch::SALSACU<key_len, T, hash_t, Util::SalsaBytes>(
+              depth, width)));
+  check("SALSA Count Min", cm_words, cm_bytes);
+  check("SALSA CU Sketch", cu_words, cu_bytes);
+
+  return;
+}
+
+} // namespace OmniSketch::Test
+
+#undef SSC_PARA_PATH
+#undef SSC_TEST_PATH
+#undef SSC_DATA_PATH
+
+// Driver instance:
+//      AUTHOR: XierLabber
+//      CONFIG: sketch_config.toml  # with respect to the `src/` directory
+//    TEMPLATE: <13, int32_t, Hash::AwareHash>
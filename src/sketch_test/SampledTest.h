@@ -0,0 +1,174 @@
+/**
+ * @file SampledTest.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test packet sampling in front of Count Min, CU and Count Sketch
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/test.h>
+#include <sketch/CMSketch.h>
+#include <sketch/CUSketch.h>
+#include <sketch/CountSketch.h>
+#include <sketch/Sampled.h>
+
+#define SP_PARA_PATH "SP.para"
+#define SP_TEST_PATH "SP.test"
+#define SP_DATA_PATH "SP.data"
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Testing class for sampled sketches
+ *
+ * @details Count Min, CU and Count Sketch are each put behind
+ * Sketch::Sampled with every configured probability, so that the update rate
+ * gained by sampling can be weighed against the accuracy lost. With a
+ * capacity, the probability also adapts to the rate at which packets are
+ * replayed.
+ *
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+class SampledTest : public TestBase<key_len, T> {
+  using TestBase<key_len, T>::config_file;
+
+public:
+  /**
+   * @brief Constructor
+   * @details Names from left to right are
+   * - show name
+   * - config file
+   * - path to the node that contains metrics of interest (concatenated with
+   * '.')
+   */
+  SampledTest(const std::string_view config_file)
+      : TestBase<key_len, T>("Sampled", config_file, SP_TEST_PATH) {}
+
+  /**
+   * @brief Test all sketches
+   * @details An overriden method
+   */
+  void runTest() override;
+};
+
+} // namespace OmniSketch::Test
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Test {
+
+template <int32_t key_len, typename T, typename hash_t>
+void SampledTest<key_len, T, hash_t>::runTest() {
+  /**
+   * @brief shorthand for convenience
+   *
+   */
+  using StreamData = Data::StreamData<key_len>;
+  using Ptr = std::unique_ptr<Sketch::SketchBase<key_len, T>>;
+
+  /// Part I.
+  ///   Parse the config file
+  ///
+  /// Step i.  First we list the variables to parse, namely:
+  ///
+  int32_t depth, width;      // sketch config
+  std::vector<double> probs; // sampling config
+  double capacity = 0.0;
+  std::string data_file; // data config
+  toml::array arr;       // shortly we will convert it to format
+  /// Step ii. Open the config file
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed()) {
+    return;
+  }
+  /// Step iii. Set the working node of the parser.
+  parser.setWorkingNode(
+      SP_PARA_PATH); // do not forget to to enclose it with braces
+  /// Step iv. Parse depth, width and probabilities
+  if (!parser.parseConfig(depth, "depth"))
+    return;
+  if (!parser.parseConfig(width, "width"))
+    return;
+  if (!parser.parseConfig(probs, "prob"))
+    return;
+  /// [Optional] Capacity in packets per second, for adaptation
+  parser.parseConfig(capacity, "capacity", false);
+  /// Step v. Move to the data node
+  parser.setWorkingNode(SP_DATA_PATH);
+  /// Step vi. Parse data and format
+  if (!parser.parseConfig(data_file, "data"))
+    return;
+  if (!parser.parseConfig(arr, "format"))
+    return;
+  Data::DataFormat format(arr); // conver from toml::array to Data::DataFormat
+  /// [Optional] User-defined rules
+  ///
+  /// Step vii. Parse Cnt Method.
+  std::string method;
+  Data::CntMethod cnt_method = Data::InLength;
+  if (!parser.parseConfig(method, "cnt_method"))
+    return;
+  if (!method.compare("InPacket")) {
+    cnt_method = Data::InPacket;
+  }
+
+  /// Part II.
+  ///   Prepare data
+  ///
+  StreamData data(data_file, format); // specify both data file and data format
+  if (!data.succeed())
+    return;
+  Data::GndTruth<key_len, T> gnd_truth;
+  gnd_truth.getGroundTruth(data.begin(), data.end(), cnt_method);
+  fmt::print("DataSet: {:d} records with {:d} keys ({})\n", data.size(),
+             gnd_truth.size(), data_file);
+
+  /// Part III.
+  ///   Test each sketch behind each probability
+  ///
+  auto run = [&](const std::string &name, double prob, auto *ptr_sampled) {
+    ptr_sampled->setCapacity(capacity);
+    Ptr ptr(ptr_sampled);
+    TestBase<key_len, T> tester(fmt::format("{} (p = {:g})", name, prob),
+                                config_file, SP_TEST_PATH);
+    tester.testUpdate(ptr, data.begin(), data.end(), cnt_method);
+    tester.testQuery(ptr, gnd_truth);
+    tester.testSize(ptr);
+    tester.show();
+  };
+  for (double prob : probs) {
+    run("Count Min", prob,
+        new Sketch::Sampled<key_len, T, Sketch::CMSketch<key_len, T, hash_t>>(
+            prob, depth, width));
+  }
+  for (double prob : probs) {
+    run("CU Sketch", prob,
+        new Sketch::Sampled<key_len, T, Sketch::CUSketch<key_len, T, hash_t>>(
+            prob, depth, width));
+  }
+  for (double prob : probs) {
+    run("Count Sketch", prob,
+        new Sketch::Sampled<key_len, T,
+                            Sketch::CountSketch<key_len, T, hash_t>>(
+            prob, depth, width));
+  }
+
+  return;
+}
+
+} // namespace OmniSketch::Test
+
+#undef SP_PARA_PATH
+#undef SP_TEST_PATH
+#undef SP_DATA_PATH
+
+// Driver instance:
+//      AUTHOR: XierLabber
+//      CONFIG: sketch_config.toml  # with respect to the `src/` directory
+//    TEMPLATE: <13, int32_t, Hash::AwareHash>
\ No newline at end of file
@@ -0,0 +1,251 @@
+/**
+ * @file SnapshotTest.h
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test snapshot reads of Count Min, Count Sketch, Elastic Sketch and
+ * Heavy Keeper during updates
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/test.h>
+#include <sketch/CMSketch.h>
+#include <sketch/CountSketch.h>
+#include <sketch/ElasticSketch.h>
+#include <sketch/HeavyKeeper.h>
+#include <sketch/Snapshot.h>
+
+#include <atomic>
+#include <thread>
+
+#define SN_PARA_PATH "SN.para"
+#define SN_TEST_PATH "SN.test"
+#define SN_DATA_PATH "SN.data"
+#define SN_CM_PATH "SN.cm"
+#define SN_ES_PATH "SN.es"
+#define SN_HK_PATH "SN.hk"
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Testing class of snapshot reads
+ *
+ * @details Each sketch is first updated alone, which is the baseline. It is
+ * then put behind Sketch::Snapshot and updated again, while a reader thread
+ * keeps reading it: point queries of the flows in the stream for Count Min
+ * and Count Sketch, and heavy hitters for Elastic Sketch and Heavy Keeper.
+ * The update rate shows what the readers cost the ingest thread, and the
+ * number of reads is recorded as `Snapshot.reads`. Once updates are done, the
+ * last view is published and tested as the baseline is.
+ *
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+class SnapshotTest : public TestBase<key_len, T> {
+  using TestBase<key_len, T>::config_file;
+
+public:
+  /**
+   * @brief Constructor
+   * @details Names from left to right are
+   * - show name
+   * - config file
+   * - path to the node that contains metrics of interest (concatenated with
+   * '.')
+   */
+  SnapshotTest(const std::string_view config_file)
+      : TestBase<key_len, T>("Snapshot", config_file, SN_TEST_PATH) {}
+
+  /**
+   * @brief Test all sketches
+   * @details An overriden method
+   */
+  void runTest() override;
+};
+
+} // namespace OmniSketch::Test
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Test {
+
+template <int32_t key_len, typename T, typename hash_t>
+void SnapshotTest<key_len, T, hash_t>::runTest() {
+  /**
+   * @brief shorthand for convenience
+   *
+   */
+  using StreamData = Data::StreamData<key_len>;
+  using Ptr = std::unique_ptr<Sketch::SketchBase<key_len, T>>;
+
+  /// Part I.
+  ///   Parse the config file
+  ///
+  /// Step i.  First we list the variables to parse, namely:
+  ///
+  int32_t epoch;                        // updates between publications
+  int32_t cm_depth, cm_width;           // Count Min and Count Sketch
+  int32_t es_num_buckets, es_num_per_bucket, es_l_depth, es_l_width; // ES
+  int32_t hk_depth, hk_width, hk_num_threshold; // Heavy Keeper
+  double hk_b, hk_alpha;
+  double num_heavy_hitter;
+  std::string data_file; // data config
+  toml::array arr;       // shortly we will convert it to format
+  /// Step ii. Open the config file
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed()) {
+    return;
+  }
+  /// Step iii. Parse the epoch
+  parser.setWorkingNode(SN_PARA_PATH);
+  if (!parser.parseConfig(epoch, "epoch"))
+    return;
+  /// Step iv. Parse each sketch, with the same names as in its own section
+  parser.setWorkingNode(SN_CM_PATH);
+  if (!parser.parseConfig(cm_depth, "depth"))
+    return;
+  if (!parser.parseConfig(cm_width, "width"))
+    return;
+  parser.setWorkingNode(SN_ES_PATH);
+  if (!parser.parseConfig(es_num_buckets, "num_buckets"))
+    return;
+  if (!parser.parseConfig(es_num_per_bucket, "num_per_bucket"))
+    return;
+  if (!parser.parseConfig(es_l_depth, "l_depth"))
+    return;
+  if (!parser.parseConfig(es_l_width, "l_width"))
+    return;
+  parser.setWorkingNode(SN_HK_PATH);
+  if (!parser.parseConfig(hk_depth, "depth"))
+    return;
+  if (!parser.parseConfig(hk_width, "width"))
+    return;
+  if (!parser.parseConfig(hk_num_threshold, "num_threshold"))
+    return;
+  if (!parser.parseConfig(hk_b, "b"))
+    return;
+  if (!parser.parseConfig(hk_alpha, "hash_table_alpha"))
+    return;
+  /// Step v. Move to the data node
+  parser.setWorkingNode(SN_DATA_PATH);
+  /// Step vi. Parse data and format
+  if (!parser.parseConfig(num_heavy_hitter, "threshold_heavy_hitter"))
+    return;
+  if (!parser.parseConfig(data_file, "data"))
+    return;
+  if (!parser.parseConfig(arr, "format"))
+    return;
+  Data::DataFormat format(arr); // conver from toml::array to Data::DataFormat
+  /// [Optional] User-defined rules
+  ///
+  /// Step vii. Parse Cnt Method.
+  std::string method;
+  Data::CntMethod cnt_method = Data::InLength;
+  if (!parser.parseConfig(method, "cnt_method"))
+    return;
+  if (!method.compare("InPacket")) {
+    cnt_method = Data::InPacket;
+  }
+
+  /// Part II.
+  ///   Prepare data
+  ///
+  StreamData data(data_file, format); // specify both data file and data format
+  if (!data.succeed())
+    return;
+  Data::GndTruth<key_len, T> gnd_truth, gnd_truth_heavy_hitters;
+  gnd_truth.getGroundTruth(data.begin(), data.end(), cnt_method);
+  gnd_truth_heavy_hitters.getHeavyHitter(gnd_truth, num_heavy_hitter,
+                                         Data::TopK);
+  const double threshold = gnd_truth_heavy_hitters.min();
+  fmt::print("DataSet: {:d} records with {:d} keys ({})\n", data.size(),
+             gnd_truth.size(), data_file);
+
+  /// Part III.
+  ///   Test each sketch alone and behind snapshots, with a reader
+  ///
+  auto evaluate = [&](TestBase<key_len, T> &tester, Ptr &ptr, bool heavy) {
+    if (heavy)
+      tester.testHeavyHitter(ptr, threshold, gnd_truth_heavy_hitters);
+    else
+      tester.testQuery(ptr, gnd_truth);
+    tester.testSize(ptr);
+    tester.show();
+  };
+  auto run = [&](const std::string &name, Ptr plain, auto *ptr_snapshot,
+                 bool heavy) {
+    {
+      TestBase<key_len, T> tester(name, config_file, SN_TEST_PATH);
+      tester.testUpdate(plain, data.begin(), data.end(), cnt_method);
+      evaluate(tester, plain, heavy);
+    }
+    Ptr ptr(ptr_snapshot);
+    TestBase<key_len, T> tester(
+        fmt::format("{} (snapshot every {} updates)", name, epoch),
+        config_file, SN_TEST_PATH);
+    std::atomic<bool> done(false);
+    int64_t reads = 0;
+    std::thread reader([&]() {
+      for (auto rec = data.begin(); !done.load(std::memory_order_relaxed);
+           ++reads) {
+        if (heavy) {
+          ptr_snapshot->getHeavyHitter(threshold);
+        } else {
+          ptr_snapshot->query(rec->flowkey);
+          if (++rec == data.end())
+            rec = data.begin();
+        }
+      }
+    });
+    tester.testUpdate(ptr, data.begin(), data.end(), cnt_method);
+    done.store(true);
+    reader.join();
+    ptr_snapshot->publish();
+    STATS_SET("Snapshot", "reads", reads);
+    evaluate(tester, ptr, heavy);
+  };
+  run("Count Min",
+      Ptr(new Sketch::CMSketch<key_len, T, hash_t>(cm_depth, cm_width)),
+      new Sketch::Snapshot<key_len, T, Sketch::CMSketch<key_len, T, hash_t>>(
+          epoch, cm_depth, cm_width),
+      false);
+  run("Count Sketch",
+      Ptr(new Sketch::CountSketch<key_len, T, hash_t>(cm_depth, cm_width)),
+      new Sketch::Snapshot<key_len, T,
+                           Sketch::CountSketch<key_len, T, hash_t>>(
+          epoch, cm_depth, cm_width),
+      false);
+  run("Elastic Sketch",
+      Ptr(new Sketch::ElasticSketch<key_len, T, hash_t>(
+          es_num_buckets, es_num_per_bucket, es_l_depth, es_l_width)),
+      new Sketch::Snapshot<key_len, T,
+                           Sketch::ElasticSketch<key_len, T, hash_t>>(
+          epoch, es_num_buckets, es_num_per_bucket, es_l_depth, es_l_width),
+      true);
+  run("Heavy Keeper",
+      Ptr(new Sketch::HeavyKeeper<key_len, T, hash_t>(
+          hk_depth, hk_width, hk_num_threshold, hk_b, hk_alpha)),
+      new Sketch::Snapshot<key_len, T, Sketch::HeavyKeeper<key_len, T, hash_t>>(
+          epoch, hk_depth, hk_width, hk_num_threshold, hk_b, hk_alpha),
+      true);
+
+  return;
+}
+
+} // namespace OmniSketch::Test
+
+#undef SN_PARA_PATH
+#undef SN_TEST_PATH
+#undef SN_DATA_PATH
+#undef SN_CM_PATH
+#undef SN_ES_PATH
+#undef SN_HK_PATH
+
+// Driver instance:
+//      AUTHOR: XierLabber
+//      CONFIG: sketch_config.toml  # with respect to the `src/` directory
+//    TEMPLATE: <13, int32_t, Hash::AwareHash>
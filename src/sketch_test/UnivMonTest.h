@@ -83,6 +83,9 @@ void UnivMonTest<key_len, T, hash_t>::runTest() {
     return;
   if (!parser.parseConfig(width, "width"))
     return;
+  /// [Optional] Sample levels by a single hash and share row hashes
+  bool shared_hash = false;
+  parser.parseConfig(shared_hash, "shared_hash", false);
   /// Step v. Move to the data node
   parser.setWorkingNode(UM_DATA_PATH);
   /// Step vi. Parse data and format
@@ -114,7 +117,8 @@ void UnivMonTest<key_len, T, hash_t>::runTest() {
   OmniSketch::Hash::AwareHash(1);
   std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
       new Sketch::UnivMon<key_len, T, hash_t>(
-          depth, width, static_cast<int32_t>(std::log2(gnd_truth.size()))));
+          depth, width, static_cast<int32_t>(std::log2(gnd_truth.size())),
+          shared_hash));
   /// remember that the left ptr must point to the base class in order to call
   /// the methods in it
 
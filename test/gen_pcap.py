@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Generate the small pcap files read by test_parser.cpp
+
+Usage: python3 gen_pcap.py parser_eth.pcap eth
+       python3 gen_pcap.py parser_sll.pcap sll
+
+Packets are TCP and UDP over IPv4 for the most part, mixed with what the fast
+header parser has to skip or leave to PcapPlusPlus: 802.1Q tags, fragments,
+ICMP errors, IP-in-IP, GRE, VXLAN, GTP, AH, bad lengths, truncated captures,
+ARP, IPv6 and unknown EtherTypes. The same arguments give the same file.
+"""
+import random
+import struct
+import sys
+
+NUM_PACKETS = 600
+NUM_FLOWS = 40
+
+
+def ip4(proto, payload, src, dst, frag=0, ihl=5, total=None):
+    opts = b'\x01' * ((ihl - 5) * 4)
+    total = 20 + len(opts) + len(payload) if total is None else total
+    return struct.pack('!BBHHHBBH4s4s', 0x40 | ihl, 0, total, 1, frag, 64,
+                       proto, 0, src, dst) + opts + payload
+
+
+def tcp(sport, dport, doff=5, data=b'x' * 10):
+    return struct.pack('!HHIIBBHHH', sport, dport, 1, 0, doff << 4, 0x10,
+                       1000, 0, 0) + b'\0' * max(0, (doff - 5) * 4) + data
+
+
+def udp(sport, dport, data=b'y' * 12):
+    return struct.pack('!HHHH', sport, dport, 8 + len(data), 0) + data
+
+
+def eth(ether_type, payload, vlan=False):
+    header = b'\xaa' * 6 + b'\xbb' * 6
+    if vlan:
+        header += struct.pack('!HH', 0x8100, 7)
+    return header + struct.pack('!H', ether_type) + payload
+
+
+def datagram(flow, rng):
+    src, dst, sport, dport = flow
+    kind = rng.random()
+    if kind < 0.35:
+        return ip4(6, tcp(sport, dport, rng.choice([5, 5, 8])), src, dst,
+                   ihl=rng.choice([5, 5, 6]))
+    if kind < 0.50:
+        return ip4(17, udp(sport, dport), src, dst)
+    if kind < 0.53:  # first fragment
+        return ip4(6, tcp(sport, dport), src, dst, frag=0x2000)
+    if kind < 0.56:  # later fragment
+        return ip4(6, b'z' * 30, src, dst, frag=0x0010)
+    if kind < 0.58:  # echo request
+        return ip4(1, b'\x08\0\0\0\0\0\0\0', src, dst)
+    if kind < 0.62:  # port unreachable, quoting the datagram
+        quoted = ip4(17, udp(dport, sport), dst, src)[:28]
+        return ip4(1, b'\x03\x03\0\0\0\0\0\0' + quoted, src, dst)
+    if kind < 0.65:  # IP in IP
+        return ip4(4, ip4(6, tcp(sport, dport), dst, src), src, dst)
+    if kind < 0.68:  # GRE
+        inner = ip4(17, udp(sport, dport), dst, src)
+        return ip4(47, b'\0\0\x08\0' + inner, src, dst)
+    if kind < 0.73:  # VXLAN
+        inner = eth(0x0800, ip4(6, tcp(dport, sport), dst, src))
+        return ip4(17, udp(sport, 4789, b'\x08\0\0\0\0\0\x01\0' + inner), src,
+                   dst)
+    if kind < 0.75:  # GTP-U
+        inner = ip4(17, udp(dport, sport), dst, src)
+        gtp = struct.pack('!BBHI', 0x30, 0xff, len(inner), 1) + inner
+        return ip4(17, udp(sport, 2152, gtp), src, dst)
+    if kind < 0.77:  # TCP header too short
+        return ip4(6, tcp(sport, dport, 3), src, dst)
+    if kind < 0.79:  # OSPF
+        return ip4(89, b'o' * 40, src, dst)
+    if kind < 0.81:  # total length of 0
+        return ip4(6, tcp(sport, dport), src, dst, total=0)
+    if kind < 0.83:  # total length shorter than captured
+        return ip4(17, udp(sport, dport), src, dst, total=30)
+    if kind < 0.85:  # AH
+        return ip4(51, bytes([6, 1]) + b'\0' * 10 + tcp(sport, dport), src,
+                   dst)
+    return ip4(6, tcp(sport, dport, 5, b'q' * rng.randrange(0, 200)), src,
+               dst)
+
+
+def main():
+    path, link = sys.argv[1], sys.argv[2]
+    link_type = {'eth': 1, 'sll': 113}[link]
+    rng = random.Random(link)
+    flows = [(bytes([10, 0, rng.randrange(256), rng.randrange(256)]),
+              bytes([192, 168, rng.randrange(256), 1]),
+              rng.randrange(1, 65536), rng.choice([80, 443, 53, 1234]))
+             for _ in range(NUM_FLOWS)]
+    with open(path, 'wb') as out:
+        out.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535,
+                              link_type))
+        ts = 1600000000 * 10**6
+        for _ in range(NUM_PACKETS):
+            flow = flows[min(int(rng.paretovariate(1.0)) - 1, NUM_FLOWS - 1)]
+            ip = datagram(flow, rng)
+            other = rng.random()
+            if link_type == 1:
+                if other < 0.04:
+                    pkt = eth(0x0806, b'a' * 28)
+                elif other < 0.07:
+                    ipv6 = struct.pack('!IHBB', 0x60000000, 30, 6, 64)
+                    pkt = eth(0x86dd, ipv6 + b'\0' * 32 + tcp(1, 2))
+                elif other < 0.08:
+                    pkt = eth(100, b'l' * 100)
+                elif other < 0.25:
+                    pkt = eth(0x0800, ip, vlan=True)
+                else:
+                    pkt = eth(0x0800, ip)
+            else:
+                ether_type = 0x0806 if other < 0.04 else 0x0800
+                pkt = b'\0' * 14 + struct.pack('!H', ether_type) + ip
+            wire = len(pkt)
+            if rng.random() < 0.05:  # cut by the snapshot length
+                pkt = pkt[:rng.randrange(1, len(pkt) + 1)]
+            ts += rng.randrange(0, 2000)
+            out.write(struct.pack('<IIII', ts // 10**6, ts % 10**6, len(pkt),
+                                  wire) + pkt)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,62 @@
+/**
+ * @file test_arena.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test the slab arena
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <common/arena.h>
+#include <set>
+
+/**
+ * @cond TEST
+ * @brief Test that slabs are disjoint, reset and recycled
+ *
+ */
+void TestSlabArena() {
+  using namespace OmniSketch::Util;
+
+  SlabArena<int64_t> arena;
+  std::set<std::pair<int64_t *, int64_t *>> live;
+  for (int32_t round = 0; round < 3; ++round) {
+    for (int32_t bits = 0; bits < 18; bits += 3) {
+      int64_t *slab = arena.allocate(bits);
+      const int32_t n = 1 << bits;
+      for (int32_t i = 0; i < n; ++i) {
+        VERIFY(slab[i] == 0);
+        slab[i] = i + 1;
+      }
+      // no overlap with any live slab
+      auto it = live.lower_bound({slab, slab});
+      VERIFY(it == live.end() || it->first >= slab + n);
+      VERIFY(it == live.begin() || std::prev(it)->second <= slab);
+      live.emplace(slab, slab + n);
+    }
+  }
+  VERIFY(arena.bytesUsed() <= arena.bytesReserved());
+
+  // a released slab serves the next request of its size
+  int64_t *slab = arena.allocate(5);
+  const size_t used = arena.bytesUsed();
+  const size_t reserved = arena.bytesReserved();
+  arena.release(slab, 5);
+  VERIFY(arena.bytesUsed() == used - 32 * sizeof(int64_t));
+  VERIFY(arena.allocate(5) == slab);
+  VERIFY(arena.bytesUsed() == used && arena.bytesReserved() == reserved);
+
+  arena.reset();
+  VERIFY(arena.bytesUsed() == 0 && arena.bytesReserved() == 0);
+}
+
+/**
+ * @brief Slab arena test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(arena) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestSlabArena();
+  }
+}
+/** @endcond */
@@ -0,0 +1,103 @@
+/**
+ * @file test_blocked.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test cache-line-blocked counters
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <common/blocked.h>
+#include <random>
+
+/**
+ * @cond TEST
+ * @brief Test BlockedCounter::locate()
+ *
+ */
+void TestLocate() {
+  using OmniSketch::Sketch::BlockedCounter;
+
+  std::mt19937_64 rng(1);
+  for (int32_t depth : {1, 3, 4, 5, 8}) {
+    BlockedCounter<int32_t, int16_t> counter(depth, 1000, true);
+    const int32_t slots = BlockedCounter<int32_t, int16_t>::slots;
+    const int32_t per_row = slots / depth;
+    size_t index[8];
+    int32_t sign[8];
+    for (int32_t t = 0; t < 1000; ++t) {
+      counter.locate(rng(), index, sign);
+      const size_t block = index[0] / slots;
+      VERIFY(block < 1000);
+      for (int32_t i = 0; i < depth; ++i) {
+        // all rows in one block, each in its own range
+        VERIFY(index[i] / slots == block);
+        VERIFY(static_cast<int32_t>(index[i] % slots) / per_row == i);
+        VERIFY(sign[i] == 1 || sign[i] == -1);
+      }
+    }
+  }
+
+  // not enough room or bits
+  try {
+    BlockedCounter<int32_t, int16_t> counter(33, 10, false);
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+  try {
+    BlockedCounter<int32_t, int8_t> counter(16, 10, true);
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+}
+
+/**
+ * @brief Test escalation of narrow sub-counters
+ *
+ */
+void TestEscalation() {
+  using OmniSketch::Sketch::BlockedCounter;
+
+  try {
+    BlockedCounter<int32_t, int8_t> counter(4, 10, false);
+    const size_t base = counter.size();
+    for (int32_t i = 0; i < 1000; ++i) {
+      counter.add(3, 1);
+      counter.add(5, -1);
+    }
+    VERIFY(counter.get(3) == 1000);
+    VERIFY(counter.get(5) == -1000);
+    VERIFY(counter.get(4) == 0);
+    VERIFY(counter.getOverflowNum() == 2);
+    VERIFY(counter.size() > base);
+    // back into range
+    counter.set(3, 7);
+    VERIFY(counter.get(3) == 7);
+    VERIFY(counter.getOverflowNum() == 1);
+    // the boundary value itself
+    counter.set(4, 127);
+    VERIFY(counter.get(4) == 127);
+    counter.add(4, 1);
+    VERIFY(counter.get(4) == 128);
+
+    counter.clear();
+    VERIFY(counter.get(5) == 0 && counter.getOverflowNum() == 0);
+    VERIFY(counter.size() == base);
+  } catch (const std::exception &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+}
+
+/**
+ * @brief Blocked counter test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(blocked) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestLocate();
+    TestEscalation();
+  }
+}
+/** @endcond */
@@ -0,0 +1,171 @@
+/**
+ * @file test_budget.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test sizing sketches by a memory budget
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <common/budget.h>
+#include <sketch/BloomFilter.h>
+#include <sketch/CHCMSketch.h>
+#include <sketch/CHCUSketch.h>
+#include <sketch/CHCountSketch.h>
+#include <sketch/CMSketch.h>
+#include <sketch/CountSketch.h>
+#include <sketch/HashPipe.h>
+
+/**
+ * @cond TEST
+ * @brief Test ParseMemory()
+ *
+ */
+void TestParseMemory() {
+  using OmniSketch::Util::ParseMemory;
+
+  try {
+    VERIFY(ParseMemory("65536") == 65536);
+    VERIFY(ParseMemory("100B") == 100);
+    VERIFY(ParseMemory("512kB") == 512 * 1024);
+    VERIFY(ParseMemory("512KB") == 512 * 1024);
+    VERIFY(ParseMemory("1.5MB") == 1536 * 1024);
+    VERIFY(ParseMemory(" 2 mb ") == 2 * 1024 * 1024);
+    VERIFY(ParseMemory("1GB") == 1024 * 1024 * 1024);
+    VERIFY(ParseMemory("1.9") == 1);
+  } catch (const std::exception &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+
+  for (const char *str : {"", "MB", "1.5TB", "-1MB", "0", "0.5", "1.5 M B!"}) {
+    try {
+      ParseMemory(str);
+      SET_FAILURE_FLAG;
+    } catch (const std::invalid_argument &exp) {
+      VERIFY_EXCEPTION(exp);
+    }
+  }
+}
+
+/**
+ * @brief Check that `width` is the largest one within the budget
+ *
+ */
+template <typename Sketch, typename... Args>
+void VerifyTight(size_t budget, int32_t width, Args... args) {
+  Sketch fit(args..., width);
+  Sketch over(args..., width + 1);
+  VERIFY(fit.size() <= budget);
+  VERIFY(over.size() > budget || over.size() == fit.size());
+}
+
+/**
+ * @brief Test the solvers of sketches
+ *
+ */
+template <typename index_t> void TestSolve() {
+  using namespace OmniSketch::Sketch;
+  using CM = CMSketch<13, int32_t, OmniSketch::Hash::AwareHash, index_t>;
+  using CS = CountSketch<13, int32_t, OmniSketch::Hash::AwareHash, index_t>;
+  using BF = BloomFilter<13, OmniSketch::Hash::AwareHash, index_t>;
+  using HP = HashPipe<13, int32_t>;
+
+  for (size_t budget : {4096, 10000, 65536, 1536 * 1024}) {
+    for (int32_t depth : {1, 3, 5}) {
+      try {
+        VerifyTight<CM>(budget, CM::solveWidth(depth, budget), depth);
+        VerifyTight<CS>(budget, CS::solveWidth(depth, budget), depth);
+        VerifyTight<HP>(budget, HP::solveWidth(depth, budget), depth);
+      } catch (const std::exception &exp) {
+        VERIFY_NO_EXCEPTION(exp);
+      }
+    }
+    try {
+      const int32_t num_bits = BF::solveBits(3, budget);
+      BF fit(num_bits, 3), over(num_bits + 1, 3);
+      VERIFY(fit.size() <= budget);
+      VERIFY(over.size() > budget || over.size() == fit.size());
+    } catch (const std::exception &exp) {
+      VERIFY_NO_EXCEPTION(exp);
+    }
+  }
+
+  // too small for even a width of 1
+  try {
+    CM::solveWidth(5, sizeof(CM));
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+}
+
+/**
+ * @brief Test the solvers of sketches with a counter hierarchy, with the
+ * parameters in the config
+ *
+ */
+void TestSolveCH() {
+  using namespace OmniSketch::Sketch;
+  using CHCM = CHCMSketch<13, 2, int32_t, OmniSketch::Hash::AwareHash>;
+  using CHCU = CHCUSketch<13, 2, int32_t, OmniSketch::Hash::AwareHash>;
+  using CHCS = CHCountSketch<13, 2, int32_t, OmniSketch::Hash::AwareHash>;
+  const double ratio = 0.9;
+  const std::vector<size_t> width_cnt = {4, 14}, no_hash = {3};
+
+  for (size_t budget : {65536, 1536 * 1024}) {
+    try {
+      int32_t width = CHCM::solveWidth(5, ratio, width_cnt, no_hash, budget);
+      CHCM cm_fit(5, width, ratio, width_cnt, no_hash);
+      CHCM cm_over(5, width + 1, ratio, width_cnt, no_hash);
+      VERIFY(cm_fit.size() <= budget);
+      VERIFY(cm_over.size() > budget || cm_over.size() == cm_fit.size());
+
+      width = CHCS::solveWidth(5, ratio, width_cnt, no_hash, budget);
+      CHCS cs_fit(5, width, ratio, width_cnt, no_hash);
+      CHCS cs_over(5, width + 1, ratio, width_cnt, no_hash);
+      VERIFY(cs_fit.size() <= budget);
+      VERIFY(cs_over.size() > budget || cs_over.size() == cs_fit.size());
+
+      width = CHCU::solveWidth(5, ratio, width_cnt, no_hash, 4, 500, budget);
+      CHCU cu_fit(5, width, ratio, width_cnt, no_hash, 4, 500);
+      CHCU cu_over(5, width + 1, ratio, width_cnt, no_hash, 4, 500);
+      VERIFY(cu_fit.size() <= budget);
+      VERIFY(cu_over.size() > budget || cu_over.size() == cu_fit.size());
+    } catch (const std::exception &exp) {
+      VERIFY_NO_EXCEPTION(exp);
+    }
+  }
+
+  // so large a budget that counters would outnumber int32_t
+  const size_t huge = size_t(1) << 40;
+  try {
+    for (int32_t depth : {1, 5}) {
+      const int32_t widths[] = {
+          CHCM::solveWidth(depth, ratio, width_cnt, no_hash, huge),
+          CHCS::solveWidth(depth, ratio, width_cnt, no_hash, huge),
+          CHCU::solveWidth(depth, ratio, width_cnt, no_hash, 4, 500, huge)};
+      for (int32_t width : widths) {
+        VERIFY(width > 1);
+        VERIFY(int64_t(depth) * OmniSketch::Util::NextPrime(width) <=
+               std::numeric_limits<int32_t>::max());
+      }
+    }
+  } catch (const std::exception &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+}
+
+/**
+ * @brief Memory budget test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(budget) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestParseMemory();
+    TestSolveCH();
+    TestSolve<OmniSketch::Index::Mod>();
+    TestSolve<OmniSketch::Index::FastRange>();
+    TestSolve<OmniSketch::Index::Pow2>();
+  }
+}
+/** @endcond */
@@ -0,0 +1,123 @@
+/**
+ * @file test_concurrent.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test sketches shared by concurrent threads
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <random>
+#include <sketch/BloomFilter.h>
+#include <sketch/CMSketch.h>
+#include <sketch/ConcurrentBloomFilter.h>
+#include <sketch/ConcurrentCMSketch.h>
+#include <sketch/ConcurrentCountSketch.h>
+#include <sketch/CountSketch.h>
+#include <thread>
+#include <vector>
+
+/**
+ * @cond TEST
+ * @brief Update `sketch` from 8 threads, each with every 8th record
+ *
+ */
+template <typename Sketch, typename Op>
+void RunThreads(Sketch &sketch, const std::vector<OmniSketch::FlowKey<4>> &keys,
+                Op op) {
+  const int32_t num_threads = 8;
+  std::vector<std::thread> threads;
+  for (int32_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (size_t i = t; i < keys.size(); i += num_threads)
+        op(sketch, keys[i], static_cast<int32_t>(i % 7 + 1));
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+}
+
+/**
+ * @brief Test that concurrent sketches end up as the plain ones, updated from
+ * a single thread, and thus lose no update
+ *
+ */
+void TestSketch() {
+  using namespace OmniSketch;
+  std::vector<FlowKey<4>> keys;
+  std::mt19937 rng(1);
+  for (int32_t t = 0; t < 400000; ++t)
+    keys.emplace_back(static_cast<int32_t>(std::min(rng() % 5000, rng() % 5000)));
+
+  // a narrow sketch, so that threads keep colliding on counters
+  Hash::AwareHash(1);
+  Sketch::CMSketch<4, int32_t> cm(3, 100);
+  Hash::AwareHash(1);
+  Sketch::ConcurrentCMSketch<4, int32_t> ccm(3, 100);
+  Hash::AwareHash(1);
+  Sketch::CountSketch<4, int32_t> cs(3, 100);
+  Hash::AwareHash(1);
+  Sketch::ConcurrentCountSketch<4, int32_t> ccs(3, 100);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    cm.update(keys[i], i % 7 + 1);
+    cs.update(keys[i], i % 7 + 1);
+  }
+  auto update = [](auto &sketch, const FlowKey<4> &key, int32_t val) {
+    sketch.update(key, val);
+  };
+  RunThreads(ccm, keys, update);
+  RunThreads(ccs, keys, update);
+  for (int32_t key = 0; key < 5000; ++key) {
+    VERIFY(ccm.query(FlowKey<4>(key)) == cm.query(FlowKey<4>(key)));
+    VERIFY(ccs.query(FlowKey<4>(key)) == cs.query(FlowKey<4>(key)));
+  }
+  VERIFY(ccm.size() >= sizeof(int32_t) * 3 * 100);
+
+  ccm.clear();
+  ccs.clear();
+  for (int32_t key = 0; key < 5000; ++key) {
+    VERIFY(ccm.query(FlowKey<4>(key)) == 0);
+    VERIFY(ccs.query(FlowKey<4>(key)) == 0);
+  }
+}
+
+/**
+ * @brief Test that concurrent inserts set the same bits
+ *
+ */
+void TestBloomFilter() {
+  using namespace OmniSketch;
+  std::vector<FlowKey<4>> keys;
+  for (int32_t key = 0; key < 20000; key += 2)
+    keys.emplace_back(key);
+
+  Hash::AwareHash(1);
+  Sketch::BloomFilter<4> bf(4000, 3);
+  Hash::AwareHash(1);
+  Sketch::ConcurrentBloomFilter<4> cbf(4000, 3);
+  for (const auto &key : keys)
+    bf.insert(key);
+  RunThreads(cbf, keys, [](auto &filter, const FlowKey<4> &key, int32_t) {
+    filter.insert(key);
+  });
+  for (int32_t key = 0; key < 20000; ++key)
+    VERIFY(cbf.lookup(FlowKey<4>(key)) == bf.lookup(FlowKey<4>(key)));
+  for (const auto &key : keys)
+    VERIFY(cbf.lookup(key));
+
+  cbf.clear();
+  for (const auto &key : keys)
+    VERIFY(!cbf.lookup(key));
+}
+
+/**
+ * @brief Concurrent sketch test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(concurrent) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestSketch();
+    TestBloomFilter();
+  }
+}
+/** @endcond */
@@ -838,6 +838,67 @@ void TestMovable() {
   counter++;
 }
 
+/**
+ * @brief Test that records and flow summaries are shared once turned on
+ *
+ */
+void TestShareData() {
+  using std::string_view_literals::operator""sv;
+  using namespace OmniSketch::Data;
+
+  try {
+    static constexpr std::string_view input = R"(
+        name = [["flowkey", "length"], [4, 2]]
+    )"sv;
+    toml::table array = toml::parse(input);
+    DataFormat format(*array["name"].as_array());
+
+    char name[L_tmpnam];
+    std::tmpnam(name);
+    char content[600];
+    for (int i = 0; i < 100; ++i) {
+      *reinterpret_cast<int32_t *>(content + 6 * i) = i % 7 + (i % 3) * 100;
+      *reinterpret_cast<int16_t *>(content + 6 * i + 4) = 40 + i;
+    }
+    std::ofstream fout(name, std::ios::binary);
+    fout.write(content, sizeof(content));
+    fout.close();
+
+    ShareData() = true;
+    StreamData<4> data_1(name, format);
+    std::remove(name);
+    // read from memory
+    StreamData<4> data_2(name, format);
+    VERIFY(data_1.succeed() && data_2.succeed());
+    VERIFY(data_2.size() == 100 && &*data_1.begin() == &*data_2.begin());
+
+    GndTruth<4, int64_t> gnd_truth_1, gnd_truth_2, heavy_1, heavy_2;
+    gnd_truth_1.getGroundTruth(data_1.begin(), data_1.end(), InLength);
+    gnd_truth_2.getGroundTruth(data_2.begin(), data_2.end(), InLength);
+    VERIFY(gnd_truth_1.size() == gnd_truth_2.size());
+    VERIFY(gnd_truth_1.totalValue() == gnd_truth_2.totalValue());
+    for (auto p = gnd_truth_1.begin(), q = gnd_truth_2.begin();
+         p != gnd_truth_1.end(); ++p, ++q) {
+      VERIFY(p->get_left() == q->get_left());
+      VERIFY(p->get_right() == q->get_right());
+    }
+    heavy_1.getHeavyHitter(gnd_truth_1, 5, TopK);
+    heavy_2.getHeavyHitter(data_2.begin(), data_2.end(), InLength, 5, TopK);
+    VERIFY(heavy_1.size() == 5 && heavy_2.size() == 5);
+    for (auto p = heavy_1.begin(), q = heavy_2.begin(); p != heavy_1.end();
+         ++p, ++q) {
+      VERIFY(p->get_left() == q->get_left());
+    }
+
+    ShareData() = false;
+    StreamData<4> data_3(name, format);
+    VERIFY(!data_3.succeed() && data_3.empty());
+  } catch (const std::exception &exp) {
+    ShareData() = false;
+    VERIFY_NO_EXCEPTION(exp);
+  }
+}
+
 OMNISKETCH_DECLARE_TEST(data) {
   for (int i = 0; i < g_repeat; i++) {
     TestDataFormat();
@@ -847,6 +908,7 @@ OMNISKETCH_DECLARE_TEST(data) {
     TestHeavyChanger();
     TestEstimation();
     TestMovable();
+    TestShareData();
   }
 }
 
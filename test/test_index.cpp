@@ -0,0 +1,121 @@
+/**
+ * @file test_index.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test indexing policies
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <common/hash.h>
+#include <common/index.h>
+#include <random>
+#include <set>
+#include <type_traits>
+
+/**
+ * @cond TEST
+ * @brief Test that every policy stays in range and Reciprocal matches Mod
+ *
+ */
+void TestReduce() {
+  using namespace OmniSketch::Index;
+
+  std::mt19937_64 rng(1);
+  for (int32_t width : {1, 2, 3, 100, 1000, 31497, 114970, 2577607}) {
+    const int32_t prime = Mod::roundWidth(width);
+    const int32_t pow2 = Pow2::roundWidth(width);
+    VERIFY(Reciprocal::roundWidth(width) == prime);
+    VERIFY(FastRange::roundWidth(width) == width);
+    VERIFY(pow2 <= width && 2 * pow2 > width && !(pow2 & (pow2 - 1)));
+
+    Mod mod(prime);
+    Reciprocal reciprocal(prime);
+    FastRange fastrange(width);
+    Pow2 pow(pow2);
+    for (int32_t t = 0; t < 10000; ++t) {
+      const uint64_t hash = rng();
+      VERIFY(reciprocal(hash) == mod(hash));
+      VERIFY(fastrange(hash) >= 0 && fastrange(hash) < width);
+      VERIFY(pow(hash) >= 0 && pow(hash) < pow2);
+    }
+    // extremes
+    for (uint64_t hash : {0ULL, 1ULL, ~0ULL, ~0ULL - 1, 1ULL << 63}) {
+      VERIFY(reciprocal(hash) == mod(hash));
+      VERIFY(fastrange(hash) < width && pow(hash) < pow2);
+    }
+  }
+}
+
+/**
+ * @brief Test that keys differing only in the last byte spread over buckets
+ *
+ */
+void TestLastByte() {
+  using namespace OmniSketch;
+  using namespace OmniSketch::Index;
+
+  constexpr int32_t width = 1000;
+  const int32_t pow2 = Pow2::roundWidth(width);
+  FastRange fastrange(width);
+  Pow2 pow(pow2);
+  for (int32_t row = 0; row < 4; ++row) {
+    Hash::AwareHash hash;
+    std::set<int32_t> fastrange_buckets, pow2_buckets;
+    uint8_t key[4] = {10, 0, 0, 0};
+    for (int32_t last = 0; last < 256; ++last) {
+      key[3] = static_cast<uint8_t>(last);
+      const uint64_t value = hash(key, 4);
+      fastrange_buckets.insert(fastrange(value));
+      pow2_buckets.insert(pow(value));
+    }
+    // about 226 and 202 distinct buckets are expected, and 1 without Mix()
+    VERIFY(fastrange_buckets.size() > 160);
+    VERIFY(pow2_buckets.size() > 160);
+  }
+}
+
+/**
+ * @brief Test Dispatch()
+ *
+ */
+void TestDispatch() {
+  using namespace OmniSketch::Index;
+
+  try {
+    VERIFY(Dispatch("mod", [](auto policy) {
+      return std::is_same_v<decltype(policy), Mod>;
+    }));
+    VERIFY(Dispatch("reciprocal", [](auto policy) {
+      return std::is_same_v<decltype(policy), Reciprocal>;
+    }));
+    VERIFY(Dispatch("fastrange", [](auto policy) {
+      return std::is_same_v<decltype(policy), FastRange>;
+    }));
+    VERIFY(Dispatch("pow2", [](auto policy) {
+      return std::is_same_v<decltype(policy), Pow2>;
+    }));
+  } catch (const std::exception &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+
+  try {
+    Dispatch("div", [](auto) { return 0; });
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+}
+
+/**
+ * @brief Indexing policy test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(index) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestReduce();
+    TestLastByte();
+    TestDispatch();
+  }
+}
+/** @endcond */
@@ -0,0 +1,74 @@
+/**
+ * @file test_interleave.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test interleaved execution
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <common/interleave.h>
+#include <vector>
+
+/**
+ * @cond TEST
+ * @brief Test that every job runs all its steps and that the `s`-th steps of
+ * jobs take place in job order
+ *
+ */
+void TestInterleave() {
+  using namespace OmniSketch::Util;
+
+  struct Machine {
+    std::vector<int32_t> steps;       // steps of each job
+    std::vector<int32_t> job, done;   // per slot
+    std::vector<int32_t> finished;    // steps run by each job
+    std::vector<std::vector<int32_t>> order; // jobs in order of each step
+
+    void run(int32_t slot) {
+      const int32_t s = done[slot]++;
+      if (order.size() <= static_cast<size_t>(s))
+        order.resize(s + 1);
+      order[s].push_back(job[slot]);
+      finished[job[slot]]++;
+    }
+    void start(int32_t slot, int32_t j) {
+      job[slot] = j;
+      done[slot] = 0;
+      run(slot);
+    }
+    bool resume(int32_t slot) {
+      run(slot);
+      return done[slot] < steps[job[slot]];
+    }
+  };
+
+  for (int32_t width : {1, 2, 3, 8, 64}) {
+    for (int32_t n : {0, 1, 5, 100}) {
+      Machine m;
+      for (int32_t i = 0; i < n; ++i)
+        m.steps.push_back(2 + (i * 7) % 5);
+      m.job.resize(width);
+      m.done.resize(width);
+      m.finished.resize(n);
+      Interleave(m, n, width);
+      for (int32_t i = 0; i < n; ++i)
+        VERIFY(m.finished[i] == m.steps[i]);
+      for (const auto &jobs : m.order) {
+        for (size_t k = 1; k < jobs.size(); ++k)
+          VERIFY(jobs[k - 1] < jobs[k]);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Interleaved execution test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(interleave) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestInterleave();
+  }
+}
+/** @endcond */
@@ -0,0 +1,65 @@
+/**
+ * @file test_levels.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test level sampling
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <common/hash.h>
+#include <common/levels.h>
+#include <random>
+#include <vector>
+
+/**
+ * @cond TEST
+ * @brief Test that levels are geometric and level hashes deterministic
+ *
+ */
+void TestLevelSampler() {
+  using namespace OmniSketch;
+
+  try {
+    Sketch::LevelSampler<4, Hash::AwareHash> bad(0, 16);
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+
+  const int32_t depth = 3, logn = 8, n = 1 << 16;
+  Sketch::LevelSampler<4, Hash::AwareHash> sampler(depth, logn);
+  std::mt19937 rng(1);
+  std::vector<int32_t> cnt(logn + 1);
+  for (int32_t t = 0; t < n; ++t) {
+    FlowKey<4> key(static_cast<int32_t>(rng()));
+    const int32_t levels = sampler.numLevels(key);
+    VERIFY(levels >= 1 && levels <= logn);
+    VERIFY(levels == sampler.numLevels(key));
+    cnt[levels]++;
+
+    uint64_t rows[depth], a[depth], b[depth];
+    sampler.hashRows(key, rows);
+    sampler.atLevel(rows, 0, a);
+    sampler.atLevel(rows, 0, b);
+    for (int32_t r = 0; r < depth; ++r)
+      VERIFY(a[r] == b[r]);
+    sampler.atLevel(rows, 1, b);
+    VERIFY(a[0] != b[0] || a[1] != b[1] || a[2] != b[2]);
+  }
+  // about half of the keys stop at each level
+  for (int32_t l = 1; l < 4; ++l) {
+    VERIFY(std::abs(cnt[l] - (n >> l)) < (n >> l) / 10);
+  }
+}
+
+/**
+ * @brief Level sampling test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(levels) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestLevelSampler();
+  }
+}
+/** @endcond */
@@ -0,0 +1,163 @@
+/**
+ * @file test_parser.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test the pcap parser, with or without PcapPlusPlus layers
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <fmt/format.h>
+#include <pcap_parser/parser.h>
+#include <sketch/CMSketch.h>
+#include <unordered_set>
+
+/**
+ * @cond TEST
+ * @brief Records of a pcap file, parsed as `options` (in TOML) say
+ *
+ */
+std::vector<OmniSketch::Data::Record<13>> Parse(const std::string &options) {
+  using namespace OmniSketch;
+  Util::ConfigParser::overrides() = toml::parse("[parser]\n" + options);
+  Util::PcapParser<13> pcap_parser("test_parser.toml");
+  Util::ConfigParser::overrides() = toml::table{};
+  VERIFY(pcap_parser.succeed());
+
+  std::vector<Data::Record<13>> records;
+  const int32_t count = pcap_parser.parsePcapPackets(
+      [&records](const std::vector<Data::Record<13>> &batch) {
+        VERIFY(!batch.empty() && batch.size() <= 64);
+        records.insert(records.end(), batch.begin(), batch.end());
+      });
+  VERIFY(count == static_cast<int32_t>(records.size()));
+  return records;
+}
+
+/**
+ * @brief Whether records are the same, one by one
+ *
+ */
+bool Same(const std::vector<OmniSketch::Data::Record<13>> &a,
+          const std::vector<OmniSketch::Data::Record<13>> &b) {
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (!(a[i].flowkey == b[i].flowkey) || a[i].timestamp != b[i].timestamp ||
+        a[i].length != b[i].length)
+      return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Test parsing headers from the bytes against PcapPlusPlus layers, on
+ * Ethernet (with 802.1Q tags) and Linux cooked captures of TCP and UDP mixed
+ * with fragments, ICMP errors, tunnels such as VXLAN and truncated packets
+ *
+ */
+void TestFast() {
+  for (const char *input : {"parser_eth.pcap", "parser_sll.pcap"}) {
+    const auto input_option = fmt::format("input = \"{}\"\n", input);
+    const auto layers = Parse(input_option + "fast = false\n");
+    const auto fast = Parse(input_option + "fast = true\n");
+    VERIFY(!layers.empty());
+    VERIFY(Same(layers, fast));
+  }
+}
+
+/**
+ * @brief Test updating a sketch straight from the packets
+ *
+ */
+void TestSketch() {
+  using namespace OmniSketch;
+  const auto records = Parse("fast = true\n");
+  Hash::AwareHash(1);
+  Sketch::CMSketch<13, int32_t> expected(3, 1000);
+  for (const auto &record : records)
+    expected.update(record.flowkey, record.length);
+
+  // no output is needed
+  Util::ConfigParser::overrides() =
+      toml::parse("[parser]\nmode = \"sketch\"\nfast = true\n");
+  Util::PcapParser<13> pcap_parser("test_parser.toml");
+  Util::ConfigParser::overrides() = toml::table{};
+  VERIFY(pcap_parser.succeed() && pcap_parser.toSketch());
+  Hash::AwareHash(1);
+  Sketch::CMSketch<13, int32_t> sketch(3, 1000);
+  VERIFY(pcap_parser.updateSketch(sketch, Data::InLength, 4) ==
+         static_cast<int32_t>(records.size()));
+  for (const auto &record : records)
+    VERIFY(sketch.query(record.flowkey) == expected.query(record.flowkey));
+}
+
+/**
+ * @brief Test parsing in parallel against parsing in the calling thread, with
+ * and without limits on packets and flows
+ *
+ */
+void TestParallel() {
+  for (const char *input : {"parser_eth.pcap", "parser_sll.pcap"}) {
+    for (const char *limit :
+         {"", "packet_count = 100\n", "flow_count = 10\n",
+          "packet_count = 0\n"}) {
+      const auto options =
+          fmt::format("input = \"{}\"\nfast = true\n{}", input, limit);
+      const auto serial = Parse(options + "threads = 0\n");
+      for (int32_t threads : {1, 3}) {
+        VERIFY(Same(serial,
+                    Parse(options + fmt::format("threads = {}\n", threads))));
+      }
+    }
+  }
+  // and the limits are kept
+  VERIFY(Parse("threads = 3\npacket_count = 100\n").size() == 100);
+  VERIFY(Parse("threads = 3\npacket_count = 0\n").empty());
+  std::unordered_set<OmniSketch::FlowKey<13>> flows;
+  for (const auto &record : Parse("threads = 3\nflow_count = 10\n"))
+    flows.insert(record.flowkey);
+  VERIFY(flows.size() == 9);
+}
+
+/**
+ * @brief Test that an exception in taking records reaches the caller, with
+ * no thread left behind
+ *
+ */
+void TestThrow() {
+  using namespace OmniSketch;
+  for (int32_t threads : {0, 1, 3}) {
+    Util::ConfigParser::overrides() =
+        toml::parse(fmt::format("[parser]\nthreads = {}\n", threads));
+    Util::PcapParser<13> pcap_parser("test_parser.toml");
+    Util::ConfigParser::overrides() = toml::table{};
+    VERIFY(pcap_parser.succeed());
+    int32_t num_batches = 0;
+    try {
+      pcap_parser.parsePcapPackets(
+          [&num_batches](const std::vector<Data::Record<13>> &batch) {
+            if (++num_batches == 2)
+              throw std::runtime_error("Runtime Error: Taken too many.");
+          });
+      SET_FAILURE_FLAG;
+    } catch (const std::runtime_error &exp) {
+      VERIFY_EXCEPTION(exp);
+    }
+    VERIFY(num_batches == 2);
+  }
+}
+
+/**
+ * @brief Parser test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(parser) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestFast();
+    TestSketch();
+    TestParallel();
+    TestThrow();
+  }
+}
+/** @endcond */
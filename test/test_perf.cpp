@@ -0,0 +1,76 @@
+/**
+ * @file test_perf.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test hardware performance counters
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <common/perf.h>
+#include <thread>
+
+/**
+ * @cond TEST
+ * @brief Test counting a loop
+ * @details Counters may be unavailable, in which case nothing is counted.
+ *
+ */
+void TestCount() {
+  using OmniSketch::Util::PerfCounters;
+  PerfCounters perf;
+  volatile uint64_t sum = 0;
+  perf.start();
+  for (uint64_t i = 0; i < 1000000; ++i)
+    sum = sum + i;
+  perf.stop();
+
+  const auto sample = perf.sample(1000000);
+  if (!perf.available()) {
+    VERIFY(sample.empty());
+    return;
+  }
+  VERIFY(!sample.empty());
+  for (const auto &[event, value] : sample) {
+    VERIFY(value >= 0.0);
+    // at least an add, a compare and a branch per iteration
+    if (event == "instructions")
+      VERIFY(value >= 3.0);
+  }
+  // counters are reset
+  perf.start();
+  perf.stop();
+  if (perf.available(PerfCounters::INSTRUCTIONS))
+    VERIFY(perf.count(PerfCounters::INSTRUCTIONS) < 1000000);
+}
+
+/**
+ * @brief Test counters of other threads
+ *
+ */
+void TestThreads() {
+  using OmniSketch::Util::PerfCounters;
+  PerfCounters perf;
+  perf.start();
+  std::thread([]() {
+    volatile uint64_t sum = 0;
+    for (uint64_t i = 0; i < 1000000; ++i)
+      sum = sum + i;
+  }).join();
+  perf.stop();
+  // only the calling thread is counted
+  if (perf.available(PerfCounters::INSTRUCTIONS))
+    VERIFY(perf.count(PerfCounters::INSTRUCTIONS) < 1000000);
+}
+
+/**
+ * @brief Perf test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(perf) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestCount();
+    TestThreads();
+  }
+}
+/** @endcond */
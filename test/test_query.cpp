@@ -0,0 +1,90 @@
+/**
+ * @file test_query.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test batched queries
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <algorithm>
+#include <random>
+#include <sketch/CMSketch.h>
+#include <sketch/CUSketch.h>
+#include <sketch/CountSketch.h>
+#include <sketch/NitroSketch.h>
+#include <vector>
+
+/**
+ * @cond TEST
+ * @brief Test that queryBatch() agrees with query() for any number in flight
+ *
+ */
+template <typename Sketch> void TestQueryBatch(Sketch &sketch) {
+  using namespace OmniSketch;
+  std::mt19937 rng(1);
+  std::vector<FlowKey<4>> flowkeys;
+  for (int32_t t = 0; t < 20000; ++t) {
+    const FlowKey<4> flowkey(std::min(rng() % 3000, rng() % 3000));
+    sketch.update(flowkey, 1 + rng() % 100);
+    flowkeys.push_back(flowkey);
+  }
+  std::vector<int32_t> expected;
+  for (const auto &flowkey : flowkeys)
+    expected.push_back(sketch.query(flowkey));
+  for (int32_t width : {1, 3, 16, 100000}) {
+    std::vector<int32_t> out(flowkeys.size());
+    sketch.queryBatch(flowkeys.data(), out.data(),
+                      static_cast<int32_t>(flowkeys.size()), width);
+    VERIFY(out == expected);
+  }
+  // nothing to query
+  sketch.queryBatch(flowkeys.data(), nullptr, 0, 16);
+  sketch.clear();
+  std::vector<int32_t> out(flowkeys.size(), -1);
+  sketch.queryBatch(flowkeys.data(), out.data(),
+                    static_cast<int32_t>(flowkeys.size()), 16);
+  VERIFY(std::all_of(out.begin(), out.end(), [](int32_t v) { return !v; }));
+}
+
+/**
+ * @brief Test that the minimum never underestimates
+ *
+ */
+void TestMin() {
+  using namespace OmniSketch;
+  for (int32_t depth : {1, 4, 9}) {
+    Sketch::CMSketch<4, int32_t> cm(depth, 500);
+    std::vector<int32_t> truth(3000);
+    std::mt19937 rng(2);
+    for (int32_t t = 0; t < 20000; ++t) {
+      const int32_t key = rng() % 3000;
+      truth[key] += 2;
+      cm.update(FlowKey<4>(key), 2);
+    }
+    for (int32_t key = 0; key < 3000; ++key)
+      VERIFY(cm.query(FlowKey<4>(key)) >= truth[key]);
+  }
+}
+
+/**
+ * @brief Query test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(query) {
+  using namespace OmniSketch::Sketch;
+  for (int i = 0; i < g_repeat; ++i) {
+    for (int32_t depth : {1, 3, 4, 5, 8, 17}) {
+      CMSketch<4, int32_t> cm(depth, 1000);
+      CUSketch<4, int32_t> cu(depth, 1000);
+      CountSketch<4, int32_t> cs(depth, 1000);
+      NitroSketch<4, int32_t> nitro(depth, 1000);
+      TestQueryBatch(cm);
+      TestQueryBatch(cu);
+      TestQueryBatch(cs);
+      TestQueryBatch(nitro);
+    }
+    TestMin();
+  }
+}
+/** @endcond */
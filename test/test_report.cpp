@@ -0,0 +1,148 @@
+/**
+ * @file test_report.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test reports of tests
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <common/report.h>
+#include <sstream>
+
+/**
+ * @cond TEST
+ * @brief A record of Count Min
+ *
+ */
+OmniSketch::Test::Report::Record MakeRecord() {
+  OmniSketch::Test::Report::Record record;
+  record.run_id = "20221018T071500Z-42";
+  record.time = "2022-10-18T07:15:00Z";
+  record.host = {{"hostname", "bench"}, {"cpus", "8"}};
+  record.git = "abc1234-dirty";
+  record.sketch = "Count Min";
+  record.test = "CM.test";
+  record.params = {{"para.depth", "5"}, {"para.memory", "1.5MB"}};
+  record.dataset = "../data/records.bin";
+  record.memory = 1600000;
+  record.metrics = {{"Size.SIZE", "1600000"},
+                    {"Query.ARE", "0.16"},
+                    {"Query.DIST<=inf", "1"}};
+  return record;
+}
+
+/**
+ * @brief Test writing records
+ *
+ */
+void TestWrite() {
+  using OmniSketch::Test::Report;
+  const Report::Record record = MakeRecord();
+
+  std::ostringstream json;
+  Report::writeJson(json, record);
+  VERIFY(json.str() ==
+         "{\"run_id\": \"20221018T071500Z-42\", \"time\": "
+         "\"2022-10-18T07:15:00Z\", \"host\": {\"hostname\": \"bench\", "
+         "\"cpus\": 8}, \"git\": \"abc1234-dirty\", \"sketch\": \"Count Min\", "
+         "\"test\": \"CM.test\", \"params\": {\"para.depth\": 5, "
+         "\"para.memory\": \"1.5MB\"}, \"dataset\": \"../data/records.bin\", "
+         "\"memory\": 1600000, \"metrics\": {\"Size.SIZE\": 1600000, "
+         "\"Query.ARE\": 0.16, \"Query.DIST<=inf\": 1}}\n");
+
+  std::ostringstream csv;
+  Report::writeCsvHeader(csv);
+  Report::writeCsv(csv, record);
+  const std::string prefix =
+      "20221018T071500Z-42,2022-10-18T07:15:00Z,hostname=bench;cpus=8,"
+      "abc1234-dirty,Count Min,CM.test,para.depth=5;para.memory=1.5MB,"
+      "../data/records.bin,1600000,";
+  VERIFY(csv.str() == "RunID,Time,Host,Git,Sketch,Test,Params,Dataset,Memory,"
+                      "Metric,Value\n" +
+                          prefix + "Size.SIZE,1600000\n" + prefix +
+                          "Query.ARE,0.16\n" + prefix + "Query.DIST<=inf,1\n");
+
+  // quoting and escaping
+  Report::Record odd = record;
+  odd.sketch = "Count \"Min\", CH";
+  odd.metrics = {{"Query.ARE", "nan"}};
+  std::ostringstream odd_json, odd_csv;
+  Report::writeJson(odd_json, odd);
+  Report::writeCsv(odd_csv, odd);
+  VERIFY(odd_json.str().find("\"sketch\": \"Count \\\"Min\\\", CH\"") !=
+         std::string::npos);
+  VERIFY(odd_json.str().find("\"Query.ARE\": null") != std::string::npos);
+  VERIFY(odd_csv.str().find(",\"Count \"\"Min\"\", CH\",") !=
+         std::string::npos);
+}
+
+/**
+ * @brief Test that only JSON numbers are written as is, and that control
+ * characters are escaped
+ *
+ */
+void TestJsonValue() {
+  using OmniSketch::Test::Report;
+  Report::Record record = MakeRecord();
+  record.sketch = std::string("a\tb\r\nc\b\f\x01\x1f\"\\\0", 13);
+  record.metrics = {};
+  for (const char *num : {"0", "-0", "12", "-3.25", "1e5", "2.5E-3", "1E+10"})
+    record.metrics.emplace_back(num, num);
+  for (const char *str : {"0x10", "+5", "007", "1.", ".5", "1e", "-", "",
+                          "1 ", "infinity", "1,5"})
+    record.metrics.emplace_back(str, str);
+  for (const char *non_finite : {"nan", "-nan", "inf", "-inf"})
+    record.metrics.emplace_back(non_finite, non_finite);
+
+  std::ostringstream json;
+  Report::writeJson(json, record);
+  const std::string out = json.str();
+  VERIFY(out.find("\"sketch\": "
+                  "\"a\\tb\\r\\nc\\b\\f\\u0001\\u001f\\\"\\\\\\u0000\"") !=
+         std::string::npos);
+  for (const char *num : {"0", "-0", "12", "-3.25", "1e5", "2.5E-3", "1E+10"})
+    VERIFY(out.find("\"" + std::string(num) + "\": " + num + ",") !=
+               std::string::npos ||
+           out.find("\"" + std::string(num) + "\": " + num + "}") !=
+               std::string::npos);
+  for (const char *str : {"0x10", "+5", "007", "1.", ".5", "1e", "-", "",
+                          "1 ", "infinity", "1,5"}) {
+    const std::string quoted = "\"" + std::string(str) + "\"";
+    VERIFY(out.find(quoted + ": " + quoted) != std::string::npos);
+  }
+  for (const char *non_finite : {"nan", "-nan", "inf", "-inf"})
+    VERIFY(out.find("\"" + std::string(non_finite) + "\": null") !=
+           std::string::npos);
+  // no raw control character is left
+  for (char c : out.substr(0, out.size() - 1))
+    VERIFY(static_cast<unsigned char>(c) >= 0x20);
+}
+
+/**
+ * @brief Test the run ID and host info
+ *
+ */
+void TestRunInfo() {
+  using OmniSketch::Test::Report;
+  VERIFY(!Report::runId().empty());
+  VERIFY(Report::runId() == Report::runId());
+  VERIFY(!Report::gitHash().empty());
+  bool has_cpus = false;
+  for (const auto &[key, value] : Report::hostInfo())
+    has_cpus |= key == "cpus";
+  VERIFY(has_cpus);
+}
+
+/**
+ * @brief Report test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(report) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestWrite();
+    TestJsonValue();
+    TestRunInfo();
+  }
+}
+/** @endcond */
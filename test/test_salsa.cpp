@@ -0,0 +1,149 @@
+/**
+ * @file test_salsa.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test word-parallel primitives of SALSA
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <common/hash.h>
+#include <common/salsa.h>
+#include <random>
+#include <sketch/SALSACM.h>
+#include <sketch/SALSACU.h>
+#include <vector>
+
+/**
+ * @cond TEST
+ * @brief Test boundaries against a scan flag by flag
+ *
+ */
+void TestBoundary() {
+  using OmniSketch::Util::SalsaRow;
+  std::mt19937 rng(1);
+  for (int32_t width : {1, 7, 8, 63, 64, 65, 1000}) {
+    // two rows, so that the flags of the next row follow
+    std::vector<uint8_t> bitmap(2 * SalsaRow::bitmapBytes(width) +
+                                SalsaRow::kPadding);
+    uint8_t *row = bitmap.data();
+    auto flag = [row](int32_t i) { return (row[i / 8] >> (i % 8)) & 1; };
+    // counters of 1 to 8 bytes, with the last flag of the row set at times
+    for (int32_t i = 0; i < width;) {
+      const int32_t len = 1 + rng() % 8;
+      for (int32_t j = i; j < i + len - 1 && j < width; ++j)
+        row[j / 8] |= 1 << (j % 8);
+      i += len;
+    }
+    if (rng() % 2)
+      row[(width - 1) / 8] |= 1 << ((width - 1) % 8);
+    std::fill(bitmap.begin() + SalsaRow::bitmapBytes(width), bitmap.end(),
+              0xff);
+
+    for (int32_t idx = 0; idx < width; ++idx) {
+      int32_t left = idx, right = idx;
+      while (left >= 1 && flag(left - 1))
+        left--;
+      while (right < width - 1 && flag(right))
+        right++;
+      int32_t l, r;
+      SalsaRow::boundary(row, width, idx, l, r);
+      VERIFY(l == left && r == right);
+    }
+  }
+}
+
+/**
+ * @brief Test reading and writing counters against byte-by-byte access
+ *
+ */
+void TestValue() {
+  using OmniSketch::Util::SalsaRow;
+  std::mt19937_64 rng(2);
+  const int32_t width = 64;
+  std::vector<uint8_t> bytes(width + SalsaRow::kPadding);
+  for (auto &b : bytes)
+    b = rng();
+  for (int32_t t = 0; t < 10000; ++t) {
+    const int32_t len = 1 + rng() % 8;
+    const int32_t left = rng() % (width - len + 1), right = left + len - 1;
+    const std::vector<uint8_t> before = bytes;
+
+    uint64_t val = 0;
+    for (int32_t i = left; i <= right; ++i)
+      val = (val << 8) + bytes[i];
+    VERIFY(SalsaRow::get(bytes.data(), left, right) == val);
+
+    val = len == 8 ? rng() : rng() % (1ULL << (len * 8));
+    SalsaRow::set(bytes.data(), left, right, val);
+    for (int32_t i = right; i >= left; --i, val >>= 8)
+      VERIFY(bytes[i] == (val & 0xff));
+    for (int32_t i = 0; i < static_cast<int32_t>(bytes.size()); ++i)
+      VERIFY(i >= left && i <= right ? true : bytes[i] == before[i]);
+  }
+  VERIFY(SalsaRow::fits(255, 1) && !SalsaRow::fits(256, 1));
+  VERIFY(SalsaRow::fits(~0U, 4) && !SalsaRow::fits(1ULL << 32, 4));
+  VERIFY(SalsaRow::fits(~0ULL, 8));
+}
+
+/**
+ * @brief Test that merged counters never underestimate
+ *
+ */
+void TestSketch() {
+  using namespace OmniSketch;
+  Sketch::SALSACM<4, int32_t> cm(3, 400);
+  Sketch::SALSACU<4, int32_t> cu(3, 400);
+  std::vector<int32_t> truth(2000);
+  std::mt19937 rng(3);
+  for (int32_t t = 0; t < 200000; ++t) {
+    // skewed, so that counters merge up to 4 bytes
+    const int32_t key = std::min<int32_t>(rng() % 2000, rng() % 2000);
+    const int32_t val = 1 + rng() % 1500;
+    truth[key] += val;
+    cm.update(FlowKey<4>(key), val);
+    cu.update(FlowKey<4>(key), val);
+  }
+  for (int32_t key = 0; key < 2000; ++key) {
+    VERIFY(cm.query(FlowKey<4>(key)) >= truth[key]);
+    VERIFY(cu.query(FlowKey<4>(key)) >= truth[key]);
+  }
+}
+
+/**
+ * @brief Test that sketches by words and by bytes estimate alike, as they
+ * hash alike
+ *
+ */
+template <template <int32_t, typename, typename, typename> class Sketch>
+void TestSameAsBytes() {
+  using namespace OmniSketch;
+  Hash::AwareHash(1);
+  Sketch<4, int32_t, Hash::AwareHash, Util::SalsaRow> words(3, 400);
+  Hash::AwareHash(1);
+  Sketch<4, int32_t, Hash::AwareHash, Util::SalsaBytes> bytes(3, 400);
+  std::mt19937 rng(4);
+  for (int32_t t = 0; t < 200000; ++t) {
+    const int32_t key = std::min<int32_t>(rng() % 2000, rng() % 2000);
+    const int32_t val = 1 + rng() % 1500;
+    words.update(FlowKey<4>(key), val);
+    bytes.update(FlowKey<4>(key), val);
+  }
+  for (int32_t key = 0; key < 2000; ++key)
+    VERIFY(words.query(FlowKey<4>(key)) == bytes.query(FlowKey<4>(key)));
+}
+
+/**
+ * @brief SALSA test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(salsa) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestBoundary();
+    TestValue();
+    TestSketch();
+    TestSameAsBytes<OmniSketch::Sketch::SALSACM>();
+    TestSameAsBytes<OmniSketch::Sketch::SALSACU>();
+  }
+}
+/** @endcond */
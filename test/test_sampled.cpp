@@ -0,0 +1,133 @@
+/**
+ * @file test_sampled.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test geometric skipping and sampled sketches
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <common/sampling.h>
+#include <random>
+#include <sketch/CMSketch.h>
+#include <sketch/Sampled.h>
+#include <vector>
+
+/**
+ * @cond TEST
+ * @brief Test the mean of skips
+ *
+ */
+void TestGeometricSkip() {
+  using OmniSketch::Util::GeometricSkip;
+  for (double p : {0.5, 0.1, 0.01}) {
+    GeometricSkip skip(p, 7);
+    const int32_t n = 200000;
+    double sum = 0.0;
+    for (int32_t i = 0; i < n; ++i) {
+      const int32_t s = skip.next();
+      VERIFY(s >= 0);
+      sum += s;
+    }
+    const double mean = (1 - p) / p;
+    // well within 5 standard deviations of the mean
+    VERIFY(std::abs(sum / n - mean) < 5 * std::sqrt((1 - p) / n) / p);
+  }
+  GeometricSkip all(1.0);
+  for (int32_t i = 0; i < 1000; ++i)
+    VERIFY(all.next() == 0);
+  try {
+    GeometricSkip never(0.0);
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+  try {
+    all.setProb(1.5);
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+  all.setProb(0.3);
+  VERIFY(all.prob() == 0.3);
+}
+
+/**
+ * @brief Test levels set by the load
+ *
+ */
+void TestLevel() {
+  using namespace OmniSketch;
+  Sketch::Sampled<4, int32_t, Sketch::CMSketch<4, int32_t>> sampled(0.5, 3,
+                                                                    100);
+  VERIFY(sampled.updateProb() == 0.5);
+  sampled.adjustUpdateProb(1.0);
+  VERIFY(sampled.updateProb() == 0.5);
+  sampled.adjustUpdateProb(1.5);
+  VERIFY(sampled.updateProb() == 0.25);
+  sampled.adjustUpdateProb(4.0);
+  VERIFY(sampled.updateProb() == 0.125);
+  sampled.adjustUpdateProb(1e9);
+  VERIFY(sampled.updateProb() == 0.5 / 128);
+  sampled.adjustUpdateProb(0.1);
+  VERIFY(sampled.updateProb() == 0.5);
+  try {
+    sampled.setCapacity(-1.0);
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+}
+
+/**
+ * @brief Test that heavy flows are estimated within a few percent, whatever
+ * the levels went through and whether updated one by one or in batches
+ *
+ */
+void TestEstimate() {
+  using namespace OmniSketch;
+  using Sampled = Sketch::Sampled<4, int32_t, Sketch::CMSketch<4, int32_t>>;
+  Sampled one(0.25, 3, 100003), batch(0.25, 3, 100003);
+  std::vector<FlowKey<4>> flowkeys;
+  std::vector<int32_t> vals, truth(10);
+  std::mt19937 rng(1);
+  for (int32_t t = 0; t < 1000000; ++t) {
+    const int32_t key = rng() % 10;
+    flowkeys.emplace_back(key);
+    vals.push_back(1 + key);
+    truth[key] += 1 + key;
+  }
+  const int32_t n = static_cast<int32_t>(flowkeys.size());
+  for (int32_t i = 0; i < n; i += 1000) {
+    const int32_t level = i / 1000 % 3;
+    one.setLevel(level);
+    batch.setLevel(level);
+    for (int32_t j = i; j < i + 1000; ++j)
+      one.update(flowkeys[j], vals[j]);
+    batch.updateBatch(flowkeys.data() + i, vals.data() + i, 1000, 8);
+  }
+  for (int32_t key = 0; key < 10; ++key) {
+    VERIFY(std::abs(one.query(FlowKey<4>(key)) - truth[key]) <
+           0.05 * truth[key]);
+    VERIFY(std::abs(batch.query(FlowKey<4>(key)) - truth[key]) <
+           0.05 * truth[key]);
+  }
+  // probability 1 is no sampling at all
+  Sampled full(1.0, 3, 100003);
+  full.updateBatch(flowkeys.data(), vals.data(), n, 8);
+  for (int32_t key = 0; key < 10; ++key)
+    VERIFY(full.query(FlowKey<4>(key)) == truth[key]);
+}
+
+/**
+ * @brief Sampling test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(sampled) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestGeometricSkip();
+    TestLevel();
+    TestEstimate();
+  }
+}
+/** @endcond */
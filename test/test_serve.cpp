@@ -0,0 +1,272 @@
+/**
+ * @file test_serve.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test the query server and its client
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <dirent.h>
+#include <random>
+#include <serve/server.h>
+#include <sketch/CMSketch.h>
+#include <sketch/HeavyKeeper.h>
+#include <thread>
+#include <vector>
+
+/**
+ * @cond TEST
+ * @brief Records of skewed keys, so that there are heavy hitters
+ *
+ */
+std::vector<OmniSketch::Data::Record<4>> SkewedRecords(int32_t n) {
+  std::vector<OmniSketch::Data::Record<4>> records(n);
+  std::mt19937 rng(1);
+  for (auto &record : records) {
+    record.flowkey = OmniSketch::FlowKey<4>(
+        static_cast<int32_t>(std::min(rng() % 2000, rng() % 2000)));
+    record.length = 1;
+  }
+  return records;
+}
+
+/**
+ * @brief A socket file of this process
+ *
+ */
+std::string SocketPath(const char *name) {
+  return "/tmp/omnisketch_test_" + std::string(name) + "_" +
+         std::to_string(::getpid()) + ".sock";
+}
+
+/**
+ * @brief Test point queries during ingest
+ *
+ */
+void TestQuery() {
+  using namespace OmniSketch;
+  const auto records = SkewedRecords(200000);
+  const std::string path = SocketPath("query");
+  Serve::Server<4, int32_t, Sketch::CMSketch<4, int32_t>> server(path, 1000, 3,
+                                                                 500);
+  server.start();
+
+  // estimates of Count Min never decrease while records come
+  std::atomic<bool> done(false);
+  bool monotone = true;
+  std::atomic<int64_t> reads(0);
+  std::thread reader([&]() {
+    Serve::Client<4> client(path);
+    std::vector<FlowKey<4>> flowkeys{FlowKey<4>(0), FlowKey<4>(1)};
+    int64_t last[2] = {0, 0}, out[2];
+    while (!done.load()) {
+      client.query(flowkeys.data(), out, 2);
+      monotone = monotone && out[0] >= last[0] && out[1] >= last[1];
+      last[0] = out[0], last[1] = out[1];
+      reads++;
+    }
+  });
+  // halfway, wait for a reply, however threads are scheduled
+  const auto half = records.begin() + records.size() / 2;
+  VERIFY(server.ingest(records.begin(), half, Data::InPacket, 4) == 100000);
+  while (reads.load() == 0)
+    std::this_thread::yield();
+  VERIFY(server.ingest(half, records.end(), Data::InPacket, 4) == 100000);
+  server.flush();
+  done.store(true);
+  reader.join();
+  VERIFY(monotone);
+  VERIFY(reads.load() > 0);
+
+  // once flushed, answers are those of the sketch
+  Serve::Client<4> client(path);
+  std::vector<FlowKey<4>> flowkeys;
+  for (int32_t key = 0; key < 2000; ++key)
+    flowkeys.emplace_back(key);
+  std::vector<int64_t> out(flowkeys.size());
+  client.query(flowkeys.data(), out.data(), flowkeys.size());
+  for (int32_t key = 0; key < 2000; ++key)
+    VERIFY(out[key] == server.snapshot().base().query(flowkeys[key]));
+
+  // Count Min keeps no flowkeys
+  Serve::Client<4>::Flows flows;
+  const Serve::Summary summary = client.dump(&flows);
+  VERIFY(summary.records == 200000);
+  VERIFY(summary.bytes > 0);
+  VERIFY(flows.empty());
+  try {
+    client.getTopK(10);
+    SET_FAILURE_FLAG;
+  } catch (const std::runtime_error &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+  server.stop();
+}
+
+/**
+ * @brief Test heavy hitters and top-k
+ *
+ */
+void TestHeavyHitter() {
+  using namespace OmniSketch;
+  const auto records = SkewedRecords(200000);
+  const std::string path = SocketPath("heavy");
+  Serve::Server<4, int32_t, Sketch::HeavyKeeper<4, int32_t>> server(
+      path, 5000, 2, 500, 50, 1.08, 2.0);
+  server.start();
+  server.ingest(records.begin(), records.end(), Data::InPacket);
+  server.flush();
+
+  Serve::Client<4> client(path);
+  const auto expected = server.snapshot().base().getHeavyHitter(100);
+  const auto hh = client.getHeavyHitter(100);
+  VERIFY(hh.size() > 0 && hh.size() == expected.size());
+  for (const auto &[flowkey, val] : hh)
+    VERIFY(expected.count(flowkey) && expected.at(flowkey) == val);
+
+  const auto top = client.getTopK(10);
+  VERIFY(top.size() == 10);
+  for (size_t i = 1; i < top.size(); ++i)
+    VERIFY(top[i - 1].second >= top[i].second);
+  // the largest of all flows tracked
+  Serve::Client<4>::Flows flows;
+  client.dump(&flows);
+  VERIFY(flows.size() >= top.size());
+  for (const auto &flow : flows)
+    VERIFY(flow.second <= top[0].second);
+}
+
+/**
+ * @brief Test records read from a pipe
+ *
+ */
+void TestPipe() {
+  using std::string_view_literals::operator""sv;
+  using namespace OmniSketch;
+  static constexpr std::string_view input = R"(
+      name = [["flowkey", "length"], [4, 4]]
+  )"sv;
+  toml::table array = toml::parse(input);
+  const Data::DataFormat format(*array["name"].as_array());
+  const auto records = SkewedRecords(100000);
+  const std::string path = SocketPath("pipe");
+  Serve::Server<4, int32_t, Sketch::CMSketch<4, int32_t>> server(path, 1000, 3,
+                                                                 500);
+  int fds[2];
+  VERIFY(::pipe(fds) == 0);
+  // written in odd chunks, so that records are split across reads
+  std::thread writer([&]() {
+    std::vector<int8_t> bytes(records.size() * 8);
+    for (size_t i = 0; i < records.size(); ++i)
+      format.writeAsFormat(records[i], bytes.data() + i * 8);
+    for (size_t i = 0; i < bytes.size(); i += 1001) {
+      const size_t len = std::min<size_t>(1001, bytes.size() - i);
+      VERIFY(::write(fds[1], bytes.data() + i, len) == ssize_t(len));
+    }
+    ::close(fds[1]);
+  });
+  {
+    Data::RecordSource<4> source(fds[0], format, 1000);
+    VERIFY(server.ingest(source, Data::InLength) == 100000);
+  }
+  writer.join();
+  ::close(fds[0]);
+
+  Sketch::CMSketch<4, int32_t> &sketch = server.snapshot().base();
+  int64_t total = 0;
+  for (int32_t key = 0; key < 2000; ++key)
+    total += sketch.query(FlowKey<4>(key));
+  VERIFY(total >= 100000);
+}
+
+/**
+ * @brief Number of threads of this process
+ *
+ */
+int32_t NumThreads() {
+  int32_t n = 0;
+  if (DIR *dir = ::opendir("/proc/self/task")) {
+    while (const dirent *entry = ::readdir(dir))
+      n += entry->d_name[0] != '.';
+    ::closedir(dir);
+  }
+  return n;
+}
+
+/**
+ * @brief Test that threads of clients that left are joined
+ *
+ */
+void TestReap() {
+  using namespace OmniSketch;
+  const std::string path = SocketPath("reap");
+  Serve::Server<4, int32_t, Sketch::CMSketch<4, int32_t>> server(path, 1000, 3,
+                                                                 500);
+  server.start();
+  const int32_t before = NumThreads();
+  FlowKey<4> flowkey(1);
+  int64_t out;
+  for (int32_t i = 0; i < 100; ++i) {
+    Serve::Client<4> client(path);
+    client.query(&flowkey, &out, 1);
+  }
+  // a few may be yet to be joined, but not one per client
+  VERIFY(NumThreads() < before + 10);
+  server.stop();
+}
+
+/**
+ * @brief Test requests the server refuses
+ *
+ */
+void TestInvalid() {
+  using namespace OmniSketch;
+  const std::string path = SocketPath("invalid");
+  Serve::Server<4, int32_t, Sketch::CMSketch<4, int32_t>> server(path, 1000, 3,
+                                                                 500);
+  server.start();
+  // a client of another key length
+  try {
+    Serve::Client<8> client(path);
+    FlowKey<8> flowkey;
+    int64_t out;
+    client.query(&flowkey, &out, 1);
+    SET_FAILURE_FLAG;
+  } catch (const std::runtime_error &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+  // too large a batch
+  try {
+    Serve::Client<4> client(path);
+    std::vector<FlowKey<4>> flowkeys(Serve::kMaxBatch + 1);
+    std::vector<int64_t> out(flowkeys.size());
+    client.query(flowkeys.data(), out.data(), flowkeys.size());
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+  server.stop();
+  // nobody listening
+  try {
+    Serve::Client<4> client(path);
+    SET_FAILURE_FLAG;
+  } catch (const std::runtime_error &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+}
+
+/**
+ * @brief Serve test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(serve) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestQuery();
+    TestHeavyHitter();
+    TestPipe();
+    TestReap();
+    TestInvalid();
+  }
+}
+/** @endcond */
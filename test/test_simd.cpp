@@ -0,0 +1,196 @@
+/**
+ * @file test_simd.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test SIMD kernels and packed buckets
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <common/bucket.h>
+#include <common/simd.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+/**
+ * @cond TEST
+ * @brief Test MaskedAddBits() against getBit()-style bit numbering
+ *
+ */
+void TestMaskedAddBits() {
+  using OmniSketch::Util::MaskedAddBits;
+
+  std::mt19937 rng(1);
+  int8_t bits[13];
+  for (auto &b : bits)
+    b = static_cast<int8_t>(rng());
+  std::vector<int32_t> c32(104, 1);
+  std::vector<int64_t> c64(104, 1);
+  MaskedAddBits(c32.data(), bits, 13, -3);
+  MaskedAddBits(c64.data(), bits, 13, static_cast<int64_t>(5));
+  for (int32_t k = 0; k < 104; ++k) {
+    const bool on = (bits[k >> 3] >> (k & 7)) & 1;
+    VERIFY(c32[k] == (on ? -2 : 1));
+    VERIFY(c64[k] == (on ? 6 : 1));
+  }
+}
+
+/**
+ * @brief Test SplitAddBits() against MaskedAddBits()
+ *
+ */
+void TestSplitAddBits() {
+  using namespace OmniSketch::Util;
+
+  std::mt19937 rng(3);
+  int8_t bits[13], flipped[13];
+  for (int32_t i = 0; i < 13; ++i) {
+    bits[i] = static_cast<int8_t>(rng());
+    flipped[i] = ~bits[i];
+  }
+  std::vector<int32_t> off32(104, 2), on32(104, 2), off_ref(104, 2),
+      on_ref(104, 2);
+  SplitAddBits(off32.data(), on32.data(), bits, 13, -7);
+  MaskedAddBits(on_ref.data(), bits, 13, -7);
+  MaskedAddBits(off_ref.data(), flipped, 13, -7);
+  VERIFY(off32 == off_ref && on32 == on_ref);
+
+  std::vector<int64_t> off64(104), on64(104);
+  SplitAddBits(off64.data(), on64.data(), bits, 13, static_cast<int64_t>(3));
+  for (int32_t k = 0; k < 104; ++k) {
+    const bool on = (bits[k >> 3] >> (k & 7)) & 1;
+    VERIFY(on64[k] == (on ? 3 : 0) && off64[k] == (on ? 0 : 3));
+  }
+}
+
+/**
+ * @brief Test FindFingerprint() on packed buckets
+ *
+ */
+void TestFindFingerprint() {
+  using namespace OmniSketch::Util;
+
+  for (int32_t n : {1, 4, 15, 16, 17, 40}) {
+    PackedBuckets<int32_t> buckets(3, n, n);
+    uint8_t *fps = buckets.fp(1);
+    // all empty: the first empty entry is the first one
+    VERIFY(FindFingerprint(fps, n, 0, [](int32_t) { return true; }) == 0);
+    for (int32_t i = 0; i < n; ++i)
+      fps[i] = static_cast<uint8_t>(i % 3 + 1);
+    // no empty entry, even if the padding is zero
+    VERIFY(FindFingerprint(fps, n, 0, [](int32_t) { return true; }) == -1);
+    // the predicate is only checked on hits, in increasing order
+    int32_t last = -1;
+    int32_t found = FindFingerprint(fps, n, 2, [&](int32_t i) {
+      VERIFY(fps[i] == 2 && i > last);
+      last = i;
+      return i >= n / 2;
+    });
+    int32_t expected = -1;
+    for (int32_t i = n / 2; i < n && expected == -1; ++i)
+      if (fps[i] == 2)
+        expected = i;
+    VERIFY(found == expected);
+    // neighbouring buckets are left untouched
+    VERIFY(buckets.fp(0)[0] == 0 && buckets.fp(2)[0] == 0);
+    VERIFY(buckets.val(1) + n <= reinterpret_cast<int32_t *>(buckets.fp(2)));
+  }
+}
+
+/**
+ * @brief Test MinIndex()
+ *
+ */
+void TestMinIndex() {
+  using OmniSketch::Util::MinIndex;
+
+  std::mt19937 rng(2);
+  for (int32_t n = 1; n < 40; ++n) {
+    std::vector<int32_t> v32(n);
+    std::vector<int64_t> v64(n);
+    for (int32_t i = 0; i < n; ++i)
+      v64[i] = v32[i] = static_cast<int32_t>(rng() % 7) - 3;
+    int32_t expected = 0;
+    for (int32_t i = 1; i < n; ++i)
+      if (v32[i] < v32[expected])
+        expected = i;
+    VERIFY(MinIndex(v32.data(), n) == expected);
+    VERIFY(MinIndex(v64.data(), n) == expected);
+  }
+}
+
+/**
+ * @brief Test GatherMin() against a scalar scan
+ *
+ */
+void TestGatherMin() {
+  using OmniSketch::Util::GatherMin;
+
+  std::mt19937 rng(4);
+  std::vector<int32_t> c32(1000);
+  std::vector<int64_t> c64(1000);
+  for (int32_t i = 0; i < 1000; ++i) {
+    c32[i] = static_cast<int32_t>(rng());
+    c64[i] = static_cast<int64_t>(rng()) << (rng() % 32);
+  }
+  for (int32_t n = 1; n < 40; ++n) {
+    std::vector<int32_t> offsets(n);
+    for (auto &o : offsets)
+      o = rng() % 1000;
+    int32_t min32 = c32[offsets[0]];
+    int64_t min64 = c64[offsets[0]];
+    for (int32_t i = 1; i < n; ++i) {
+      min32 = std::min(min32, c32[offsets[i]]);
+      min64 = std::min(min64, c64[offsets[i]]);
+    }
+    VERIFY(GatherMin(c32.data(), offsets.data(), n) == min32);
+    VERIFY(GatherMin(c64.data(), offsets.data(), n) == min64);
+  }
+}
+
+/**
+ * @brief Test Median() against sorting
+ *
+ */
+void TestMedian() {
+  using OmniSketch::Util::Median;
+
+  auto expected = [](auto vals) {
+    std::sort(vals.begin(), vals.end());
+    const size_t n = vals.size();
+    return (n & 1) ? vals[n / 2] : (vals[n / 2 - 1] + vals[n / 2]) / 2;
+  };
+  std::mt19937 rng(5);
+  for (int32_t n = 1; n < 40; ++n) {
+    for (int32_t t = 0; t < 100; ++t) {
+      // few distinct values, so that ties are common
+      std::vector<int32_t> v32(n);
+      std::vector<double> v64(n);
+      for (int32_t i = 0; i < n; ++i) {
+        v32[i] = static_cast<int32_t>(rng() % 9) - 4;
+        v64[i] = (rng() % 1000) / 7.0;
+      }
+      const int32_t m32 = expected(v32);
+      const double m64 = expected(v64);
+      VERIFY(Median(v32.data(), n) == m32);
+      VERIFY(Median(v64.data(), n) == m64);
+    }
+  }
+}
+
+/**
+ * @brief SIMD test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(simd) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestMaskedAddBits();
+    TestSplitAddBits();
+    TestFindFingerprint();
+    TestMinIndex();
+    TestGatherMin();
+    TestMedian();
+  }
+}
+/** @endcond */
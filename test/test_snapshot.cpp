@@ -0,0 +1,175 @@
+/**
+ * @file test_snapshot.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test reads of snapshots while the sketch is being updated
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <atomic>
+#include <random>
+#include <sketch/CMSketch.h>
+#include <sketch/CountSketch.h>
+#include <sketch/ElasticSketch.h>
+#include <sketch/HeavyKeeper.h>
+#include <sketch/Snapshot.h>
+#include <thread>
+#include <vector>
+
+/**
+ * @cond TEST
+ * @brief Skewed keys, so that there are heavy hitters
+ *
+ */
+std::vector<OmniSketch::FlowKey<4>> SkewedKeys(int32_t n) {
+  std::vector<OmniSketch::FlowKey<4>> keys;
+  std::mt19937 rng(1);
+  for (int32_t i = 0; i < n; ++i)
+    keys.emplace_back(static_cast<int32_t>(std::min(rng() % 2000, rng() % 2000)));
+  return keys;
+}
+
+/**
+ * @brief Update from one thread while another reads, then compare the last
+ * view with the live sketch
+ *
+ * @param read    called repeatedly by the reader, concurrently with updates
+ * @param check   called with the snapshot once updates are done
+ */
+template <typename Snap, typename Read, typename Check>
+void RunSnapshot(Snap &snap, Read read, Check check) {
+  const auto keys = SkewedKeys(200000);
+  std::atomic<bool> done(false);
+  std::atomic<int64_t> reads(0);
+  std::thread reader([&]() {
+    while (!done.load()) {
+      read(snap);
+      reads++;
+    }
+  });
+  for (size_t i = 0; i < keys.size(); ++i) {
+    // halfway, let the reader in, however threads are scheduled
+    if (i == keys.size() / 2) {
+      while (reads.load() == 0)
+        std::this_thread::yield();
+    }
+    snap.update(keys[i], 1);
+  }
+  done.store(true);
+  reader.join();
+  VERIFY(reads.load() > 0);
+  // no reader left, so it is published at once
+  VERIFY(snap.publish());
+  check(snap);
+}
+
+/**
+ * @brief Test Count Min and Count Sketch
+ *
+ */
+void TestCounters() {
+  using namespace OmniSketch;
+  Sketch::Snapshot<4, int32_t, Sketch::CMSketch<4, int32_t>> cm(1000, 3, 500);
+  // views only move forward, so estimates of Count Min never decrease
+  int32_t last = 0;
+  bool monotone = true;
+  RunSnapshot(
+      cm,
+      [&](const auto &snap) {
+        const int32_t est = snap.query(FlowKey<4>(0));
+        monotone = monotone && est >= last;
+        last = est;
+      },
+      [](auto &snap) {
+        for (int32_t key = 0; key < 2000; ++key)
+          VERIFY(snap.query(FlowKey<4>(key)) ==
+                 snap.base().query(FlowKey<4>(key)));
+      });
+  VERIFY(monotone);
+
+  Sketch::Snapshot<4, int32_t, Sketch::CountSketch<4, int32_t>> cs(1000, 3,
+                                                                   500);
+  RunSnapshot(
+      cs,
+      [](const auto &snap) {
+        std::vector<FlowKey<4>> keys{FlowKey<4>(0), FlowKey<4>(1)};
+        int32_t out[2];
+        snap.queryBatch(keys.data(), out, 2, 2);
+      },
+      [](auto &snap) {
+        for (int32_t key = 0; key < 2000; ++key)
+          VERIFY(snap.query(FlowKey<4>(key)) ==
+                 snap.base().query(FlowKey<4>(key)));
+      });
+}
+
+/**
+ * @brief Test heavy hitters of Elastic Sketch and Heavy Keeper
+ *
+ */
+void TestHeavyHitter() {
+  using namespace OmniSketch;
+  auto same = [](const Data::Estimation<4, int32_t> &a,
+                 const Data::Estimation<4, int32_t> &b) {
+    if (a.size() != b.size())
+      return false;
+    for (const auto &kv : a)
+      if (!b.count(kv.get_left()) || b.at(kv.get_left()) != kv.get_right())
+        return false;
+    return true;
+  };
+  Sketch::Snapshot<4, int32_t, Sketch::ElasticSketch<4, int32_t>> es(
+      5000, 200, 8, 2, 500);
+  RunSnapshot(
+      es, [](const auto &snap) { snap.getHeavyHitter(100); },
+      [&](auto &snap) {
+        const auto hh = snap.getHeavyHitter(100);
+        VERIFY(hh.size() > 0);
+        VERIFY(same(hh, snap.base().getHeavyHitter(100)));
+      });
+
+  Sketch::Snapshot<4, int32_t, Sketch::HeavyKeeper<4, int32_t>> hk(
+      5000, 2, 500, 50, 1.08, 2.0);
+  RunSnapshot(
+      hk, [](const auto &snap) { snap.getHeavyHitter(100); },
+      [&](auto &snap) {
+        const auto hh = snap.getHeavyHitter(100);
+        VERIFY(hh.size() > 0);
+        VERIFY(same(hh, snap.base().getHeavyHitter(100)));
+      });
+}
+
+/**
+ * @brief Test invalid arguments
+ *
+ */
+void TestInvalid() {
+  using namespace OmniSketch;
+  try {
+    Sketch::Snapshot<4, int32_t, Sketch::CMSketch<4, int32_t>> cm(0, 3, 500);
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+  Sketch::CMSketch<4, int32_t> narrow(3, 100), wide(3, 200);
+  try {
+    narrow.copyFrom(wide);
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+}
+
+/**
+ * @brief Snapshot test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(snapshot) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestCounters();
+    TestHeavyHitter();
+    TestInvalid();
+  }
+}
+/** @endcond */
@@ -0,0 +1,248 @@
+/**
+ * @file test_source.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test records read as they come
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <chrono>
+#include <common/source.h>
+#include <common/test.h>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+/**
+ * @cond TEST
+ * @brief Format of 8-byte records, a flowkey followed by a length
+ *
+ */
+OmniSketch::Data::DataFormat Format() {
+  using std::string_view_literals::operator""sv;
+  static constexpr std::string_view input = R"(
+      name = [["flowkey", "length"], [4, 4]]
+  )"sv;
+  toml::table array = toml::parse(input);
+  return OmniSketch::Data::DataFormat(*array["name"].as_array());
+}
+
+/**
+ * @brief Bytes of `n` records, with `i` as both flowkey and length
+ *
+ */
+std::vector<int8_t> Bytes(int32_t n) {
+  std::vector<int8_t> bytes(n * 8);
+  for (int32_t i = 0; i < n; ++i) {
+    std::memcpy(bytes.data() + i * 8, &i, 4);
+    std::memcpy(bytes.data() + i * 8 + 4, &i, 4);
+  }
+  return bytes;
+}
+
+/**
+ * @brief Read all records, checking they come in order and in chunks of at
+ * most `chunk`
+ *
+ * @return number of records
+ */
+int32_t Drain(OmniSketch::Data::RecordSource<4> &source, int32_t chunk) {
+  int32_t i = 0;
+  while (const auto *records = source.next()) {
+    VERIFY(!records->empty() && records->size() <= size_t(chunk));
+    for (const auto &record : *records) {
+      VERIFY(record.flowkey == OmniSketch::FlowKey<4>(i));
+      VERIFY(record.length == i);
+      i++;
+    }
+  }
+  VERIFY(source.size() == i);
+  return i;
+}
+
+/**
+ * @brief Test records from a pipe, written in odd pieces with pauses
+ *
+ */
+void TestPipe() {
+  using namespace OmniSketch;
+  const auto bytes = Bytes(100000);
+  int fds[2];
+  VERIFY(::pipe(fds) == 0);
+  std::thread writer([&]() {
+    for (size_t i = 0, k = 0; i < bytes.size(); i += 1001, ++k) {
+      const size_t len = std::min<size_t>(1001, bytes.size() - i);
+      VERIFY(::write(fds[1], bytes.data() + i, len) == ssize_t(len));
+      if (k % 100 == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // and an incomplete record, which is dropped
+    VERIFY(::write(fds[1], bytes.data(), 3) == 3);
+    ::close(fds[1]);
+  });
+  {
+    Data::RecordSource<4> source(fds[0], Format(), 500);
+    VERIFY(Drain(source, 500) == 100000);
+  }
+  writer.join();
+  ::close(fds[0]);
+}
+
+/**
+ * @brief Test records from a file, with a queue of various depths
+ *
+ */
+void TestFile() {
+  using namespace OmniSketch;
+  const std::string path =
+      "/tmp/omnisketch_test_source_" + std::to_string(::getpid()) + ".bin";
+  const auto bytes = Bytes(100000);
+  std::ofstream(path, std::ios::binary)
+      .write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+  for (int32_t depth : {1, 2, 8}) {
+    Data::RecordSource<4> source(path, Format(), 4096, depth);
+    VERIFY(source.succeed());
+    VERIFY(Drain(source, 4096) == 100000);
+    // and it stays over
+    VERIFY(source.next() == nullptr);
+  }
+  ::unlink(path.c_str());
+
+  Data::RecordSource<4> missing(path, Format());
+  VERIFY(!missing.succeed());
+  VERIFY(missing.next() == nullptr);
+}
+
+/**
+ * @brief Test stopping on a quiet pipe, as well as leaving records unread
+ *
+ */
+void TestStop() {
+  using namespace OmniSketch;
+  const auto bytes = Bytes(10);
+  for (int32_t chunk : {1, 4096}) {
+    int fds[2];
+    VERIFY(::pipe(fds) == 0);
+    {
+      Data::RecordSource<4> source(fds[0], Format(), chunk);
+      VERIFY(::write(fds[1], bytes.data(), bytes.size()) == 80);
+      // records come while the pipe is still open
+      const auto *records = source.next();
+      VERIFY(records != nullptr && records->front().length == 0);
+      // and nothing more, until stopped
+      if (chunk == 4096) {
+        int32_t i = records->size();
+        while (i < 10 && (records = source.next()))
+          i += records->size();
+        VERIFY(i == 10);
+        std::thread stopper([&]() {
+          std::this_thread::sleep_for(std::chrono::milliseconds(50));
+          source.stop();
+        });
+        VERIFY(source.next() == nullptr);
+        stopper.join();
+      }
+      // otherwise records are left unread
+    }
+    ::close(fds[1]);
+    ::close(fds[0]);
+  }
+}
+
+/**
+ * @brief Test invalid arguments
+ *
+ */
+void TestInvalid() {
+  using namespace OmniSketch;
+  try {
+    Data::RecordSource<4> source(STDIN_FILENO, Format(), 0);
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+  try {
+    Data::RecordSource<8> source(STDIN_FILENO, Format());
+    SET_FAILURE_FLAG;
+  } catch (const std::runtime_error &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+}
+
+/**
+ * @brief A sketch that counts and sums the values it is updated with
+ *
+ */
+class SumSketch : public OmniSketch::Sketch::SketchBase<4, int32_t> {
+public:
+  int64_t num_updates = 0;
+  int64_t sum = 0;
+  size_t size() const override { return sizeof(*this); }
+  void update(const OmniSketch::FlowKey<4> &flowkey, int32_t val) override {
+    num_updates++;
+    sum += val;
+  }
+};
+
+/**
+ * @brief Test updating a sketch from a pipe by the harness
+ *
+ */
+void TestUpdateStream() {
+  using namespace OmniSketch;
+  const auto bytes = Bytes(100000);
+  int fds[2];
+  VERIFY(::pipe(fds) == 0);
+  std::thread writer([&]() {
+    for (size_t i = 0; i < bytes.size(); i += 1001) {
+      const size_t len = std::min<size_t>(1001, bytes.size() - i);
+      VERIFY(::write(fds[1], bytes.data() + i, len) == ssize_t(len));
+    }
+    ::close(fds[1]);
+  });
+  Test::TestBase<4, int32_t> test("Stream", "test_sketch.toml",
+                                  "XXX.tmp.test");
+  std::unique_ptr<Sketch::SketchBase<4, int32_t>> ptr(new SumSketch);
+  {
+    Data::RecordSource<4> source(fds[0], Format(), 500);
+    VERIFY(test.testUpdateStream(ptr, source, Data::InLength, 1) == 100000);
+  }
+  writer.join();
+  ::close(fds[0]);
+  // each record once, with its length
+  const auto *sketch = static_cast<const SumSketch *>(ptr.get());
+  VERIFY(sketch->num_updates == 100000);
+  VERIFY(sketch->sum == int64_t(99999) * 100000 / 2);
+
+  // and the rate is shown
+  Test::Row row;
+  Test::RowSink() = [&row](std::string_view, const Test::Row &shown) {
+    row = shown;
+  };
+  test.show();
+  Test::RowSink() = nullptr;
+  bool has_rate = false;
+  for (const auto &[name, value] : row) {
+    if (name == "Update.RATE") {
+      has_rate = true;
+      VERIFY(std::stod(value) > 0.0);
+    }
+  }
+  VERIFY(has_rate);
+}
+
+/**
+ * @brief Source test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(source) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestPipe();
+    TestFile();
+    TestStop();
+    TestUpdateStream();
+    TestInvalid();
+  }
+}
+/** @endcond */
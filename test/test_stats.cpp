@@ -0,0 +1,100 @@
+/**
+ * @file test_stats.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test statistics of sketches
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <common/stats.h>
+#include <sketch/HashPipe.h>
+#include <sstream>
+#include <thread>
+
+/**
+ * @cond TEST
+ * @brief Test recording and writing statistics
+ *
+ */
+void TestRecord() {
+  using OmniSketch::Util::Stats;
+  Stats::clear();
+  VERIFY(Stats::all().empty());
+
+  try {
+    Stats::add("CH", "decodes", 1);
+    Stats::add("CH", "decodes", 2);
+    Stats::set("CH", "overflow_rate", 0.5);
+    Stats::set("CH", "overflow_rate", 0.25);
+    Stats::hist("CH", "carries", 2, 3);
+    Stats::hist("CH", "carries", 0);
+    Stats::set("HashPipe", "evictions", 7);
+  } catch (const std::exception &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+  const auto &ch = Stats::all().at("CH");
+  VERIFY(ch.at("decodes").count == 3);
+  VERIFY(ch.at("overflow_rate").value == 0.25);
+  VERIFY(ch.at("carries").bins == std::vector<int64_t>({1, 0, 3}));
+
+  // a name is bound to its kind
+  try {
+    Stats::set("CH", "decodes", 1.0);
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+
+  std::ostringstream json, csv;
+  Stats::writeJson(json);
+  Stats::writeCsv(csv);
+  VERIFY(json.str() == "{\"CH\": {\"carries\": [1, 0, 3], \"decodes\": 3, "
+                       "\"overflow_rate\": 0.25}, \"HashPipe\": "
+                       "{\"evictions\": 7}}\n");
+  VERIFY(csv.str() == "Scope,Name,Bin,Value\n"
+                      "CH,carries,0,1\nCH,carries,1,0\nCH,carries,2,3\n"
+                      "CH,decodes,,3\nCH,overflow_rate,,0.25\n"
+                      "HashPipe,evictions,,7\n");
+
+  // statistics are per thread
+  std::thread([]() {
+    VERIFY(Stats::all().empty());
+    Stats::add("CH", "decodes", 1);
+  }).join();
+  VERIFY(Stats::all().at("CH").at("decodes").count == 3);
+
+  Stats::clear();
+  VERIFY(Stats::all().empty());
+}
+
+/**
+ * @brief Test evictions reported by HashPipe
+ *
+ */
+void TestEvictions() {
+  using OmniSketch::Util::Stats;
+  Stats::clear();
+  // 20 distinct flowkeys through 2 stages of at most 2 slots
+  OmniSketch::Sketch::HashPipe<4, int32_t> hp(2, 2);
+  for (int32_t i = 1; i <= 20; ++i)
+    hp.update(OmniSketch::FlowKey<4>(i), 1);
+  hp.size();
+  VERIFY(Stats::all().at("HashPipe").at("evictions").value >= 16);
+  hp.clear();
+  hp.size();
+  VERIFY(Stats::all().at("HashPipe").at("evictions").value == 0);
+  Stats::clear();
+}
+
+/**
+ * @brief Statistics test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(stats) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestRecord();
+    TestEvictions();
+  }
+}
+/** @endcond */
@@ -0,0 +1,93 @@
+/**
+ * @file test_thread_pool.cpp
+ * @author XierLabber<yangshibo@stu.pku.edu.cn>
+ * @brief Test the thread pool
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <common/thread_pool.h>
+#include <stdexcept>
+
+/**
+ * @cond TEST
+ * @brief Test ThreadPool::submit()
+ *
+ */
+void TestSubmit() {
+  using OmniSketch::Util::ThreadPool;
+
+  ThreadPool pool(4);
+  std::vector<std::future<int64_t>> results;
+  for (int64_t i = 0; i < 100; ++i) {
+    results.push_back(pool.submit([i]() { return i * i; }));
+  }
+  for (int64_t i = 0; i < 100; ++i) {
+    VERIFY(results[i].get() == i * i);
+  }
+}
+
+/**
+ * @brief Test ThreadPool::parallelFor()
+ *
+ */
+void TestParallelFor() {
+  using OmniSketch::Util::ThreadPool;
+
+  ThreadPool pool(4);
+  // every index is visited exactly once, chunks are contiguous
+  std::vector<int32_t> visited(100003, 0);
+  pool.parallelFor(0, visited.size(), [&](int64_t lo, int64_t hi) {
+    VERIFY(lo < hi);
+    for (int64_t i = lo; i < hi; ++i)
+      visited[i]++;
+  });
+  VERIFY(std::all_of(visited.begin(), visited.end(),
+                     [](int32_t v) { return v == 1; }));
+
+  // fewer indices than workers, and empty ranges
+  int32_t sum = 0;
+  pool.parallelFor(0, 2, [&](int64_t lo, int64_t hi) {
+    for (int64_t i = lo; i < hi; ++i)
+      __atomic_add_fetch(&sum, 1, __ATOMIC_RELAXED);
+  });
+  VERIFY(sum == 2);
+  pool.parallelFor(5, 5, [&](int64_t, int64_t) { SET_FAILURE_FLAG; });
+
+  // nested calls run serially on the worker
+  std::vector<int32_t> nested(64, 0);
+  pool.parallelFor(0, 8, [&](int64_t lo, int64_t hi) {
+    for (int64_t i = lo; i < hi; ++i) {
+      pool.parallelFor(0, 8, [&](int64_t l, int64_t h) {
+        for (int64_t j = l; j < h; ++j)
+          nested[i * 8 + j]++;
+      });
+    }
+  });
+  VERIFY(std::all_of(nested.begin(), nested.end(),
+                     [](int32_t v) { return v == 1; }));
+
+  // exceptions are rethrown in the caller
+  try {
+    pool.parallelFor(0, 100, [&](int64_t lo, int64_t hi) {
+      if (hi == 100)
+        throw std::runtime_error("Thrown by the last chunk");
+    });
+    SET_FAILURE_FLAG;
+  } catch (const std::runtime_error &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+}
+
+/**
+ * @brief Thread pool test
+ *
+ */
+OMNISKETCH_DECLARE_TEST(thread_pool) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestSubmit();
+    TestParallelFor();
+  }
+}
+/** @endcond */